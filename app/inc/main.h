@@ -54,6 +54,10 @@
 		 */
 			/** @defgroup LIB_FATFS_DISKIO_SD SD Disk I/O */
 		/**@}LIB_FATFS_DISKIO*/
+
+		/** @defgroup LIB_FATFS_BLOCKDEV Block device arbitration */
+
+		/** @defgroup LIB_FATFS_EXFAT exFAT reader */
 	/**@}LIB_FATFS*/
 
 	/** @defgroup LIB_USBD USB Mass Storage Device */
@@ -109,14 +113,21 @@
  */
 
 /* Includes ------------------------------------------------------------------*/
+#include <malloc.h>			/* Heap statistics */
+#include <string.h>			/* Test buffers compare */
 #include "led.h"			/* BSP-LED APIs */
 #include "text.h"			/* LIB_TEXT APIs */
 #include "graphic.h"		/* LIB_GRAPHIC APIs */
 #include "ff.h"				/* FatFS APIs */
+#include "diskio.h"			/* FatFS Disk I/O APIs */
+#include "blockdev.h"		/* FatFS block device arbitration APIs */
 #include "audio_codec.h"	/* BSP_DRV_ACODEC APIs */
 #include "audio.h"			/* LIB_AUDIO APIs */
 #include "button.h"			/* BSP_DEVICE_BUTTON APIs */
 #include "usbd.h"			/* LIB_USBD API */
+#include "usbd_perf.h"		/* LIB_USBD_PERF APIs */
+#include "usbd_console.h"	/* LIB_USBD_CONSOLE APIs */
+#include "sd.h"				/* BSP_DRV_SD APIs */
 
 /* Exported types ------------------------------------------------------------*/
 /* Exported constants --------------------------------------------------------*/
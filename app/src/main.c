@@ -35,13 +35,31 @@
 #include "main.h"
 
 /* Private typedef -----------------------------------------------------------*/
+/**
+ * @typedef boot_stage_t
+ * This type define the milestones recorded in the boot timeline.
+ */
+typedef enum
+{
+	BOOT_STAGE_BSP = 0, /*!< Clocks, tick and board support ready */
+	BOOT_STAGE_USB, /*!< USB mass storage started, SD card identified */
+	BOOT_STAGE_GRAPHIC, /*!< Display ready */
+	BOOT_STAGE_AUDIO, /*!< Audio codec ready */
+	BOOT_STAGE_MOUNT, /*!< File system mounted */
+	BOOT_STAGE_NUMBER
+} boot_stage_t;
+
 /* Private define ------------------------------------------------------------*/
+#define FREE_SCAN_SECTORS	(2) /*!< FAT sectors counted by the free cluster scan per idle loop */
+
 /* Private macro -------------------------------------------------------------*/
 #define TESTING /*!< Enable this flag to active the testing functions. */
 
 /* Private variables ---------------------------------------------------------*/
 static FATFS g_fatfsSDCard;
 static char g_pcFsMountPoint[4] = "0:/";
+static uint32_t g_pui32BootTimeline[BOOT_STAGE_NUMBER]; /*!< HAL tick at the end of each boot stage */
+static DWORD g_pui32TestSectors[2][_MAX_SS / 4]; /*!< Data of the tests, which never run at the same time */
 #ifdef TESTING
 unsigned char pcHelloMP3[] = {
   0xFF,0xF2,0x40,0xC0,0x19,0xB7,0x00,0x14,0x02,0xE6,0x5C, /* ..@.......\ */
@@ -204,6 +222,219 @@ unsigned char pcHelloMP3[] = {
 
 /* Private function prototypes -----------------------------------------------*/
 #ifdef TESTING
+/**
+ * @brief  Serve the USB host while a test waits: the READ10/WRITE10/sync of
+ *         the USB interrupt are only run by blockdev_process() and the pending
+ *         host writes by diskio_flushIdleWrite(), as in the main loop.
+ * @retval None
+ */
+void _test_serveHost(void)
+{
+	blockdev_process(BLOCKDEV_PRIORITY_USB, BLOCKDEV_UNLIMITED);
+	diskio_flushIdleWrite();
+	graphic_process();
+}
+
+/**
+ * @brief  Wait for a delay while the USB host and the display are served.
+ * @param  ui32Delay: Delay in millisecond.
+ * @retval None
+ */
+void _test_delay_ms(uint32_t ui32Delay)
+{
+	uint32_t ui32Start = HAL_GetTick();
+
+	do
+	{
+		_test_serveHost();
+	} while ((HAL_GetTick() - ui32Start) < ui32Delay);
+}
+
+/**
+ * @brief  Benchmark the data block CRC16 against the raw block read.
+ * @note   Expectation:
+ * 			@arg LCD report the CPU cycles to compute the CRC16 of one block.
+ * 			@arg LCD report the CPU cycles to read one block from the card
+ * 			(including its CRC check when SD_CRC_CHECK is enabled).
+ * 			@arg LCD report the CRC cost in per mille of the block read, and the
+ * 			number of CRC errors detected so far.
+ * @retval None
+ */
+void test_BenchmarkCRC(void)
+{
+#define CRC_BENCHMARK_BLOCKS	(64)
+	uint32_t *pui32Block = (uint32_t *) g_pui32TestSectors[0];
+	sd_crc_statistic_t crcStatistic;
+	uint32_t ui32CrcCycles;
+	uint32_t ui32ReadCycles;
+	uint32_t ui32Block;
+	volatile uint16_t ui16Crc = 0;
+
+	/* Clear screen  */
+	graphic_clearRenderBuffer();
+	graphic_render();
+	text_setWrapText(false);
+	text_setCursor(0, 0);
+	text_setTextSize(1);
+
+	/* Enable the DWT cycle counter */
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	if (!sd_readBlocks(pui32Block, 0, 1))
+	{
+		text_putString("read failed\n", FAST);
+		return;
+	}
+
+	/* CRC kernel alone */
+	ui32CrcCycles = DWT->CYCCNT;
+	for (ui32Block = 0; CRC_BENCHMARK_BLOCKS > ui32Block; ui32Block++)
+	{
+		ui16Crc ^= sd_computeCRC16((uint8_t *) pui32Block, SD_BLOCK_SIZE);
+	}
+	ui32CrcCycles = (DWT->CYCCNT - ui32CrcCycles) / CRC_BENCHMARK_BLOCKS;
+
+	/* Block read through the driver */
+	ui32ReadCycles = DWT->CYCCNT;
+	for (ui32Block = 0; CRC_BENCHMARK_BLOCKS > ui32Block; ui32Block++)
+	{
+		sd_readBlocks(pui32Block, ui32Block, 1);
+	}
+	ui32ReadCycles = (DWT->CYCCNT - ui32ReadCycles) / CRC_BENCHMARK_BLOCKS;
+
+	sd_getCrcStatistic(&crcStatistic);
+	text_printString("crc:");
+	text_printNumber(ui32CrcCycles);
+	text_printString("cyc\nread:");
+	text_printNumber(ui32ReadCycles);
+	text_printString("cyc\ncost:");
+	text_printNumber((ui32CrcCycles * 1000) / ui32ReadCycles);
+	text_printString("/1000\nerr:");
+	text_printNumber(crcStatistic.ui32ReadErrors + crcStatistic.ui32WriteErrors);
+	text_printString("/");
+	text_printNumber(crcStatistic.ui32Failures);
+	text_printString("\n");
+	graphic_render();
+	_test_delay_ms(3000);
+}
+
+/**
+ * @brief  Test the card geometry decoding with recorded CSD and OCR registers.
+ * @note   Expectation:
+ * 			@arg LCD report OK for the SDSC card (CSD Version 1.0, byte addressing).
+ * 			@arg LCD report OK for the SDHC and SDXC cards (CSD Version 2.0,
+ * 			block addressing), the SDXC one above the 32-bit byte capacity.
+ * 			@arg LCD report OK for a CSD Version 2.0 read with CCS = 0, which
+ * 			must be addressed by byte as a standard capacity card.
+ * @retval None
+ */
+void test_SDCardGeometry(void)
+{
+	static const struct
+	{
+		const char *pcName;
+		uint8_t pui8Csd[16]; /* MSB first, as received after the CMD9 data token */
+		uint32_t ui32Ocr; /* CMD58 response once the card is ready */
+		sd_card_type_t eCardType;
+		bool bBlockAddressing;
+		uint32_t ui32BlockNumber;
+	} pFixture[] =
+	{
+	/* 2GB SDSC: C_SIZE 3771, C_SIZE_MULT 7, READ_BL_LEN 10 */
+	{ "sdsc:", { 0x00, 0x26, 0x00, 0x32, 0x5F, 0x5A, 0x83, 0xAE, 0xFE, 0xFB,
+			0xCF, 0xFF, 0x92, 0x80, 0x40, 0xDF }, 0x80FF8000, SD_CARD_SDSC,
+			false, 3862528 },
+	/* 8GB SDHC: C_SIZE 0x3B37 */
+	{ "sdhc:", { 0x40, 0x0E, 0x00, 0x32, 0x5B, 0x59, 0x00, 0x00, 0x3B, 0x37,
+			0x7F, 0x80, 0x0A, 0x40, 0x40, 0xAF }, 0xC0FF8000, SD_CARD_SDHC,
+			true, 15523840 },
+	/* 64GB SDXC: C_SIZE 0x1D97F */
+	{ "sdxc:", { 0x40, 0x0E, 0x00, 0x32, 0x5B, 0x59, 0x00, 0x01, 0xD9, 0x7F,
+			0x7F, 0x80, 0x0A, 0x40, 0x00, 0x63 }, 0xC0FF8000, SD_CARD_SDXC,
+			true, 124125184 },
+	/* SDHC register with the CCS bit cleared */
+	{ "ccs0:", { 0x40, 0x0E, 0x00, 0x32, 0x5B, 0x59, 0x00, 0x00, 0x3B, 0x37,
+			0x7F, 0x80, 0x0A, 0x40, 0x40, 0xAF }, 0x80FF8000, SD_CARD_SDSC,
+			false, 15523840 } };
+	sd_card_info_t cardInfo;
+	uint32_t ui32Fixture;
+
+	/* Clear screen  */
+	graphic_clearRenderBuffer();
+	graphic_render();
+	text_setWrapText(false);
+	text_setCursor(0, 0);
+	text_setTextSize(1);
+
+	for (ui32Fixture = 0; (sizeof(pFixture) / sizeof(pFixture[0])) > ui32Fixture;
+			ui32Fixture++)
+	{
+		sd_decodeCardInfo(pFixture[ui32Fixture].pui8Csd,
+				pFixture[ui32Fixture].ui32Ocr, &cardInfo);
+		text_printString(pFixture[ui32Fixture].pcName);
+		if ((pFixture[ui32Fixture].eCardType == cardInfo.CardType)
+				&& (pFixture[ui32Fixture].bBlockAddressing
+						== cardInfo.CardBlockAddressing)
+				&& (pFixture[ui32Fixture].ui32BlockNumber
+						== cardInfo.CardBlockNumber)
+				&& ((uint64_t) pFixture[ui32Fixture].ui32BlockNumber
+						* SD_BLOCK_SIZE == cardInfo.CardCapacity))
+		{
+			text_printString("OK\n");
+		}
+		else
+		{
+			text_printNumber(cardInfo.CardBlockNumber);
+			text_printString(" Bad!!!\n");
+		}
+	}
+	graphic_render();
+	_test_delay_ms(3000);
+}
+
+/**
+ * @brief  Test the boot timeline and the SD card initialization.
+ * @note   Expectation:
+ * 			@arg LCD report the tick (ms) at the end of each boot stage.
+ * 			@arg LCD report the SD init time, the number of ACMD41 polls
+ * 			and the SPI clock (kHz) used for data transfer.
+ * @retval None
+ */
+void test_BootTimeline(void)
+{
+	static const char *ppcStageName[BOOT_STAGE_NUMBER] =
+	{ "bsp:", "usb:", "lcd:", "aud:", "fs:" };
+	sd_init_statistic_t initStatistic;
+	uint32_t ui32Stage;
+
+	/* Clear screen  */
+	graphic_clearRenderBuffer();
+	graphic_render();
+	text_setWrapText(false);
+	text_setCursor(0, 0);
+	text_setTextSize(1);
+
+	for (ui32Stage = 0; BOOT_STAGE_NUMBER > ui32Stage; ui32Stage++)
+	{
+		text_printString(ppcStageName[ui32Stage]);
+		text_printNumber(g_pui32BootTimeline[ui32Stage]);
+		text_printString("ms\n");
+	}
+
+	sd_getInitStatistic(&initStatistic);
+	text_printString("sd:");
+	text_printNumber(initStatistic.ui32InitTimeMs);
+	text_printString("ms/");
+	text_printNumber(initStatistic.ui32ReadyPolls);
+	text_printString("\nclk:");
+	text_printNumber(initStatistic.ui32ClockHz / 1000);
+	text_printString("kHz\n");
+	graphic_render();
+	_test_delay_ms(3000);
+}
+
 /**
  * @brief  Test the display driver.
  * @note   Expectation:
@@ -236,55 +467,55 @@ void test_DisplayDriver(void)
 {
 	display_render_logo();
 	display_setDim(false);
-	display_delay_ms(1000);
+	_test_delay_ms(1000);
 	display_setDim(true);
-	display_delay_ms(1000);
+	_test_delay_ms(1000);
 	display_turnOff();
-	display_delay_ms(1000);
+	_test_delay_ms(1000);
 	display_turnOn();
-	display_delay_ms(1000);
+	_test_delay_ms(1000);
 	display_setInvertMode();
-	display_delay_ms(1000);
+	_test_delay_ms(1000);
 	display_setNormalMode();
 	display_scrollLeft(DISP_PAGE_0, DISP_PAGE_3);
-	display_delay_ms(1000);
+	_test_delay_ms(1000);
 	display_scrollRight(DISP_PAGE_0, DISP_PAGE_3);
-	display_delay_ms(1000);
+	_test_delay_ms(1000);
 	display_scrollDiagLeft(DISP_PAGE_0, DISP_PAGE_3);
-	display_delay_ms(1000);
+	_test_delay_ms(1000);
 	display_scrollDiagRight(DISP_PAGE_0, DISP_PAGE_3);
-	display_delay_ms(1000);
+	_test_delay_ms(1000);
 	display_scrollStop();
-	display_delay_ms(1000);
+	_test_delay_ms(1000);
 	display_render_logo();
 	display_scrollLeft(DISP_PAGE_1, DISP_PAGE_2);
-	display_delay_ms(1000);
+	_test_delay_ms(1000);
 	display_render_logo();
 	display_scrollRight(DISP_PAGE_3, DISP_PAGE_3);
-	display_delay_ms(1000);
+	_test_delay_ms(1000);
 	display_render_logo();
 	display_scrollDiagLeft(DISP_PAGE_2, DISP_PAGE_3);
-	display_delay_ms(3000);
+	_test_delay_ms(3000);
 	display_render_logo();
 	display_scrollDiagRight(DISP_PAGE_0, DISP_PAGE_1);
-	display_delay_ms(3000);
+	_test_delay_ms(3000);
 	display_render_logo();
 	display_scrollUp(SCROLL_BY_2FPS);
-	display_delay_ms(3000);
+	_test_delay_ms(3000);
 	display_scrollUp(SCROLL_BY_3FPS);
-	display_delay_ms(3000);
+	_test_delay_ms(3000);
 	display_scrollUp(SCROLL_BY_4FPS);
-	display_delay_ms(3000);
+	_test_delay_ms(3000);
 	display_scrollUp(SCROLL_BY_5FPS);
-	display_delay_ms(3000);
+	_test_delay_ms(3000);
 	display_scrollUp(SCROLL_BY_25FPS);
-	display_delay_ms(3000);
+	_test_delay_ms(3000);
 	display_scrollUp(SCROLL_BY_64FPS);
-	display_delay_ms(3000);
+	_test_delay_ms(3000);
 	display_scrollUp(SCROLL_BY_128FPS);
-	display_delay_ms(3000);
+	_test_delay_ms(3000);
 	display_scrollUp(SCROLL_BY_256FPS);
-	display_delay_ms(3000);
+	_test_delay_ms(3000);
 	display_render_logo();
 	display_scrollStop();
 }
@@ -312,58 +543,58 @@ void test_GraphicLibrary(void)
 
 	graphic_drawPixel(0, 0, WHITE);
 	graphic_render();
-	graphic_delay_ms(1000);
+	_test_delay_ms(1000);
 
 	graphic_drawPixel(DISPLAY_WIDTH / 2, DISPLAY_HEIGHT / 2, WHITE);
 	graphic_render();
-	graphic_delay_ms(1000);
+	_test_delay_ms(1000);
 
 	graphic_drawPixel(DISPLAY_WIDTH - 1, DISPLAY_HEIGHT - 1, WHITE);
 	graphic_render();
-	graphic_delay_ms(1000);
+	_test_delay_ms(1000);
 
 	graphic_drawPixel(0, DISPLAY_HEIGHT - 1, WHITE);
 	graphic_render();
-	graphic_delay_ms(1000);
+	_test_delay_ms(1000);
 
 	graphic_drawPixel(DISPLAY_WIDTH - 1, 0, WHITE);
 	graphic_render();
-	graphic_delay_ms(1000);
+	_test_delay_ms(1000);
 
 	/* Normal-Boundary-Abnormal */
 	graphic_drawFastHLine(5, 5, DISPLAY_WIDTH / 2, WHITE);
 	graphic_render();
-	graphic_delay_ms(1000);
+	_test_delay_ms(1000);
 	graphic_drawFastHLine(-1, -4, DISPLAY_WIDTH / 2, WHITE);
 	graphic_render();
-	graphic_delay_ms(1000);
+	_test_delay_ms(1000);
 	graphic_drawFastHLine(-5, 7, DISPLAY_WIDTH / 2, WHITE);
 	graphic_render();
-	graphic_delay_ms(1000);
+	_test_delay_ms(1000);
 
 	/* Normal-Boundary-Abnormal */
 	graphic_drawFastVLine(DISPLAY_WIDTH / 2, 2, DISPLAY_HEIGHT * 2 / 3,
 			INVERSE);
 	graphic_render();
-	graphic_delay_ms(1000);
+	_test_delay_ms(1000);
 	graphic_drawFastVLine(DISPLAY_WIDTH / 2 + 1, 2, DISPLAY_HEIGHT, INVERSE);
 	graphic_render();
-	graphic_delay_ms(1000);
+	_test_delay_ms(1000);
 	graphic_drawFastVLine(DISPLAY_WIDTH / 2 + 2, -10, DISPLAY_HEIGHT, INVERSE);
 	graphic_render();
-	graphic_delay_ms(1000);
+	_test_delay_ms(1000);
 	graphic_drawFastVLine(DISPLAY_WIDTH / 2 + 3, -10, -3, INVERSE);
 	graphic_render();
-	graphic_delay_ms(1000);
+	_test_delay_ms(1000);
 
 	graphic_drawRect(2, 2, DISPLAY_WIDTH - 4, DISPLAY_HEIGHT - 4, WHITE);
 	graphic_render();
-	graphic_delay_ms(1000);
+	_test_delay_ms(1000);
 
 	graphic_fillRect(DISPLAY_WIDTH / 4, DISPLAY_HEIGHT / 4, DISPLAY_WIDTH / 2,
 	DISPLAY_HEIGHT / 2, INVERSE);
 	graphic_render();
-	graphic_delay_ms(1000);
+	_test_delay_ms(1000);
 }
 
 /**
@@ -382,29 +613,29 @@ void test_TextLibrary(void)
 	char *pcTestString = "Project Moon\n";
 	graphic_clearRenderBuffer();
 	graphic_render();
-	graphic_delay_ms(1000);
+	_test_delay_ms(1000);
 
 	text_setWrapText(true);
 	text_setCursor(1, 1);
 	text_setTextSize(2);
 	text_printString("abcdefghijklmnopqrstuvxyw\n");
 	graphic_render();
-	graphic_delay_ms(1000);
+	_test_delay_ms(1000);
 
 	text_setCursor(3, 3);
 	text_printString("0123456789\n");
 	graphic_render();
-	graphic_delay_ms(1000);
+	_test_delay_ms(1000);
 
 	text_setCursor(0, 5);
 	text_setTextSize(3);
 	text_printNumber(97531);
 	graphic_render();
-	graphic_delay_ms(1000);
+	_test_delay_ms(1000);
 
 	graphic_clearRenderBuffer();
 	graphic_render();
-	graphic_delay_ms(1000);
+	_test_delay_ms(1000);
 
 	text_setCursor(0, 2);
 	text_setTextSize(1);
@@ -491,7 +722,7 @@ void test_FatFileSystem(void)
 	f_close(&file);
 	text_putString("DONE\n", FAST);
 
-	graphic_delay_ms(1000);
+	_test_delay_ms(1000);
 	graphic_clearRenderBuffer();
 	text_setWrapText(true);
 	text_setCursor(0, 0);
@@ -522,7 +753,7 @@ void test_BenchmarkReadWriteFile(void)
 #define LOOP_TIMES	(3)
 #define WRITE_TIMES (10240) /* WRITE_TIME x 512 = 5MB */
 #define DUMMY_DATA_BLOCK_SIZE	(512)
-	static uint8_t pui8DummyDataBlock[DUMMY_DATA_BLOCK_SIZE];
+	uint8_t *pui8DummyDataBlock = (uint8_t *) g_pui32TestSectors[0];
 	pui8DummyDataBlock[0] = '1';
 	pui8DummyDataBlock[256] = '2';
 	pui8DummyDataBlock[511] = '3';
@@ -588,11 +819,585 @@ void test_BenchmarkReadWriteFile(void)
 		goto unmount;
 	}
 
+	/* Stream the file back: FAT sectors read from the card per MB */
+	diskio_cache_statistic_t cacheStatistic;
+	uint32_t ui32BytesRead = 0;
+	uint32_t ui32TotalRead = 0;
+	text_putString("Benchmark: READ\n", FAST);
+	if (f_open(&file, (TCHAR *)pcFileName, FA_READ) != FR_OK)
+	{
+		text_putString("open failed!!!\n", FAST);
+		goto unmount;
+	}
+	diskio_resetCacheStatistic();
+	ui32Tickstart = HAL_GetTick();
+	while ((f_read(&file, pui8DummyDataBlock, DUMMY_DATA_BLOCK_SIZE,
+			(UINT *) &ui32BytesRead) == FR_OK) && (0 != ui32BytesRead))
+	{
+		ui32TotalRead += ui32BytesRead;
+	}
+	ui32TimeInMs = HAL_GetTick() - ui32Tickstart;
+	f_close(&file);
+	diskio_getCacheStatistic(&cacheStatistic);
+	text_printNumber(ui32TotalRead / (ui32TimeInMs + 1));
+	text_printString("KB/s\nfat:");
+	text_printNumber(cacheStatistic.ui32FatMisses);
+	text_printString("/");
+	text_printNumber(cacheStatistic.ui32DataSectors / 2048);
+	text_printString("MB ra:");
+	text_printNumber(cacheStatistic.ui32FatReadAheadHits);
+	text_printString("\n");
+	graphic_render();
+
 unmount:
 	/* Unmount */
 	f_mount(NULL, (TCHAR const*) g_pcFsMountPoint, 0);
 }
 
+/**
+ * @brief  Format the SD card with the allocation unit aligned layout.
+ * @note   Expectation: the write benchmark on the stock formatted card, the new
+ * 			layout (sectors per cluster, data area offset in the AU) then the same
+ * 			benchmark on the device formatted card.
+ * 			All data of the card are lost: only built with TESTING_FORMAT.
+ * @retval None
+ */
+void test_FormatMedia(void)
+{
+	sd_card_info_t sdCardInfo;
+
+	/* Stock formatted card */
+	test_BenchmarkReadWriteFile();
+
+	/* Clear screen  */
+	graphic_clearRenderBuffer();
+	graphic_render();
+	text_setWrapText(false);
+	text_setCursor(0, 0);
+	text_setTextSize(1);
+
+	/* Work area must be registered before formatting */
+	if ((f_mount(&g_fatfsSDCard, (TCHAR const*) g_pcFsMountPoint, 0) != FR_OK)
+			|| !sd_getCardInfo(&sdCardInfo))
+	{
+		text_putString("mount failed\n", FAST);
+		return;
+	}
+
+	text_putString("Format: ", FAST);
+	if (f_mkfs_media((TCHAR const*) g_pcFsMountPoint) != FR_OK)
+	{
+		text_putString("failed\n", FAST);
+		goto unmount;
+	}
+	text_putString("DONE\n", FAST);
+
+	/* Remount to read the new layout */
+	f_mount(&g_fatfsSDCard, (TCHAR const*) g_pcFsMountPoint, 1);
+	text_printString("AU:");
+	text_printNumber(sdCardInfo.CardAllocationUnit);
+	text_printString(" clus:");
+	text_printNumber(g_fatfsSDCard.csize);
+	text_printString("\ndata%AU:");
+	text_printNumber((0 == sdCardInfo.CardAllocationUnit) ? (0) :
+			(g_fatfsSDCard.database % sdCardInfo.CardAllocationUnit));
+	text_printString("\n");
+	graphic_render();
+	_test_delay_ms(2000);
+
+unmount:
+	/* Unmount */
+	f_mount(NULL, (TCHAR const*) g_pcFsMountPoint, 0);
+
+	/* Device formatted card */
+	test_BenchmarkReadWriteFile();
+}
+
+/**
+ * @brief  Benchmark writing on erased (trimmed) and not erased space.
+ * @note   Expectation: Write speed in KB/s when overwriting the clusters of a file
+ * 			in place, before and after these clusters are erased by CTRL_TRIM.
+ * @retval None
+ */
+void test_BenchmarkTrimmedWrite(void)
+{
+#define TRIM_WRITE_TIMES	(4096) /* TRIM_WRITE_TIMES x 512 = 2MB */
+#define TRIM_LINKMAP_SIZE	(32) /* Fragments of the file * 2 + 1 */
+	uint8_t *pui8DummyDataBlock = (uint8_t *) g_pui32TestSectors[0];
+	DWORD pui32LinkMap[TRIM_LINKMAP_SIZE];
+	DWORD pui32Range[2];
+	DWORD *pui32Fragment;
+	uint32_t ui32Tickstart;
+	uint32_t ui32TimeInMs;
+	uint32_t byteswritten;
+	int iWriteTimes;
+	int iTestTimes;
+	FIL file;
+
+	/* Clear screen  */
+	graphic_clearRenderBuffer();
+	graphic_render();
+	text_setWrapText(false);
+	text_setCursor(0, 0);
+	text_setTextSize(1);
+
+	/* Mount */
+	if (f_mount(&g_fatfsSDCard, (TCHAR const*) g_pcFsMountPoint, 0) != FR_OK)
+	{
+		text_putString("mount failed\n", FAST);
+		return;
+	}
+
+	/* Allocate the clusters once, both passes overwrite them in place */
+	text_putString("Benchmark: TRIM\n", FAST);
+	if (f_open(&file, "W-TRIM", FA_CREATE_ALWAYS | FA_WRITE) != FR_OK)
+	{
+		text_putString("open failed!!!\n", FAST);
+		goto unmount;
+	}
+	for (iWriteTimes = TRIM_WRITE_TIMES; iWriteTimes > 0; iWriteTimes--)
+	{
+		f_write(&file, pui8DummyDataBlock, DUMMY_DATA_BLOCK_SIZE, (void *)&byteswritten);
+	}
+	f_sync(&file);
+
+	for (iTestTimes = 0; iTestTimes < 2; iTestTimes++)
+	{
+		if (1 == iTestTimes)
+		{
+			/* Erase every fragment of the file: [size, (count, cluster)..., 0] */
+			file.cltbl = pui32LinkMap;
+			pui32LinkMap[0] = TRIM_LINKMAP_SIZE;
+			if (f_lseek(&file, CREATE_LINKMAP) != FR_OK)
+			{
+				text_putString("linkmap failed\n", FAST);
+				break;
+			}
+			file.cltbl = NULL;
+			for (pui32Fragment = &pui32LinkMap[1]; 0 != pui32Fragment[0]; pui32Fragment += 2)
+			{
+				pui32Range[0] = g_fatfsSDCard.database
+						+ ((pui32Fragment[1] - 2) * g_fatfsSDCard.csize);
+				pui32Range[1] = pui32Range[0]
+						+ (pui32Fragment[0] * g_fatfsSDCard.csize) - 1;
+				disk_ioctl(g_fatfsSDCard.drv, CTRL_TRIM, pui32Range);
+			}
+		}
+
+		f_lseek(&file, 0);
+		ui32Tickstart = HAL_GetTick();
+		for (iWriteTimes = TRIM_WRITE_TIMES; iWriteTimes > 0; iWriteTimes--)
+		{
+			if ((f_write(&file, pui8DummyDataBlock, DUMMY_DATA_BLOCK_SIZE, (void *)&byteswritten) != FR_OK)
+					|| (byteswritten == 0))
+			{
+				break;
+			}
+		}
+		f_sync(&file);
+		ui32TimeInMs = HAL_GetTick() - ui32Tickstart;
+		text_printString((0 == iTestTimes) ? ("raw:") : ("trim:"));
+		text_printNumber((uint32_t)(((TRIM_WRITE_TIMES * 512 * 125 /*1000*/) / (128/*1024*/ * ui32TimeInMs))));
+		text_printString("KB/s\n");
+		graphic_render();
+	}
+
+	/* Close file */
+	if (f_close(&file) != FR_OK )
+	{
+		text_putString("close failed\n", FAST);
+	}
+
+unmount:
+	/* Unmount */
+	f_mount(NULL, (TCHAR const*) g_pcFsMountPoint, 0);
+}
+
+#if _USE_WRITE_COMBINE == 1
+/**
+ * @brief  Fill a sector with the stamp of the trace step which writes it.
+ * @param  pui32Sector: sector buffer
+ * @param  ui32Step: trace step, 0 for a sector never written by the trace
+ * @param  ui32Offset: sector offset in the trace window
+ * @retval None
+ */
+void _test_stampSector(DWORD *pui32Sector, uint32_t ui32Step,
+		uint32_t ui32Offset)
+{
+	uint32_t ui32Word;
+	for (ui32Word = 0; (_MAX_SS / 4) > ui32Word; ui32Word++)
+	{
+		pui32Sector[ui32Word] = (0 == ui32Step) ? (0) :
+				((ui32Step << 24) | (ui32Offset << 16) | ui32Word);
+	}
+}
+
+/**
+ * @brief  Replay a write sequence through the disk I/O write combining.
+ * @note   The sequence is the one of a file appended by f_write and f_sync: data
+ * 			sectors written one or two at a time, the FAT and the directory
+ * 			sectors updated on sync, a partial data sector written again, a read of
+ * 			a pending sector. It is replayed in the sectors of a scratch file.
+ * 			Expectation:
+ * 			@arg LCD report the number of multi-block write commands reaching the
+ * 			card after each step, and stops at the first step which differs.
+ * 			@arg LCD report OK when every sector of the window holds the data of
+ * 			the last step which wrote it (zero if never written).
+ * @retval None
+ */
+void test_DiskWriteCombine(void)
+{
+#define TRACE_WINDOW_SECTORS	(16)
+#define TRACE_WRITE	(0)
+#define TRACE_READ	(1)
+#define TRACE_SYNC	(2)
+	static const struct
+	{
+		uint8_t ui8Operation;
+		uint8_t ui8Offset; /* First sector in the window */
+		uint8_t ui8Count; /* Number of sectors, at most 2 */
+		uint8_t ui8Commands; /* Write commands sent to the card once the step is done */
+	} pTrace[] =
+	{
+	{ TRACE_WRITE, 4, 1, 0 }, /* 1: data, pending 4 */
+	{ TRACE_WRITE, 5, 1, 0 }, /* 2: data, pending 4..5 */
+	{ TRACE_WRITE, 6, 2, 1 }, /* 3: data, 4..7 fill the buffer: one CMD25 */
+	{ TRACE_WRITE, 8, 1, 1 }, /* 4: data, pending 8 */
+	{ TRACE_WRITE, 0, 1, 2 }, /* 5: FAT on sync, 8 written */
+	{ TRACE_WRITE, 2, 1, 3 }, /* 6: directory on sync, 0 written */
+	{ TRACE_WRITE, 8, 1, 4 }, /* 7: partial sector again, 2 written */
+	{ TRACE_WRITE, 9, 2, 4 }, /* 8: data, pending 8..10 */
+	{ TRACE_WRITE, 11, 2, 5 }, /* 9: no room, 8..10 written */
+	{ TRACE_READ, 12, 1, 6 }, /* 10: read of a pending sector, 11..12 written */
+	{ TRACE_WRITE, 13, 1, 6 }, /* 11: data, pending 13 */
+	{ TRACE_SYNC, 0, 0, 7 }, /* 12: CTRL_SYNC, 13 written */
+	{ TRACE_SYNC, 0, 0, 7 } /* 13: nothing pending */
+	};
+	DWORD (*pui32TraceData)[_MAX_SS / 4] = g_pui32TestSectors;
+	uint8_t pui8LastStep[TRACE_WINDOW_SECTORS] = { 0 }; /* Last step which wrote each sector */
+	DWORD pui32LinkMap[4]; /* [size, count, cluster, 0]: one fragment only */
+	DWORD ui32WindowSector;
+	sd_latency_statistic_t readLatency;
+	sd_latency_statistic_t writeLatency;
+	uint32_t ui32BaseCommands;
+	uint32_t ui32Step;
+	uint32_t ui32Sector;
+	uint32_t ui32Offset;
+	uint32_t byteswritten;
+	bool bPassed = true;
+	FIL file;
+
+	/* Clear screen  */
+	graphic_clearRenderBuffer();
+	graphic_render();
+	text_setWrapText(false);
+	text_setCursor(0, 0);
+	text_setTextSize(1);
+
+	/* Mount */
+	if (f_mount(&g_fatfsSDCard, (TCHAR const*) g_pcFsMountPoint, 0) != FR_OK)
+	{
+		text_putString("mount failed\n", FAST);
+		return;
+	}
+
+	/* Scratch file of zeroed sectors, its sectors must be consecutive */
+	text_putString("Replay: MERGE\n", FAST);
+	memset(g_pui32TestSectors, 0, sizeof(g_pui32TestSectors));
+	if (f_open(&file, "W-TRACE", FA_CREATE_ALWAYS | FA_WRITE) != FR_OK)
+	{
+		text_putString("open failed!!!\n", FAST);
+		goto unmount;
+	}
+	for (ui32Sector = 0; TRACE_WINDOW_SECTORS > ui32Sector; ui32Sector++)
+	{
+		f_write(&file, pui32TraceData[0], _MAX_SS, (void *)&byteswritten);
+	}
+	f_sync(&file);
+	file.cltbl = pui32LinkMap;
+	pui32LinkMap[0] = sizeof(pui32LinkMap) / sizeof(pui32LinkMap[0]);
+	if (f_lseek(&file, CREATE_LINKMAP) != FR_OK)
+	{
+		text_putString("fragmented\n", FAST);
+		f_close(&file);
+		goto unmount;
+	}
+	file.cltbl = NULL;
+	f_close(&file);
+	ui32WindowSector = g_fatfsSDCard.database
+			+ ((pui32LinkMap[2] - 2) * g_fatfsSDCard.csize);
+
+	/* Replay, counting the commands which reach the card */
+	sd_getLatencyStatistic(&readLatency, &writeLatency);
+	ui32BaseCommands = writeLatency.ui32Commands;
+	for (ui32Step = 0; (sizeof(pTrace) / sizeof(pTrace[0])) > ui32Step; ui32Step++)
+	{
+		switch (pTrace[ui32Step].ui8Operation)
+		{
+		case TRACE_WRITE:
+			for (ui32Sector = 0; pTrace[ui32Step].ui8Count > ui32Sector; ui32Sector++)
+			{
+				ui32Offset = pTrace[ui32Step].ui8Offset + ui32Sector;
+				_test_stampSector(pui32TraceData[ui32Sector], ui32Step + 1,
+						ui32Offset);
+				pui8LastStep[ui32Offset] = ui32Step + 1;
+			}
+			bPassed = (RES_OK == disk_write(g_fatfsSDCard.drv,
+					(const BYTE *) pui32TraceData,
+					ui32WindowSector + pTrace[ui32Step].ui8Offset,
+					pTrace[ui32Step].ui8Count));
+			break;
+
+		case TRACE_READ:
+			/* The sector read back holds the last data written */
+			ui32Offset = pTrace[ui32Step].ui8Offset;
+			bPassed = (RES_OK == disk_read(g_fatfsSDCard.drv,
+					(BYTE *) pui32TraceData[0], ui32WindowSector + ui32Offset, 1));
+			_test_stampSector(pui32TraceData[1], pui8LastStep[ui32Offset],
+					ui32Offset);
+			bPassed = bPassed && (0 == memcmp(pui32TraceData[0],
+					pui32TraceData[1], _MAX_SS));
+			break;
+
+		default:
+			bPassed = (RES_OK == disk_ioctl(g_fatfsSDCard.drv, CTRL_SYNC, NULL));
+			break;
+		}
+
+		sd_getLatencyStatistic(&readLatency, &writeLatency);
+		if (!bPassed || (pTrace[ui32Step].ui8Commands
+				!= (writeLatency.ui32Commands - ui32BaseCommands)))
+		{
+			text_printString("step ");
+			text_printNumber(ui32Step + 1);
+			text_printString(": ");
+			text_printNumber(writeLatency.ui32Commands - ui32BaseCommands);
+			text_printString(" Bad!!!\n");
+			bPassed = false;
+			break;
+		}
+	}
+	if (bPassed)
+	{
+		text_printString("cmd: ");
+		text_printNumber(writeLatency.ui32Commands - ui32BaseCommands);
+		text_printString(" OK\n");
+	}
+
+	/* Card content: the last write of each sector wins */
+	for (ui32Offset = 0; bPassed && (TRACE_WINDOW_SECTORS > ui32Offset); ui32Offset++)
+	{
+		_test_stampSector(pui32TraceData[1], pui8LastStep[ui32Offset], ui32Offset);
+		if (!sd_readBlocks((uint32_t *) pui32TraceData[0],
+				ui32WindowSector + ui32Offset, 1)
+				|| (0 != memcmp(pui32TraceData[0], pui32TraceData[1], _MAX_SS)))
+		{
+			text_printString("sector ");
+			text_printNumber(ui32Offset);
+			text_printString(" Bad!!!\n");
+			bPassed = false;
+		}
+	}
+	if (bPassed)
+	{
+		text_printString("data: OK\n");
+	}
+	graphic_render();
+	_test_delay_ms(3000);
+
+unmount:
+	/* Unmount */
+	f_mount(NULL, (TCHAR const*) g_pcFsMountPoint, 0);
+}
+#endif /* _USE_WRITE_COMBINE == 1 */
+
+/**
+ * @brief  Benchmark directory listing with the disk I/O sector cache.
+ * @note   Expectation: Number of entries, listing time in ms and cache hit rate
+ * 			of FAT/directory sectors for a cold and a warm listing of the LIST folder,
+ * 			then the LFN pool high-water mark/failures and the heap size.
+ * @retval None
+ */
+void test_BenchmarkDirectoryListing(void)
+{
+	const char *pcDirectoryName = "LIST"; /* Fill with 500 files before testing */
+	DIR directory;
+	FILINFO fileInfo;
+	diskio_cache_statistic_t cacheStatistic;
+	uint32_t ui32Tickstart;
+	uint32_t ui32Entries;
+	uint32_t ui32Accesses;
+	UINT uiPoolPeak;
+	DWORD ui32PoolFails;
+	int iTestTimes;
+
+	/* Clear screen  */
+	graphic_clearRenderBuffer();
+	graphic_render();
+	text_setWrapText(false);
+	text_setCursor(0, 0);
+	text_setTextSize(1);
+
+	/* Mount */
+	if (f_mount(&g_fatfsSDCard, (TCHAR const*) g_pcFsMountPoint, 0) != FR_OK)
+	{
+		text_putString("mount failed\n", FAST);
+		return;
+	}
+
+	text_putString("Benchmark: LIST\n", FAST);
+	for (iTestTimes = 0; iTestTimes < 2; iTestTimes++)
+	{
+		diskio_resetCacheStatistic();
+		ui32Entries = 0;
+		ui32Tickstart = HAL_GetTick();
+		if (f_opendir(&directory, pcDirectoryName) != FR_OK)
+		{
+			text_putString("opendir failed\n", FAST);
+			break;
+		}
+		while ((f_readdir(&directory, &fileInfo) == FR_OK)
+				&& (0 != fileInfo.fname[0]))
+		{
+			ui32Entries++;
+		}
+		f_closedir(&directory);
+		diskio_getCacheStatistic(&cacheStatistic);
+
+		ui32Accesses = cacheStatistic.ui32MetaHits + cacheStatistic.ui32MetaMisses;
+		text_printNumber(ui32Entries);
+		text_printString(":");
+		text_printNumber(HAL_GetTick() - ui32Tickstart);
+		text_printString("ms ");
+		text_printNumber((0 == ui32Accesses) ? (0) :
+				((cacheStatistic.ui32MetaHits * 100) / ui32Accesses));
+		text_printString("%hit\n");
+		graphic_render();
+	}
+
+	/* The LFN working buffers come from the FatFs pool, not from the heap */
+	ff_get_pool_stat(&uiPoolPeak, &ui32PoolFails);
+	text_printString("lfn:");
+	text_printNumber(uiPoolPeak);
+	text_printString("/");
+	text_printNumber(ui32PoolFails);
+	text_printString(" heap:");
+	text_printNumber(mallinfo().arena);
+	text_printString("B\n");
+	graphic_render();
+
+	/* Unmount */
+	f_mount(NULL, (TCHAR const*) g_pcFsMountPoint, 0);
+}
+
+#if _USE_LFN == 3
+/**
+ * @brief  Test the exhaustion and the recovery of the LFN working buffer pool.
+ * @note   Expectation:
+ * 			@arg LCD report OK once every pool block is held, one more block
+ * 			is refused.
+ * 			@arg LCD report OK when a directory opened while the pool is empty
+ * 			fails with FR_NOT_ENOUGH_CORE and the failure is counted.
+ * 			@arg LCD report OK when, the blocks released, the directory opens
+ * 			and every block can be held again.
+ * @retval None
+ */
+void test_LfnPoolExhaustion(void)
+{
+	void *ppvBlock[_LFN_POOL_SLOTS + 1];
+	DIR directory;
+	UINT uiPoolPeak;
+	DWORD ui32PoolFails;
+	DWORD ui32BaseFails;
+	FRESULT eResult;
+	uint32_t ui32Slot;
+	bool bSuccess;
+
+	/* Clear screen  */
+	graphic_clearRenderBuffer();
+	graphic_render();
+	text_setWrapText(false);
+	text_setCursor(0, 0);
+	text_setTextSize(1);
+
+	/* Mount */
+	if (f_mount(&g_fatfsSDCard, (TCHAR const*) g_pcFsMountPoint, 0) != FR_OK)
+	{
+		text_putString("mount failed\n", FAST);
+		return;
+	}
+	ff_get_pool_stat(&uiPoolPeak, &ui32BaseFails);
+
+	/* Hold every block as the file functions running on other volumes would,
+	 one more block than the pool has must be refused */
+	bSuccess = true;
+	for (ui32Slot = 0; ui32Slot <= _LFN_POOL_SLOTS; ui32Slot++)
+	{
+		ppvBlock[ui32Slot] = ff_memalloc((_MAX_LFN + 1) * 2);
+		if ((_LFN_POOL_SLOTS > ui32Slot) != (NULL != ppvBlock[ui32Slot]))
+		{
+			bSuccess = false;
+		}
+	}
+	text_printString("full: ");
+	text_printString(bSuccess ? "OK\n" : "Bad!!!\n");
+
+	/* A directory operation needs its own block */
+	eResult = f_opendir(&directory, "/");
+	ff_get_pool_stat(&uiPoolPeak, &ui32PoolFails);
+	text_printString("core: ");
+	if ((FR_NOT_ENOUGH_CORE == eResult) && (ui32BaseFails + 2 == ui32PoolFails))
+	{
+		text_printString("OK\n");
+	}
+	else
+	{
+		text_printNumber(eResult);
+		text_printString(" Bad!!!\n");
+	}
+	if (FR_OK == eResult)
+	{
+		f_closedir(&directory);
+	}
+
+	/* Released blocks are served again */
+	for (ui32Slot = 0; ui32Slot < _LFN_POOL_SLOTS; ui32Slot++)
+	{
+		ff_memfree(ppvBlock[ui32Slot]);
+	}
+	eResult = f_opendir(&directory, "/");
+	bSuccess = (FR_OK == eResult);
+	if (bSuccess)
+	{
+		f_closedir(&directory);
+	}
+	for (ui32Slot = 0; ui32Slot < _LFN_POOL_SLOTS; ui32Slot++)
+	{
+		ppvBlock[ui32Slot] = ff_memalloc((_MAX_LFN + 1) * 2);
+		bSuccess = bSuccess && (NULL != ppvBlock[ui32Slot]);
+	}
+	for (ui32Slot = 0; ui32Slot < _LFN_POOL_SLOTS; ui32Slot++)
+	{
+		ff_memfree(ppvBlock[ui32Slot]);
+	}
+	text_printString("free: ");
+	if (bSuccess)
+	{
+		text_printString("OK\n");
+	}
+	else
+	{
+		text_printNumber(eResult);
+		text_printString(" Bad!!!\n");
+	}
+	graphic_render();
+
+	/* Unmount */
+	f_mount(NULL, (TCHAR const*) g_pcFsMountPoint, 0);
+	_test_delay_ms(3000);
+}
+#endif /* _USE_LFN == 3 */
+
 /**
  * @brief  Test the Audio CODEC driver and Audio library APIs.
  * @note   Expectation:
@@ -618,17 +1423,17 @@ void test_Audio(void)
 		acodec_sendData(pcHelloMP3, sizeof(pcHelloMP3));
 		text_putString("Hello! ", FAST);
 		acodec_endFilePadding();
-		acodec_delay_ms(1000);
+		_test_delay_ms(1000);
 	}
 
 	/* Audio library testing */
 	audio_playFileBlocking("MUSIC/Soft-Ambient-3.mp3");
 	acodec_endFilePadding();
-	acodec_delay_ms(1000);
+	_test_delay_ms(1000);
 
 	audio_playFileBlocking("MUSIC/NhuNgayHomQua.mp3");
 	acodec_endFilePadding();
-	acodec_delay_ms(1000);
+	_test_delay_ms(1000);
 
 	/* Unmount FS */
 	if (f_mount(NULL, (TCHAR const*) g_pcFsMountPoint, 0) != FR_OK)
@@ -637,11 +1442,31 @@ void test_Audio(void)
 	}
 }
 
+/**
+ * @brief  Print the SD card busy time which was hidden from the writer.
+ * @retval None
+ */
+void _test_reportSDBusyStatistic(void)
+{
+	sd_busy_statistic_t busyStatistic;
+	sd_getBusyStatistic(&busyStatistic);
+	text_printString("Hidden:");
+	text_printNumber(busyStatistic.ui32HiddenTimeMs);
+	text_printString("ms/");
+	text_printNumber(busyStatistic.ui32DeferredWrites);
+	text_printString("\nStall:");
+	text_printNumber(busyStatistic.ui32StalledTimeMs);
+	text_printString("ms\n");
+	graphic_render();
+}
+
 /**
  * @brief  Test record functions of Audio library APIs.
  * @note   Expectation:
  * 			@arg Record in 8KHz in 10 second and playback.
+ * 			@arg Report the SD busy time hidden during the 8KHz recording.
  * 			@arg Record in 16KHz in 10 second and playback.
+ * 			@arg Report the SD busy time hidden during the 16KHz recording.
  * @retval None
  */
 void test_AudioRecord(void)
@@ -660,16 +1485,22 @@ void test_AudioRecord(void)
 	if ((res == FR_OK) || (res == FR_EXIST))
 	{
 		/* Record in 8KHz */
+		sd_resetBusyStatistic();
 		audio_recordFileBlocking("RECORD/record8kHZ.wav", 10, REC_8KHz);
+		_test_reportSDBusyStatistic();
+		_test_delay_ms(1000);
 		audio_playFileBlocking("RECORD/record8kHZ.wav");
 		acodec_endFilePadding();
-		acodec_delay_ms(1000);
+		_test_delay_ms(1000);
 
 		/* Record in 16KHz */
+		sd_resetBusyStatistic();
 		audio_recordFileBlocking("RECORD/record16kHZ.wav", 10, REC_16KHz);
+		_test_reportSDBusyStatistic();
+		_test_delay_ms(1000);
 		audio_playFileBlocking("RECORD/record16kHZ.wav");
 		acodec_endFilePadding();
-		acodec_delay_ms(1000);
+		_test_delay_ms(1000);
 	}
 	else
 	{
@@ -733,10 +1564,13 @@ void test_ButtonDriver(void)
 		text_printLine("Please press button:");
 		text_putString(pcButtonName[g_i32ExpectedButtonPressed], FAST);
 		text_printString(": ");
-		while (g_i32ButtonPressed != g_i32ExpectedButtonPressed);
+		while (g_i32ButtonPressed != g_i32ExpectedButtonPressed)
+		{
+			_test_serveHost();
+		}
 		text_printString("\n        GOOD");
 		graphic_render();
-		bsp_delay_ms(200);
+		_test_delay_ms(200);
 	}
 }
 
@@ -760,21 +1594,37 @@ int main(void)
 	/* Enable the LED0 and LED1 */
 	bsp_led_init(LED_RED);
 	bsp_led_init(LED_RED1);
+	g_pui32BootTimeline[BOOT_STAGE_BSP] = HAL_GetTick();
 
+#if USBD_AUDIO_ENABLE == 1
+	/* Enable the USB speaker, played by the audio CODEC */
+	usbd_startSpeakerDeviceMode();
+#else
 	/* Enable Mass Storage Device Mode through USB */
 	usbd_startMassStorageDeviceMode();
+#endif /* USBD_AUDIO_ENABLE == 1 */
+	g_pui32BootTimeline[BOOT_STAGE_USB] = HAL_GetTick();
 
 	if (!graphic_init())
 	{
 		goto error;
 	}
+	g_pui32BootTimeline[BOOT_STAGE_GRAPHIC] = HAL_GetTick();
 
 	if (!audio_init())
 	{
 		goto error;
 	}
+	g_pui32BootTimeline[BOOT_STAGE_AUDIO] = HAL_GetTick();
+
+	/* Mount now so that the boot time includes the card identification and
+	 the volume detection, a missing card is not a boot error */
+	f_mount(&g_fatfsSDCard, (TCHAR const*) g_pcFsMountPoint, 1);
+	g_pui32BootTimeline[BOOT_STAGE_MOUNT] = HAL_GetTick();
 
 #ifdef TESTING
+	test_BootTimeline();
+	test_SDCardGeometry();
 	test_DisplayDriver();
 	test_GraphicLibrary();
 	test_TextLibrary();
@@ -782,13 +1632,70 @@ int main(void)
 	test_FatFileSystem();
 	test_Audio();
 	test_AudioRecord();
+#ifdef TESTING_FORMAT
+	test_FormatMedia();
+#endif
+	test_BenchmarkCRC();
 	test_BenchmarkReadWriteFile();
+	test_BenchmarkTrimmedWrite();
+#if _USE_WRITE_COMBINE == 1
+	test_DiskWriteCombine();
+#endif
+	test_BenchmarkDirectoryListing();
+#if _USE_LFN == 3
+	test_LfnPoolExhaustion();
 #endif
 
+	/* The tests unmount the volume when they end: register it again so that
+	 the background work of the main loop (free cluster scan) can run */
+	f_mount(&g_fatfsSDCard, (TCHAR const*) g_pcFsMountPoint, 0);
+#endif
+
+	uint32_t ui32LedTick = HAL_GetTick();
+	DWORD ui32FreeClusters;
+	FATFS *pFatFs;
 	while (true)
 	{
-		bsp_led_toggle(LED_RED);
-		bsp_delay_ms(1000);
+		/* Serve the card accesses queued by the USB host and the background work,
+		 count the free clusters a few FAT sectors at a time when idle */
+		if (0 == blockdev_process(BLOCKDEV_PRIORITY_BACKGROUND, BLOCKDEV_UNLIMITED))
+		{
+			f_scanfree(g_pcFsMountPoint, FREE_SCAN_SECTORS, &ui32FreeClusters, &pFatFs);
+		}
+
+		/* Write back the sectors left pending by the write combining */
+		diskio_flushIdleWrite();
+
+		/* Send the next transfer of the frame presented on the display */
+		graphic_process();
+
+#if USBD_AUDIO_ENABLE == 1
+		/* Feed the CODEC from the USB stream */
+		audio_serveUsbSpeaker();
+#else
+		/* Run the benchmark requested by the USB host, one transfer at a time */
+		usbd_perf_process();
+#endif /* USBD_AUDIO_ENABLE == 1 */
+
+#if USBD_CDC_ENABLE == 1
+		/* Commands, counters and trace records of the CDC-ACM terminal */
+		usbd_console_process();
+#endif /* USBD_CDC_ENABLE == 1 */
+
+		/* Card inserted or removed: identify the new card, FatFs mounts the
+		 volume again on its next access and the USB host is told */
+		if (sd_pollDetect())
+		{
+			diskio_setMediumRemoved(0);
+			disk_initialize(0);
+			usbd_setMediumChanged();
+		}
+
+		if ((HAL_GetTick() - ui32LedTick) >= 1000)
+		{
+			ui32LedTick += 1000;
+			bsp_led_toggle(LED_RED);
+		}
 	}
 	error: bsp_led_on(LED_RED);
 	while (true);
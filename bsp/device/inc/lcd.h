@@ -41,6 +41,7 @@
 
 /* Exported types ------------------------------------------------------------*/
 /* Exported constants --------------------------------------------------------*/
+#define LCD_COMMAND_LIST_SIZE	(32) /*!< Maximum number of command bytes in one bsp_lcd_sendCommandList() transfer */
 /* Exported macro ------------------------------------------------------------*/
 #define bsp_lcd_delay_ms(x) bsp_delay_ms(x) /*!< Wrapper BSP API */
 
@@ -48,7 +49,10 @@
 bool bsp_lcd_init(void);
 void bsp_lcd_reset(void);
 bool bsp_lcd_sendCommand(uint8_t ui8Command);
-bool bsp_lcd_sendData(uint8_t * pui8Buffer, uint16_t ui16Size);
+bool bsp_lcd_sendCommandList(const uint8_t * pui8Commands, uint8_t ui8Count);
+bool bsp_lcd_sendDisplayData(const uint8_t * pui8Data, uint16_t ui16Size);
+bool bsp_lcd_isBusy(void);
+void bsp_lcd_configTransferCallback(void (*action)(bool bSucceeded));
 
 /**@}BSP_DEVICE_LCD*/
 #endif /* LCD_H_ */
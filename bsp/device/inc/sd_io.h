@@ -41,12 +41,16 @@
 
 /* Exported types ------------------------------------------------------------*/
 /* Exported constants --------------------------------------------------------*/
+#define SDIO_COMMAND_CRC_AUTO	(0xFF) /*!< Command CRC7 computed by bsp_sdio_sendCommand() */
+#define SDIO_NO_RESPONSE_EXPECTED	(0x80) /*!< Response byte never sent by a card: bsp_sdio_sendCommand() does not wait for it */
 /* Exported macro ------------------------------------------------------------*/
 /* Exported functions --------------------------------------------------------*/
 bool bsp_sdio_init(void);
 bool bsp_sdio_isDetected(void);
+uint32_t bsp_sdio_setClock(uint32_t ui32MaxFrequency);
 bool bsp_sdio_sendData(uint8_t * pui8Buffer, uint16_t ui16Size);
 bool bsp_sdio_readData(uint8_t * pui8Buffer, uint16_t ui16Size);
+bool bsp_sdio_waitReady(void);
 bool bsp_sdio_sendCommand(uint8_t ui8Cmd, uint32_t ui32Arg, uint8_t ui8CRC,
 		uint8_t ui8ExpectedResponse);
 bool bsp_sdio_sendSpecialCommand(uint8_t ui8Cmd, uint32_t ui32Arg,
@@ -36,6 +36,7 @@
  */
 /* Includes ------------------------------------------------------------------*/
 #include "lcd.h"
+#include <string.h> /* memcpy() */
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
@@ -74,8 +75,10 @@
 /** @addtogroup BSP_INT_PRIORITY
  * @{
  */
-#define I2Cx_DMA_TX_IRQ_PRIORITY		(2)
-#define I2Cx_DMA_RX_IRQ_PRIORITY		(1)
+/* Below the USB (10) and the SD card SPI DMA (1, 2): the HAL completion polls the end
+ of the transfer in the interrupt, the display only needs the completion flag */
+#define I2Cx_DMA_TX_IRQ_PRIORITY		(12)
+#define I2Cx_DMA_RX_IRQ_PRIORITY		(11)
 /**@}BSP_INT_PRIORITY*/
 
 /**@}BSP-LCD-PERIPHERALS*/
@@ -90,7 +93,8 @@
 
 /* Constant value of LCD module */
 #define LCD_I2C_DEVICE_ADDRESS		(0x3C)	/*!< 0b011110[SA0][RW] - 0x3C or 0x3D */
-#define LCD_COMMAND_PACKET_SIZE		(2)		/*!< Size in byte of LCD command packet. */
+#define LCD_COMMAND_PACKET_SIZE		(1 + LCD_COMMAND_LIST_SIZE)	/*!< Size in byte of LCD command packet: control byte and command stream. */
+#define LCD_DATA_CONTROL_BYTE		(0x40)	/*!< Control byte: Co = 0, D/C = 1 'Data', six '0' */
 
 /** @addtogroup BSP-LCD-PERIPHERALS
  * @{
@@ -98,6 +102,8 @@
 /* Private variables ---------------------------------------------------------*/
 static uint16_t g_ui16SlaveAddress = (uint16_t) (LCD_I2C_DEVICE_ADDRESS << 1); /*!< I2C Address of LCD device. */
 static I2C_HandleTypeDef i2chandle_lcd; /*!< I2C handler for LCD declaration. */
+static uint8_t g_pui8CommandPacket[LCD_COMMAND_PACKET_SIZE]; /*!< Command packet, the DMA still reads it after bsp_lcd_sendCommandList() returns. */
+static void (*g_pfnTransferCallback)(bool bSucceeded) = 0; /*!< Called by the DMA TX interrupt when a transfer ends. */
 
 /* Private functions declaration ---------------------------------------------*/
 /* Private function prototypes -----------------------------------------------*/
@@ -235,6 +241,45 @@ void I2Cx_DMA_TX_IRQHandler(void)
 {
 	HAL_DMA_IRQHandler(i2chandle_lcd.hdmatx);
 }
+
+/**
+ * @brief  Master transmission (command packet) completed callback.
+ * @param  hi2c: I2C handle pointer
+ * @retval None
+ */
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+	if ((&i2chandle_lcd == hi2c) && (0 != g_pfnTransferCallback))
+	{
+		g_pfnTransferCallback(true);
+	}
+}
+
+/**
+ * @brief  Memory transmission (display data span) completed callback.
+ * @param  hi2c: I2C handle pointer
+ * @retval None
+ */
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+	if ((&i2chandle_lcd == hi2c) && (0 != g_pfnTransferCallback))
+	{
+		g_pfnTransferCallback(true);
+	}
+}
+
+/**
+ * @brief  I2C error callback: the transfer ended without reaching the LCD module.
+ * @param  hi2c: I2C handle pointer
+ * @retval None
+ */
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+	if ((&i2chandle_lcd == hi2c) && (0 != g_pfnTransferCallback))
+	{
+		g_pfnTransferCallback(false);
+	}
+}
 /**@}BSP-LCD-PERIPHERALS*/
 
 /* Exported variables --------------------------------------------------------*/
@@ -304,22 +349,39 @@ void bsp_lcd_reset(void)
  */
 bool bsp_lcd_sendCommand(uint8_t ui8Command)
 {
-	uint8_t pui8CommandPacket[LCD_COMMAND_PACKET_SIZE] =
-	{ 0x00, /* Control byte: Co = 0, D/C = 0 'Command', six '0' */
-	ui8Command /* Data byte */
-	};
+	return bsp_lcd_sendCommandList(&ui8Command, 1);
+}
+
+/**
+ * @brief  Transmit a list of SSD1306 commands and their parameters to LCD module in one transfer.
+ * @note   The commands follow a single control byte 0x00 (Co = 0: the rest of the transfer is
+ *			a command stream), so the list costs one start, address and stop on the bus.
+ *			The list is copied, the caller may reuse it when the function returns.
+ * @param  pui8Commands: Command bytes in sending order.
+ * @param  ui8Count: Number of command bytes, at most LCD_COMMAND_LIST_SIZE.
+ * @retval bool: Transmission result
+ *			@arg true: completed
+ *			@arg false: aborted
+ */
+bool bsp_lcd_sendCommandList(const uint8_t * pui8Commands, uint8_t ui8Count)
+{
+	if ((0 == ui8Count) || (ui8Count > LCD_COMMAND_LIST_SIZE))
+	{
+		return false;
+	}
 
 	/*  Before starting a new communication transfer, you need to check the current
 	 state of the peripheral; if it's busy you need to wait for the end of current
 	 transfer before starting a new one. */
-	/* FIXME: For simplicity reasons, this example is just waiting till the end of the
-	 transfer, but application may perform other tasks while transfer operation
-	 is ongoing. */
 	while (HAL_I2C_STATE_READY != HAL_I2C_GetState(&i2chandle_lcd));
 
+	/* The packet is only rewritten once the previous transfer released it */
+	g_pui8CommandPacket[0] = 0x00; /* Control byte: Co = 0, D/C = 0 'Command', six '0' */
+	memcpy(&g_pui8CommandPacket[1], pui8Commands, ui8Count);
+
 	while (HAL_OK
 			!= HAL_I2C_Master_Transmit_DMA(&i2chandle_lcd, g_ui16SlaveAddress,
-					pui8CommandPacket, LCD_COMMAND_PACKET_SIZE))
+					g_pui8CommandPacket, 1 + ui8Count))
 	{
 		/* When Acknowledge failure occurs (Slave don't acknowledge its address)
 		 Master restarts communication. Transmission aborted when Timeout error occurs.*/
@@ -332,37 +394,32 @@ bool bsp_lcd_sendCommand(uint8_t ui8Command)
 }
 
 /**
- * @brief  Transmit SSD1306 data to LCD module.
- * @note   The transmision data must begin with the Control byte: 0x40 to indicate the data is comming.
- *			To reduce latency of copy buffer, this function don't prepare the transmision packet as bsp_lcd_sendCommand does.
- *			FIXME: This is not the recommend way because it add more complexity to the upper layer to handle the package creation.
- *			@arg: Idea 1: CPU copy is acceptable if the upper layer only update part of display.
- *			@arg: Idea 2: implement DMA copy and LCD busy flag - non-blocking mechanism
- *          @arg: Idea 3: allocate dynamic buffer and pass the data pointer to upper layer
- * @param  pui8Buffer: Data buffer pointer.
- * @param  ui16Size: Data buffer size in byte.
+ * @brief  Transmit a span of SSD1306 display data (GDDRAM content) to LCD module.
+ * @note   The Control byte 0x40 is sent in place of the I2C memory address, so the buffer
+ *			only holds the pixel data and the span can start anywhere in the display buffer.
+ *			The data is written to the column/page window set up before by the caller.
+ * @param  pui8Data: Pointer to the first data byte of the span.
+ * @param  ui16Size: Span size in byte.
  * @retval bool: Transmission result
  *			@arg true: completed
  *			@arg false: aborted
  */
-bool bsp_lcd_sendData(uint8_t * pui8Buffer, uint16_t ui16Size)
+bool bsp_lcd_sendDisplayData(const uint8_t * pui8Data, uint16_t ui16Size)
 {
-	if (*pui8Buffer != 0x40)
+	if (0 == ui16Size)
 	{
-		return false;
+		return true;
 	}
 
 	/*  Before starting a new communication transfer, you need to check the current
 	 state of the peripheral; if it's busy you need to wait for the end of current
 	 transfer before starting a new one. */
-	/* FIXME: For simplicity reasons, this example is just waiting till the end of the
-	 transfer, but application may perform other tasks while transfer operation
-	 is ongoing. */
 	while (HAL_I2C_STATE_READY != HAL_I2C_GetState(&i2chandle_lcd));
 
 	while (HAL_OK
-			!= HAL_I2C_Master_Transmit_DMA(&i2chandle_lcd, g_ui16SlaveAddress,
-					pui8Buffer, ui16Size))
+			!= HAL_I2C_Mem_Write_DMA(&i2chandle_lcd, g_ui16SlaveAddress,
+					LCD_DATA_CONTROL_BYTE, I2C_MEMADD_SIZE_8BIT,
+					(uint8_t *) pui8Data, ui16Size))
 	{
 		/* When Acknowledge failure occurs (Slave don't acknowledge its address)
 		 Master restarts communication. Transmission aborted when Timeout error occurs.*/
@@ -374,6 +431,29 @@ bool bsp_lcd_sendData(uint8_t * pui8Buffer, uint16_t ui16Size)
 	return true;
 }
 
+/**
+ * @brief  Check whether a transfer to the LCD module is still in progress.
+ * @retval bool: Bus state
+ *			@arg true: a DMA transfer is running
+ *			@arg false: the bus is free
+ */
+bool bsp_lcd_isBusy(void)
+{
+	return (HAL_I2C_STATE_READY != HAL_I2C_GetState(&i2chandle_lcd));
+}
+
+/**
+ * @brief  Register the function called from the DMA TX interrupt at the end of every transfer.
+ * @note   The callback runs in interrupt context and may start the next transfer.
+ * @param  action: Callback function pointer, 0 to disable.
+ *			@arg bSucceeded: true when the transfer completed, false on bus error.
+ * @retval None
+ */
+void bsp_lcd_configTransferCallback(void (*action)(bool bSucceeded))
+{
+	g_pfnTransferCallback = action;
+}
+
 /**@}BSP_DEVICE_LCD_PRIVATE*/
 /**@}BSP_DEVICE_LCD*/
 /********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
@@ -113,17 +113,53 @@
 #define SD_COMMAND_PREFIX			(0x40) /*!< SPI command prefix: 0b01xx.xxxx */
 #define SD_COMMAND_MASK				(0x3F) /*!< SPI command mask: 0b00xx.xxxx */
 #define SD_DUMMY_BYTE				(0xFF) /*!< Dummy byte of SPI data */
-#define SD_NO_RESPONSE_EXPECTED  	(0x80) /*!< Indicate sending non-response SD command */
+#define SD_IDENTIFICATION_CLOCK		(400000) /*!< Maximum SPI clock (Hz) while the card is in identification mode */
+#define SD_SPI_PRESCALER_NUMBER		(8) /*!< Number of SPI baudrate prescalers: 2, 4, ... 256 */
 
 /** @addtogroup BSP_SPI_PERIPHERALS
  * @{
  */
 /* Private variables ---------------------------------------------------------*/
 static SPI_HandleTypeDef spihandle_sd; /*!< SPI handler for SD declaration. */
+static uint32_t g_ui32SdioClockLimit = SD_IDENTIFICATION_CLOCK; /*!< Requested maximum SPI clock (Hz), kept over a bus re-initialization */
+static const uint8_t g_pui8Crc7Table[256] = /*!< CRC7 (x^7 + x^3 + 1) of one byte, result in bits [7:1] */
+{ 0x00, 0x12, 0x24, 0x36, 0x48, 0x5A, 0x6C, 0x7E,
+		0x90, 0x82, 0xB4, 0xA6, 0xD8, 0xCA, 0xFC, 0xEE,
+		0x32, 0x20, 0x16, 0x04, 0x7A, 0x68, 0x5E, 0x4C,
+		0xA2, 0xB0, 0x86, 0x94, 0xEA, 0xF8, 0xCE, 0xDC,
+		0x64, 0x76, 0x40, 0x52, 0x2C, 0x3E, 0x08, 0x1A,
+		0xF4, 0xE6, 0xD0, 0xC2, 0xBC, 0xAE, 0x98, 0x8A,
+		0x56, 0x44, 0x72, 0x60, 0x1E, 0x0C, 0x3A, 0x28,
+		0xC6, 0xD4, 0xE2, 0xF0, 0x8E, 0x9C, 0xAA, 0xB8,
+		0xC8, 0xDA, 0xEC, 0xFE, 0x80, 0x92, 0xA4, 0xB6,
+		0x58, 0x4A, 0x7C, 0x6E, 0x10, 0x02, 0x34, 0x26,
+		0xFA, 0xE8, 0xDE, 0xCC, 0xB2, 0xA0, 0x96, 0x84,
+		0x6A, 0x78, 0x4E, 0x5C, 0x22, 0x30, 0x06, 0x14,
+		0xAC, 0xBE, 0x88, 0x9A, 0xE4, 0xF6, 0xC0, 0xD2,
+		0x3C, 0x2E, 0x18, 0x0A, 0x74, 0x66, 0x50, 0x42,
+		0x9E, 0x8C, 0xBA, 0xA8, 0xD6, 0xC4, 0xF2, 0xE0,
+		0x0E, 0x1C, 0x2A, 0x38, 0x46, 0x54, 0x62, 0x70,
+		0x82, 0x90, 0xA6, 0xB4, 0xCA, 0xD8, 0xEE, 0xFC,
+		0x12, 0x00, 0x36, 0x24, 0x5A, 0x48, 0x7E, 0x6C,
+		0xB0, 0xA2, 0x94, 0x86, 0xF8, 0xEA, 0xDC, 0xCE,
+		0x20, 0x32, 0x04, 0x16, 0x68, 0x7A, 0x4C, 0x5E,
+		0xE6, 0xF4, 0xC2, 0xD0, 0xAE, 0xBC, 0x8A, 0x98,
+		0x76, 0x64, 0x52, 0x40, 0x3E, 0x2C, 0x1A, 0x08,
+		0xD4, 0xC6, 0xF0, 0xE2, 0x9C, 0x8E, 0xB8, 0xAA,
+		0x44, 0x56, 0x60, 0x72, 0x0C, 0x1E, 0x28, 0x3A,
+		0x4A, 0x58, 0x6E, 0x7C, 0x02, 0x10, 0x26, 0x34,
+		0xDA, 0xC8, 0xFE, 0xEC, 0x92, 0x80, 0xB6, 0xA4,
+		0x78, 0x6A, 0x5C, 0x4E, 0x30, 0x22, 0x14, 0x06,
+		0xE8, 0xFA, 0xCC, 0xDE, 0xA0, 0xB2, 0x84, 0x96,
+		0x2E, 0x3C, 0x0A, 0x18, 0x66, 0x74, 0x42, 0x50,
+		0xBE, 0xAC, 0x9A, 0x88, 0xF6, 0xE4, 0xD2, 0xC0,
+		0x1C, 0x0E, 0x38, 0x2A, 0x54, 0x46, 0x70, 0x62,
+		0x8C, 0x9E, 0xA8, 0xBA, 0xC4, 0xD6, 0xE0, 0xF2 };
 
 /* Private functions declaration ---------------------------------------------*/
 static void SPI_MspInit(SPI_HandleTypeDef *hspi);
 static void SPI_Error(void);
+static uint8_t sdio_computeCRC7(const uint8_t *pui8Buffer, uint32_t ui32Size);
 
 /* Private function prototypes -----------------------------------------------*/
 /**
@@ -227,11 +263,31 @@ static void SPI_Error(void)
 	/* De-initialize the SPI communication BUS */
 	HAL_SPI_DeInit(&spihandle_sd);
 
-	/* Re-Initialize the SPI communication BUS */
+	/* Re-Initialize the SPI communication BUS at the clock previously granted
+	 to the card, the card itself is not reset so it stays in data mode */
+	uint32_t ui32ClockLimit = g_ui32SdioClockLimit;
 	bsp_sdio_init();
+	bsp_sdio_setClock(ui32ClockLimit);
 }
 /**@}BSP_SPI_PERIPHERALS*/
 
+/**
+ * @brief  Compute the CRC7 of an SD command packet.
+ * @param  pui8Buffer: Command bytes (command index and argument)
+ * @param  ui32Size: Number of bytes
+ * @retval uint8_t: CRC7 in bits [7:1] with the end bit set, ready to be sent
+ */
+static uint8_t sdio_computeCRC7(const uint8_t *pui8Buffer, uint32_t ui32Size)
+{
+	uint8_t ui8Crc = 0;
+
+	while (ui32Size--)
+	{
+		ui8Crc = g_pui8Crc7Table[ui8Crc ^ *pui8Buffer++];
+	}
+	return (ui8Crc | 0x01);
+}
+
 /**
  * @brief  This function handles DMA Rx interrupt request.
  * @retval None
@@ -259,13 +315,15 @@ void SPIx_DMA_TX_IRQHandler(void)
  */
 bool bsp_sdio_init(void)
 {
-	/* SPI baudrate is set to 18 MHz maximum (PCLK1 / SPI_BaudRatePrescaler = 24 / 2 = 12 MHz)
-	 to verify these constraints:
+	/* The card starts in identification mode, which only guarantees 400 kHz.
+	 The SPI starts at the slowest prescaler and is raised right away to the
+	 fastest rate not above SD_IDENTIFICATION_CLOCK. The SD driver switches to
+	 the data transfer rate (bsp_sdio_setClock) once the CSD has been read:
 	 - SD card SPI interface max baudrate is 25MHz for write/read
 	 - PCLK1 max frequency is 36 MHz
 	 */
 	spihandle_sd.Instance = SPIx;
-	spihandle_sd.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_2;
+	spihandle_sd.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_256;
 	spihandle_sd.Init.Direction = SPI_DIRECTION_2LINES;
 	spihandle_sd.Init.CLKPhase = SPI_PHASE_1EDGE;
 	spihandle_sd.Init.CLKPolarity = SPI_POLARITY_LOW;
@@ -283,6 +341,7 @@ bool bsp_sdio_init(void)
 	{
 		return false;
 	}
+	bsp_sdio_setClock(SD_IDENTIFICATION_CLOCK);
 
 	/* Configure the SD CSn and Detect pins */
 	GPIO_InitTypeDef GPIO_InitStruct;
@@ -323,6 +382,57 @@ bool bsp_sdio_init(void)
 	return true;
 }
 
+/**
+ * @brief  Changes the SPI clock of the SD bus.
+ * 		   The SPI prescaler is the smallest one (2 to 256) which keeps the bus
+ * 		   clock below or equal to the requested frequency. The slowest clock is
+ * 		   used when even the 256 prescaler is too fast.
+ * @param  ui32MaxFrequency: Maximum allowed SPI clock in Hz
+ * @retval uint32_t: Effective SPI clock in Hz
+ */
+uint32_t bsp_sdio_setClock(uint32_t ui32MaxFrequency)
+{
+	static const uint32_t pui32Prescaler[SD_SPI_PRESCALER_NUMBER] =
+	{ SPI_BAUDRATEPRESCALER_2, SPI_BAUDRATEPRESCALER_4,
+			SPI_BAUDRATEPRESCALER_8, SPI_BAUDRATEPRESCALER_16,
+			SPI_BAUDRATEPRESCALER_32, SPI_BAUDRATEPRESCALER_64,
+			SPI_BAUDRATEPRESCALER_128, SPI_BAUDRATEPRESCALER_256 };
+	uint32_t ui32Pclk = HAL_RCC_GetPCLK1Freq();
+	uint32_t ui32Index = 0;
+
+	/* Divider of entry i is 2^(i + 1) */
+	while ((SD_SPI_PRESCALER_NUMBER - 1 > ui32Index)
+			&& ((ui32Pclk >> (ui32Index + 1)) > ui32MaxFrequency))
+	{
+		ui32Index++;
+	}
+
+	g_ui32SdioClockLimit = ui32MaxFrequency;
+	spihandle_sd.Init.BaudRatePrescaler = pui32Prescaler[ui32Index];
+
+	/* The baudrate bits must only be changed while the SPI is disabled, and
+	 the SPI must only be disabled once the last DMA transfer is complete and
+	 its last byte has left the shift register (TXE = 1, BSY = 0) */
+	if (bsp_sdio_waitReady())
+	{
+		uint32_t ui32TickStart = HAL_GetTick();
+
+		while ((RESET == __HAL_SPI_GET_FLAG(&spihandle_sd, SPI_FLAG_TXE))
+				|| (RESET != __HAL_SPI_GET_FLAG(&spihandle_sd, SPI_FLAG_BSY)))
+		{
+			if (SPIx_TIMEOUT_MAX < (HAL_GetTick() - ui32TickStart))
+			{
+				break;
+			}
+		}
+	}
+	__HAL_SPI_DISABLE(&spihandle_sd);
+	MODIFY_REG(spihandle_sd.Instance->CR1, SPI_CR1_BR, pui32Prescaler[ui32Index]);
+	__HAL_SPI_ENABLE(&spihandle_sd);
+
+	return ui32Pclk >> (ui32Index + 1);
+}
+
 /**
  * @brief  Detects if SD card is correctly plugged in the memory slot or not.
  * @retval bool: Returns if SD is detected or not
@@ -389,6 +499,8 @@ bool bsp_sdio_sendData(uint8_t * pui8Buffer, uint16_t ui16Size)
  * @param  ui16Size: Requested data size in byte.
  * @note   Each byte in the buffer will be send and replace by the received data.
  * 			So that the initialize value of all the data in the buffer should equal to 0xFF for safe.
+ * @note   The function returns once the last byte is received, the buffer can be
+ * 			checked right away (response token, CRC).
  * @retval bool: Status of transmission
  *			@arg true: succeeded
  *			@arg false: failed
@@ -427,6 +539,12 @@ bool bsp_sdio_readData(uint8_t * pui8Buffer, uint16_t ui16Size)
 			}
 		}
 		++ui32DataCounter;
+		if (0 == ui16Size)
+		{
+			/* The last received byte is only valid, and the dummy transmit
+			 value only released, once its DMA transfer is complete */
+			return bsp_sdio_waitReady();
+		}
 #else
 		/* Read single byte at a time */
 		status = HAL_SPI_TransmitReceive(&spihandle_sd, (uint8_t*) &ui32TransmisionDummyValue,
@@ -444,12 +562,38 @@ bool bsp_sdio_readData(uint8_t * pui8Buffer, uint16_t ui16Size)
 	return true;
 }
 
+/**
+ * @brief  Wait for the end of the current SPI DMA transfer.
+ * 		   bsp_sdio_sendData() and bsp_sdio_readData() only start the DMA of the
+ * 		   last byte, the received data is valid once the SPI is back to ready.
+ * @retval bool: Status of the transfer
+ *			@arg true: SPI ready
+ *			@arg false: timeout, the SPI bus has been re-initialized
+ */
+bool bsp_sdio_waitReady(void)
+{
+	uint32_t ui32TickStart = HAL_GetTick();
+
+	while (HAL_SPI_STATE_READY != HAL_SPI_GetState(&spihandle_sd))
+	{
+		if (SPIx_TIMEOUT_MAX < (HAL_GetTick() - ui32TickStart))
+		{
+			/* Execute user timeout callback */
+			SPI_Error();
+			return false;
+		}
+	}
+	return true;
+}
+
 /**
  * @brief  Send 5 bytes command to the SD card and get the R3 response.
  * @param  ui8Cmd: The user expected command to send to SD device.
  * @param  ui32Arg: The command argument.
- * @param  ui8CRC: The CRC value of the command packet.
- * @param  ui8ExpectedResponse: Expected response from the SD device.
+ * @param  ui8CRC: The CRC value of the command packet,
+ * 			SDIO_COMMAND_CRC_AUTO to compute it from the command and argument.
+ * @param  ui8ExpectedResponse: Expected response from the SD device,
+ * 			SDIO_NO_RESPONSE_EXPECTED to return right after the command packet.
  * @retval bool: Status of transmission
  *			@arg true: succeeded
  *			@arg false: failed
@@ -462,9 +606,15 @@ bool bsp_sdio_sendCommand(uint8_t ui8Cmd, uint32_t ui32Arg, uint8_t ui8CRC,
 			(uint8_t) (ui32Arg >> 24), (uint8_t) (ui32Arg >> 16),
 			(uint8_t) (ui32Arg >> 8), (uint8_t) (ui32Arg), ui8CRC };
 
+	if (SDIO_COMMAND_CRC_AUTO == ui8CRC)
+	{
+		pui8CommandPacket[SD_COMMAND_PACKET_SIZE - 1] = sdio_computeCRC7(
+				pui8CommandPacket, SD_COMMAND_PACKET_SIZE - 1);
+	}
+
 	if (bsp_sdio_sendData(pui8CommandPacket, SD_COMMAND_PACKET_SIZE))
 	{
-		if (SD_NO_RESPONSE_EXPECTED != ui8ExpectedResponse)
+		if (SDIO_NO_RESPONSE_EXPECTED != ui8ExpectedResponse)
 		{
 			return bsp_sdio_waitResponse(ui8ExpectedResponse);
 		}
@@ -477,7 +627,8 @@ bool bsp_sdio_sendCommand(uint8_t ui8Cmd, uint32_t ui32Arg, uint8_t ui8CRC,
  * @brief  Send 5 bytes command to the SD card and get the R7 response.
  * @param  ui8Cmd: The user expected command to send to SD device.
  * @param  ui32Arg: The command argument.
- * @param  ui8CRC: The CRC value of the command packet.
+ * @param  ui8CRC: The CRC value of the command packet,
+ * 			SDIO_COMMAND_CRC_AUTO to compute it from the command and argument.
  * @param  ui8ExpectedResponse: Expected response from the SD device.
  * @param  pui32TrailingResponse: Additional 4 trailing byte buffer pointer of R7 response.
  * @retval bool: Status of transmission
@@ -489,7 +640,7 @@ bool bsp_sdio_sendSpecialCommand(uint8_t ui8Cmd, uint32_t ui32Arg, uint8_t ui8CR
 {
 	if (bsp_sdio_sendCommand(ui8Cmd, ui32Arg, ui8CRC, ui8ExpectedResponse))
 	{
-		if (SD_NO_RESPONSE_EXPECTED != ui8ExpectedResponse)
+		if (SDIO_NO_RESPONSE_EXPECTED != ui8ExpectedResponse)
 		{
 			uint8_t *pui8TrailingByte = (uint8_t *) pui32TrailingResponse;
 			/* Read more 4 trailing byte of R7 response */
@@ -70,17 +70,21 @@ typedef enum
 /* Exported constants --------------------------------------------------------*/
 #define DISPLAY_WIDTH		(128) /*!< LCD width in pixel unit */
 #define DISPLAY_HEIGHT		(32) /*!< LCD height in pixel unit */
+#define DISPLAY_PAGE_NUMBER	(DISPLAY_HEIGHT / 8) /*!< Every page holds 8 rows */
 
 /* Exported macro ------------------------------------------------------------*/
-#define display_delay_ms(x) bsp_lcd_delay_ms(x) /*!< Wrapper LCD API */
-
 /* Exported functions --------------------------------------------------------*/
 bool display_init(void);
 void display_turnOn(void);
 void display_turnOff(void);
 void display_setDim(bool bIsDim);
 uint8_t* display_getRenderBufferPointer(void);
+void display_markDirty(uint8_t ui8Page, uint8_t ui8FirstColumn,
+		uint8_t ui8LastColumn);
 void display_render(void);
+void display_present(void);
+void display_process(void);
+void display_delay_ms(uint32_t ui32Delay);
 void display_render_logo(void);
 void display_clearRenderBuffer(void);
 void display_setInvertMode(void);
@@ -104,6 +104,17 @@ typedef struct _sd_cid_t
 	uint8_t Reserved2; /*!< always 1 */
 } sd_cid_t;
 
+/**
+ * @typedef sd_card_type_t
+ * This type define the SD card capacity class.
+ */
+typedef enum
+{
+	SD_CARD_SDSC = 0, /*!< Standard Capacity: byte addressing, CSD Version 1.0 */
+	SD_CARD_SDHC = 1, /*!< High Capacity: block addressing, CSD Version 2.0 */
+	SD_CARD_SDXC = 2 /*!< Extended Capacity: block addressing, CSD Version 2.0 */
+} sd_card_type_t;
+
 /**
  * @struct _sd_card_info_t
  * This type define the SD Card information.
@@ -112,10 +123,63 @@ typedef struct _sd_card_info_t
 {
 	sd_csd_t Csd;
 	sd_cid_t Cid;
-	uint32_t CardCapacity; /*!< Card Capacity */
+	sd_card_type_t CardType; /*!< Card capacity class */
+	bool CardBlockAddressing; /*!< true: commands take a block number (OCR CCS = 1), false: a byte address */
+	uint64_t CardCapacity; /*!< Card Capacity in byte unit */
+	uint32_t CardBlockNumber; /*!< Number of SD_BLOCK_SIZE blocks */
 	uint32_t CardBlockSize; /*!< Card Block Size */
+	uint32_t CardEraseBlockSize; /*!< Erase unit in number of SD_BLOCK_SIZE blocks */
+	uint32_t CardAllocationUnit; /*!< Allocation unit (AU) in number of SD_BLOCK_SIZE blocks, 0 if not reported */
 } sd_card_info_t;
 
+/**
+ * @struct _sd_busy_statistic_t
+ * This type define the statistic of the card programming (busy) time
+ * which is not waited by the write functions.
+ */
+typedef struct _sd_busy_statistic_t
+{
+	uint32_t ui32DeferredWrites; /*!< Number of write/erase returned before the card finished programming */
+	uint32_t ui32HiddenTimeMs; /*!< Busy time overlapped with other works */
+	uint32_t ui32StalledTimeMs; /*!< Busy time still waited at the next card access */
+} sd_busy_statistic_t;
+
+/**
+ * @struct _sd_init_statistic_t
+ * This type define the statistic of the last card initialization.
+ */
+typedef struct _sd_init_statistic_t
+{
+	uint32_t ui32InitTimeMs; /*!< Duration of sd_init() from the bus setup to the card ready */
+	uint32_t ui32ReadyPolls; /*!< Number of ACMD41 sent before the card left the idle state */
+	uint32_t ui32ClockHz; /*!< SPI clock used for data transfer, 0 if the initialization failed */
+} sd_init_statistic_t;
+
+/**
+ * @struct _sd_crc_statistic_t
+ * This type define the statistic of the data blocks corrupted on the bus.
+ */
+typedef struct _sd_crc_statistic_t
+{
+	uint32_t ui32ReadErrors; /*!< Read blocks received with a wrong CRC */
+	uint32_t ui32WriteErrors; /*!< Written blocks rejected by the card for a wrong CRC */
+	uint32_t ui32Failures; /*!< Transfers failed after SD_CRC_RETRY retries */
+} sd_crc_statistic_t;
+
+/**
+ * @struct _sd_latency_statistic_t
+ * This type define the statistic of the data commands duration, timed with
+ * the cycle counter from the command to the last data byte (the programming
+ * of a write is accounted by sd_busy_statistic_t).
+ */
+typedef struct _sd_latency_statistic_t
+{
+	uint32_t ui32Commands; /*!< Commands timed: CMD17/CMD18 per read transaction, CMD24/CMD25 per write transaction */
+	uint32_t ui32Blocks; /*!< SD_BLOCK_SIZE blocks transferred by these commands */
+	uint32_t ui32TotalUs; /*!< Sum of the command durations, wraps after 71 minutes */
+	uint32_t ui32MaxUs; /*!< Longest command */
+} sd_latency_statistic_t;
+
 /**
  * @typedef sd_hardware_status_t
  * This type define the SD detection on its memory slot.
@@ -128,18 +192,34 @@ typedef enum
 
 /* Exported constants --------------------------------------------------------*/
 #define SD_BLOCK_SIZE				(0x200) /*!< Block size 512 bytes work with FatFS */
+#define SD_CRC_CHECK				(1) /*!< 1: CRC of every command and data block checked (CMD59), 0: CRC ignored */
 
 /* Exported macro ------------------------------------------------------------*/
-#define sd_isDetected()	bsp_sd_isDetected() /*!< Wrapper SDIO API */
+#define sd_isDetected()	bsp_sdio_isDetected() /*!< Wrapper SDIO API */
 
 /* Exported functions --------------------------------------------------------*/
 bool sd_init(void);
 bool sd_getStatus(void);
+bool sd_pollDetect(void);
 bool sd_getCardInfo(sd_card_info_t *pCardInfo);
-bool sd_readBlocks(uint32_t* pui32Data, uint64_t ui64ReadAddr,
-		uint16_t ui16BlockSize, uint32_t ui32NumberOfBlocks);
-bool sd_writeBlocks(uint32_t* pui32Data, uint64_t ui64WriteAddr,
-		uint16_t ui16BlockSize, uint32_t ui32NumberOfBlocks);
+void sd_decodeCardInfo(const uint8_t *pui8CsdResponseArray, uint32_t ui32Ocr,
+		sd_card_info_t *pCardInfo);
+uint32_t sd_getBlockNumber(void);
+bool sd_readBlocks(uint32_t* pui32Data, uint32_t ui32BlockAddr,
+		uint32_t ui32NumberOfBlocks);
+bool sd_writeBlocks(uint32_t* pui32Data, uint32_t ui32BlockAddr,
+		uint32_t ui32NumberOfBlocks);
+bool sd_eraseBlocks(uint32_t ui32BlockAddr, uint32_t ui32NumberOfBlocks);
+bool sd_isBusy(void);
+bool sd_waitReady(void);
+void sd_getBusyStatistic(sd_busy_statistic_t *pStatistic);
+void sd_resetBusyStatistic(void);
+void sd_getInitStatistic(sd_init_statistic_t *pStatistic);
+void sd_getCrcStatistic(sd_crc_statistic_t *pStatistic);
+void sd_getLatencyStatistic(sd_latency_statistic_t *pReadStatistic,
+		sd_latency_statistic_t *pWriteStatistic);
+void sd_resetLatencyStatistic(void);
+uint16_t sd_computeCRC16(const uint8_t *pui8Buffer, uint32_t ui32Size);
 
 /**@}BSP_DRV_SD*/
 #endif /* SD_H_ */
@@ -49,10 +49,31 @@ typedef enum
 	VCCTYPE_SWITCHCAP = 0x02 /*!< Using internal VCC need to enable switch capacitors */
 } vcctype_t;
 
+/**
+ * @typedef display_window_t
+ * This type define one GDDRAM window and its data span in the display buffer.
+ */
+typedef struct
+{
+	uint8_t ui8FirstColumn; /*!< COLUMNADDR start */
+	uint8_t ui8LastColumn; /*!< COLUMNADDR end */
+	uint8_t ui8FirstPage; /*!< PAGEADDR start */
+	uint8_t ui8LastPage; /*!< PAGEADDR end */
+	uint16_t ui16Offset; /*!< First byte of the span in the display buffer */
+	uint16_t ui16Size; /*!< Span size in byte */
+} display_window_t;
+
 /* Private define ------------------------------------------------------------*/
 #define DISPLAY_DATA_SIZE		(DISPLAY_WIDTH * DISPLAY_HEIGHT / 8) /*!< Unit in byte. Every 8 pixel in same column corresponding to one byte data (8-bit) */
+#define DISPLAY_WINDOW_COMMANDS	(6) /*!< COLUMNADDR and PAGEADDR with their start/end parameters */
+#define DISPLAY_WINDOW_COST		(2 + DISPLAY_WINDOW_COMMANDS) /*!< Bus bytes of a COLUMNADDR/PAGEADDR window: [address][control][6 commands] */
+#define DISPLAY_SPAN_OVERHEAD	(2) /*!< Bus bytes in front of every data span: [address][control] */
+#define DISPLAY_FRAME_COST		(DISPLAY_WINDOW_COST + DISPLAY_SPAN_OVERHEAD + DISPLAY_DATA_SIZE) /*!< Bus bytes of a full frame update */
 
 /* Private macro -------------------------------------------------------------*/
+#define DISPLAY_ENTER_CRITICAL(ui32Primask)	do { (ui32Primask) = __get_PRIMASK(); __disable_irq(); } while (0)
+#define DISPLAY_EXIT_CRITICAL(ui32Primask)	__set_PRIMASK(ui32Primask)
+
 /* SSD1306 command list */
 #define SSD1306_SETCONTRAST			(0x81)
 #define SSD1306_DISPLAYALLON_RESUME	(0xA4)
@@ -90,10 +111,8 @@ typedef enum
 /* Private variables ---------------------------------------------------------*/
 static const vcctype_t OLED_VCCTYPE = VCCTYPE_SWITCHCAP; /*!< This variable select the VCC configuration of the display_init() function */
 
-/* FIXME: implement the best idea note in bsp_lcd_sendCommand to make the code cleaner: no magic number '1' here */
-#define DISPLAY_BUFFER_SIZE	(1 + DISPLAY_DATA_SIZE)
-static uint8_t g_ui8DisplayBuffer[DISPLAY_BUFFER_SIZE] = /*!< This is display buffer for the LCD and the format is: [control byte 0x40][data] */
-{0x40 /* Control Byte - Co = Data */,
+static uint8_t g_ui8DisplayBuffer[DISPLAY_DATA_SIZE] = /*!< This is display buffer for the LCD, the control byte 0x40 is sent by bsp_lcd_sendDisplayData() */
+{
 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
@@ -130,10 +149,10 @@ static uint8_t g_ui8DisplayBuffer[DISPLAY_BUFFER_SIZE] = /*!< This is display bu
 0x03, 0x03, 0x03, 0x03, 0x03, 0x01, 0x00, 0x00, 0x00, 0x01, 0x03, 0x01, 0x00, 0x00, 0x00, 0x03,
 0x03, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
 };
-static uint8_t *g_pui8DisplayDataBuffer = &g_ui8DisplayBuffer[1]; /*!< Pointer to the data region in the display buffer. Skip the control byte. */
+static uint8_t *g_pui8DisplayDataBuffer = g_ui8DisplayBuffer; /*!< Pointer to the data region in the display buffer. */
 
-static uint8_t g_ui8LogoDisplay[DISPLAY_BUFFER_SIZE] = /*!< This is the project LOGO in display buffer format */
-{0x40 /* Control Byte - Co = Data */,
+static const uint8_t g_ui8LogoDisplay[DISPLAY_DATA_SIZE] = /*!< This is the project LOGO in display buffer format */
+{
 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x00, 0x80, 0xC0, 0x60, 0x60,
 0x30, 0x30, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0xB0, 0xF0, 0x60, 0xE2, 0xC0, 0x80, 0x00,
 0x00, 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x04, 0x44, 0x00, 0x00, 0xFE, 0x4A, 0xFA, 0x0A,
@@ -171,8 +190,250 @@ static uint8_t g_ui8LogoDisplay[DISPLAY_BUFFER_SIZE] = /*!< This is the project
 0x00, 0x01, 0x4F, 0x4F, 0x0F, 0x0F, 0x00, 0x03, 0x03, 0x23, 0x03, 0x03, 0x01, 0x31, 0x00, 0x00
 };
 
+static uint8_t g_pui8DirtyFirstColumn[DISPLAY_PAGE_NUMBER] = /*!< First column per page which differs from the LCD GDDRAM. The GDDRAM is undefined after reset. */
+{ 0, 0, 0, 0 };
+static uint8_t g_pui8DirtyLastColumn[DISPLAY_PAGE_NUMBER] = /*!< Last column per page which differs from the LCD GDDRAM. The page is clean when first > last. */
+{ DISPLAY_WIDTH - 1, DISPLAY_WIDTH - 1, DISPLAY_WIDTH - 1, DISPLAY_WIDTH - 1 };
+
+/* Asynchronous pipeline: display_present() copies the dirty spans of the render (back) buffer
+ to the front buffer, which is sent window by window while the application keeps drawing into
+ the back buffer. The DMA TX interrupt only flags the end of a transfer, the next one is started
+ by display_process() in the main loop. */
+static uint8_t g_ui8DisplayFrontBuffer[DISPLAY_DATA_SIZE]; /*!< Spans being transmitted, only read by the DMA */
+static display_window_t g_pFlightWindows[DISPLAY_PAGE_NUMBER]; /*!< Windows of the transfer in flight */
+static volatile uint8_t g_ui8FlightWindowCount = 0; /*!< Number of windows in flight */
+static volatile uint8_t g_ui8FlightWindow = 0; /*!< Window being transmitted */
+static volatile bool g_bFlightWindowSet = false; /*!< The window commands of the current window are sent, the data span is next */
+static volatile bool g_bTransferBusy = false; /*!< An asynchronous frame is on the bus */
+static volatile bool g_bTransferDone = false; /*!< The DMA TX interrupt completed a transfer of the frame, the next one is due */
+static volatile bool g_bPresentPending = false; /*!< display_present() was called during the transfer */
+static volatile bool g_bResendAll = false; /*!< A transfer failed, the GDDRAM content is unknown */
+
 /* Private functions declaration ---------------------------------------------*/
+static bool display_swap(void);
+
 /* Private function prototypes -----------------------------------------------*/
+/**
+ * @brief  Mark the whole render buffer as different from the LCD GDDRAM.
+ * @retval None
+ */
+static void display_markAllDirty(void)
+{
+	/* The application modifies the back buffer: the pending frame is merged into the next present */
+	g_bPresentPending = false;
+	for (uint8_t ui8Page = 0; ui8Page < DISPLAY_PAGE_NUMBER; ui8Page++)
+	{
+		g_pui8DirtyFirstColumn[ui8Page] = 0;
+		g_pui8DirtyLastColumn[ui8Page] = DISPLAY_WIDTH - 1;
+	}
+}
+
+/**
+ * @brief  Set up the GDDRAM window which the next display data is written to.
+ * @param  ui8FirstColumn: Column start address.
+ * @param  ui8LastColumn: Column end address.
+ * @param  ui8FirstPage: Page start address.
+ * @param  ui8LastPage: Page end address.
+ * @retval bool: Transmission result
+ *			@arg true: completed
+ *			@arg false: aborted
+ */
+static bool display_setWindow(uint8_t ui8FirstColumn, uint8_t ui8LastColumn,
+		uint8_t ui8FirstPage, uint8_t ui8LastPage)
+{
+	const uint8_t pui8Commands[DISPLAY_WINDOW_COMMANDS] =
+	{ SSD1306_COLUMNADDR, ui8FirstColumn, /* Column start address (0 = reset) */
+	ui8LastColumn, /* Column end address (127 = reset) */
+	SSD1306_PAGEADDR, ui8FirstPage, /* Page start address (0 = reset) */
+	ui8LastPage /* Page end address (3 = Height in 32pxl) */
+	};
+	return bsp_lcd_sendCommandList(pui8Commands, DISPLAY_WINDOW_COMMANDS);
+}
+
+/**
+ * @brief  Turn the dirty ranges into GDDRAM windows and mark every page clean.
+ * @note   Every dirty page is one column window. When the windows cost more bus bytes
+ *			than a full frame (e.g. after a clear screen), the whole buffer is one window instead.
+ * @param  pWindows: Window list output, DISPLAY_PAGE_NUMBER entries.
+ * @retval uint8_t: Number of windows, 0 when the LCD already shows the render buffer.
+ */
+static uint8_t display_planWindows(display_window_t *pWindows)
+{
+	uint32_t ui32Bytes = 0;
+	uint8_t ui8Count = 0;
+	uint8_t ui8Page;
+
+	if (g_bResendAll)
+	{
+		g_bResendAll = false;
+		display_markAllDirty();
+	}
+
+	/* Estimate the bus cost of the dirty windows */
+	for (ui8Page = 0; ui8Page < DISPLAY_PAGE_NUMBER; ui8Page++)
+	{
+		if (g_pui8DirtyFirstColumn[ui8Page] <= g_pui8DirtyLastColumn[ui8Page])
+		{
+			ui32Bytes += DISPLAY_WINDOW_COST + DISPLAY_SPAN_OVERHEAD
+					+ (g_pui8DirtyLastColumn[ui8Page] - g_pui8DirtyFirstColumn[ui8Page] + 1);
+		}
+	}
+
+	if (ui32Bytes >= DISPLAY_FRAME_COST)
+	{
+		pWindows[0].ui8FirstColumn = 0;
+		pWindows[0].ui8LastColumn = DISPLAY_WIDTH - 1;
+		pWindows[0].ui8FirstPage = 0;
+		pWindows[0].ui8LastPage = DISPLAY_PAGE_NUMBER - 1;
+		pWindows[0].ui16Offset = 0;
+		pWindows[0].ui16Size = DISPLAY_DATA_SIZE;
+		ui8Count = 1;
+	}
+	else if (0 != ui32Bytes)
+	{
+		for (ui8Page = 0; ui8Page < DISPLAY_PAGE_NUMBER; ui8Page++)
+		{
+			uint8_t ui8FirstColumn = g_pui8DirtyFirstColumn[ui8Page];
+			uint8_t ui8LastColumn = g_pui8DirtyLastColumn[ui8Page];
+			if (ui8FirstColumn > ui8LastColumn)
+			{
+				continue;
+			}
+			pWindows[ui8Count].ui8FirstColumn = ui8FirstColumn;
+			pWindows[ui8Count].ui8LastColumn = ui8LastColumn;
+			pWindows[ui8Count].ui8FirstPage = ui8Page;
+			pWindows[ui8Count].ui8LastPage = ui8Page;
+			pWindows[ui8Count].ui16Offset = ui8Page * DISPLAY_WIDTH + ui8FirstColumn;
+			pWindows[ui8Count].ui16Size = ui8LastColumn - ui8FirstColumn + 1;
+			ui8Count++;
+		}
+	}
+
+	/* Every page is clean now */
+	for (ui8Page = 0; ui8Page < DISPLAY_PAGE_NUMBER; ui8Page++)
+	{
+		g_pui8DirtyFirstColumn[ui8Page] = DISPLAY_WIDTH;
+		g_pui8DirtyLastColumn[ui8Page] = 0;
+	}
+
+	return ui8Count;
+}
+
+/**
+ * @brief  Start the next transfer of the frame in flight: the window commands or the data span.
+ * @note   Called by display_swap() then by display_process() at the end of every transfer.
+ *			When the frame is done, a present requested meanwhile is swapped in right away.
+ * @retval None
+ */
+static void display_transferNext(void)
+{
+	bool bResult;
+
+	if (g_ui8FlightWindow >= g_ui8FlightWindowCount)
+	{
+		g_bTransferBusy = false;
+		if (g_bPresentPending)
+		{
+			g_bPresentPending = false;
+			display_swap();
+		}
+		return;
+	}
+
+	display_window_t *pWindow = &g_pFlightWindows[g_ui8FlightWindow];
+	if (!g_bFlightWindowSet)
+	{
+		g_bFlightWindowSet = true;
+		bResult = display_setWindow(pWindow->ui8FirstColumn,
+				pWindow->ui8LastColumn, pWindow->ui8FirstPage,
+				pWindow->ui8LastPage);
+	}
+	else
+	{
+		g_bFlightWindowSet = false;
+		g_ui8FlightWindow++;
+		bResult = bsp_lcd_sendDisplayData(
+				&g_ui8DisplayFrontBuffer[pWindow->ui16Offset], pWindow->ui16Size);
+	}
+
+	if (!bResult)
+	{
+		/* Drop the frame, the next render or present rewrites the whole screen */
+		g_bResendAll = true;
+		g_bTransferBusy = false;
+	}
+}
+
+/**
+ * @brief  Copy the dirty spans to the front buffer and start sending them.
+ * @note   Called with the bus idle: by display_present(), or by display_process() for a
+ *			pending present while the application has not drawn since.
+ * @retval bool: Transfer state
+ *			@arg true: a frame is in flight
+ *			@arg false: nothing to send
+ */
+static bool display_swap(void)
+{
+	uint8_t ui8Count = display_planWindows(g_pFlightWindows);
+	if (0 == ui8Count)
+	{
+		return false;
+	}
+
+	for (uint8_t i = 0; i < ui8Count; i++)
+	{
+		memcpy(&g_ui8DisplayFrontBuffer[g_pFlightWindows[i].ui16Offset],
+				&g_ui8DisplayBuffer[g_pFlightWindows[i].ui16Offset],
+				g_pFlightWindows[i].ui16Size);
+	}
+
+	/* A synchronous command may still be on the bus, its completion must not step this frame */
+	while (bsp_lcd_isBusy());
+
+	g_ui8FlightWindowCount = ui8Count;
+	g_ui8FlightWindow = 0;
+	g_bFlightWindowSet = false;
+	g_bTransferDone = false;
+	g_bTransferBusy = true;
+	display_transferNext();
+	return true;
+}
+
+/**
+ * @brief  Transfer end notification from the LCD DMA TX interrupt.
+ * @note   The next transfer is left to display_process(): the HAL polls the address phase and
+ *			retries a not acknowledged address, which must not run in the interrupt.
+ * @param  bSucceeded: Transfer result.
+ * @retval None
+ */
+static void display_transferComplete(bool bSucceeded)
+{
+	if (!g_bTransferBusy)
+	{
+		/* Synchronous transfer */
+		return;
+	}
+	if (!bSucceeded)
+	{
+		g_bResendAll = true;
+		g_bTransferBusy = false;
+		return;
+	}
+	g_bTransferDone = true;
+}
+
+/**
+ * @brief  Wait for the asynchronous frame in flight, a pending present is left to the caller.
+ * @retval None
+ */
+static void display_waitIdle(void)
+{
+	g_bPresentPending = false;
+	while (g_bTransferBusy)
+	{
+		display_process();
+	}
+}
 
 /* Exported functions prototype ----------------------------------------------*/
 /**
@@ -192,54 +453,55 @@ bool display_init(void)
 	/* Reset the LCD module to let VCC stable */
 	bsp_lcd_reset();
 
-	bsp_lcd_sendCommand(SSD1306_DISPLAYOFF); /* 0xAE */
-	bsp_lcd_sendCommand(SSD1306_SETDISPLAYCLOCKDIV); /* 0xD5 */
-	bsp_lcd_sendCommand(0x80); /* The suggested ratio 0x80: Fosc=333+8*4.625(kHz), D=0+1 */
+	const uint8_t pui8InitCommands[] =
+	{ SSD1306_DISPLAYOFF, /* 0xAE */
+	SSD1306_SETDISPLAYCLOCKDIV, /* 0xD5 */
+	0x80, /* The suggested ratio 0x80: Fosc=333+8*4.625(kHz), D=0+1 */
+
+	SSD1306_SETMULTIPLEX, /* 0xA8 */
+	DISPLAY_HEIGHT - 1,
+
+	SSD1306_SETDISPLAYOFFSET, /* 0xD3 */
+	0, /* No Offset */
+	SSD1306_SETSTARTLINE | 0x0, /* Line #0 */
+	SSD1306_CHARGEPUMP, /* 0x8D */
+	(VCCTYPE_EXTERNAL == OLED_VCCTYPE) ? 0x10 /* Disable charge pump */
+			: 0x14, /* Enable charge pump during display on */
+	SSD1306_MEMORYMODE, /* 0x20 */
+	0x00, /* 0x00 act like ks0108 */
+	SSD1306_SEGREMAP | 0x1, /* Column address 127 is mapped to SEG0 */
+	SSD1306_COMSCANDEC, /* Re-mapped mode. Scan from COM[N-1] to COM0 */
 
-	bsp_lcd_sendCommand(SSD1306_SETMULTIPLEX); /* 0xA8 */
-	bsp_lcd_sendCommand(DISPLAY_HEIGHT - 1);
+	/* For OLED LCD 128x32 */
+	SSD1306_SETCOMPINS, /* 0xDA */
+	0x02, /* Sequential COM pin configuration */
+	SSD1306_SETCONTRAST, /* 0x81 */
+	0x8F,
 
-	bsp_lcd_sendCommand(SSD1306_SETDISPLAYOFFSET); /* 0xD3 */
-	bsp_lcd_sendCommand(0); /* No Offset */
-	bsp_lcd_sendCommand(SSD1306_SETSTARTLINE | 0x0); /* Line #0 */
-	bsp_lcd_sendCommand(SSD1306_CHARGEPUMP); /* 0x8D */
-	if (OLED_VCCTYPE == VCCTYPE_EXTERNAL)
-	{
-		bsp_lcd_sendCommand(0x10); /* Disable charge pump */
-	}
-	else
-	{
-		bsp_lcd_sendCommand(0x14); /* Enable charge pump during display on */
-	}
-	bsp_lcd_sendCommand(SSD1306_MEMORYMODE); /* 0x20 */
-	bsp_lcd_sendCommand(0x00); /* 0x00 act like ks0108 */
-	bsp_lcd_sendCommand(SSD1306_SEGREMAP | 0x1); /* Column address 127 is mapped to SEG0 */
-	bsp_lcd_sendCommand(SSD1306_COMSCANDEC); /* Re-mapped mode. Scan from COM[N-1] to COM0 */
+	SSD1306_SETPRECHARGE, /* 0xd9 */
+	(VCCTYPE_EXTERNAL == OLED_VCCTYPE) ? 0x22 /* Phase 2 period: 2 DCLKs, Phase 1 period: 2 DCLKs */
+			: 0xF1, /* Phase 2 period: 15 DCLKs, Phase 1 period: 1 DCLKs */
+	SSD1306_SETVCOMDETECT, /* 0xDB */
+	0x40, /* VCOMH de-select level ~VCC */
+	SSD1306_DISPLAYALLON_RESUME, /* 0xA4 */
+	SSD1306_NORMALDISPLAY, /* 0xA6 */
 
-	/* For OLED LCD 128x32 */
-	bsp_lcd_sendCommand(SSD1306_SETCOMPINS); /* 0xDA */
-	bsp_lcd_sendCommand(0x02); /* Sequential COM pin configuration */
-	bsp_lcd_sendCommand(SSD1306_SETCONTRAST); /* 0x81 */
-	bsp_lcd_sendCommand(0x8F);
+	SSD1306_DEACTIVATE_SCROLL,
 
-	bsp_lcd_sendCommand(SSD1306_SETPRECHARGE); /* 0xd9 */
-	if (OLED_VCCTYPE == VCCTYPE_EXTERNAL)
-	{
-		bsp_lcd_sendCommand(0x22); /* Phase 2 period: 2 DCLKs, Phase 1 period: 2 DCLKs */
-	}
-	else
+	/* Turn on OLED panel */
+	SSD1306_DISPLAYON };
+
+	/* The whole sequence is one command stream */
+	if (!bsp_lcd_sendCommandList(pui8InitCommands, sizeof(pui8InitCommands)))
 	{
-		bsp_lcd_sendCommand(0xF1); /* Phase 2 period: 15 DCLKs, Phase 1 period: 1 DCLKs */
+		return false;
 	}
-	bsp_lcd_sendCommand(SSD1306_SETVCOMDETECT); /* 0xDB */
-	bsp_lcd_sendCommand(0x40); /* VCOMH de-select level ~VCC */
-	bsp_lcd_sendCommand(SSD1306_DISPLAYALLON_RESUME); /* 0xA4 */
-	bsp_lcd_sendCommand(SSD1306_NORMALDISPLAY); /* 0xA6 */
 
-	bsp_lcd_sendCommand(SSD1306_DEACTIVATE_SCROLL);
+	/* The GDDRAM content is undefined after reset */
+	display_markAllDirty();
 
-	/* Turn on OLED panel */
-	bsp_lcd_sendCommand(SSD1306_DISPLAYON);
+	/* The DMA TX interrupt flags the end of every transfer of the asynchronous pipeline */
+	bsp_lcd_configTransferCallback(display_transferComplete);
 
 	return true;
 }
@@ -282,8 +544,9 @@ void display_setDim(bool bIsDim)
 	{
 		ui8ContrastValue = (VCCTYPE_EXTERNAL == OLED_VCCTYPE) ? (0x9F) : (0xCF);
 	}
-	bsp_lcd_sendCommand(SSD1306_SETCONTRAST);
-	bsp_lcd_sendCommand(ui8ContrastValue);
+	const uint8_t pui8Commands[] =
+	{ SSD1306_SETCONTRAST, ui8ContrastValue };
+	bsp_lcd_sendCommandList(pui8Commands, sizeof(pui8Commands));
 }
 
 /**
@@ -296,23 +559,117 @@ uint8_t* display_getRenderBufferPointer(void)
 }
 
 /**
- * @brief  Transmit the display buffer to the LCD device.
- * @note   This function will override the current display data which cause extra power cost.
- *         @arg Idea: For better approach, this function should support renew part of the display.
- *		   @arg Risk: Must consider the extra computation cost to determine the column and page to update.
+ * @brief  Mark a column range of one page in the render buffer as changed.
+ *			The graphic layer call this function before it modifies the render buffer,
+ *			display_render() and display_present() then only transmit the changed ranges.
+ * @param  ui8Page: Page of the changed data.
+ * @param  ui8FirstColumn: First changed column.
+ * @param  ui8LastColumn: Last changed column.
+ * @retval None
+ */
+void display_markDirty(uint8_t ui8Page, uint8_t ui8FirstColumn,
+		uint8_t ui8LastColumn)
+{
+	if (ui8LastColumn >= DISPLAY_WIDTH)
+	{
+		ui8LastColumn = DISPLAY_WIDTH - 1;
+	}
+	if ((ui8Page >= DISPLAY_PAGE_NUMBER) || (ui8FirstColumn > ui8LastColumn))
+	{
+		return;
+	}
+
+	/* The application modifies the back buffer: the pending frame is merged into the next present */
+	g_bPresentPending = false;
+
+	if (ui8FirstColumn < g_pui8DirtyFirstColumn[ui8Page])
+	{
+		g_pui8DirtyFirstColumn[ui8Page] = ui8FirstColumn;
+	}
+	if (ui8LastColumn > g_pui8DirtyLastColumn[ui8Page])
+	{
+		g_pui8DirtyLastColumn[ui8Page] = ui8LastColumn;
+	}
+}
+
+/**
+ * @brief  Transmit the changed part of the display buffer to the LCD device and wait until it is shown.
+ * @note   Synchronous path for boot screens and tests: the transfer in flight is finished first,
+ *			then the dirty windows are sent straight from the render buffer.
+ *			Nothing is sent if no page is dirty.
  * @retval None
  */
 void display_render(void)
 {
-	bsp_lcd_sendCommand(SSD1306_COLUMNADDR);
-	bsp_lcd_sendCommand(0); /* Column start address (0 = reset) */
-	bsp_lcd_sendCommand(DISPLAY_WIDTH - 1); /* Column end address (127 = reset) */
+	display_window_t pWindows[DISPLAY_PAGE_NUMBER];
 
-	bsp_lcd_sendCommand(SSD1306_PAGEADDR);
-	bsp_lcd_sendCommand(0); /* Page start address (0 = reset) */
-	bsp_lcd_sendCommand(3); /* Page end address for Height in 32pxl */
+	display_waitIdle();
 
-	bsp_lcd_sendData((uint8_t *) g_ui8DisplayBuffer, DISPLAY_BUFFER_SIZE);
+	uint8_t ui8Count = display_planWindows(pWindows);
+	for (uint8_t i = 0; i < ui8Count; i++)
+	{
+		display_setWindow(pWindows[i].ui8FirstColumn, pWindows[i].ui8LastColumn,
+				pWindows[i].ui8FirstPage, pWindows[i].ui8LastPage);
+		bsp_lcd_sendDisplayData(&g_pui8DisplayDataBuffer[pWindows[i].ui16Offset],
+				pWindows[i].ui16Size);
+	}
+	while (bsp_lcd_isBusy());
+}
+
+/**
+ * @brief  Queue the changed part of the display buffer for transmission and return at once.
+ * @note   The dirty spans are copied to the front buffer and sent transfer by transfer by
+ *			display_process(), so the application may draw the next frame meanwhile. A present
+ *			issued while a frame is on the bus is swapped in when the transfer completes; if the
+ *			application draws again before that, it is merged with the next present.
+ * @retval None
+ */
+void display_present(void)
+{
+	uint32_t ui32Primask;
+
+	display_process();
+	DISPLAY_ENTER_CRITICAL(ui32Primask);
+	if (g_bTransferBusy)
+	{
+		g_bPresentPending = true;
+		DISPLAY_EXIT_CRITICAL(ui32Primask);
+	}
+	else
+	{
+		DISPLAY_EXIT_CRITICAL(ui32Primask);
+		display_swap();
+	}
+}
+
+/**
+ * @brief  Start the next transfer of the frame in flight once the previous one completed.
+ * @note   Called from the main loop, the playback loop and display_delay_ms(): a frame is a few
+ *			transfers (window commands then data span per dirty page) and moves one at a call.
+ * @retval None
+ */
+void display_process(void)
+{
+	if (g_bTransferDone)
+	{
+		g_bTransferDone = false;
+		display_transferNext();
+	}
+}
+
+/**
+ * @brief  Wait for a delay while the frame in flight keeps being sent.
+ * @param  ui32Delay: Delay in millisecond.
+ * @retval None
+ */
+void display_delay_ms(uint32_t ui32Delay)
+{
+	uint32_t ui32Start = HAL_GetTick();
+
+	do
+	{
+		display_process();
+	} while ((HAL_GetTick() - ui32Start) < ui32Delay);
 }
 
 /**
@@ -321,15 +678,12 @@ void display_render(void)
  */
 void display_render_logo(void)
 {
-	bsp_lcd_sendCommand(SSD1306_COLUMNADDR);
-	bsp_lcd_sendCommand(0); /* Column start address (0 = reset) */
-	bsp_lcd_sendCommand(DISPLAY_WIDTH - 1); /* Column end address (127 = reset) */
+	display_waitIdle();
+	display_setWindow(0, DISPLAY_WIDTH - 1, 0, DISPLAY_PAGE_NUMBER - 1);
+	bsp_lcd_sendDisplayData(g_ui8LogoDisplay, DISPLAY_DATA_SIZE);
 
-	bsp_lcd_sendCommand(SSD1306_PAGEADDR);
-	bsp_lcd_sendCommand(0); /* Page start address (0 = reset) */
-	bsp_lcd_sendCommand(3); /* Page end address for Height in 32pxl */
-
-	bsp_lcd_sendData((uint8_t *) g_ui8LogoDisplay, DISPLAY_BUFFER_SIZE);
+	/* The LCD no longer shows the render buffer */
+	display_markAllDirty();
 }
 
 /**
@@ -338,6 +692,28 @@ void display_render_logo(void)
  */
 void display_clearRenderBuffer(void)
 {
+	uint8_t *pui8Page = g_pui8DisplayDataBuffer;
+
+	/* Only the lit columns of each page need to be sent again */
+	for (uint8_t ui8Page = 0; ui8Page < DISPLAY_PAGE_NUMBER; ui8Page++)
+	{
+		int16_t i16First = 0;
+		int16_t i16Last = DISPLAY_WIDTH - 1;
+		while ((i16First < DISPLAY_WIDTH) && (0 == pui8Page[i16First]))
+		{
+			i16First++;
+		}
+		if (i16First < DISPLAY_WIDTH)
+		{
+			while (0 == pui8Page[i16Last])
+			{
+				i16Last--;
+			}
+			display_markDirty(ui8Page, i16First, i16Last);
+		}
+		pui8Page += DISPLAY_WIDTH;
+	}
+
 	memset(g_pui8DisplayDataBuffer, 0, DISPLAY_DATA_SIZE);
 }
 
@@ -382,20 +758,27 @@ void display_setNormalMode(void)
  */
 void display_scrollUp(scroll_interval_t scrollInterval)
 {
-	bsp_lcd_sendCommand(SSD1306_DEACTIVATE_SCROLL);
+	display_waitIdle();
 
-	bsp_lcd_sendCommand(SSD1306_SET_VERTICAL_SCROLL_AREA);
-	bsp_lcd_sendCommand(0); /* Set No. of rows in top fixed area */
-	bsp_lcd_sendCommand(DISPLAY_HEIGHT); /* Set No. of rows in scroll area */
+	const uint8_t pui8Commands[] =
+	{ SSD1306_DEACTIVATE_SCROLL,
 
-	bsp_lcd_sendCommand(SSD1306_VERTICAL_AND_RIGHT_HORIZONTAL_SCROLL);
-	bsp_lcd_sendCommand(0x00); /* Dummy byte */
-	bsp_lcd_sendCommand(4); /* Start page address - out of range 128x23 */
-	bsp_lcd_sendCommand(scrollInterval); /* Time interval between each scroll step */
-	bsp_lcd_sendCommand(4); /* Stop page address - out of range 128x23 */
-	bsp_lcd_sendCommand(1); /* Vertical scrolling offset */
+	SSD1306_SET_VERTICAL_SCROLL_AREA,
+	0, /* Set No. of rows in top fixed area */
+	DISPLAY_HEIGHT, /* Set No. of rows in scroll area */
 
-	bsp_lcd_sendCommand(SSD1306_ACTIVATE_SCROLL);
+	SSD1306_VERTICAL_AND_RIGHT_HORIZONTAL_SCROLL,
+	0x00, /* Dummy byte */
+	4, /* Start page address - out of range 128x23 */
+	scrollInterval, /* Time interval between each scroll step */
+	4, /* Stop page address - out of range 128x23 */
+	1, /* Vertical scrolling offset */
+
+	SSD1306_ACTIVATE_SCROLL };
+	bsp_lcd_sendCommandList(pui8Commands, sizeof(pui8Commands));
+
+	/* The scroll moves the GDDRAM content */
+	display_markAllDirty();
 }
 
 /**
@@ -411,17 +794,24 @@ void display_scrollUp(scroll_interval_t scrollInterval)
  */
 void display_scrollRight(display_page_t pageStart, display_page_t pageStop)
 {
-	bsp_lcd_sendCommand(SSD1306_DEACTIVATE_SCROLL);
+	display_waitIdle();
+
+	const uint8_t pui8Commands[] =
+	{ SSD1306_DEACTIVATE_SCROLL,
+
+	SSD1306_RIGHT_HORIZONTAL_SCROLL,
+	0x00, /* Dummy byte */
+	pageStart, /* Start page address */
+	SCROLL_BY_2FPS, /* Time interval between each scroll step */
+	pageStop, /* End page address */
+	0x00, /* Dummy byte */
+	0xFF, /* Dummy byte */
 
-	bsp_lcd_sendCommand(SSD1306_RIGHT_HORIZONTAL_SCROLL);
-	bsp_lcd_sendCommand(0x00); /* Dummy byte */
-	bsp_lcd_sendCommand(pageStart); /* Start page address */
-	bsp_lcd_sendCommand(SCROLL_BY_2FPS); /* Time interval between each scroll step */
-	bsp_lcd_sendCommand(pageStop); /* End page address */
-	bsp_lcd_sendCommand(0x00); /* Dummy byte */
-	bsp_lcd_sendCommand(0xFF); /* Dummy byte */
+	SSD1306_ACTIVATE_SCROLL };
+	bsp_lcd_sendCommandList(pui8Commands, sizeof(pui8Commands));
 
-	bsp_lcd_sendCommand(SSD1306_ACTIVATE_SCROLL);
+	/* The scroll moves the GDDRAM content */
+	display_markAllDirty();
 }
 
 /**
@@ -437,17 +827,24 @@ void display_scrollRight(display_page_t pageStart, display_page_t pageStop)
  */
 void display_scrollLeft(display_page_t pageStart, display_page_t pageStop)
 {
-	bsp_lcd_sendCommand(SSD1306_DEACTIVATE_SCROLL);
+	display_waitIdle();
+
+	const uint8_t pui8Commands[] =
+	{ SSD1306_DEACTIVATE_SCROLL,
+
+	SSD1306_LEFT_HORIZONTAL_SCROLL,
+	0x00, /* Dummy byte */
+	pageStart, /* Start page address */
+	SCROLL_BY_2FPS, /* Time interval between each scroll step */
+	pageStop, /* Stop page address */
+	0x00, /* Dummy byte */
+	0xFF, /* Dummy byte */
 
-	bsp_lcd_sendCommand(SSD1306_LEFT_HORIZONTAL_SCROLL);
-	bsp_lcd_sendCommand(0x00); /* Dummy byte */
-	bsp_lcd_sendCommand(pageStart); /* Start page address */
-	bsp_lcd_sendCommand(SCROLL_BY_2FPS); /* Time interval between each scroll step */
-	bsp_lcd_sendCommand(pageStop); /* Stop page address */
-	bsp_lcd_sendCommand(0x00); /* Dummy byte */
-	bsp_lcd_sendCommand(0xFF); /* Dummy byte */
+	SSD1306_ACTIVATE_SCROLL };
+	bsp_lcd_sendCommandList(pui8Commands, sizeof(pui8Commands));
 
-	bsp_lcd_sendCommand(SSD1306_ACTIVATE_SCROLL);
+	/* The scroll moves the GDDRAM content */
+	display_markAllDirty();
 }
 
 /**
@@ -463,20 +860,27 @@ void display_scrollLeft(display_page_t pageStart, display_page_t pageStop)
  */
 void display_scrollDiagRight(display_page_t pageStart, display_page_t pageStop)
 {
-	bsp_lcd_sendCommand(SSD1306_DEACTIVATE_SCROLL);
+	display_waitIdle();
+
+	const uint8_t pui8Commands[] =
+	{ SSD1306_DEACTIVATE_SCROLL,
 
-	bsp_lcd_sendCommand(SSD1306_SET_VERTICAL_SCROLL_AREA);
-	bsp_lcd_sendCommand(0); /* Set No. of rows in top fixed area */
-	bsp_lcd_sendCommand(DISPLAY_HEIGHT); /* Set No. of rows in scroll area */
+	SSD1306_SET_VERTICAL_SCROLL_AREA,
+	0, /* Set No. of rows in top fixed area */
+	DISPLAY_HEIGHT, /* Set No. of rows in scroll area */
 
-	bsp_lcd_sendCommand(SSD1306_VERTICAL_AND_RIGHT_HORIZONTAL_SCROLL);
-	bsp_lcd_sendCommand(0x00); /* Dummy byte */
-	bsp_lcd_sendCommand(pageStart); /* Start page address */
-	bsp_lcd_sendCommand(SCROLL_BY_5FPS); /* Time interval between each scroll step */
-	bsp_lcd_sendCommand(pageStop); /* Stop page address */
-	bsp_lcd_sendCommand(1); /* Vertical scrolling offset */
+	SSD1306_VERTICAL_AND_RIGHT_HORIZONTAL_SCROLL,
+	0x00, /* Dummy byte */
+	pageStart, /* Start page address */
+	SCROLL_BY_5FPS, /* Time interval between each scroll step */
+	pageStop, /* Stop page address */
+	1, /* Vertical scrolling offset */
 
-	bsp_lcd_sendCommand(SSD1306_ACTIVATE_SCROLL);
+	SSD1306_ACTIVATE_SCROLL };
+	bsp_lcd_sendCommandList(pui8Commands, sizeof(pui8Commands));
+
+	/* The scroll moves the GDDRAM content */
+	display_markAllDirty();
 }
 
 /**
@@ -492,29 +896,40 @@ void display_scrollDiagRight(display_page_t pageStart, display_page_t pageStop)
  */
 void display_scrollDiagLeft(display_page_t pageStart, display_page_t pageStop)
 {
-	bsp_lcd_sendCommand(SSD1306_DEACTIVATE_SCROLL);
+	display_waitIdle();
+
+	const uint8_t pui8Commands[] =
+	{ SSD1306_DEACTIVATE_SCROLL,
 
-	bsp_lcd_sendCommand(SSD1306_SET_VERTICAL_SCROLL_AREA);
-	bsp_lcd_sendCommand(0); /* Set No. of rows in top fixed area */
-	bsp_lcd_sendCommand(DISPLAY_HEIGHT); /* Set No. of rows in scroll area */
+	SSD1306_SET_VERTICAL_SCROLL_AREA,
+	0, /* Set No. of rows in top fixed area */
+	DISPLAY_HEIGHT, /* Set No. of rows in scroll area */
 
-	bsp_lcd_sendCommand(SSD1306_VERTICAL_AND_LEFT_HORIZONTAL_SCROLL);
-	bsp_lcd_sendCommand(0x00); /* Dummy byte */
-	bsp_lcd_sendCommand(pageStart); /* Start page address */
-	bsp_lcd_sendCommand(SCROLL_BY_5FPS); /* Time interval between each scroll step */
-	bsp_lcd_sendCommand(pageStop); /* Stop page address */
-	bsp_lcd_sendCommand(1); /* Vertical scrolling offset */
+	SSD1306_VERTICAL_AND_LEFT_HORIZONTAL_SCROLL,
+	0x00, /* Dummy byte */
+	pageStart, /* Start page address */
+	SCROLL_BY_5FPS, /* Time interval between each scroll step */
+	pageStop, /* Stop page address */
+	1, /* Vertical scrolling offset */
 
-	bsp_lcd_sendCommand(SSD1306_ACTIVATE_SCROLL);
+	SSD1306_ACTIVATE_SCROLL };
+	bsp_lcd_sendCommandList(pui8Commands, sizeof(pui8Commands));
+
+	/* The scroll moves the GDDRAM content */
+	display_markAllDirty();
 }
 
 /**
  * @brief  Stop rolling the display.
+ * @note   The GDDRAM keeps the scrolled content, the next display_render() rewrites the whole screen.
  * @retval None
  */
 void display_scrollStop(void)
 {
+	display_waitIdle();
 	bsp_lcd_sendCommand(SSD1306_DEACTIVATE_SCROLL);
+
+	display_markAllDirty();
 }
 
 /**@}BSP_DRV_DISP_PRIVATE*/
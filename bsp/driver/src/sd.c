@@ -76,6 +76,22 @@ typedef enum
 	SD_IN_SPI_IDLE = 1 /*!< SD already in SPI mode */
 } sd_software_status_t;
 
+/**
+ * @typedef sd_init_state_t
+ * This type define the steps of the card identification sequence.
+ */
+typedef enum
+{
+	SD_INIT_RESET = 0, /*!< CMD0: software reset, enter SPI mode */
+	SD_INIT_CHECK_VOLTAGE, /*!< CMD8: interface condition, SD Ver.2 only */
+	SD_INIT_SET_CRC_MODE, /*!< CMD59: command and data CRC check on or off */
+	SD_INIT_WAIT_READY, /*!< CMD55-ACMD41: wait for the end of the card power up */
+	SD_INIT_READ_OCR, /*!< CMD58: capacity class */
+	SD_INIT_SET_BLOCK_LENGTH, /*!< CMD16: byte addressing card only */
+	SD_INIT_DONE, /*!< Card ready for data transfer */
+	SD_INIT_FAILED /*!< Card did not answer */
+} sd_init_state_t;
+
 /* Private define ------------------------------------------------------------*/
 /**
  * @brief  SD Commands: CMDxx = CMD-number | 0x40
@@ -87,6 +103,7 @@ typedef enum
 #define SD_CMD_SEND_CID               (10)  /*!< CMD10 = 0x4A */
 #define SD_CMD_STOP_TRANSMISSION      (12)  /*!< CMD12 = 0x4C */
 #define SD_CMD_SEND_STATUS            (13)  /*!< CMD13 = 0x4D */
+#define SD_CMD_SD_APP_STATUS          (13)  /*!< ACMD13 = 0x4D */
 #define SD_CMD_SET_BLOCKLEN           (16)  /*!< CMD16 = 0x50 */
 #define SD_CMD_READ_SINGLE_BLOCK      (17)  /*!< CMD17 = 0x51 */
 #define SD_CMD_READ_MULT_BLOCK        (18)  /*!< CMD18 = 0x52 */
@@ -107,6 +124,7 @@ typedef enum
 #define SD_CMD_APP_SEND_OP_COND	      (41)  /*!< CMD41 = 0x69 */
 #define SD_CMD_APP_CMD				  (55)  /*!< CMD55 = 0x77 */
 #define SD_CMD_READ_OCR				  (58)  /*!< CMD58 = 0x7A */
+#define SD_CMD_CRC_ON_OFF			  (59)  /*!< CMD59 = 0x7B */
 
 /**
  * @brief  Start Data tokens:
@@ -116,150 +134,304 @@ typedef enum
 #define SD_START_DATA_SINGLE_BLOCK_READ    (0xFE)  /*!< Data token start byte, Start Single Block Read */
 #define SD_START_DATA_MULTIPLE_BLOCK_READ  (0xFE)  /*!< Data token start byte, Start Multiple Block Read */
 #define SD_START_DATA_SINGLE_BLOCK_WRITE   (0xFE)  /*!< Data token start byte, Start Single Block Write */
-#define SD_START_DATA_MULTIPLE_BLOCK_WRITE (0xFD)  /*!< Data token start byte, Start Multiple Block Write */
+#define SD_START_DATA_MULTIPLE_BLOCK_WRITE (0xFC)  /*!< Data token start byte, Start Multiple Block Write */
 #define SD_STOP_DATA_MULTIPLE_BLOCK_WRITE  (0xFD)  /*!< Data token stop byte, Stop Multiple Block Write */
 
 /* Only need to correct the CRC of the first two CMD */
 #define SD_CRC_CMD_GO_IDLE_STATE	(0x95)
 #define SD_CRC_CMD_SEND_IF_COND		(0x87)
-#define SD_CRC_NOT_CARE				(0xFF)
+#define SD_CRC_NOT_CARE				(SDIO_COMMAND_CRC_AUTO) /*!< Other CMD: computed by the SDIO layer, checked once CMD59 enabled it */
+#define SD_CRC_RETRY				(3) /*!< Number of retry of a block transferred with a wrong CRC */
+
+#define SD_OCR_CCS					(0x40000000) /*!< Card Capacity Status bit in OCR: Block addressing */
+#define SD_CSD_STRUCTURE_V1			(0) /*!< CSD Version 1.0: Standard Capacity */
+#define SD_CSD_STRUCTURE_V2			(1) /*!< CSD Version 2.0: High Capacity and Extended Capacity */
+#define SD_CSD_V2_SDXC_MIN_C_SIZE	(0xFFFF) /*!< Minimum C_SIZE of SDXC, smaller value is SDHC */
+#define SD_CSD_V2_C_SIZE_UNIT_BLOCK	(1024) /*!< CSD Version 2.0: (C_SIZE + 1) in unit of 512KB */
 
 #define SD_NUMBER_OF_CSD_RESPONSE_BYTE	(16)
 #define SD_NUMBER_OF_CID_RESPONSE_BYTE	(16)
+#define SD_NUMBER_OF_SSR_RESPONSE_BYTE	(64) /*!< SD Status register: 512 bits */
+#define SD_SSR_AU_SIZE_BYTE				(10) /*!< AU_SIZE is bits [431:428] of the SD Status */
+#define SD_SSR_AU_SIZE_SHIFT			(4)
+
+#define SD_DATA_RESPONSE_TIMEOUT	(64) /*!< Number of byte to look for the data response token */
+#define SD_WRITE_BUSY_TIMEOUT_MS	(500) /*!< Maximum card programming time (SDHC spec: 500ms) */
+#define SD_ERASE_TIMEOUT_PER_UNIT_MS	(250) /*!< Maximum erase time of one erase unit */
+#define SD_CCC_ERASE				(1 << 5) /*!< Card Command Class 5: erase commands supported */
+#define SD_NOT_BUSY_TOKEN			(0xFF) /*!< The card release MISO line when programming is done */
+#define SD_DUMMY_BYTE				(0xFF) /*!< Dummy byte clocked out while reading */
+#define SD_INIT_TIMEOUT_MS			(1000) /*!< Maximum ACMD41 polling time (SD spec: 1s) */
+#define SD_MAX_SPI_CLOCK			(25000000) /*!< SPI mode only support the Default Speed: 25MHz */
+#define SD_DEFAULT_SPI_CLOCK		(25000000) /*!< Clock used when TRAN_SPEED is not decodable */
+#define SD_DETECT_DEBOUNCE_MS		(50) /*!< Card detect pin stable time before an insertion/removal is reported */
 
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
 sd_hardware_status_t g_sdStatus = SD_NOT_PRESENT;
 sd_software_status_t g_sdSoftareStatus = SD_NOT_IN_SPI_IDLE;
 
+static volatile bool g_bCardBusy = false; /*!< Card is programming the last written block */
+static uint32_t g_ui32BusyStartTick = 0; /*!< Tick when the last write command returned */
+static uint32_t g_ui32BusyTimeoutMs = SD_WRITE_BUSY_TIMEOUT_MS; /*!< Maximum duration of the pending busy period */
+static sd_busy_statistic_t g_sdBusyStatistic = { 0 }; /*!< Deferred busy-wait statistic */
+static sd_init_statistic_t g_sdInitStatistic = { 0 }; /*!< Last card initialization statistic */
+static sd_crc_statistic_t g_sdCrcStatistic = { 0 }; /*!< Data CRC error statistic */
+static sd_latency_statistic_t g_sdReadLatency = { 0 }; /*!< Read command duration statistic */
+static sd_latency_statistic_t g_sdWriteLatency = { 0 }; /*!< Write command duration statistic */
+static sd_hardware_status_t g_sdDetectSample = SD_NOT_PRESENT; /*!< Last card detect pin level */
+static uint32_t g_ui32DetectTick = 0; /*!< Tick when the card detect pin last toggled */
+static const uint16_t g_pui16Crc16Table[256] = /*!< CRC16-CCITT (x^16 + x^12 + x^5 + 1) of one byte */
+{ 0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+		0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+		0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+		0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+		0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+		0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+		0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+		0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+		0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+		0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+		0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+		0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+		0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+		0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+		0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+		0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+		0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+		0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+		0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+		0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+		0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+		0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+		0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+		0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+		0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+		0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+		0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+		0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+		0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+		0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+		0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+		0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0 };
+
+static uint32_t g_ui32Ocr = 0; /*!< OCR register read at the end of the identification */
+static sd_card_info_t g_sdCardInfo; /*!< Card geometry cached at initialization */
+static const uint32_t g_pui32SdAllocationUnit[16] = /*!< AU_SIZE code to number of SD_BLOCK_SIZE blocks */
+{ 0, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384, 24576, 32768,
+		49152, 65536, 131072 };
+
 /* Private functions declaration ---------------------------------------------*/
 static bool sd_goIdleState(void);
-static bool sd_getCSDRegister(sd_csd_t* pCsd);
+static uint32_t sd_getTransferSpeed(uint8_t ui8TranSpeed);
+static bool sd_getCSDRegister(uint8_t *pui8CsdResponseArray);
 static bool sd_getCIDRegister(sd_cid_t* pCid);
+static bool sd_readDataBlock(uint8_t *pui8Data, uint32_t ui32Size);
+static sd_response_t sd_readMultipleBlocks(uint8_t *pui8Data,
+		uint32_t ui32BlockAddr, uint32_t ui32NumberOfBlocks,
+		uint32_t *pui32ReadBlocks);
+static bool sd_stopTransmission(void);
+static sd_response_t sd_writeMultipleBlocks(uint8_t *pui8Data,
+		uint32_t ui32BlockAddr, uint32_t ui32NumberOfBlocks,
+		uint32_t *pui32WrittenBlocks);
+static bool sd_getSDStatusRegister(uint32_t *pui32AllocationUnit);
+static void sd_parseCSDRegister(const uint8_t *pui8CsdResponseArray,
+		sd_csd_t* pCsd);
+static void sd_computeCardGeometry(sd_card_info_t *pCardInfo,
+		bool bBlockAddressing);
+static uint32_t sd_getCommandAddress(uint32_t ui32BlockAddr);
 static sd_response_t sd_getDataResponse(void);
+static bool sd_waitNotBusy(uint32_t ui32TimeoutMs);
+static bool sd_activate(void);
+static void sd_markBusy(uint32_t ui32TimeoutMs);
+static void sd_recordLatency(sd_latency_statistic_t *pStatistic,
+		uint32_t ui32StartCycles, uint32_t ui32Blocks);
 
 /* Private function prototypes -----------------------------------------------*/
 /**
- * @brief  Put SD in Idle state.
+ * @brief  Put SD in Idle state then bring it out of identification mode.
+ * 		   The sequence is run as a state machine (CMD0, CMD8, ACMD41, CMD58
+ * 		   and CMD16) so that every step has a single failure exit. ACMD41 is
+ * 		   polled until the card leaves the idle state or SD_INIT_TIMEOUT_MS
+ * 		   elapsed, the card may never answer when it is not supplied properly.
  * @retval bool: The SD Response
  *			@arg true: Sequence succeed
  *			@arg false: Sequence failed
  */
 static bool sd_goIdleState(void)
 {
+	sd_init_state_t eState = SD_INIT_RESET;
+	uint32_t ui32TrailingResponse = 0;
+	uint32_t ui32StartTick = HAL_GetTick();
 	bool bReturn = false;
-	/* Send CMD0 (SD_CMD_GO_IDLE_STATE) to put SD in SPI mode and
-	 Wait for In Idle State Response (R1 Format) equal to 0x01 */
-	bsp_sdio_activate();
-	bReturn = bsp_sdio_sendCommand(SD_CMD_GO_IDLE_STATE, 0,
-	SD_CRC_CMD_GO_IDLE_STATE, SD_IN_IDLE_STATE);
-	bsp_sdio_deactivate();
-	bsp_sdio_sendDummy();
-	if (false == bReturn)
-	{
-		/* No Idle State Response: return response failure */
-		return false;
-	}
 
-	/*----------Activates the card initialization process-----------*/
-	/* Send CMD8 Wait for no error Response (R7 Format) Response 0x01 0x000001AA */
-	bsp_sdio_activate();
-	uint32_t ui32TrailingResponse = 0;
-	bReturn = bsp_sdio_sendSpecialCommand(SD_CMD_SEND_IF_COND, 0x000001AA,
-	SD_CRC_CMD_SEND_IF_COND, SD_IN_IDLE_STATE, &ui32TrailingResponse);
-	bsp_sdio_deactivate();
-	bsp_sdio_sendDummy();
-	if ((false == bReturn) || (0x01AA != (ui32TrailingResponse & 0x0FFF)))
+	g_sdInitStatistic.ui32ReadyPolls = 0;
+	while ((SD_INIT_DONE != eState) && (SD_INIT_FAILED != eState))
 	{
-		/* No Idle State Response: return response failure
-		 or Mismatch trailing response */
-		return false;
-	}
+		switch (eState)
+		{
+		case SD_INIT_RESET:
+			/* Send CMD0 (SD_CMD_GO_IDLE_STATE) to put SD in SPI mode and
+			 Wait for In Idle State Response (R1 Format) equal to 0x01 */
+			bsp_sdio_activate();
+			bReturn = bsp_sdio_sendCommand(SD_CMD_GO_IDLE_STATE, 0,
+			SD_CRC_CMD_GO_IDLE_STATE, SD_IN_IDLE_STATE);
+			bsp_sdio_deactivate();
+			bsp_sdio_sendDummy();
+			eState = (bReturn) ? (SD_INIT_CHECK_VOLTAGE) : (SD_INIT_FAILED);
+			break;
 
-	/* Send CMD55-ACMD41 until response equal to 0x0 and
-	 Wait for no error Response (R1 Format) equal to 0x00 */
-	while (true)
-	{
-		bsp_sdio_activate();
-		bsp_sdio_sendCommand(SD_CMD_APP_CMD, 0, SD_CRC_NOT_CARE,
-				SD_IN_IDLE_STATE); /* Response 0x01 */
-		bsp_sdio_deactivate();
-		bsp_sdio_sendDummy();
+		case SD_INIT_CHECK_VOLTAGE:
+			/* Send CMD8 Wait for no error Response (R7 Format) Response 0x01 0x000001AA */
+			bsp_sdio_activate();
+			ui32TrailingResponse = 0;
+			bReturn = bsp_sdio_sendSpecialCommand(SD_CMD_SEND_IF_COND,
+					0x000001AA, SD_CRC_CMD_SEND_IF_COND, SD_IN_IDLE_STATE,
+					&ui32TrailingResponse);
+			bsp_sdio_deactivate();
+			bsp_sdio_sendDummy();
+			/* No Idle State Response or Mismatch trailing response */
+			eState = ((bReturn) && (0x01AA == (ui32TrailingResponse & 0x0FFF))) ?
+					(SD_INIT_SET_CRC_MODE) : (SD_INIT_FAILED);
+			break;
 
-		bsp_sdio_activate();
-		bReturn = bsp_sdio_sendCommand(SD_CMD_APP_SEND_OP_COND, 0x40000000,
-		SD_CRC_NOT_CARE, SD_RESPONSE_NO_ERROR);
-		bsp_sdio_deactivate();
-		bsp_sdio_sendDummy();
-		if (true == bReturn)
-		{
+		case SD_INIT_SET_CRC_MODE:
+			/* Send CMD59 with bit 0 set to enable the CRC check: the card then
+			 rejects corrupted commands and written blocks, read blocks are checked here */
+			bsp_sdio_activate();
+			bReturn = bsp_sdio_sendCommand(SD_CMD_CRC_ON_OFF, SD_CRC_CHECK,
+			SD_CRC_NOT_CARE, SD_IN_IDLE_STATE);
+			bsp_sdio_deactivate();
+			bsp_sdio_sendDummy();
+			eState = (bReturn) ? (SD_INIT_WAIT_READY) : (SD_INIT_FAILED);
+			break;
+
+		case SD_INIT_WAIT_READY:
+			/* Send CMD55-ACMD41 until response equal to 0x0 and
+			 Wait for no error Response (R1 Format) equal to 0x00 */
+			bsp_sdio_activate();
+			bsp_sdio_sendCommand(SD_CMD_APP_CMD, 0, SD_CRC_NOT_CARE,
+					SD_IN_IDLE_STATE); /* Response 0x01 */
+			bsp_sdio_deactivate();
+			bsp_sdio_sendDummy();
+
+			bsp_sdio_activate();
+			bReturn = bsp_sdio_sendCommand(SD_CMD_APP_SEND_OP_COND, 0x40000000,
+			SD_CRC_NOT_CARE, SD_RESPONSE_NO_ERROR);
+			bsp_sdio_deactivate();
+			bsp_sdio_sendDummy();
+			g_sdInitStatistic.ui32ReadyPolls++;
+			if (bReturn)
+			{
+				eState = SD_INIT_READ_OCR;
+			}
+			else if ((HAL_GetTick() - ui32StartTick) > SD_INIT_TIMEOUT_MS)
+			{
+				eState = SD_INIT_FAILED;
+			}
+			/* else: card still initializing, poll again */
+			break;
+
+		case SD_INIT_READ_OCR:
+			/* Send CMD58 */
+			bsp_sdio_activate();
+			ui32TrailingResponse = 0;
+			bReturn = bsp_sdio_sendSpecialCommand(SD_CMD_READ_OCR, 0,
+			SD_CRC_NOT_CARE, SD_RESPONSE_NO_ERROR, &ui32TrailingResponse);
+			bsp_sdio_deactivate();
+			bsp_sdio_sendDummy();
+			if (bReturn)
+			{
+				/* Check CCS flag (bit 30) in OCR register */
+				g_ui32Ocr = ui32TrailingResponse;
+				/* SD Ver.2 Block address does not need the block length */
+				eState = (0 != (g_ui32Ocr & SD_OCR_CCS)) ?
+						(SD_INIT_DONE) : (SD_INIT_SET_BLOCK_LENGTH);
+			}
+			else
+			{
+				/* Error occur. Should not be here */
+				eState = SD_INIT_FAILED;
+			}
+			break;
+
+		case SD_INIT_SET_BLOCK_LENGTH:
+			/* SD Ver.2 Byte address - Force block size to 512 bytes to work with FAT file system */
+			bsp_sdio_activate();
+			bReturn = bsp_sdio_sendCommand(SD_CMD_SET_BLOCKLEN, SD_BLOCK_SIZE,
+			SD_CRC_NOT_CARE, SD_RESPONSE_NO_ERROR);
+			bsp_sdio_deactivate();
+			bsp_sdio_sendDummy();
+			eState = (bReturn) ? (SD_INIT_DONE) : (SD_INIT_FAILED);
+			break;
+
+		default:
+			eState = SD_INIT_FAILED;
 			break;
 		}
 	}
 
-	/* Send CMD58 */
-	bsp_sdio_activate();
-	ui32TrailingResponse = 0;
-	bReturn = bsp_sdio_sendSpecialCommand(SD_CMD_READ_OCR, 0, SD_CRC_NOT_CARE,
-			SD_RESPONSE_NO_ERROR, &ui32TrailingResponse);
-	bsp_sdio_deactivate();
-	bsp_sdio_sendDummy();
-	if (false == bReturn)
+	return (SD_INIT_DONE == eState);
+}
+
+/**
+ * @brief  Decode the maximum data transfer rate of the card.
+ * @param  ui8TranSpeed: TRAN_SPEED field of the CSD register
+ * @retval uint32_t: Maximum SPI clock in Hz, never above SD_MAX_SPI_CLOCK
+ */
+static uint32_t sd_getTransferSpeed(uint8_t ui8TranSpeed)
+{
+	/* Time value multiplied by 10: reserved, 1.0, 1.2, 1.3, ... 8.0 */
+	static const uint8_t pui8TimeValue[16] =
+	{ 0, 10, 12, 13, 15, 20, 25, 30, 35, 40, 45, 50, 55, 60, 70, 80 };
+	/* Transfer rate unit divided by 10: 100kbit/s, 1Mbit/s, 10Mbit/s, 100Mbit/s */
+	static const uint32_t pui32RateUnit[4] =
+	{ 10000, 100000, 1000000, 10000000 };
+	uint32_t ui32Frequency;
+
+	/* Bits [2:0] rate unit, bits [6:3] time value, upper units are reserved */
+	if ((ui8TranSpeed & 0x07) > 3)
 	{
-		/* Error occur. Return response failure. Should not be here */
-		return false;
+		return SD_DEFAULT_SPI_CLOCK;
 	}
-
-	/* Check CCS flag (bit 30) in OCR register */
-	if (0 == (ui32TrailingResponse & 0x40000000))
+	ui32Frequency = pui32RateUnit[ui8TranSpeed & 0x07]
+			* pui8TimeValue[(ui8TranSpeed >> 3) & 0x0F];
+	if (0 == ui32Frequency)
 	{
-		/* SD Ver.2 Byte address - Force block size to 512 bytes to work with FAT file system */
-		bsp_sdio_activate();
-		bReturn = bsp_sdio_sendCommand(SD_CMD_SET_BLOCKLEN, SD_BLOCK_SIZE,
-		SD_CRC_NOT_CARE, SD_RESPONSE_NO_ERROR);
-		bsp_sdio_deactivate();
-		bsp_sdio_sendDummy();
-		if (false == bReturn)
-		{
-			/* Error occur. Return response failure. Should not be here */
-			return false;
-		}
+		return SD_DEFAULT_SPI_CLOCK;
 	}
-	/* else: SD Ver.2 Block address */
-	return true;
+
+	return (ui32Frequency > SD_MAX_SPI_CLOCK) ?
+			(SD_MAX_SPI_CLOCK) : (ui32Frequency);
 }
 
 /**
  * @brief  Read the CSD card register.
  *         Reading the contents of the CSD register in SPI mode is a simple
  *         read-block transaction.
- * @param  pCsd: pointer on an SCD register structure
+ * @param  pui8CsdResponseArray: SD_NUMBER_OF_CSD_RESPONSE_BYTE buffer for the raw register
  * @retval bool: The SD Response
  *			@arg true: Read succeed
  *			@arg false: Read failed
  */
-static bool sd_getCSDRegister(sd_csd_t* pCsd)
+static bool sd_getCSDRegister(uint8_t *pui8CsdResponseArray)
 {
 	bool bReturn = false;
-	uint8_t pui8CsdResponseArray[SD_NUMBER_OF_CSD_RESPONSE_BYTE];
 
 	/* Send CMD9 (CSD register) or CMD10(CSD register) and
 	 * Wait for response in the R1 format (0x00 is no errors) */
-	bsp_sdio_activate();
+	if (!sd_activate())
+	{
+		return false;
+	}
 	if (bsp_sdio_sendCommand(SD_CMD_SEND_CSD, 0, SD_CRC_NOT_CARE,
 			SD_RESPONSE_NO_ERROR))
 	{
 		if (bsp_sdio_waitResponse(SD_START_DATA_SINGLE_BLOCK_READ))
 		{
 			/* Store CSD register value on CSD_Tab */
-			bsp_sdio_readData(pui8CsdResponseArray,
+			bReturn = sd_readDataBlock(pui8CsdResponseArray,
 			SD_NUMBER_OF_CSD_RESPONSE_BYTE);
-
-			/* Get CRC bytes (not really needed by us, but required by SD) */
-			bsp_sdio_sendDummy();
-			bsp_sdio_sendDummy();
-
-			bReturn = true;
 		}
 	}
 	bsp_sdio_deactivate();
@@ -267,84 +439,218 @@ static bool sd_getCSDRegister(sd_csd_t* pCsd)
 	/* Send dummy byte: 8 Clock pulses of delay */
 	bsp_sdio_sendDummy();
 
-	if (true == bReturn)
-	{
-		/* Byte 0 */
-		pCsd->CSDStruct = (pui8CsdResponseArray[0] & 0xC0) >> 6;
-		pCsd->SysSpecVersion = (pui8CsdResponseArray[0] & 0x3C) >> 2;
-		pCsd->Reserved1 = pui8CsdResponseArray[0] & 0x03;
-
-		/* Byte 1 */
-		pCsd->TAAC = pui8CsdResponseArray[1];
-
-		/* Byte 2 */
-		pCsd->NSAC = pui8CsdResponseArray[2];
-
-		/* Byte 3 */
-		pCsd->MaxBusClkFrec = pui8CsdResponseArray[3];
-
-		/* Byte 4 */
-		pCsd->CardComdClasses = pui8CsdResponseArray[4] << 4;
-
-		/* Byte 5 */
-		pCsd->CardComdClasses |= (pui8CsdResponseArray[5] & 0xF0) >> 4;
-		pCsd->RdBlockLen = pui8CsdResponseArray[5] & 0x0F;
-
-		/* Byte 6 */
-		pCsd->PartBlockRead = (pui8CsdResponseArray[6] & 0x80) >> 7;
-		pCsd->WrBlockMisalign = (pui8CsdResponseArray[6] & 0x40) >> 6;
-		pCsd->RdBlockMisalign = (pui8CsdResponseArray[6] & 0x20) >> 5;
-		pCsd->DSRImpl = (pui8CsdResponseArray[6] & 0x10) >> 4;
-		pCsd->Reserved2 = 0; /*!< Reserved */
+	return bReturn;
+}
 
-		pCsd->DeviceSize = (pui8CsdResponseArray[6] & 0x03) << 10;
+/**
+ * @brief  Decode the raw CSD register.
+ *         Both CSD Version 1.0 (SDSC) and Version 2.0 (SDHC/SDXC) layout are supported.
+ * @param  pui8CsdResponseArray: the 16 bytes CSD register, MSB first.
+ * @param  pCsd: pointer on an SCD register structure
+ * @retval None
+ */
+static void sd_parseCSDRegister(const uint8_t *pui8CsdResponseArray,
+		sd_csd_t* pCsd)
+{
+	/* Byte 0 */
+	pCsd->CSDStruct = (pui8CsdResponseArray[0] & 0xC0) >> 6;
+	pCsd->SysSpecVersion = (pui8CsdResponseArray[0] & 0x3C) >> 2;
+	pCsd->Reserved1 = pui8CsdResponseArray[0] & 0x03;
+
+	/* Byte 1 */
+	pCsd->TAAC = pui8CsdResponseArray[1];
+
+	/* Byte 2 */
+	pCsd->NSAC = pui8CsdResponseArray[2];
+
+	/* Byte 3 */
+	pCsd->MaxBusClkFrec = pui8CsdResponseArray[3];
+
+	/* Byte 4 */
+	pCsd->CardComdClasses = pui8CsdResponseArray[4] << 4;
+
+	/* Byte 5 */
+	pCsd->CardComdClasses |= (pui8CsdResponseArray[5] & 0xF0) >> 4;
+	pCsd->RdBlockLen = pui8CsdResponseArray[5] & 0x0F;
+
+	/* Byte 6 */
+	pCsd->PartBlockRead = (pui8CsdResponseArray[6] & 0x80) >> 7;
+	pCsd->WrBlockMisalign = (pui8CsdResponseArray[6] & 0x40) >> 6;
+	pCsd->RdBlockMisalign = (pui8CsdResponseArray[6] & 0x20) >> 5;
+	pCsd->DSRImpl = (pui8CsdResponseArray[6] & 0x10) >> 4;
+	pCsd->Reserved2 = 0; /*!< Reserved */
+
+	pCsd->DeviceSize = (pui8CsdResponseArray[6] & 0x03) << 10;
+
+	/* Byte 7 */
+	pCsd->DeviceSize |= (pui8CsdResponseArray[7]) << 2;
+
+	/* Byte 8 */
+	pCsd->DeviceSize |= (pui8CsdResponseArray[8] & 0xC0) >> 6;
+
+	pCsd->MaxRdCurrentVDDMin = (pui8CsdResponseArray[8] & 0x38) >> 3;
+	pCsd->MaxRdCurrentVDDMax = (pui8CsdResponseArray[8] & 0x07);
+
+	/* Byte 9 */
+	pCsd->MaxWrCurrentVDDMin = (pui8CsdResponseArray[9] & 0xE0) >> 5;
+	pCsd->MaxWrCurrentVDDMax = (pui8CsdResponseArray[9] & 0x1C) >> 2;
+	pCsd->DeviceSizeMul = (pui8CsdResponseArray[9] & 0x03) << 1;
+	/* Byte 10 */
+	pCsd->DeviceSizeMul |= (pui8CsdResponseArray[10] & 0x80) >> 7;
+
+	pCsd->EraseGrSize = (pui8CsdResponseArray[10] & 0x40) >> 6;
+	pCsd->EraseGrMul = (pui8CsdResponseArray[10] & 0x3F) << 1;
+
+	/* Byte 11 */
+	pCsd->EraseGrMul |= (pui8CsdResponseArray[11] & 0x80) >> 7;
+	pCsd->WrProtectGrSize = (pui8CsdResponseArray[11] & 0x7F);
+
+	/* Byte 12 */
+	pCsd->WrProtectGrEnable = (pui8CsdResponseArray[12] & 0x80) >> 7;
+	pCsd->ManDeflECC = (pui8CsdResponseArray[12] & 0x60) >> 5;
+	pCsd->WrSpeedFact = (pui8CsdResponseArray[12] & 0x1C) >> 2;
+	pCsd->MaxWrBlockLen = (pui8CsdResponseArray[12] & 0x03) << 2;
+
+	/* Byte 13 */
+	pCsd->MaxWrBlockLen |= (pui8CsdResponseArray[13] & 0xC0) >> 6;
+	pCsd->WriteBlockPaPartial = (pui8CsdResponseArray[13] & 0x20) >> 5;
+	pCsd->Reserved3 = 0;
+	pCsd->ContentProtectAppli = (pui8CsdResponseArray[13] & 0x01);
+
+	/* Byte 14 */
+	pCsd->FileFormatGrouop = (pui8CsdResponseArray[14] & 0x80) >> 7;
+	pCsd->CopyFlag = (pui8CsdResponseArray[14] & 0x40) >> 6;
+	pCsd->PermWrProtect = (pui8CsdResponseArray[14] & 0x20) >> 5;
+	pCsd->TempWrProtect = (pui8CsdResponseArray[14] & 0x10) >> 4;
+	pCsd->FileFormat = (pui8CsdResponseArray[14] & 0x0C) >> 2;
+	pCsd->ECC = (pui8CsdResponseArray[14] & 0x03);
+
+	/* Byte 15 */
+	pCsd->CSD_CRC = (pui8CsdResponseArray[15] & 0xFE) >> 1;
+	pCsd->Reserved4 = 1;
+
+	if (SD_CSD_STRUCTURE_V2 == pCsd->CSDStruct)
+	{
+		/* CSD Version 2.0: 22-bit C_SIZE in byte 7..9,
+		 current and C_SIZE_MULT fields do not exist anymore */
+		pCsd->DeviceSize = (pui8CsdResponseArray[7] & 0x3F) << 16;
+		pCsd->DeviceSize |= pui8CsdResponseArray[8] << 8;
+		pCsd->DeviceSize |= pui8CsdResponseArray[9];
+		pCsd->MaxRdCurrentVDDMin = 0;
+		pCsd->MaxRdCurrentVDDMax = 0;
+		pCsd->MaxWrCurrentVDDMin = 0;
+		pCsd->MaxWrCurrentVDDMax = 0;
+		pCsd->DeviceSizeMul = 0;
+	}
+}
 
-		/* Byte 7 */
-		pCsd->DeviceSize |= (pui8CsdResponseArray[7]) << 2;
+/**
+ * @brief  Compute the card type and geometry from the decoded CSD register.
+ * @param  pCardInfo: pointer to the SD Card Info structure, the Csd field must be valid.
+ * @param  bBlockAddressing: Card Capacity Status from the OCR register.
+ * @retval None
+ */
+static void sd_computeCardGeometry(sd_card_info_t *pCardInfo,
+		bool bBlockAddressing)
+{
+	sd_csd_t *pCsd = &(pCardInfo->Csd);
 
-		/* Byte 8 */
-		pCsd->DeviceSize |= (pui8CsdResponseArray[8] & 0xC0) >> 6;
+	if (SD_CSD_STRUCTURE_V2 == pCsd->CSDStruct)
+	{
+		/* Capacity = (C_SIZE + 1) * 512KB */
+		pCardInfo->CardBlockNumber = (pCsd->DeviceSize + 1)
+				* SD_CSD_V2_C_SIZE_UNIT_BLOCK;
+		pCardInfo->CardType =
+				(pCsd->DeviceSize >= SD_CSD_V2_SDXC_MIN_C_SIZE) ?
+						(SD_CARD_SDXC) : (SD_CARD_SDHC);
+	}
+	else
+	{
+		/* Capacity = (C_SIZE + 1) * 2^(C_SIZE_MULT + 2) * 2^READ_BL_LEN */
+		pCardInfo->CardBlockNumber = (pCsd->DeviceSize + 1)
+				<< (pCsd->DeviceSizeMul + 2 + pCsd->RdBlockLen - 9);
+		pCardInfo->CardType = SD_CARD_SDSC;
+	}
 
-		pCsd->MaxRdCurrentVDDMin = (pui8CsdResponseArray[8] & 0x38) >> 3;
-		pCsd->MaxRdCurrentVDDMax = (pui8CsdResponseArray[8] & 0x07);
+	pCardInfo->CardBlockAddressing = bBlockAddressing;
+	if (!bBlockAddressing)
+	{
+		/* Whatever the CSD said, a byte addressing card is a standard capacity card */
+		pCardInfo->CardType = SD_CARD_SDSC;
+	}
 
-		/* Byte 9 */
-		pCsd->MaxWrCurrentVDDMin = (pui8CsdResponseArray[9] & 0xE0) >> 5;
-		pCsd->MaxWrCurrentVDDMax = (pui8CsdResponseArray[9] & 0x1C) >> 2;
-		pCsd->DeviceSizeMul = (pui8CsdResponseArray[9] & 0x03) << 1;
-		/* Byte 10 */
-		pCsd->DeviceSizeMul |= (pui8CsdResponseArray[10] & 0x80) >> 7;
+	/* Erase unit = (SECTOR_SIZE + 1) write blocks of 2^WRITE_BL_LEN bytes
+	 (SDHC/SDXC: fixed to 64KB) */
+	pCardInfo->CardEraseBlockSize = (uint32_t) pCsd->EraseGrMul + 1;
+	if (pCsd->MaxWrBlockLen > 9)
+	{
+		pCardInfo->CardEraseBlockSize <<= (pCsd->MaxWrBlockLen - 9);
+	}
 
-		pCsd->EraseGrSize = (pui8CsdResponseArray[10] & 0x40) >> 6;
-		pCsd->EraseGrMul = (pui8CsdResponseArray[10] & 0x3F) << 1;
+	/* Transfer block size is forced to 512 bytes at initialization */
+	pCardInfo->CardBlockSize = SD_BLOCK_SIZE;
+	pCardInfo->CardCapacity = (uint64_t) pCardInfo->CardBlockNumber
+			* SD_BLOCK_SIZE;
+}
 
-		/* Byte 11 */
-		pCsd->EraseGrMul |= (pui8CsdResponseArray[11] & 0x80) >> 7;
-		pCsd->WrProtectGrSize = (pui8CsdResponseArray[11] & 0x7F);
+/**
+ * @brief  Convert a block number to the address argument of the read/write commands.
+ * @param  ui32BlockAddr: Block number (LBA) in unit of SD_BLOCK_SIZE.
+ * @retval uint32_t: block address for SDHC/SDXC, byte address for SDSC.
+ */
+static uint32_t sd_getCommandAddress(uint32_t ui32BlockAddr)
+{
+	return (g_sdCardInfo.CardBlockAddressing) ?
+			(ui32BlockAddr) : (ui32BlockAddr * SD_BLOCK_SIZE);
+}
 
-		/* Byte 12 */
-		pCsd->WrProtectGrEnable = (pui8CsdResponseArray[12] & 0x80) >> 7;
-		pCsd->ManDeflECC = (pui8CsdResponseArray[12] & 0x60) >> 5;
-		pCsd->WrSpeedFact = (pui8CsdResponseArray[12] & 0x1C) >> 2;
-		pCsd->MaxWrBlockLen = (pui8CsdResponseArray[12] & 0x03) << 2;
+/**
+ * @brief  Read the SD Status register (ACMD13) and decode the allocation unit size.
+ *         The response is a R2 followed by a 64 bytes data block.
+ * @param  pui32AllocationUnit: AU size in number of SD_BLOCK_SIZE blocks, 0 if not defined.
+ * @retval bool: The SD Response
+ *			@arg true: Read succeed
+ *			@arg false: Read failed
+ */
+static bool sd_getSDStatusRegister(uint32_t *pui32AllocationUnit)
+{
+	bool bReturn = false;
+	uint8_t pui8SsrResponseArray[SD_NUMBER_OF_SSR_RESPONSE_BYTE];
+	uint8_t ui8R2Status = SD_DUMMY_BYTE;
 
-		/* Byte 13 */
-		pCsd->MaxWrBlockLen |= (pui8CsdResponseArray[13] & 0xC0) >> 6;
-		pCsd->WriteBlockPaPartial = (pui8CsdResponseArray[13] & 0x20) >> 5;
-		pCsd->Reserved3 = 0;
-		pCsd->ContentProtectAppli = (pui8CsdResponseArray[13] & 0x01);
+	/* Send CMD55-ACMD13 (SD_CMD_SD_APP_STATUS) and
+	 Wait for response in the R1 format (0x00 is no errors) */
+	if (!sd_activate())
+	{
+		return false;
+	}
+	if (bsp_sdio_sendCommand(SD_CMD_APP_CMD, 0, SD_CRC_NOT_CARE,
+			SD_RESPONSE_NO_ERROR))
+	{
+		bsp_sdio_deactivate();
+		bsp_sdio_sendDummy();
+		bsp_sdio_activate();
+		if (bsp_sdio_sendCommand(SD_CMD_SD_APP_STATUS, 0, SD_CRC_NOT_CARE,
+				SD_RESPONSE_NO_ERROR))
+		{
+			/* Second byte of R2 response */
+			if (bsp_sdio_readData(&ui8R2Status, 1) && (0 == ui8R2Status)
+					&& bsp_sdio_waitResponse(SD_START_DATA_SINGLE_BLOCK_READ))
+			{
+				bReturn = sd_readDataBlock(pui8SsrResponseArray,
+				SD_NUMBER_OF_SSR_RESPONSE_BYTE);
+			}
+		}
+	}
+	bsp_sdio_deactivate();
 
-		/* Byte 14 */
-		pCsd->FileFormatGrouop = (pui8CsdResponseArray[14] & 0x80) >> 7;
-		pCsd->CopyFlag = (pui8CsdResponseArray[14] & 0x40) >> 6;
-		pCsd->PermWrProtect = (pui8CsdResponseArray[14] & 0x20) >> 5;
-		pCsd->TempWrProtect = (pui8CsdResponseArray[14] & 0x10) >> 4;
-		pCsd->FileFormat = (pui8CsdResponseArray[14] & 0x0C) >> 2;
-		pCsd->ECC = (pui8CsdResponseArray[14] & 0x03);
+	/* Send dummy byte: 8 Clock pulses of delay */
+	bsp_sdio_sendDummy();
 
-		/* Byte 15 */
-		pCsd->CSD_CRC = (pui8CsdResponseArray[15] & 0xFE) >> 1;
-		pCsd->Reserved4 = 1;
+	if (true == bReturn)
+	{
+		*pui32AllocationUnit = g_pui32SdAllocationUnit[pui8SsrResponseArray[SD_SSR_AU_SIZE_BYTE]
+				>> SD_SSR_AU_SIZE_SHIFT];
 	}
 	return bReturn;
 }
@@ -364,21 +670,18 @@ static bool sd_getCIDRegister(sd_cid_t* pCid)
 	uint8_t pui8CidResponseArray[SD_NUMBER_OF_CID_RESPONSE_BYTE];
 
 	/* Send CMD10 (CID register) and Wait for response in the R1 format (0x00 is no errors) */
-	bsp_sdio_activate();
+	if (!sd_activate())
+	{
+		return false;
+	}
 	if (bsp_sdio_sendCommand(SD_CMD_SEND_CID, 0, SD_CRC_NOT_CARE,
 			SD_RESPONSE_NO_ERROR))
 	{
 		if (bsp_sdio_waitResponse(SD_START_DATA_SINGLE_BLOCK_READ))
 		{
 			/* Store CID register value on CID_Tab */
-			bsp_sdio_readData(pui8CidResponseArray,
-			SD_NUMBER_OF_CSD_RESPONSE_BYTE);
-
-			/* Get CRC bytes (not really needed by us, but required by SD) */
-			bsp_sdio_sendDummy();
-			bsp_sdio_sendDummy();
-
-			bReturn = true;
+			bReturn = sd_readDataBlock(pui8CidResponseArray,
+			SD_NUMBER_OF_CID_RESPONSE_BYTE);
 		}
 	}
 	bsp_sdio_deactivate();
@@ -441,8 +744,256 @@ static bool sd_getCIDRegister(sd_cid_t* pCid)
 	return bReturn;
 }
 
+/**
+ * @brief  Read a data block and its CRC16 after the start block token.
+ * @param  pui8Data: Buffer to store the data block
+ * @param  ui32Size: Data block size in byte
+ * @retval bool: The data integrity
+ *			@arg true: CRC matched (or CRC check disabled)
+ *			@arg false: CRC mismatched or bus error
+ */
+static bool sd_readDataBlock(uint8_t *pui8Data, uint32_t ui32Size)
+{
+	uint8_t pui8Crc[2] = { SD_DUMMY_BYTE, SD_DUMMY_BYTE };
+
+	if (!bsp_sdio_readData(pui8Data, ui32Size)
+			|| !bsp_sdio_readData(pui8Crc, sizeof(pui8Crc)))
+	{
+		return false;
+	}
+#if (SD_CRC_CHECK)
+	return (((pui8Crc[0] << 8) | pui8Crc[1])
+			== sd_computeCRC16(pui8Data, ui32Size));
+#else
+	return true;
+#endif
+}
+
+/**
+ * @brief  Read block(s) in one CMD17 or CMD18 transaction.
+ * @param  pui8Data: Buffer to store the SD_BLOCK_SIZE bytes blocks
+ * @param  ui32BlockAddr: Block number (LBA) from where data is to be read
+ * @param  ui32NumberOfBlocks: Number of SD_BLOCK_SIZE blocks to read
+ * @param  pui32ReadBlocks: Number of blocks received with a good CRC
+ * @retval sd_response_t: Result of the transaction
+ *			@arg SD_RESPONSE_NO_ERROR: all blocks read
+ *			@arg SD_DATA_CRC_ERROR: block read with a wrong CRC
+ *			@arg SD_RESPONSE_FAILURE: command rejected, no data token or no CMD12 response
+ */
+static sd_response_t sd_readMultipleBlocks(uint8_t *pui8Data,
+		uint32_t ui32BlockAddr, uint32_t ui32NumberOfBlocks,
+		uint32_t *pui32ReadBlocks)
+{
+	bool bMultipleBlock = (ui32NumberOfBlocks > 1);
+	uint8_t ui8StartData =
+			(bMultipleBlock) ?
+					(SD_START_DATA_MULTIPLE_BLOCK_READ) :
+					(SD_START_DATA_SINGLE_BLOCK_READ);
+	sd_response_t sdResponse = SD_RESPONSE_NO_ERROR;
+
+	*pui32ReadBlocks = 0;
+
+	if (!sd_activate())
+	{
+		return SD_RESPONSE_FAILURE;
+	}
+
+	/* Send CMD17 (SD_CMD_READ_SINGLE_BLOCK) or CMD18 (SD_CMD_READ_MULT_BLOCK) to read blocks and
+	 Check if the SD acknowledged the read block command: R1 response (0x00: no errors) */
+	if (!bsp_sdio_sendCommand(
+			(bMultipleBlock) ?
+					(SD_CMD_READ_MULT_BLOCK) : (SD_CMD_READ_SINGLE_BLOCK),
+			sd_getCommandAddress(ui32BlockAddr), SD_CRC_NOT_CARE,
+			SD_RESPONSE_NO_ERROR))
+	{
+		bsp_sdio_deactivate();
+		bsp_sdio_sendDummy();
+		return SD_RESPONSE_FAILURE;
+	}
+
+	/* Data transfer: the card sends the blocks one after the other, each one after its access time */
+	while (ui32NumberOfBlocks--)
+	{
+		if (!bsp_sdio_waitResponse(ui8StartData))
+		{
+			sdResponse = SD_RESPONSE_FAILURE;
+			break;
+		}
+
+		/* Read the SD block data and its CRC */
+		if (!sd_readDataBlock(pui8Data, SD_BLOCK_SIZE))
+		{
+			sdResponse = SD_DATA_CRC_ERROR;
+			break;
+		}
+		(*pui32ReadBlocks)++;
+
+		/* Set next read address */
+		pui8Data += SD_BLOCK_SIZE;
+	}
+
+	/* Terminate the multiple block read, also after an error in the middle of it */
+	if (bMultipleBlock && !sd_stopTransmission()
+			&& (SD_RESPONSE_NO_ERROR == sdResponse))
+	{
+		sdResponse = SD_RESPONSE_FAILURE;
+	}
+
+	bsp_sdio_deactivate();
+	/* Send dummy byte: 8 Clock pulses of delay */
+	bsp_sdio_sendDummy();
+
+	return sdResponse;
+}
+
+/**
+ * @brief  Stop the data stream of CMD18 with CMD12.
+ * @note   The byte following CMD12 is a stuff byte, then comes the R1 response and
+ * 			a busy period. The R1 error bits are not checked: the card may flag the
+ * 			block it prefetched after the last requested one (end of the card),
+ * 			the requested blocks were already checked by their CRC.
+ * @retval bool: The SD Status
+ *			@arg true: Card stopped and ready
+ *			@arg false: No response or busy timeout
+ */
+static bool sd_stopTransmission(void)
+{
+	uint32_t ui32Timeout = SD_DATA_RESPONSE_TIMEOUT;
+	uint8_t ui8Response;
+
+	if (!bsp_sdio_sendCommand(SD_CMD_STOP_TRANSMISSION, 0, SD_CRC_NOT_CARE,
+			SDIO_NO_RESPONSE_EXPECTED))
+	{
+		return false;
+	}
+
+	/* Skip the stuff byte */
+	bsp_sdio_sendDummy();
+
+	/* R1 response: the first byte with the bit 7 cleared */
+	do
+	{
+		ui8Response = SD_DUMMY_BYTE;
+		bsp_sdio_readData(&ui8Response, 1);
+	} while ((ui8Response & 0x80) && --ui32Timeout);
+	if (0 == ui32Timeout)
+	{
+		return false;
+	}
+
+	/* R1b: the card keeps MISO low until it is ready for the next command */
+	return sd_waitNotBusy(SD_WRITE_BUSY_TIMEOUT_MS);
+}
+
+/**
+ * @brief  Writes block(s) in one CMD24 or CMD25 transaction.
+ * @note   The function returns before the card finishes programming the last block,
+ * 			the busy period is waited at the next card access.
+ * @param  pui8Data: Pointer to the data to write
+ * @param  ui32BlockAddr: Block number (LBA) from where data is to be written
+ * @param  ui32NumberOfBlocks: Number of SD_BLOCK_SIZE blocks to write
+ * @param  pui32WrittenBlocks: Number of blocks accepted by the card
+ * @retval sd_response_t: Data response of the last block sent
+ *			@arg SD_DATA_OK: all blocks accepted
+ *			@arg SD_DATA_CRC_ERROR: block rejected due to a CRC error
+ *			@arg Other: command or write error
+ */
+static sd_response_t sd_writeMultipleBlocks(uint8_t *pui8Data,
+		uint32_t ui32BlockAddr, uint32_t ui32NumberOfBlocks,
+		uint32_t *pui32WrittenBlocks)
+{
+	bool bMultipleBlock = (ui32NumberOfBlocks > 1);
+	uint8_t ui8StartData =
+			(bMultipleBlock) ?
+					(SD_START_DATA_MULTIPLE_BLOCK_WRITE) :
+					(SD_START_DATA_SINGLE_BLOCK_WRITE);
+	sd_response_t sdDataResponse = SD_DATA_OK;
+	uint8_t pui8Crc[2] = { SD_DUMMY_BYTE, SD_DUMMY_BYTE };
+
+	*pui32WrittenBlocks = 0;
+
+	/* Wait for the previous block programming only when the card is needed again */
+	if (!sd_activate())
+	{
+		return SD_DATA_OTHER_ERROR;
+	}
+
+	/* Send CMD24 (SD_CMD_WRITE_SINGLE_BLOCK) or CMD25 (SD_CMD_WRITE_MULT_BLOCK) to write blocks and
+	 Check if the SD acknowledged the write block command: R1 response (0x00: no errors) */
+	if (!bsp_sdio_sendCommand(
+			(bMultipleBlock) ?
+					(SD_CMD_WRITE_MULT_BLOCK) : (SD_CMD_WRITE_SINGLE_BLOCK),
+			sd_getCommandAddress(ui32BlockAddr), SD_CRC_NOT_CARE,
+			SD_RESPONSE_NO_ERROR))
+	{
+		bsp_sdio_deactivate();
+		bsp_sdio_sendDummy();
+		return SD_DATA_OTHER_ERROR;
+	}
+
+	/* Data transfer */
+	while (ui32NumberOfBlocks--)
+	{
+		/* Send dummy byte */
+		bsp_sdio_sendDummy();
+
+		/* Send the data token to signify the start of the data */
+		bsp_sdio_sendData(&ui8StartData, 1);
+
+		/* Write the block data to SD : write count data by block */
+		bsp_sdio_sendData(pui8Data, SD_BLOCK_SIZE);
+
+#if (SD_CRC_CHECK)
+		/* Put CRC bytes, the card rejects the block when they mismatch */
+		uint16_t ui16Crc = sd_computeCRC16(pui8Data, SD_BLOCK_SIZE);
+		pui8Crc[0] = (uint8_t) (ui16Crc >> 8);
+		pui8Crc[1] = (uint8_t) ui16Crc;
+#endif
+		bsp_sdio_sendData(pui8Crc, sizeof(pui8Crc));
+
+		/* Set next write address */
+		pui8Data += SD_BLOCK_SIZE;
+
+		/* Read data response, the card start programming the block right after it */
+		sdDataResponse = sd_getDataResponse();
+		if (SD_DATA_OK != sdDataResponse)
+		{
+			break;
+		}
+		(*pui32WrittenBlocks)++;
+
+		/* Next block of the same transaction can only be sent when the card is ready */
+		if ((0 < ui32NumberOfBlocks)
+				&& !sd_waitNotBusy(SD_WRITE_BUSY_TIMEOUT_MS))
+		{
+			sdDataResponse = SD_DATA_OTHER_ERROR;
+			break;
+		}
+	}
+
+	if (bMultipleBlock)
+	{
+		/* Terminate the multiple block write by the Stop Tran token */
+		uint8_t ui8StopData = SD_STOP_DATA_MULTIPLE_BLOCK_WRITE;
+		sd_waitNotBusy(SD_WRITE_BUSY_TIMEOUT_MS);
+		bsp_sdio_sendData(&ui8StopData, 1);
+		bsp_sdio_sendDummy();
+	}
+
+	/* Do not wait for the last programming here */
+	sd_markBusy(SD_WRITE_BUSY_TIMEOUT_MS);
+	bsp_sdio_deactivate();
+
+	/* Send dummy byte: 8 Clock pulses of delay to initiate internal write */
+	bsp_sdio_sendDummy();
+
+	return sdDataResponse;
+}
+
 /**
  * @brief  Get SD card data response.
+ * @note   The card keeps MISO low while programming the block after the data response.
+ * 			This function does not wait for that busy period, see sd_markBusy().
  * @retval The SD status: Read data response xxx0<status>1
  *         @arg status 010: Data accepted.
  *         @arg status 101: Data rejected due to a CRC error.
@@ -451,21 +1002,20 @@ static bool sd_getCIDRegister(sd_cid_t* pCid)
  */
 static sd_response_t sd_getDataResponse(void)
 {
-	uint32_t ui32Timeout = 64;
-	sd_response_t sdResponse, sdResponeReturnvalue;
+	uint32_t ui32Timeout = SD_DATA_RESPONSE_TIMEOUT;
+	uint8_t ui8Response;
 
 	while (ui32Timeout--)
 	{
 		/* Read response */
-		bsp_sdio_readData(&sdResponse, 1);
+		ui8Response = SD_DUMMY_BYTE;
+		bsp_sdio_readData(&ui8Response, 1);
 
 		/* Mask unused bits */
-		sdResponse &= 0x1F;
-		switch (sdResponse)
+		switch (ui8Response & 0x1F)
 		{
 		case SD_DATA_OK:
-			sdResponeReturnvalue = SD_DATA_OK;
-			break;
+			return SD_DATA_OK;
 
 		case SD_DATA_CRC_ERROR:
 			return SD_DATA_CRC_ERROR;
@@ -474,24 +1024,98 @@ static sd_response_t sd_getDataResponse(void)
 			return SD_DATA_WRITE_ERROR;
 
 		default:
-			sdResponeReturnvalue = SD_DATA_OTHER_ERROR;
 			break;
 		}
+	}
+	return SD_DATA_OTHER_ERROR;
+}
 
-		/* Exit loop in case of data ok */
-		if (SD_DATA_OK == sdResponeReturnvalue)
+/**
+ * @brief  Wait until the selected SD card releases the MISO line.
+ * @param  ui32TimeoutMs: Maximum busy time in ms.
+ * @retval bool: The SD Status
+ *			@arg true: Card ready
+ *			@arg false: Card busy timeout
+ */
+static bool sd_waitNotBusy(uint32_t ui32TimeoutMs)
+{
+	uint32_t ui32StartTick = HAL_GetTick();
+	uint8_t ui8Response;
+	do
+	{
+		ui8Response = SD_DUMMY_BYTE;
+		bsp_sdio_readData(&ui8Response, 1);
+		if ((HAL_GetTick() - ui32StartTick) > ui32TimeoutMs)
 		{
-			break;
+			return false;
 		}
+	} while (SD_NOT_BUSY_TOKEN != ui8Response);
+	return true;
+}
+
+/**
+ * @brief  Select the SD card for a new command.
+ *         If the card is still programming a previous written block,
+ *         wait here until it releases the MISO line.
+ * @retval bool: The SD Status
+ *			@arg true: Card selected and ready
+ *			@arg false: Card busy timeout
+ */
+static bool sd_activate(void)
+{
+	bsp_sdio_activate();
+	if (!g_bCardBusy)
+	{
+		return true;
 	}
 
-	/* Wait for null data */
-	do
+	uint32_t ui32AccessTick = HAL_GetTick();
+	if (!sd_waitNotBusy(g_ui32BusyTimeoutMs))
 	{
-		bsp_sdio_readData(&sdResponse, 1);
-	} while (0 == sdResponse);
+		bsp_sdio_deactivate();
+		bsp_sdio_sendDummy();
+		return false;
+	}
+
+	/* Time between the write return and this access was overlapped with other works */
+	g_sdBusyStatistic.ui32HiddenTimeMs += ui32AccessTick - g_ui32BusyStartTick;
+	g_sdBusyStatistic.ui32StalledTimeMs += HAL_GetTick() - ui32AccessTick;
+	g_bCardBusy = false;
+	return true;
+}
 
-	return sdResponeReturnvalue;
+/**
+ * @brief  Record the card is programming a block instead of waiting for it.
+ * @param  ui32TimeoutMs: Maximum duration of the busy period in ms.
+ * @retval None
+ */
+static void sd_markBusy(uint32_t ui32TimeoutMs)
+{
+	g_bCardBusy = true;
+	g_ui32BusyTimeoutMs = ui32TimeoutMs;
+	g_ui32BusyStartTick = HAL_GetTick();
+	g_sdBusyStatistic.ui32DeferredWrites++;
+}
+
+/**
+ * @brief  Account the duration of a data command.
+ * @param  pStatistic: read or write statistic
+ * @param  ui32StartCycles: cycle counter when the command was sent
+ * @param  ui32Blocks: number of blocks transferred by the command
+ * @retval None
+ */
+static void sd_recordLatency(sd_latency_statistic_t *pStatistic,
+		uint32_t ui32StartCycles, uint32_t ui32Blocks)
+{
+	uint32_t ui32Us = (DWT->CYCCNT - ui32StartCycles)
+			/ (SystemCoreClock / 1000000);
+	pStatistic->ui32Commands++;
+	pStatistic->ui32Blocks += ui32Blocks;
+	pStatistic->ui32TotalUs += ui32Us;
+	if (pStatistic->ui32MaxUs < ui32Us)
+	{
+		pStatistic->ui32MaxUs = ui32Us;
+	}
 }
 
 /* Exported functions prototype ----------------------------------------------*/
@@ -509,9 +1133,15 @@ bool sd_init(void)
 	}
 	else
 	{
-		/* Configure IO functionalities for SD pin */
+		/* Configure IO functionalities for SD pin, the bus runs at the
+		 identification clock until the CSD is known */
+		uint32_t ui32StartTick = HAL_GetTick();
 		bsp_sdio_init();
 
+		/* The cycle counter times the data commands */
+		CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+		DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
 		/* Check SD card  pin */
 		if (bsp_sdio_isDetected())
 		{
@@ -524,14 +1154,31 @@ bool sd_init(void)
 			return false;
 		}
 
-		/* SD initialized and set to SPI mode properly */
-		if (sd_goIdleState())
+		/* SD initialized and set to SPI mode properly,
+		 then cache the card geometry so that no more register read is needed */
+		uint8_t pui8CsdResponseArray[SD_NUMBER_OF_CSD_RESPONSE_BYTE];
+		if (sd_goIdleState() && sd_getCSDRegister(pui8CsdResponseArray)
+				&& sd_getCIDRegister(&(g_sdCardInfo.Cid)))
 		{
+			sd_decodeCardInfo(pui8CsdResponseArray, g_ui32Ocr, &g_sdCardInfo);
+
+			/* Identification done: switch to the card data transfer rate */
+			g_sdInitStatistic.ui32ClockHz = bsp_sdio_setClock(
+					sd_getTransferSpeed(g_sdCardInfo.Csd.MaxBusClkFrec));
+
+			/* Allocation unit is optional: SD 1.x cards do not report it */
+			if (!sd_getSDStatusRegister(&(g_sdCardInfo.CardAllocationUnit)))
+			{
+				g_sdCardInfo.CardAllocationUnit = 0;
+			}
+			g_sdInitStatistic.ui32InitTimeMs = HAL_GetTick() - ui32StartTick;
 			g_sdSoftareStatus = SD_IN_SPI_IDLE;
 			return true;
 		}
 		else
 		{
+			g_sdInitStatistic.ui32InitTimeMs = HAL_GetTick() - ui32StartTick;
+			g_sdInitStatistic.ui32ClockHz = 0;
 			g_sdSoftareStatus = SD_NOT_IN_SPI_IDLE;
 			return false;
 		}
@@ -550,176 +1197,376 @@ bool sd_getStatus(void)
 }
 
 /**
- * @brief  Returns the SD status.
+ * @brief  Follows the card detect pin, should be called periodically (main loop).
+ *         A removed or inserted card is not initialized anymore: sd_init()
+ *         identifies the new card and reads its geometry again.
+ * @retval bool: The card presence changed
+ *			@arg true: Card inserted or removed, see sd_getStatus()
+ *			@arg false: No change
+ */
+bool sd_pollDetect(void)
+{
+	sd_hardware_status_t sdStatus =
+			(bsp_sdio_isDetected()) ? (SD_PRESENT) : (SD_NOT_PRESENT);
+	if (sdStatus != g_sdDetectSample)
+	{
+		/* Contacts bounce while the card slides in its slot */
+		g_sdDetectSample = sdStatus;
+		g_ui32DetectTick = HAL_GetTick();
+		return false;
+	}
+
+	if ((sdStatus == g_sdStatus)
+			|| ((HAL_GetTick() - g_ui32DetectTick) < SD_DETECT_DEBOUNCE_MS))
+	{
+		return false;
+	}
+
+	g_sdStatus = sdStatus;
+	g_sdSoftareStatus = SD_NOT_IN_SPI_IDLE;
+	g_bCardBusy = false;
+	return true;
+}
+
+/**
+ * @brief  Returns the SD card information cached at initialization.
  * @param  pCardInfo: pointer to the SD Card Info structure.
  * @retval bool: The SD Status
- *			@arg true: Sequence succeed
- *			@arg false: Sequence failed
+ *			@arg true: Card information available
+ *			@arg false: Card not initialized
  */
 bool sd_getCardInfo(sd_card_info_t *pCardInfo)
 {
-	if (sd_getCSDRegister(&(pCardInfo->Csd)))
-	{
-		pCardInfo->CardCapacity = (pCardInfo->Csd.DeviceSize + 1);
-		pCardInfo->CardCapacity *= (1 << (pCardInfo->Csd.DeviceSizeMul + 2));
-		pCardInfo->CardBlockSize = 1 << (pCardInfo->Csd.RdBlockLen);
-		pCardInfo->CardCapacity *= pCardInfo->CardBlockSize;
-	}
-	else
+	if (SD_IN_SPI_IDLE != g_sdSoftareStatus)
 	{
 		return false;
 	}
+	*pCardInfo = g_sdCardInfo;
+	return true;
+}
 
-	return sd_getCIDRegister(&(pCardInfo->Cid));
+/**
+ * @brief  Decode the card type and geometry from its raw CSD and OCR registers.
+ *         sd_init() caches the result for the inserted card, a recorded register
+ *         can be decoded the same way to check the geometry computation.
+ * @param  pui8CsdResponseArray: the 16 bytes CSD register, MSB first.
+ * @param  ui32Ocr: OCR register (CMD58 response), only the CCS bit is used.
+ * @param  pCardInfo: pointer to the SD Card Info structure to fill, the Cid
+ * 			field and the allocation unit are left unchanged.
+ * @retval None
+ */
+void sd_decodeCardInfo(const uint8_t *pui8CsdResponseArray, uint32_t ui32Ocr,
+		sd_card_info_t *pCardInfo)
+{
+	sd_parseCSDRegister(pui8CsdResponseArray, &(pCardInfo->Csd));
+	sd_computeCardGeometry(pCardInfo, (0 != (ui32Ocr & SD_OCR_CCS)));
+}
+
+/**
+ * @brief  Returns the number of SD_BLOCK_SIZE blocks of the card cached at initialization.
+ * @retval uint32_t: Number of blocks, 0 if the card is not initialized.
+ */
+uint32_t sd_getBlockNumber(void)
+{
+	if (SD_IN_SPI_IDLE != g_sdSoftareStatus)
+	{
+		return 0;
+	}
+	return g_sdCardInfo.CardBlockNumber;
 }
 
 /**
  * @brief  Reads block(s) from a specified address in an SD card, in polling mode.
+ *         Several blocks are read in one CMD18 multiple block read transaction.
+ *         A block received with a wrong CRC is read again, with the following
+ *         ones, up to SD_CRC_RETRY times.
  * @param  pui32Data: Pointer to the buffer that will contain the data to transmit
- * @param  ui64ReadAddr: Address from where data is to be read
- * @param  ui16BlockSize: SD card data block size, that should be 512
- * @param  ui32NumberOfBlocks: Number of SD blocks to read
+ * @param  ui32BlockAddr: Block number (LBA) from where data is to be read
+ * @param  ui32NumberOfBlocks: Number of SD_BLOCK_SIZE blocks to read
  * @retval bool: The SD Status
  *			@arg true: Sequence succeed
  *			@arg false: Sequence failed
  */
-bool sd_readBlocks(uint32_t* pui32Data, uint64_t ui64ReadAddr,
-		uint16_t ui16BlockSize, uint32_t ui32NumberOfBlocks)
+bool sd_readBlocks(uint32_t* pui32Data, uint32_t ui32BlockAddr,
+		uint32_t ui32NumberOfBlocks)
 {
-	bool bReturn = false;
-	uint32_t ui32Offset = 0;
 	uint8_t *pui8Data = (uint8_t *) pui32Data;
+	uint32_t ui32ReadBlocks = 0;
+	uint32_t ui32Retry = 0;
+	uint32_t ui32StartCycles;
+	sd_response_t sdResponse;
 
-	/* Send CMD16 (SD_CMD_SET_BLOCKLEN) to set the size of the block and
-	 Check if the SD acknowledged the set block length command: R1 response (0x00: no errors) */
-	bsp_sdio_activate();
-	bReturn = bsp_sdio_sendCommand(SD_CMD_SET_BLOCKLEN, (uint32_t) ui16BlockSize,
-	SD_CRC_NOT_CARE, SD_RESPONSE_NO_ERROR);
-	if (false == bReturn)
-	{
-		bsp_sdio_deactivate();
-		bsp_sdio_sendDummy();
-		return false;
-	}
-
-	/* Data transfer */
-	while (ui32NumberOfBlocks--)
+	while (true)
 	{
-		bsp_sdio_deactivate();
-		/* Send dummy byte: 8 Clock pulses of delay */
-		bsp_sdio_sendDummy();
-
-		/* Send CMD17 (SD_CMD_READ_SINGLE_BLOCK) to read one block */
-		/* Check if the SD acknowledged the read block command: R1 response (0x00: no errors) */
-		bsp_sdio_activate();
-		bReturn = bsp_sdio_sendCommand(SD_CMD_READ_SINGLE_BLOCK,
-				ui64ReadAddr + ui32Offset,
-				SD_CRC_NOT_CARE, SD_RESPONSE_NO_ERROR);
-		if (false == bReturn)
+		ui32StartCycles = DWT->CYCCNT;
+		sdResponse = sd_readMultipleBlocks(pui8Data, ui32BlockAddr,
+				ui32NumberOfBlocks, &ui32ReadBlocks);
+		sd_recordLatency(&g_sdReadLatency, ui32StartCycles, ui32ReadBlocks);
+		if (SD_DATA_CRC_ERROR != sdResponse)
 		{
-			bsp_sdio_deactivate();
-			bsp_sdio_sendDummy();
-			return false;
+			return (SD_RESPONSE_NO_ERROR == sdResponse);
 		}
 
-		/* Now look for the data token to signify the start of the data */
-		if (bsp_sdio_waitResponse(SD_START_DATA_SINGLE_BLOCK_READ))
-		{
-			/* Read the SD block data : read NumByteToRead data */
-			bsp_sdio_readData((uint8_t *) (pui8Data + ui32Offset), ui16BlockSize);
-
-			/* Set next read address*/
-			ui32Offset += ui16BlockSize;
-
-			/* get CRC bytes (not really needed by us, but required by SD) */
-			bsp_sdio_sendDummy();
-			bsp_sdio_sendDummy();
-
-			/* Set response value to success */
-			bReturn = true;
-		}
-		else
+		/* Corrupted on the bus: restart the transaction from the corrupted block */
+		g_sdCrcStatistic.ui32ReadErrors++;
+		if (SD_CRC_RETRY <= ui32Retry++)
 		{
-			/* Set response value to failure */
-			bReturn = false;
+			g_sdCrcStatistic.ui32Failures++;
+			return false;
 		}
+		pui8Data += ui32ReadBlocks * SD_BLOCK_SIZE;
+		ui32BlockAddr += ui32ReadBlocks;
+		ui32NumberOfBlocks -= ui32ReadBlocks;
 	}
-
-	bsp_sdio_deactivate();
-	/* Send dummy byte: 8 Clock pulses of delay */
-	bsp_sdio_sendDummy();
-
-	return bReturn;
 }
 
 /**
  * @brief  Writes block(s) to a specified address in an SD card, in polling mode.
+ *         Several blocks are written in one CMD25 multiple block write transaction.
+ *         A block rejected by the card for a CRC error is sent again, with the
+ *         following ones, up to SD_CRC_RETRY times.
+ * @note   The function returns before the card finishes programming the last block,
+ * 			the busy period is waited at the next card access.
  * @param  pui32Data: Pointer to the buffer that will contain the data to transmit
- * @param  ui64WriteAddr: Address from where data is to be written
- * @param  ui16BlockSize: SD card data block size, that should be 512
- * @param  ui32NumberOfBlocks: Number of SD blocks to write
+ * @param  ui32BlockAddr: Block number (LBA) from where data is to be written
+ * @param  ui32NumberOfBlocks: Number of SD_BLOCK_SIZE blocks to write
  * @retval bool: The SD Status
  *			@arg true: Sequence succeed
  *			@arg false: Sequence failed
  */
-bool sd_writeBlocks(uint32_t* pui32Data, uint64_t ui64WriteAddr,
-		uint16_t ui16BlockSize, uint32_t ui32NumberOfBlocks)
+bool sd_writeBlocks(uint32_t* pui32Data, uint32_t ui32BlockAddr,
+		uint32_t ui32NumberOfBlocks)
 {
-	uint8_t bReturn = false;
-	uint32_t ui32Offset = 0;
 	uint8_t *pui8Data = (uint8_t *) pui32Data;
+	uint32_t ui32WrittenBlocks = 0;
+	uint32_t ui32Retry = 0;
+	uint32_t ui32StartCycles;
+	sd_response_t sdDataResponse;
 
-	uint8_t ui8StartData = SD_START_DATA_SINGLE_BLOCK_WRITE;
-
-	/* Data transfer */
-	bsp_sdio_activate();
-	while (ui32NumberOfBlocks--)
+	while (true)
 	{
-		/* Send CMD24 (SD_CMD_WRITE_SINGLE_BLOCK) to write blocks  and
-		 Check if the SD acknowledged the write block command: R1 response (0x00: no errors) */
-		if (!bsp_sdio_sendCommand(SD_CMD_WRITE_SINGLE_BLOCK,
-				(uint32_t) (ui64WriteAddr + ui32Offset), SD_CRC_NOT_CARE,
-				SD_RESPONSE_NO_ERROR))
+		ui32StartCycles = DWT->CYCCNT;
+		sdDataResponse = sd_writeMultipleBlocks(pui8Data, ui32BlockAddr,
+				ui32NumberOfBlocks, &ui32WrittenBlocks);
+		sd_recordLatency(&g_sdWriteLatency, ui32StartCycles,
+				ui32WrittenBlocks);
+		if (SD_DATA_CRC_ERROR != sdDataResponse)
 		{
-			bsp_sdio_deactivate();
-			bsp_sdio_sendDummy();
+			return (SD_DATA_OK == sdDataResponse);
+		}
+
+		/* Blocks before the rejected one are programmed,
+		 restart the transaction from the rejected block */
+		g_sdCrcStatistic.ui32WriteErrors++;
+		if (SD_CRC_RETRY <= ui32Retry++)
+		{
+			g_sdCrcStatistic.ui32Failures++;
 			return false;
 		}
+		pui8Data += ui32WrittenBlocks * SD_BLOCK_SIZE;
+		ui32BlockAddr += ui32WrittenBlocks;
+		ui32NumberOfBlocks -= ui32WrittenBlocks;
+	}
+}
 
-		/* Send dummy byte */
-		bsp_sdio_sendDummy();
+/**
+ * @brief  Erases block(s) of an SD card with CMD32, CMD33 and CMD38.
+ *         Erased blocks do not need to be erased again by the card when
+ *         they are written later, which speeds up the next writes.
+ * @note   The function returns as soon as the card accepted the erase command,
+ * 			the busy period is waited at the next card access.
+ * 			When the card only erases whole erase units (ERASE_BLK_EN = 0),
+ * 			the range is shrunk to the units fully inside it.
+ * @param  ui32BlockAddr: First block number (LBA) to erase
+ * @param  ui32NumberOfBlocks: Number of SD_BLOCK_SIZE blocks to erase
+ * @retval bool: The SD Status
+ *			@arg true: Sequence succeed (or nothing to erase)
+ *			@arg false: Sequence failed or erase not supported
+ */
+bool sd_eraseBlocks(uint32_t ui32BlockAddr, uint32_t ui32NumberOfBlocks)
+{
+	uint32_t ui32EraseBlockSize = g_sdCardInfo.CardEraseBlockSize;
+	uint32_t ui32EndBlockAddr = ui32BlockAddr + ui32NumberOfBlocks;
 
-		/* Send the data token to signify the start of the data */
-		bsp_sdio_sendData(&ui8StartData, 1);
+	if ((SD_IN_SPI_IDLE != g_sdSoftareStatus)
+			|| (0 == (g_sdCardInfo.Csd.CardComdClasses & SD_CCC_ERASE)))
+	{
+		return false;
+	}
 
-		/* Write the block data to SD : write count data by block */
-		bsp_sdio_sendData((uint8_t *) (pui8Data + ui32Offset), ui16BlockSize);
+	if (0 == g_sdCardInfo.Csd.EraseGrSize)
+	{
+		ui32BlockAddr = ((ui32BlockAddr + ui32EraseBlockSize - 1)
+				/ ui32EraseBlockSize) * ui32EraseBlockSize;
+		ui32EndBlockAddr = (ui32EndBlockAddr / ui32EraseBlockSize)
+				* ui32EraseBlockSize;
+	}
+	if (ui32EndBlockAddr <= ui32BlockAddr)
+	{
+		return true;
+	}
 
-		/* Set next write address */
-		ui32Offset += ui16BlockSize;
+	if (!sd_activate())
+	{
+		return false;
+	}
 
-		/* Put CRC bytes (not really needed by us, but required by SD) */
-		uint8_t pui8CRCResponse[2];
-		bsp_sdio_readData(pui8CRCResponse, 2);
+	/* Send CMD32 (SD_CMD_SD_ERASE_GRP_START), CMD33 (SD_CMD_SD_ERASE_GRP_END) to select
+	 the first and last block, then CMD38 (SD_CMD_ERASE): R1b response (0x00: no errors) */
+	if (!bsp_sdio_sendCommand(SD_CMD_SD_ERASE_GRP_START,
+			sd_getCommandAddress(ui32BlockAddr), SD_CRC_NOT_CARE,
+			SD_RESPONSE_NO_ERROR)
+			|| !bsp_sdio_sendCommand(SD_CMD_SD_ERASE_GRP_END,
+					sd_getCommandAddress(ui32EndBlockAddr - 1),
+					SD_CRC_NOT_CARE, SD_RESPONSE_NO_ERROR)
+			|| !bsp_sdio_sendCommand(SD_CMD_ERASE, 0, SD_CRC_NOT_CARE,
+					SD_RESPONSE_NO_ERROR))
+	{
+		bsp_sdio_deactivate();
+		bsp_sdio_sendDummy();
+		return false;
+	}
 
-		/* Read data response */
-		if (SD_DATA_OK == sd_getDataResponse())
-		{
-			/* Set response value to success */
-			bReturn = true;
-		}
-		else
-		{
-			/* Set response value to failure */
-			bReturn = false;
-		}
+	/* Do not wait for the erase here, it lasts up to 250ms per erase unit */
+	sd_markBusy(SD_WRITE_BUSY_TIMEOUT_MS
+			+ (((ui32EndBlockAddr - ui32BlockAddr) / ui32EraseBlockSize) + 1)
+					* SD_ERASE_TIMEOUT_PER_UNIT_MS);
+	bsp_sdio_deactivate();
+	bsp_sdio_sendDummy();
+
+	return true;
+}
+
+/**
+ * @brief  Check if the SD card is still programming the last written block.
+ *         This function does not block, it can be polled in the idle loop.
+ * @retval bool: The SD busy state
+ *			@arg true: Card is busy
+ *			@arg false: Card is ready for the next command
+ */
+bool sd_isBusy(void)
+{
+	if (!g_bCardBusy)
+	{
+		return false;
 	}
+
+	uint8_t ui8Response = SD_DUMMY_BYTE;
+	bsp_sdio_activate();
+	bsp_sdio_readData(&ui8Response, 1);
 	bsp_sdio_deactivate();
+	if (SD_NOT_BUSY_TOKEN != ui8Response)
+	{
+		return true;
+	}
 
-	/* Send dummy byte: 8 Clock pulses of delay to initiate internal write */
+	/* Programming finished in background */
+	g_sdBusyStatistic.ui32HiddenTimeMs += HAL_GetTick() - g_ui32BusyStartTick;
+	g_bCardBusy = false;
+	return false;
+}
+
+/**
+ * @brief  Wait until the SD card finishes the pending block programming.
+ * @retval bool: The SD Status
+ *			@arg true: Card ready
+ *			@arg false: Card busy timeout
+ */
+bool sd_waitReady(void)
+{
+	if (!sd_activate())
+	{
+		return false;
+	}
+	bsp_sdio_deactivate();
 	bsp_sdio_sendDummy();
+	return true;
+}
 
-	return bReturn;
+/**
+ * @brief  Get the statistic of the deferred card busy time.
+ * @note   The hidden time is accounted up to the moment the card is accessed again
+ * 			(or polled by sd_isBusy()), so it is an upper bound of the real programming time.
+ * @param  pStatistic: pointer to the statistic output structure.
+ * @retval None
+ */
+void sd_getBusyStatistic(sd_busy_statistic_t *pStatistic)
+{
+	*pStatistic = g_sdBusyStatistic;
+}
+
+/**
+ * @brief  Get the statistic of the last card initialization.
+ * @param  pStatistic: pointer to the statistic output structure.
+ * @retval None
+ */
+void sd_getInitStatistic(sd_init_statistic_t *pStatistic)
+{
+	*pStatistic = g_sdInitStatistic;
+}
+
+/**
+ * @brief  Get the statistic of the data CRC errors.
+ * @param  pStatistic: pointer to the statistic output structure.
+ * @retval None
+ */
+void sd_getCrcStatistic(sd_crc_statistic_t *pStatistic)
+{
+	*pStatistic = g_sdCrcStatistic;
+}
+
+/**
+ * @brief  Get the statistic of the data command durations.
+ * @param  pReadStatistic: pointer to the read statistic output structure.
+ * @param  pWriteStatistic: pointer to the write statistic output structure.
+ * @retval None
+ */
+void sd_getLatencyStatistic(sd_latency_statistic_t *pReadStatistic,
+		sd_latency_statistic_t *pWriteStatistic)
+{
+	*pReadStatistic = g_sdReadLatency;
+	*pWriteStatistic = g_sdWriteLatency;
+}
+
+/**
+ * @brief  Clear the statistic of the data command durations.
+ * @retval None
+ */
+void sd_resetLatencyStatistic(void)
+{
+	const sd_latency_statistic_t sdCleared = { 0 };
+	g_sdReadLatency = sdCleared;
+	g_sdWriteLatency = sdCleared;
+}
+
+/**
+ * @brief  Compute the CRC16 of an SD data block.
+ *         Table driven, one lookup per byte.
+ * @param  pui8Buffer: Data block
+ * @param  ui32Size: Data block size in byte
+ * @retval uint16_t: CRC16-CCITT with a zero seed, as sent after the data block
+ */
+uint16_t sd_computeCRC16(const uint8_t *pui8Buffer, uint32_t ui32Size)
+{
+	uint16_t ui16Crc = 0;
+
+	while (ui32Size--)
+	{
+		ui16Crc = (ui16Crc << 8)
+				^ g_pui16Crc16Table[(uint8_t) (ui16Crc >> 8) ^ *pui8Buffer++];
+	}
+	return ui16Crc;
+}
+
+/**
+ * @brief  Reset the statistic of the deferred card busy time.
+ * @retval None
+ */
+void sd_resetBusyStatistic(void)
+{
+	g_sdBusyStatistic.ui32DeferredWrites = 0;
+	g_sdBusyStatistic.ui32HiddenTimeMs = 0;
+	g_sdBusyStatistic.ui32StalledTimeMs = 0;
 }
 
 /**@}BSP_DRV_SD_PRIVATE*/
@@ -50,6 +50,16 @@ typedef enum
 	REC_16KHz = 1, /*!< Sample Rate, 0x1f40 = 8.0kHz, Average Bytes Per Second, 0x0fd7 for 8.0kHz */
 } record_rate_t;
 
+/**
+ * @struct _audio_statistic_t
+ * This type define the statistic of the CODEC feeding by the song player.
+ */
+typedef struct _audio_statistic_t
+{
+	uint32_t ui32Chunks; /*!< AUDIO_BUFFER_SIZE chunks sent to the CODEC */
+	uint32_t ui32Stalls; /*!< DREQ found requesting data with no chunk ready: the CODEC waited for the card */
+} audio_statistic_t;
+
 /* Exported constants --------------------------------------------------------*/
 /* Exported macro ------------------------------------------------------------*/
 /* Exported functions --------------------------------------------------------*/
@@ -57,6 +67,11 @@ bool audio_init(void);
 bool audio_playFileBlocking(const char *pcFileName);
 bool audio_recordFileBlocking(const char *pcFileName, uint32_t ui32PeriodSecond,
 		record_rate_t recordRate);
+bool audio_getRecordMinutesLeft(record_rate_t recordRate,
+		uint32_t *pui32Minutes);
+void audio_getStatistic(audio_statistic_t *pStatistic);
+void audio_resetStatistic(void);
+void audio_serveUsbSpeaker(void); /* Only built with USBD_AUDIO_ENABLE */
 
 /**@}LIB_AUDIO*/
 #endif /* AUDIO_H_ */
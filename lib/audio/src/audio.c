@@ -35,22 +35,48 @@
  * @{
  */
 /* Includes ------------------------------------------------------------------*/
+#include <string.h>
 #include "audio.h"
 #include "ff.h"
+#include "blockdev.h"
+#include "exfat.h"
 #include "text.h"
+#include "usbd_conf.h"
+#include "usbd_audio.h"
 
 /* Private typedef -----------------------------------------------------------*/
+/**
+ * @struct _audio_stream_t
+ * This type define a song read straight from the disk, bypassing FatFs.
+ */
+typedef struct _audio_stream_t
+{
+	bool bActive; /*!< The song is read by LBA instead of f_read() */
+	bool bExFat; /*!< The song is on an exFAT volume, mapped by exfat_mapSector() */
+	BYTE ui8Drive; /*!< Physical drive number */
+	DWORD ui32Sector; /*!< First sector of a contiguous FAT song */
+	DWORD ui32Size; /*!< Song size in byte unit */
+	DWORD ui32Position; /*!< Read position in byte unit */
+} audio_stream_t;
+
 /* Private define ------------------------------------------------------------*/
 #define REPORT_ON_SCREEN
 #define AUDIO_BUFFER_SIZE	(32) /*!< Number of byte in the local audio buffer */
 #define IMA_ADPCM_BLOCK_SIZE	(256) /*!< Record block size 128-word with 16-bit/words */
 #define WAV_HEADER_SIZE			(512) /*!< Record file header size in byte unit */
 #define FILE_BUFFER_SIZE		(512) /*!< Record file buffer size in byte unit */
+#define AUDIO_STREAM_SECTORS	(2) /*!< Sectors per raw read of a streamed song */
+#define AUDIO_STREAM_SIZE		(AUDIO_STREAM_SECTORS * 512) /*!< Raw stream buffer size in byte unit */
 
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
 static uint8_t g_pui8AudioBuffer[AUDIO_BUFFER_SIZE];
 static bool g_bNeedData = true;
+static uint8_t g_pui8StreamBuffer[AUDIO_STREAM_SIZE];
+static audio_stream_t g_audioStream;
+static exfat_volume_t g_exfatVolume; /*!< Mounted when FatFs finds no FAT volume */
+static exfat_file_t g_exfatSong;
+static audio_statistic_t g_audioStatistic; /*!< CODEC feeding of the song player */
 
 static const uint8_t g_pui8RIFFHeader0[] = /* 52 bytes */
 { 'R', 'I', 'F', 'F', /* Chunk ID (RIFF) */
@@ -71,6 +97,10 @@ static const uint8_t g_pui8RIFFHeader0[] = /* 52 bytes */
 0xff, 0xff, 0xff, 0xff /* Number of Samples (calculate after rec!) */
 }; /* Insert 452 zeroes here! */
 
+#if USBD_AUDIO_ENABLE == 1
+static uint32_t g_ui32SpeakerGeneration = 0; /*!< USB stream played by the CODEC */
+#endif /* USBD_AUDIO_ENABLE == 1 */
+
 static const uint8_t g_pui8RIFFHeader504[] = /* 8 bytes */
 { 'd', 'a', 't', 'a', /* Chunk ID (data) */
 0x70, 0x70, 0x70, 0x70 /* Chunk payload size (calculate after rec!) */
@@ -79,6 +109,9 @@ static const uint8_t g_pui8RIFFHeader504[] = /* 8 bytes */
 /* Private functions declaration ---------------------------------------------*/
 static bool audio_readSongData(FIL *pFile, uint8_t *pui8DestBuffer,
 		uint32_t ui32ReadSize);
+static bool audio_mapStreamSector(DWORD ui32Position, DWORD *pui32Sector,
+		DWORD *pui32Count);
+static bool audio_readStreamData(uint8_t *pui8DestBuffer, uint32_t ui32ReadSize);
 #ifdef REPORT_ON_SCREEN
 static void audio_renderStatus(uint32_t ui32CurrentPos,
 		uint32_t *pui32NextReportPos);
@@ -97,6 +130,11 @@ static void audio_renderStatus(uint32_t ui32CurrentPos,
 static bool audio_readSongData(FIL *pFile, uint8_t *pui8DestBuffer,
 		uint32_t ui32ReadSize)
 {
+	if (g_audioStream.bActive)
+	{
+		return audio_readStreamData(pui8DestBuffer, ui32ReadSize);
+	}
+
 	FRESULT res;
 	uint32_t ui32BytesRead = 0;
 	res = f_read(pFile, pui8DestBuffer, ui32ReadSize, (UINT*) &ui32BytesRead);
@@ -107,6 +145,93 @@ static bool audio_readSongData(FIL *pFile, uint8_t *pui8DestBuffer,
 	return true;
 }
 
+/**
+ * @brief  Get the sectors holding a position of the streamed song.
+ * @param  ui32Position: position in byte unit.
+ * @param  pui32Sector: sector address (LBA) storage pointer.
+ * @param  pui32Count: number of consecutive sectors from this sector storage pointer.
+ * @retval bool: process status
+ *			@arg true: sector mapped
+ *			@arg false: end of the song or disk error
+ */
+static bool audio_mapStreamSector(DWORD ui32Position, DWORD *pui32Sector,
+		DWORD *pui32Count)
+{
+	if (g_audioStream.bExFat)
+	{
+		return exfat_mapSector(&g_exfatSong, ui32Position, pui32Sector,
+				pui32Count);
+	}
+
+	/* Contiguous FAT song */
+	*pui32Sector = g_audioStream.ui32Sector + (ui32Position / 512);
+	*pui32Count = ((g_audioStream.ui32Size - ui32Position) + 511) / 512;
+	return true;
+}
+
+/**
+ * @brief  Read a block data of the streamed song straight from the disk.
+ * @note   The sectors are read by AUDIO_STREAM_SECTORS with multi-block
+ * 			disk_read() at LBAs computed from the position, without FatFs.
+ * 			The read size must divide AUDIO_STREAM_SIZE.
+ * @param  pui8DestBuffer: Destination buffer data pointer.
+ * @param  ui32ReadSize: Size of the data block need to read.
+ * @retval bool: process status
+ *			@arg true: read completed
+ *			@arg false: failed to read - EOF or the medium was changed
+ */
+static bool audio_readStreamData(uint8_t *pui8DestBuffer, uint32_t ui32ReadSize)
+{
+	uint32_t ui32Offset = g_audioStream.ui32Position % AUDIO_STREAM_SIZE;
+	DWORD ui32Sectors;
+	DWORD ui32Sector;
+	DWORD ui32Count;
+	DWORD i;
+
+	if (g_audioStream.ui32Position >= g_audioStream.ui32Size)
+	{
+		return false;
+	}
+
+	if (0 == ui32Offset)
+	{
+		/* The host may have rewritten the card through USB */
+		if (disk_status(g_audioStream.ui8Drive) & STA_NOINIT)
+		{
+			return false;
+		}
+		ui32Sectors = ((g_audioStream.ui32Size - g_audioStream.ui32Position)
+				+ 511) / 512;
+		if (AUDIO_STREAM_SECTORS < ui32Sectors)
+		{
+			ui32Sectors = AUDIO_STREAM_SECTORS;
+		}
+		/* A fragmented exFAT song may change cluster inside the buffer */
+		for (i = 0; i < ui32Sectors; i += ui32Count)
+		{
+			if (!audio_mapStreamSector(g_audioStream.ui32Position + (i * 512),
+					&ui32Sector, &ui32Count))
+			{
+				return false;
+			}
+			if (ui32Count > (ui32Sectors - i))
+			{
+				ui32Count = ui32Sectors - i;
+			}
+			if (RES_OK
+					!= disk_read(g_audioStream.ui8Drive,
+							&g_pui8StreamBuffer[i * 512], ui32Sector, ui32Count))
+			{
+				return false;
+			}
+		}
+	}
+
+	memcpy(pui8DestBuffer, &g_pui8StreamBuffer[ui32Offset], ui32ReadSize);
+	g_audioStream.ui32Position += ui32ReadSize;
+	return true;
+}
+
 #ifdef REPORT_ON_SCREEN
 /**
  * @brief  Render current audio format, sample rate, channel, decoded time, processed data
@@ -159,7 +284,8 @@ static void audio_renderStatus(uint32_t ui32CurrentPos,
 		text_printString("KB");
 		text_printString("             \n");
 
-		graphic_render();
+		/* Non-blocking: the decoder is fed while the status is on the bus */
+		graphic_present();
 		*pui32NextReportPos +=
 				(audioFormat == afMidi || audioFormat == afUnknown) ?
 						REPORT_INTERVAL_MIDI : REPORT_INTERVAL;
@@ -184,6 +310,112 @@ bool audio_init(void)
 	return true;
 }
 
+#if USBD_AUDIO_ENABLE == 1
+/**
+ * @brief  Play the PCM streamed by the USB host, never waits for the host.
+ *         Should be called from the main loop as often as possible: the CODEC
+ *         is fed by 32 bytes while it requests data (DREQ).
+ * @note   The CODEC is restarted with a PCM RIFF header when the host starts
+ * 			the stream or changes the sampling frequency.
+ * @retval None
+ */
+void audio_serveUsbSpeaker(void)
+{
+	uint32_t ui32SampleRate, ui32Generation;
+	const uint8_t *pui8Data;
+
+	if (usbd_audio_getStream(&ui32SampleRate, &ui32Generation)
+			&& (g_ui32SpeakerGeneration != ui32Generation))
+	{
+		/* 16-bit stereo PCM of unknown length */
+		uint8_t pui8Header[44] =
+		{ 'R', 'I', 'F', 'F', 0xFF, 0xFF, 0xFF, 0xFF, 'W', 'A', 'V', 'E', 'f',
+				'm', 't', ' ', 0x10, 0x00, 0x00, 0x00, 0x01, 0x00, /* PCM */
+				0x02, 0x00, /* Channels (2) */
+				0x00, 0x00, 0x00, 0x00, /* [24] Sample Rate */
+				0x00, 0x00, 0x00, 0x00, /* [28] Average Bytes Per Second */
+				AUDIO_FRAME_SIZE, 0x00, /* Block Align */
+				0x10, 0x00, /* Bits per sample (16) */
+				'd', 'a', 't', 'a', 0xFF, 0xFF, 0xFF, 0xFF };
+		uint32_t ui32ByteRate = ui32SampleRate * AUDIO_FRAME_SIZE;
+		pui8Header[24] = (uint8_t) ui32SampleRate;
+		pui8Header[25] = (uint8_t) (ui32SampleRate >> 8);
+		pui8Header[26] = (uint8_t) (ui32SampleRate >> 16);
+		pui8Header[28] = (uint8_t) ui32ByteRate;
+		pui8Header[29] = (uint8_t) (ui32ByteRate >> 8);
+		pui8Header[30] = (uint8_t) (ui32ByteRate >> 16);
+
+		g_ui32SpeakerGeneration = ui32Generation;
+		acodec_reset();
+		acodec_initPlaying();
+		acodec_sendData(pui8Header, sizeof(pui8Header));
+	}
+
+	while (!acodec_isDeviceBusy())
+	{
+		pui8Data = usbd_audio_getData(AUDIO_BUFFER_SIZE);
+		if (NULL == pui8Data)
+		{
+			break;
+		}
+		acodec_sendData(pui8Data, AUDIO_BUFFER_SIZE);
+		usbd_audio_releaseData(AUDIO_BUFFER_SIZE);
+	}
+}
+#endif /* USBD_AUDIO_ENABLE == 1 */
+
+/**
+ * @brief  Get the recording time left on the card without scanning the FAT.
+ * @note   The free space comes from the cached free cluster count, which is
+ * 			seeded by the background scan (f_scanfree) of the main loop.
+ * @param  recordRate: the target sample rate for recording
+ *			@arg REC_8KHz: sample rate 8KHz
+ *			@arg REC_16KHz: sample rate 16KHz
+ * @param  pui32Minutes: the recording minutes left storage pointer.
+ * @retval bool: process status
+ *			@arg true: the minutes are valid
+ *			@arg false: the free space is not known yet
+ */
+bool audio_getRecordMinutesLeft(record_rate_t recordRate,
+		uint32_t *pui32Minutes)
+{
+	FATFS *pFatFs;
+	DWORD ui32FreeClusters;
+	uint64_t ui64FreeSectors;
+
+	if ((FR_OK != f_scanfree("", 0, &ui32FreeClusters, &pFatFs))
+			|| (0xFFFFFFFF == ui32FreeClusters))
+	{
+		return false;
+	}
+
+	/* 505 samples/block: 4 sectors (8kHz) or 8 sectors (16kHz) every 505ms */
+	ui64FreeSectors = (uint64_t) ui32FreeClusters * pFatFs->csize;
+	*pui32Minutes = (uint32_t) ((ui64FreeSectors * 505)
+			/ (((REC_16KHz == recordRate) ? (8) : (4)) * 60000));
+	return true;
+}
+
+/**
+ * @brief  Get the statistic of the CODEC feeding by the song player.
+ * @param  pStatistic: pointer to the statistic output structure.
+ * @retval None
+ */
+void audio_getStatistic(audio_statistic_t *pStatistic)
+{
+	*pStatistic = g_audioStatistic;
+}
+
+/**
+ * @brief  Reset the statistic of the CODEC feeding by the song player.
+ * @retval None
+ */
+void audio_resetStatistic(void)
+{
+	g_audioStatistic.ui32Chunks = 0;
+	g_audioStatistic.ui32Stalls = 0;
+}
+
 /**
  * @brief  Play the audio file in file system. Current supported *.mp3 and *.wav.
  * @param  pcFileName: string of the audio file to play.
@@ -204,7 +436,28 @@ bool audio_playFileBlocking(const char *pcFileName)
 #endif
 
 	FIL file;
-	if (FR_OK != f_open(&file, pcFileName, FA_READ))
+	FRESULT res = f_open(&file, pcFileName, FA_READ);
+	memset(&g_audioStream, 0, sizeof(audio_stream_t));
+	if (FR_OK == res)
+	{
+		/* Unfragmented songs are streamed by LBA, bypassing FatFs */
+		g_audioStream.ui32Sector = f_getlba(&file);
+		g_audioStream.bActive = (0 != g_audioStream.ui32Sector);
+		g_audioStream.ui8Drive = file.fs->drv;
+		g_audioStream.ui32Size = f_size(&file);
+	}
+	else if ((FR_NO_FILESYSTEM == res) && exfat_mount(&g_exfatVolume, 0)
+			&& exfat_open(&g_exfatVolume, pcFileName, &g_exfatSong)
+			&& !g_exfatSong.bDirectory)
+	{
+		/* FatFs R0.11 has no exFAT (SDXC cards): the song is always
+		 streamed, volume 0 is on physical drive 0 */
+		g_audioStream.bActive = true;
+		g_audioStream.bExFat = true;
+		g_audioStream.ui8Drive = 0;
+		g_audioStream.ui32Size = g_exfatSong.ui32Size;
+	}
+	else
 	{
 		return false;
 	}
@@ -233,6 +486,17 @@ bool audio_playFileBlocking(const char *pcFileName)
 #ifdef REPORT_ON_SCREEN
 				ui32CurrentPos += AUDIO_BUFFER_SIZE;
 				audio_renderStatus(ui32CurrentPos, &ui32NextReportPos);
+#endif
+			}
+			else
+			{
+				/* Audio data is ready: serve one USB host request in the spare
+				 time then check DREQ again, the background work waits until
+				 the end of the song */
+				blockdev_process(BLOCKDEV_PRIORITY_USB, 1);
+#ifdef REPORT_ON_SCREEN
+				/* The status frame moves one I2C transfer per call */
+				graphic_process();
 #endif
 			}
 			/* Test to see just how much we can do before the audio starts to glitch */
@@ -246,6 +510,7 @@ bool audio_playFileBlocking(const char *pcFileName)
 		/* This is here in case we haven't had any free time to load new data */
 		if (true == g_bNeedData)
 		{
+			g_audioStatistic.ui32Stalls++;
 			/* Goto current file system and try reading 32 new bytes of the song */
 			if (!audio_readSongData(&file, g_pui8AudioBuffer,
 			AUDIO_BUFFER_SIZE))
@@ -263,6 +528,7 @@ bool audio_playFileBlocking(const char *pcFileName)
 
 		/* Once DREQ is released (high) we now feed 32 bytes of data to the VS1003 from our SD read buffer */
 		acodec_sendData(g_pui8AudioBuffer, AUDIO_BUFFER_SIZE);
+		g_audioStatistic.ui32Chunks++;
 
 		/* We've just dumped 32 bytes into VS1003 so our SD read buffer is empty.
 		 Set flag so we go get more data */
@@ -349,6 +615,18 @@ bool audio_recordFileBlocking(const char *pcFileName, uint32_t ui32PeriodSecond,
 
 #ifdef REPORT_ON_SCREEN
 	text_putLine("Recording...", FAST);
+	uint32_t ui32MinutesLeft;
+	text_setCursor(0, 24);
+	if (audio_getRecordMinutesLeft(recordRate, &ui32MinutesLeft))
+	{
+		text_printNumber(ui32MinutesLeft);
+		text_printString(" min left");
+	}
+	else
+	{
+		/* The background scan of the free clusters has not completed yet */
+		text_printString("calculating...");
+	}
 #endif
 
 	uint8_t *pui8FileBufferPointer = 0;
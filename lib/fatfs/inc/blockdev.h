@@ -0,0 +1,124 @@
+/**
+ ****************************************************************************
+ * @file        blockdev.h
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       This is the header of the block device arbitration layer.
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef BLOCKDEV_H_
+#define BLOCKDEV_H_
+
+/** @addtogroup LIB_FATFS_BLOCKDEV
+ * @{
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "diskio.h"
+#include <stdbool.h>
+
+/* Exported types ------------------------------------------------------------*/
+/**
+ * @typedef blockdev_priority_t
+ * This type define the priority of the block device clients, highest first.
+ */
+typedef enum
+{
+	BLOCKDEV_PRIORITY_USB = 0, /*!< USB mass storage host, its writes change the volume under FatFs */
+	BLOCKDEV_PRIORITY_BACKGROUND = 1, /*!< Indexing, scan and other deferrable work */
+	BLOCKDEV_PRIORITY_NUMBER
+} blockdev_priority_t;
+
+/**
+ * @typedef blockdev_operation_t
+ * This type define the operation of a block device request.
+ */
+typedef enum
+{
+	BLOCKDEV_READ = 0, /*!< disk_read() */
+	BLOCKDEV_WRITE = 1, /*!< disk_write() */
+	BLOCKDEV_TRIM = 2, /*!< disk_ioctl(CTRL_TRIM), no buffer */
+	BLOCKDEV_SYNC = 3 /*!< disk_ioctl(CTRL_SYNC), no buffer nor range */
+} blockdev_operation_t;
+
+typedef struct _blockdev_request_t blockdev_request_t;
+
+/**
+ * @typedef blockdev_complete_t
+ * Completion callback, called in the servicing context once the request is done.
+ */
+typedef void (*blockdev_complete_t)(blockdev_request_t *pRequest);
+
+/**
+ * @struct _blockdev_request_t
+ * This type define one block device request. The client sets the drive, the
+ * priority and the callback once with blockdev_initRequest(), the operation and
+ * its range are only written by blockdev_submit(). The request is owned by the
+ * block device layer from blockdev_submit() until bPending is cleared.
+ */
+struct _blockdev_request_t
+{
+	BYTE *pui8Buffer; /*!< Data buffer, unused for BLOCKDEV_TRIM */
+	DWORD ui32Sector; /*!< First sector address (LBA) */
+	UINT ui32Count; /*!< Number of sectors */
+	BYTE ui8Drive; /*!< Physical drive number */
+	blockdev_operation_t eOperation; /*!< Requested operation */
+	blockdev_priority_t ePriority; /*!< Client priority */
+	blockdev_complete_t pfnComplete; /*!< Completion callback, NULL if polled */
+	volatile bool bPending; /*!< Request queued or in progress */
+	DRESULT eResult; /*!< Operation result, valid once bPending is cleared */
+	DWORD ui32SubmitTick; /*!< Tick of blockdev_submit() */
+	blockdev_request_t *pNext; /*!< Next request of the same priority */
+};
+
+/**
+ * @struct _blockdev_statistic_t
+ * This type define the statistic of the block device arbitration.
+ */
+typedef struct _blockdev_statistic_t
+{
+	DWORD pui32Served[BLOCKDEV_PRIORITY_NUMBER]; /*!< Requests served per priority */
+	DWORD pui32MaxWaitMs[BLOCKDEV_PRIORITY_NUMBER]; /*!< Longest time from submit to service per priority */
+	DWORD ui32HostWrites; /*!< Host sessions (first USB write after a FatFs mount) which forced a FatFs remount */
+} blockdev_statistic_t;
+
+/* Exported constants --------------------------------------------------------*/
+#define BLOCKDEV_UNLIMITED	((UINT) -1) /*!< blockdev_process(): serve until the queue is empty */
+/* Exported macro ------------------------------------------------------------*/
+/* Exported functions --------------------------------------------------------*/
+bool blockdev_initRequest(blockdev_request_t *pRequest, BYTE ui8Drive,
+		blockdev_priority_t ePriority, blockdev_complete_t pfnComplete);
+bool blockdev_submit(blockdev_request_t *pRequest,
+		blockdev_operation_t eOperation, BYTE *pui8Buffer, DWORD ui32Sector,
+		UINT ui32Count);
+DRESULT blockdev_transfer(blockdev_request_t *pRequest);
+UINT blockdev_process(blockdev_priority_t eLowestPriority, UINT ui32MaxRequests);
+void blockdev_getStatistic(blockdev_statistic_t *pStatistic);
+
+/**@}LIB_FATFS_BLOCKDEV*/
+#endif /* BLOCKDEV_H_ */
+
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
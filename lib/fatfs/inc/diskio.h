@@ -15,6 +15,14 @@ extern "C" {
 
 #define _USE_WRITE	1	/* 1: Enable disk_write function */
 #define _USE_IOCTL	1	/* 1: Enable disk_ioctl function */
+#define _USE_CACHE	1	/* 1: Enable the sector cache for FAT/directory sectors */
+#define _CACHE_SETS	1	/* Number of sets of the sector cache (each way costs _MAX_SS bytes of RAM) */
+#define _CACHE_WAYS	2	/* Number of ways (sectors) per set of the sector cache */
+#define _USE_FAT_CACHE	1	/* 1: Keep the FAT sectors in a dedicated cache with read-ahead (needs _USE_CACHE) */
+#define _FAT_CACHE_SECTORS	2	/* Consecutive FAT sectors read on a miss (each costs _MAX_SS bytes of RAM) */
+#define _USE_WRITE_COMBINE	1	/* 1: Merge consecutive sector writes into one multi-sector write */
+#define _WRITE_COMBINE_SECTORS	4	/* Maximum number of pending sectors (each costs _MAX_SS bytes of RAM) */
+#define _WRITE_COMBINE_TIMEOUT	100	/* Pending sectors older than this (ms) are flushed by diskio_flushIdleWrite */
 
 #include "integer.h"
 
@@ -42,6 +50,47 @@ DRESULT disk_read (BYTE pdrv, BYTE* buff, DWORD sector, UINT count);
 DRESULT disk_write (BYTE pdrv, const BYTE* buff, DWORD sector, UINT count);
 DRESULT disk_ioctl (BYTE pdrv, BYTE cmd, void* buff);
 DWORD get_fattime (void);
+void diskio_setMediumChanged (BYTE pdrv);
+void diskio_setMediumRemoved (BYTE pdrv);
+
+/* Sector class for the sector cache replacement policy (diskio_readMetaSector) */
+#define DISKIO_SECTOR_DATA	0	/* File data sector */
+#define DISKIO_SECTOR_DIR	1	/* Boot or directory sector */
+#define DISKIO_SECTOR_FAT	2	/* FAT sector */
+
+#if _USE_CACHE == 1
+/**
+ * @struct _diskio_cache_statistic_t
+ * This type define the statistic of the disk I/O sector cache.
+ */
+typedef struct _diskio_cache_statistic_t
+{
+	DWORD ui32MetaHits; /*!< FAT/directory sector read served by the cache */
+	DWORD ui32MetaMisses; /*!< FAT/directory sector read from the disk */
+	DWORD ui32DataHits; /*!< Single data sector read served by the cache */
+	DWORD ui32DataMisses; /*!< Single data sector read from the disk */
+	DWORD ui32FatReads; /*!< FAT sector loaded into a file system window (hit or miss) */
+	DWORD ui32FatMisses; /*!< FAT sector loads which read the disk */
+	DWORD ui32FatReadAheadHits; /*!< FAT sector loads served by a read-ahead sector */
+	DWORD ui32DataSectors; /*!< Sectors read by disk_read() (file data streamed) */
+} diskio_cache_statistic_t;
+
+DRESULT diskio_readMetaSector (BYTE pdrv, BYTE* buff, DWORD sector, BYTE type);
+void diskio_invalidateCache (BYTE pdrv, DWORD sector, UINT count);
+void diskio_getCacheStatistic (diskio_cache_statistic_t *pStatistic);
+void diskio_resetCacheStatistic (void);
+#else
+#define diskio_readMetaSector(pdrv, buff, sector, type)	disk_read(pdrv, buff, sector, 1)
+#define diskio_invalidateCache(pdrv, sector, count)
+#endif /* _USE_CACHE == 1 */
+
+#if _USE_WRITE_COMBINE == 1
+DRESULT diskio_flushWrite (void);
+DRESULT diskio_flushIdleWrite (void);
+#else
+#define diskio_flushWrite()	RES_OK
+#define diskio_flushIdleWrite()	RES_OK
+#endif /* _USE_WRITE_COMBINE == 1 */
 
 /* Disk Status Bits (DSTATUS) */
 
@@ -0,0 +1,100 @@
+/**
+ ****************************************************************************
+ * @file        exfat.h
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       This is the header of the exFAT volume reader and of its
+ *              contiguous file writer.
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef EXFAT_H_
+#define EXFAT_H_
+
+/** @addtogroup LIB_FATFS_EXFAT
+ * @{
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "diskio.h"
+#include <stdbool.h>
+
+/* Exported types ------------------------------------------------------------*/
+/**
+ * @struct _exfat_volume_t
+ * This type define a mounted exFAT volume.
+ */
+typedef struct _exfat_volume_t
+{
+	BYTE ui8Drive; /*!< Physical drive number */
+	BYTE ui8ClusterShift; /*!< log2 of the sectors per cluster */
+	DWORD ui32FatSector; /*!< First sector of the FAT (LBA) */
+	DWORD ui32HeapSector; /*!< First sector of the cluster heap (LBA) */
+	DWORD ui32ClusterCount; /*!< Number of clusters in the heap */
+	DWORD ui32RootCluster; /*!< First cluster of the root directory */
+	DWORD ui32VolumeSector; /*!< Boot sector of the volume (LBA) */
+	DWORD ui32BitmapCluster; /*!< First cluster of the allocation bitmap, 0 if not writable */
+	bool bMountedDirty; /*!< The volume was dirty at mount, exfat_close() leaves it dirty */
+	DWORD ui32WindowSector; /*!< Sector in pui32Window, 0xFFFFFFFF if none */
+	DWORD ui32FatReads; /*!< FAT sectors read to follow cluster chains */
+	UINT pui32Window[512 / 4]; /*!< Directory/FAT sector buffer, on 32-bit boundary */
+} exfat_volume_t;
+
+/**
+ * @struct _exfat_file_t
+ * This type define an opened exFAT file or directory.
+ */
+typedef struct _exfat_file_t
+{
+	exfat_volume_t *pVolume; /*!< Volume of the file */
+	DWORD ui32FirstCluster; /*!< First cluster, 0 if the file is empty */
+	DWORD ui32Size; /*!< Size in byte unit, clipped to 4GB - 1 */
+	bool bNoFatChain; /*!< Clusters are contiguous and not recorded in the FAT */
+	bool bDirectory; /*!< The entry is a directory */
+	DWORD ui32Cluster; /*!< Last mapped cluster */
+	DWORD ui32ClusterIndex; /*!< Index of ui32Cluster in the file */
+	DWORD ui32DirectoryCluster; /*!< First cluster of the parent directory, 0 if not created by exfat_create() */
+	DWORD ui32DirectorySize; /*!< Size of the parent directory in byte unit */
+	bool bDirectoryNoFatChain; /*!< The parent directory is contiguous */
+	BYTE ui8EntryCount; /*!< Directory entries of the entry set */
+	DWORD ui32EntryPosition; /*!< Position of the entry set in the parent directory */
+} exfat_file_t;
+
+/* Exported constants --------------------------------------------------------*/
+/* Exported macro ------------------------------------------------------------*/
+/* Exported functions --------------------------------------------------------*/
+bool exfat_mount(exfat_volume_t *pVolume, BYTE ui8Drive);
+bool exfat_open(exfat_volume_t *pVolume, const char *pcPath,
+		exfat_file_t *pFile);
+bool exfat_mapSector(exfat_file_t *pFile, DWORD ui32Position,
+		DWORD *pui32Sector, DWORD *pui32Count);
+bool exfat_create(exfat_volume_t *pVolume, const char *pcPath, DWORD ui32Size,
+		exfat_file_t *pFile);
+bool exfat_close(exfat_file_t *pFile, DWORD ui32Size);
+
+/**@}LIB_FATFS_EXFAT*/
+#endif /* EXFAT_H_ */
+
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
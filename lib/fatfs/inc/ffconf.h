@@ -71,6 +71,14 @@
 /* This option switches fast seek feature. (0:Disable or 1:Enable) */
 
 
+#define	_FS_CONTIGUOUS          1
+/* This option switches the contiguous file detection. (0:Disable or 1:Enable)
+/  f_getlba() checks the cluster chain of a file opened without write access
+/  and flags it when the clusters follow each other. It gives the first
+/  sector so that the file can be streamed with disk_read(), then f_read()
+/  and f_lseek() compute the next cluster instead of reading the FAT. */
+
+
 #define _USE_LABEL              0
 /* This option switches volume label functions, f_getlabel() and f_setlabel().
 /  (0:Disable or 1:Enable) */
@@ -144,6 +152,14 @@
 /  ff_memfree(), must be added to the project. */
 
 
+#define	_LFN_POOL_SLOTS         1
+/* With _USE_LFN 3, option/syscall.c serves ff_memalloc() from a static pool of
+/  _LFN_POOL_SLOTS working buffers instead of the heap. A file function holds
+/  one buffer while it runs, so one slot per file function running at once is
+/  enough. When the pool is exhausted the file function fails with
+/  FR_NOT_ENOUGH_CORE. */
+
+
 #define	_LFN_UNICODE            0	/* 0:ANSI/OEM or 1:Unicode */
 /* This option switches character encoding on the API. (0:ANSI/OEM or 1:Unicode)
 /  To use Unicode string for the path name, enable LFN feature and set _LFN_UNICODE
@@ -207,7 +223,7 @@
 /  disk_ioctl() function. */
 
 
-#define	_USE_TRIM                0
+#define	_USE_TRIM                1
 /* This option switches ATA-TRIM feature. (0:Disable or 1:Enable)
 /  To enable Trim feature, also CTRL_TRIM command should be implemented to the
 /  disk_ioctl() function. */
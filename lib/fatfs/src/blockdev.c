@@ -0,0 +1,317 @@
+/**
+ ****************************************************************************
+ * @file        blockdev.c
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       This file implement the block device arbitration between the
+ *              USB mass storage and the on-device FatFs clients.
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/** @addtogroup LIB_FATFS_BLOCKDEV
+ * @{
+ */
+/** @defgroup LIB_FATFS_BLOCKDEV_PRIVATE Block Device (Private)
+ * @{
+ *
+ * The SD card is driven over SPI2 without any lock, so only one context may
+ * access it. That context is the main loop: FatFs clients call the disk I/O
+ * layer directly, and the requests of the other contexts (USB interrupt) are
+ * queued here and serviced by blockdev_process() at points where no FatFs
+ * operation is in progress (main loop, audio player while the codec buffer is
+ * full). Requests are served by priority then in submit order.
+ *
+ * A write of the USB host changes the volume under FatFs: the disk I/O layer
+ * then reports the medium as changed, open objects of the volume become
+ * invalid and FatFs mounts the volume again at its next access instead of
+ * writing its stale FAT/directory window over the host data. The first write
+ * of a host session marks the volume, the session ends when FatFs mounts it
+ * again.
+ */
+/* Includes ------------------------------------------------------------------*/
+#include "blockdev.h"
+#include "ff.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/**
+ * @struct _blockdev_queue_t
+ * This type define the FIFO of the requests of one priority.
+ */
+typedef struct _blockdev_queue_t
+{
+	blockdev_request_t *pHead; /*!< Next request to serve */
+	blockdev_request_t *pTail; /*!< Last submitted request */
+} blockdev_queue_t;
+
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+#define BLOCKDEV_ENTER_CRITICAL(ui32Primask)	do { (ui32Primask) = __get_PRIMASK(); __disable_irq(); } while (0)
+#define BLOCKDEV_EXIT_CRITICAL(ui32Primask)	__set_PRIMASK(ui32Primask)
+
+/* Private variables ---------------------------------------------------------*/
+static blockdev_queue_t g_pBlockdevQueue[BLOCKDEV_PRIORITY_NUMBER]; /*!< Pending requests per priority */
+static bool g_bBlockdevServicing = false; /*!< A request is being executed */
+static blockdev_statistic_t g_blockdevStatistic = { 0 }; /*!< Arbitration statistic */
+
+/* Private functions declaration ---------------------------------------------*/
+static blockdev_request_t *blockdev_dequeue(blockdev_priority_t eLowestPriority);
+static void blockdev_execute(blockdev_request_t *pRequest);
+
+/* Private function prototypes -----------------------------------------------*/
+/**
+ * @brief  Remove the oldest request of the highest pending priority.
+ * @param  eLowestPriority: Lowest priority allowed to be served
+ * @retval blockdev_request_t*: the request, NULL if nothing is pending
+ */
+static blockdev_request_t *blockdev_dequeue(blockdev_priority_t eLowestPriority)
+{
+	blockdev_request_t *pRequest = NULL;
+	uint32_t ui32Primask;
+	int i;
+
+	BLOCKDEV_ENTER_CRITICAL(ui32Primask);
+	for (i = 0; (i <= (int) eLowestPriority) && (i < BLOCKDEV_PRIORITY_NUMBER);
+			i++)
+	{
+		pRequest = g_pBlockdevQueue[i].pHead;
+		if (NULL != pRequest)
+		{
+			g_pBlockdevQueue[i].pHead = pRequest->pNext;
+			if (NULL == g_pBlockdevQueue[i].pHead)
+			{
+				g_pBlockdevQueue[i].pTail = NULL;
+			}
+			pRequest->pNext = NULL;
+			break;
+		}
+	}
+	BLOCKDEV_EXIT_CRITICAL(ui32Primask);
+	return pRequest;
+}
+
+/**
+ * @brief  Execute a request on the disk I/O layer and complete it.
+ * @param  pRequest: request to execute
+ * @retval None
+ */
+static void blockdev_execute(blockdev_request_t *pRequest)
+{
+	DWORD ui32WaitMs = HAL_GetTick() - pRequest->ui32SubmitTick;
+	DWORD pui32Range[2];
+
+	g_bBlockdevServicing = true;
+	switch (pRequest->eOperation)
+	{
+	case BLOCKDEV_READ:
+		pRequest->eResult = disk_read(pRequest->ui8Drive, pRequest->pui8Buffer,
+				pRequest->ui32Sector, pRequest->ui32Count);
+		break;
+
+	case BLOCKDEV_WRITE:
+		pRequest->eResult = disk_write(pRequest->ui8Drive,
+				pRequest->pui8Buffer, pRequest->ui32Sector,
+				pRequest->ui32Count);
+		break;
+
+	case BLOCKDEV_TRIM:
+		pui32Range[0] = pRequest->ui32Sector;
+		pui32Range[1] = pRequest->ui32Sector + pRequest->ui32Count - 1;
+		pRequest->eResult = disk_ioctl(pRequest->ui8Drive, CTRL_TRIM,
+				pui32Range);
+		break;
+
+	case BLOCKDEV_SYNC:
+		pRequest->eResult = disk_ioctl(pRequest->ui8Drive, CTRL_SYNC, NULL);
+		break;
+
+	default:
+		pRequest->eResult = RES_PARERR;
+		break;
+	}
+
+	/* The volume changed under FatFs, even a failed write may have reached the
+	 disk. It is marked once per host session: from the first host write to
+	 the FatFs remount (disk_initialize) which reads the volume again, the
+	 following writes of the session are already covered */
+	if ((BLOCKDEV_PRIORITY_USB == pRequest->ePriority)
+			&& ((BLOCKDEV_WRITE == pRequest->eOperation)
+					|| (BLOCKDEV_TRIM == pRequest->eOperation))
+			&& (0 == (disk_status(pRequest->ui8Drive) & STA_NOINIT)))
+	{
+		diskio_setMediumChanged(pRequest->ui8Drive);
+		g_blockdevStatistic.ui32HostWrites++;
+	}
+
+	g_blockdevStatistic.pui32Served[pRequest->ePriority]++;
+	if (ui32WaitMs > g_blockdevStatistic.pui32MaxWaitMs[pRequest->ePriority])
+	{
+		g_blockdevStatistic.pui32MaxWaitMs[pRequest->ePriority] = ui32WaitMs;
+	}
+	g_bBlockdevServicing = false;
+
+	/* Released before the callback so that it can submit the request again */
+	pRequest->bPending = false;
+	if (NULL != pRequest->pfnComplete)
+	{
+		pRequest->pfnComplete(pRequest);
+	}
+}
+
+/* Exported functions prototype ----------------------------------------------*/
+/**
+ * @brief  Set the client of a request: drive, priority and completion callback.
+ * @param  pRequest: request to initialize
+ * @param  ui8Drive: Physical drive number
+ * @param  ePriority: Client priority
+ * @param  pfnComplete: Completion callback, NULL if polled
+ * @retval bool: Status of the initialization
+ *			@arg true: request initialized
+ *			@arg false: request still pending (left untouched) or invalid priority
+ */
+bool blockdev_initRequest(blockdev_request_t *pRequest, BYTE ui8Drive,
+		blockdev_priority_t ePriority, blockdev_complete_t pfnComplete)
+{
+	if ((BLOCKDEV_PRIORITY_NUMBER <= ePriority) || pRequest->bPending)
+	{
+		return false;
+	}
+	pRequest->ui8Drive = ui8Drive;
+	pRequest->ePriority = ePriority;
+	pRequest->pfnComplete = pfnComplete;
+	pRequest->pNext = NULL;
+	return true;
+}
+
+/**
+ * @brief  Queue a request. Can be called from any context, interrupts included.
+ *         The operation and its range are written into the request in the same
+ *         critical section as the pending check, a request still queued or in
+ *         progress is never modified.
+ * @param  pRequest: request initialized by blockdev_initRequest(), must stay
+ * 			valid until it is completed
+ * @param  eOperation: Requested operation
+ * @param  pui8Buffer: Data buffer, NULL for BLOCKDEV_TRIM and BLOCKDEV_SYNC
+ * @param  ui32Sector: First sector address (LBA)
+ * @param  ui32Count: Number of sectors
+ * @retval bool: Status of the submission
+ *			@arg true: request queued
+ *			@arg false: request already pending
+ */
+bool blockdev_submit(blockdev_request_t *pRequest,
+		blockdev_operation_t eOperation, BYTE *pui8Buffer, DWORD ui32Sector,
+		UINT ui32Count)
+{
+	blockdev_queue_t *pQueue = &g_pBlockdevQueue[pRequest->ePriority];
+	uint32_t ui32Primask;
+
+	BLOCKDEV_ENTER_CRITICAL(ui32Primask);
+	if (pRequest->bPending)
+	{
+		BLOCKDEV_EXIT_CRITICAL(ui32Primask);
+		return false;
+	}
+	pRequest->eOperation = eOperation;
+	pRequest->pui8Buffer = pui8Buffer;
+	pRequest->ui32Sector = ui32Sector;
+	pRequest->ui32Count = ui32Count;
+	pRequest->pNext = NULL;
+	pRequest->bPending = true;
+	pRequest->ui32SubmitTick = HAL_GetTick();
+
+	if (NULL == pQueue->pTail)
+	{
+		pQueue->pHead = pRequest;
+	}
+	else
+	{
+		pQueue->pTail->pNext = pRequest;
+	}
+	pQueue->pTail = pRequest;
+	BLOCKDEV_EXIT_CRITICAL(ui32Primask);
+	return true;
+}
+
+/**
+ * @brief  Execute a request right away from the servicing context.
+ *         The pending requests of a higher priority are served first.
+ * @param  pRequest: request to execute
+ * @retval DRESULT: Operation result
+ */
+DRESULT blockdev_transfer(blockdev_request_t *pRequest)
+{
+	if (BLOCKDEV_PRIORITY_NUMBER <= pRequest->ePriority)
+	{
+		return RES_PARERR;
+	}
+	if (BLOCKDEV_PRIORITY_USB < pRequest->ePriority)
+	{
+		blockdev_process(pRequest->ePriority - 1, BLOCKDEV_UNLIMITED);
+	}
+	pRequest->bPending = true;
+	pRequest->ui32SubmitTick = HAL_GetTick();
+	blockdev_execute(pRequest);
+	return pRequest->eResult;
+}
+
+/**
+ * @brief  Serve the queued requests. Must only be called from the main loop
+ * 		   context, while no FatFs operation is in progress.
+ * @param  eLowestPriority: Lowest priority to serve, BLOCKDEV_PRIORITY_BACKGROUND for all
+ * @param  ui32MaxRequests: Maximum number of requests to serve, BLOCKDEV_UNLIMITED
+ * 			to serve until the queue is empty (the USB host keeps submitting).
+ * @retval UINT: Number of requests served
+ */
+UINT blockdev_process(blockdev_priority_t eLowestPriority, UINT ui32MaxRequests)
+{
+	blockdev_request_t *pRequest;
+	UINT ui32Served = 0;
+
+	/* A completion callback must not serve the queue again */
+	if (g_bBlockdevServicing)
+	{
+		return 0;
+	}
+
+	while ((ui32Served < ui32MaxRequests)
+			&& (NULL != (pRequest = blockdev_dequeue(eLowestPriority))))
+	{
+		blockdev_execute(pRequest);
+		ui32Served++;
+	}
+	return ui32Served;
+}
+
+/**
+ * @brief  Get the statistic of the block device arbitration.
+ * @param  pStatistic: pointer to the statistic output structure.
+ * @retval None
+ */
+void blockdev_getStatistic(blockdev_statistic_t *pStatistic)
+{
+	*pStatistic = g_blockdevStatistic;
+}
+
+/**@}LIB_FATFS_BLOCKDEV_PRIVATE*/
+/**@}LIB_FATFS_BLOCKDEV*/
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
@@ -48,6 +48,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include "sd_diskio.h"
 #include "ff.h"
+#include <string.h>
 
 /* Private typedef -----------------------------------------------------------*/
 /**
@@ -77,8 +78,55 @@ typedef struct _diskio_drivers_t
 	uint32_t pui32IsInitialized[_VOLUMES]; /*!< Initializes status of the driver */
 	generic_diskio_driver_t *pDiskDriver[_VOLUMES]; /*!< Disk IO driver pointer */
 	uint8_t pui8Lun[_VOLUMES]; /*!< multi-lun management. Only used for USB Key Disk */
+	volatile uint8_t pui8MediumChanged[_VOLUMES]; /*!< Disk written behind FatFs, reported as not initialized until disk_initialize() */
 } diskio_drivers_t;
 
+#if _USE_CACHE == 1
+/**
+ * @struct _diskio_cache_line_t
+ * This type define one cached sector of the set-associative sector cache.
+ */
+typedef struct _diskio_cache_line_t
+{
+	DWORD pui32Data[_MAX_SS / 4]; /*!< Sector data, word aligned for the disk drivers */
+	DWORD ui32Sector; /*!< Cached sector address (LBA) */
+	DWORD ui32LastUse; /*!< Access stamp for LRU replacement */
+	BYTE ui8Drive; /*!< Physical drive number of the sector */
+	BYTE bValid; /*!< Line hold valid data */
+	BYTE ui8Class; /*!< Sector class: DISKIO_SECTOR_DATA, DISKIO_SECTOR_DIR or DISKIO_SECTOR_FAT */
+} diskio_cache_line_t;
+#endif /* _USE_CACHE == 1 */
+
+#if (_USE_CACHE == 1) && (_USE_FAT_CACHE == 1)
+/**
+ * @struct _diskio_fat_cache_t
+ * This type define the dedicated FAT sector cache: a window of consecutive sectors,
+ * the sector missed followed by the sectors read ahead.
+ */
+typedef struct _diskio_fat_cache_t
+{
+	DWORD pui32Data[_FAT_CACHE_SECTORS * _MAX_SS / 4]; /*!< Sectors data, word aligned for the disk drivers */
+	DWORD ui32Sector; /*!< First sector address (LBA) of the window */
+	UINT ui32Count; /*!< Number of valid sectors, 0: empty */
+	BYTE ui8Drive; /*!< Physical drive number of the sectors */
+} diskio_fat_cache_t;
+#endif /* (_USE_CACHE == 1) && (_USE_FAT_CACHE == 1) */
+
+#if _USE_WRITE_COMBINE == 1
+/**
+ * @struct _diskio_write_combine_t
+ * This type define the consecutive sectors waiting to be written in one multi-sector write.
+ */
+typedef struct _diskio_write_combine_t
+{
+	DWORD pui32Data[_WRITE_COMBINE_SECTORS * _MAX_SS / 4]; /*!< Pending sectors data, word aligned for the disk drivers */
+	DWORD ui32Sector; /*!< First pending sector address (LBA) */
+	DWORD ui32LastWriteTick; /*!< Tick of the last sector appended */
+	UINT ui32Count; /*!< Number of pending sectors, 0: nothing pending */
+	BYTE ui8Drive; /*!< Physical drive number of the pending sectors */
+} diskio_write_combine_t;
+#endif /* _USE_WRITE_COMBINE == 1 */
+
 /* Private define ------------------------------------------------------------*/
 /* Private macro -------------------------------------------------------------*/
 
@@ -87,12 +135,43 @@ diskio_drivers_t g_diskIODrivers =
 {
 { 0 },
 { 0 },
+{ 0 },
 { 0 } }; /*!< Global Disk IO Drivers */
 
 generic_diskio_driver_t g_sdDiskIODriver = { 0 }; /*!< SD Disk IO Drivers */
 
+#if _USE_CACHE == 1
+static diskio_cache_line_t g_pDiskCache[_CACHE_SETS][_CACHE_WAYS]; /*!< Sector cache */
+static DWORD g_ui32DiskCacheStamp = 0; /*!< LRU access stamp counter */
+static diskio_cache_statistic_t g_diskCacheStatistic = { 0 }; /*!< Sector cache statistic */
+#if _USE_FAT_CACHE == 1
+static diskio_fat_cache_t g_diskFatCache = { 0 }; /*!< FAT sector cache */
+#endif /* _USE_FAT_CACHE == 1 */
+#endif /* _USE_CACHE == 1 */
+
+#if _USE_WRITE_COMBINE == 1
+static diskio_write_combine_t g_diskWriteCombine = { 0 }; /*!< Pending consecutive sector writes */
+#endif /* _USE_WRITE_COMBINE == 1 */
+
 /* Private functions declaration ---------------------------------------------*/
 static void mapDiskIODriverOfSD(generic_diskio_driver_t **ppDiskDriver);
+#if _USE_CACHE == 1
+static diskio_cache_line_t *diskio_lookupCache(BYTE pdrv, DWORD sector);
+static diskio_cache_line_t *diskio_allocateCache(BYTE pdrv, DWORD sector,
+		BYTE ui8Class);
+static DRESULT diskio_readCachedSector(BYTE pdrv, BYTE* buff, DWORD sector,
+		BYTE ui8Class);
+#if _USE_FAT_CACHE == 1
+static BYTE *diskio_lookupFatCache(BYTE pdrv, DWORD sector);
+static DRESULT diskio_readFatSector(BYTE pdrv, BYTE* buff, DWORD sector);
+#endif /* _USE_FAT_CACHE == 1 */
+#endif /* _USE_CACHE == 1 */
+#if _USE_WRITE_COMBINE == 1
+static DRESULT diskio_flushOverlappedWrite(BYTE pdrv, DWORD sector,
+		UINT count);
+static DRESULT diskio_combineWrite(BYTE pdrv, const BYTE* buff, DWORD sector,
+		UINT count);
+#endif /* _USE_WRITE_COMBINE == 1 */
 
 /* Private function prototypes -----------------------------------------------*/
 /**
@@ -115,6 +194,292 @@ void mapDiskIODriverOfSD(generic_diskio_driver_t **ppDiskDriver)
 	*ppDiskDriver = &g_sdDiskIODriver;
 }
 
+#if _USE_CACHE == 1
+/**
+ * @brief  Look up a sector in the sector cache.
+ * @param  pdrv: Physical drive number (0..)
+ * @param  sector: Sector address (LBA)
+ * @retval diskio_cache_line_t*: the cache line hold the sector, NULL if not cached.
+ */
+static diskio_cache_line_t *diskio_lookupCache(BYTE pdrv, DWORD sector)
+{
+	diskio_cache_line_t *pSet = g_pDiskCache[sector % _CACHE_SETS];
+	int i;
+	for (i = 0; i < _CACHE_WAYS; i++)
+	{
+		if (pSet[i].bValid && (pSet[i].ui32Sector == sector)
+				&& (pSet[i].ui8Drive == pdrv))
+		{
+			pSet[i].ui32LastUse = ++g_ui32DiskCacheStamp;
+			return &pSet[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief  Select a cache line to store a new sector.
+ *         Free lines are used first. Otherwise the victim is the least recently used
+ *         line of the lowest class, and a sector never replaces a higher class one:
+ *         FAT sectors stay longest, then directory sectors, then data sectors.
+ * @param  pdrv: Physical drive number (0..)
+ * @param  sector: Sector address (LBA)
+ * @param  ui8Class: class of the new sector.
+ * @retval diskio_cache_line_t*: the selected line, NULL if the sector should not be cached.
+ */
+static diskio_cache_line_t *diskio_allocateCache(BYTE pdrv, DWORD sector,
+		BYTE ui8Class)
+{
+	diskio_cache_line_t *pSet = g_pDiskCache[sector % _CACHE_SETS];
+	diskio_cache_line_t *pVictim = NULL;
+	int i;
+	for (i = 0; i < _CACHE_WAYS; i++)
+	{
+		if (!pSet[i].bValid)
+		{
+			pVictim = &pSet[i];
+			break;
+		}
+		if ((NULL == pVictim) || (pSet[i].ui8Class < pVictim->ui8Class)
+				|| ((pSet[i].ui8Class == pVictim->ui8Class)
+						&& (pSet[i].ui32LastUse < pVictim->ui32LastUse)))
+		{
+			pVictim = &pSet[i];
+		}
+	}
+
+	if ((NULL == pVictim)
+			|| (pVictim->bValid && (pVictim->ui8Class > ui8Class)))
+	{
+		return NULL;
+	}
+	pVictim->bValid = 0;
+	pVictim->ui8Drive = pdrv;
+	pVictim->ui32Sector = sector;
+	pVictim->ui8Class = ui8Class;
+	pVictim->ui32LastUse = ++g_ui32DiskCacheStamp;
+	return pVictim;
+}
+
+/**
+ * @brief  Read a single sector through the sector cache.
+ * @param  pdrv: Physical drive number (0..)
+ * @param  *buff: Data buffer to store read data
+ * @param  sector: Sector address (LBA)
+ * @param  ui8Class: class of the sector.
+ * @retval DRESULT: Operation result
+ */
+static DRESULT diskio_readCachedSector(BYTE pdrv, BYTE* buff, DWORD sector,
+		BYTE ui8Class)
+{
+	diskio_cache_line_t *pLine = diskio_lookupCache(pdrv, sector);
+	if (NULL != pLine)
+	{
+		/* A data sector read as FAT/directory sector is promoted */
+		if (pLine->ui8Class < ui8Class)
+		{
+			pLine->ui8Class = ui8Class;
+		}
+		memcpy(buff, pLine->pui32Data, _MAX_SS);
+		if (DISKIO_SECTOR_DATA != ui8Class)
+		{
+			g_diskCacheStatistic.ui32MetaHits++;
+		}
+		else
+		{
+			g_diskCacheStatistic.ui32DataHits++;
+		}
+		return RES_OK;
+	}
+
+	if (DISKIO_SECTOR_DATA != ui8Class)
+	{
+		g_diskCacheStatistic.ui32MetaMisses++;
+	}
+	else
+	{
+		g_diskCacheStatistic.ui32DataMisses++;
+	}
+
+	DRESULT diskResultReturn;
+	diskResultReturn = g_diskIODrivers.pDiskDriver[pdrv]->disk_read(
+			g_diskIODrivers.pui8Lun[pdrv], buff, sector, 1);
+	if (RES_OK == diskResultReturn)
+	{
+		pLine = diskio_allocateCache(pdrv, sector, ui8Class);
+		if (NULL != pLine)
+		{
+			memcpy(pLine->pui32Data, buff, _MAX_SS);
+			pLine->bValid = 1;
+		}
+	}
+	return diskResultReturn;
+}
+
+#if _USE_FAT_CACHE == 1
+/**
+ * @brief  Look up a sector in the FAT sector cache.
+ * @param  pdrv: Physical drive number (0..)
+ * @param  sector: Sector address (LBA)
+ * @retval BYTE*: the cached sector data, NULL if not cached.
+ */
+static BYTE *diskio_lookupFatCache(BYTE pdrv, DWORD sector)
+{
+	diskio_fat_cache_t *pCache = &g_diskFatCache;
+	if ((0 != pCache->ui32Count) && (pCache->ui8Drive == pdrv)
+			&& (sector >= pCache->ui32Sector)
+			&& ((sector - pCache->ui32Sector) < pCache->ui32Count))
+	{
+		return (BYTE*) pCache->pui32Data
+				+ ((sector - pCache->ui32Sector) * _MAX_SS);
+	}
+	return NULL;
+}
+
+/**
+ * @brief  Read a FAT sector through the FAT sector cache.
+ *         A miss reads the sector and the following ones in one multi-sector read:
+ *         a cluster chain followed while streaming a file step to the next FAT
+ *         sector, which is then already cached.
+ *         The FAT sectors never compete with the directory and data sectors.
+ * @param  pdrv: Physical drive number (0..)
+ * @param  *buff: Data buffer to store read data
+ * @param  sector: Sector address (LBA)
+ * @retval DRESULT: Operation result
+ */
+static DRESULT diskio_readFatSector(BYTE pdrv, BYTE* buff, DWORD sector)
+{
+	diskio_fat_cache_t *pCache = &g_diskFatCache;
+	BYTE *pui8Data = diskio_lookupFatCache(pdrv, sector);
+	if (NULL != pui8Data)
+	{
+		memcpy(buff, pui8Data, _MAX_SS);
+		g_diskCacheStatistic.ui32MetaHits++;
+		if (sector != pCache->ui32Sector)
+		{
+			g_diskCacheStatistic.ui32FatReadAheadHits++;
+		}
+		return RES_OK;
+	}
+	g_diskCacheStatistic.ui32MetaMisses++;
+	g_diskCacheStatistic.ui32FatMisses++;
+
+	DRESULT diskResultReturn;
+	pCache->ui32Count = 0;
+#if _USE_WRITE_COMBINE == 1
+	/* The sectors read ahead may be pending too */
+	diskResultReturn = diskio_flushOverlappedWrite(pdrv, sector,
+			_FAT_CACHE_SECTORS);
+	if (RES_OK != diskResultReturn)
+	{
+		return diskResultReturn;
+	}
+#endif /* _USE_WRITE_COMBINE == 1 */
+	diskResultReturn = g_diskIODrivers.pDiskDriver[pdrv]->disk_read(
+			g_diskIODrivers.pui8Lun[pdrv], (BYTE*) pCache->pui32Data, sector,
+			_FAT_CACHE_SECTORS);
+	if (RES_OK == diskResultReturn)
+	{
+		pCache->ui32Count = _FAT_CACHE_SECTORS;
+	}
+	else
+	{
+		/* The read-ahead may run past the end of the disk */
+		diskResultReturn = g_diskIODrivers.pDiskDriver[pdrv]->disk_read(
+				g_diskIODrivers.pui8Lun[pdrv], (BYTE*) pCache->pui32Data,
+				sector, 1);
+		if (RES_OK != diskResultReturn)
+		{
+			return diskResultReturn;
+		}
+		pCache->ui32Count = 1;
+	}
+	pCache->ui8Drive = pdrv;
+	pCache->ui32Sector = sector;
+	memcpy(buff, pCache->pui32Data, _MAX_SS);
+	return RES_OK;
+}
+#endif /* _USE_FAT_CACHE == 1 */
+#endif /* _USE_CACHE == 1 */
+
+#if _USE_WRITE_COMBINE == 1
+/**
+ * @brief  Flush the pending sectors if they overlap the given range,
+ *         so a following disk read never return older data than written.
+ * @param  pdrv: Physical drive number (0..)
+ * @param  sector: First sector address (LBA)
+ * @param  count: Number of sectors
+ * @retval DRESULT: Operation result of the flush
+ */
+static DRESULT diskio_flushOverlappedWrite(BYTE pdrv, DWORD sector,
+		UINT count)
+{
+	diskio_write_combine_t *pCombine = &g_diskWriteCombine;
+	if ((0 != pCombine->ui32Count) && (pCombine->ui8Drive == pdrv)
+			&& (sector < (pCombine->ui32Sector + pCombine->ui32Count))
+			&& (pCombine->ui32Sector < (sector + count)))
+	{
+		return diskio_flushWrite();
+	}
+	return RES_OK;
+}
+
+/**
+ * @brief  Append sector(s) to the pending write, or write them directly.
+ *         The pending sectors are flushed as one multi-sector write when a
+ *         non-consecutive sector is written, when the buffer is full, on CTRL_SYNC,
+ *         on a read of a pending sector or by diskio_flushIdleWrite().
+ *         A failed deferred write is returned by the call which flush it.
+ * @param  pdrv: Physical drive number (0..)
+ * @param  *buff: Data to be written
+ * @param  sector: Sector address (LBA)
+ * @param  count: Number of sectors to write
+ * @retval DRESULT: Operation result
+ */
+static DRESULT diskio_combineWrite(BYTE pdrv, const BYTE* buff, DWORD sector,
+		UINT count)
+{
+	diskio_write_combine_t *pCombine = &g_diskWriteCombine;
+	DRESULT diskResultReturn;
+
+	/* Only the consecutive sectors of the same drive can be merged */
+	if ((0 != pCombine->ui32Count)
+			&& ((pCombine->ui8Drive != pdrv)
+					|| ((pCombine->ui32Sector + pCombine->ui32Count) != sector)
+					|| ((pCombine->ui32Count + count) > _WRITE_COMBINE_SECTORS)))
+	{
+		diskResultReturn = diskio_flushWrite();
+		if (RES_OK != diskResultReturn)
+		{
+			return diskResultReturn;
+		}
+	}
+
+	/* A request which fill the whole buffer is already a large transfer */
+	if (count >= _WRITE_COMBINE_SECTORS)
+	{
+		return g_diskIODrivers.pDiskDriver[pdrv]->disk_write(
+				g_diskIODrivers.pui8Lun[pdrv], buff, sector, count);
+	}
+
+	if (0 == pCombine->ui32Count)
+	{
+		pCombine->ui8Drive = pdrv;
+		pCombine->ui32Sector = sector;
+	}
+	memcpy((BYTE*) pCombine->pui32Data + (pCombine->ui32Count * _MAX_SS), buff,
+			count * _MAX_SS);
+	pCombine->ui32Count += count;
+	pCombine->ui32LastWriteTick = HAL_GetTick();
+
+	if (_WRITE_COMBINE_SECTORS == pCombine->ui32Count)
+	{
+		return diskio_flushWrite();
+	}
+	return RES_OK;
+}
+#endif /* _USE_WRITE_COMBINE == 1 */
+
 /* Exported functions prototype ----------------------------------------------*/
 /**
  * @brief  Initializes a Drive.
@@ -144,7 +509,10 @@ DSTATUS disk_initialize(BYTE pdrv)
 				== g_diskIODrivers.pDiskDriver[pdrv]->disk_initialize(
 						g_diskIODrivers.pui8Lun[pdrv]))
 		{
+			/* The medium may be changed, nothing cached before is valid */
+			diskio_invalidateCache(pdrv, 0, (UINT) -1);
 			g_diskIODrivers.pui32IsInitialized[pdrv] = 1;
+			g_diskIODrivers.pui8MediumChanged[pdrv] = 0;
 			return RES_OK;
 		}
 		else
@@ -155,7 +523,8 @@ DSTATUS disk_initialize(BYTE pdrv)
 	}
 	else
 	{
-		/* Driver already initialized */
+		/* Driver already initialized: FatFs mount the volume again after a medium change */
+		g_diskIODrivers.pui8MediumChanged[pdrv] = 0;
 		return RES_OK;
 	}
 }
@@ -174,12 +543,49 @@ DSTATUS disk_status(BYTE pdrv)
 		return RES_ERROR;
 	}
 
+	if (0 != g_diskIODrivers.pui8MediumChanged[pdrv])
+	{
+		/* Force FatFs to mount the volume again */
+		return STA_NOINIT;
+	}
+
 	DSTATUS diskStatusReturn;
 	diskStatusReturn = g_diskIODrivers.pDiskDriver[pdrv]->disk_status(
 			g_diskIODrivers.pui8Lun[pdrv]);
 	return diskStatusReturn;
 }
 
+/**
+ * @brief  Report the disk content as changed behind FatFs (USB host write).
+ *         disk_status() returns STA_NOINIT until disk_initialize() is called,
+ *         so FatFs drops its mounted volume instead of using stale metadata.
+ * @param  pdrv: Physical drive number (0..)
+ * @retval None
+ */
+void diskio_setMediumChanged(BYTE pdrv)
+{
+	g_diskIODrivers.pui8MediumChanged[pdrv] = 1;
+}
+
+/**
+ * @brief  Report the medium as removed or replaced (card detect).
+ *         The sectors pending in the write combining are dropped and the
+ *         accesses fail with RES_NOTRDY until disk_initialize() identifies
+ *         the new medium, FatFs mounts the volume again on its next access.
+ * @param  pdrv: Physical drive number (0..)
+ * @retval None
+ */
+void diskio_setMediumRemoved(BYTE pdrv)
+{
+#if _USE_WRITE_COMBINE == 1
+	if (g_diskWriteCombine.ui8Drive == pdrv)
+	{
+		g_diskWriteCombine.ui32Count = 0;
+	}
+#endif /* _USE_WRITE_COMBINE == 1 */
+	g_diskIODrivers.pui32IsInitialized[pdrv] = 0;
+}
+
 /**
  * @brief  Reads Sector(s)
  * @param  pdrv: Physical drive number (0..)
@@ -196,9 +602,26 @@ DSTATUS disk_status(BYTE pdrv)
 DRESULT disk_read(BYTE pdrv, BYTE* buff, DWORD sector, UINT count)
 {
 	if (0 == g_diskIODrivers.pui32IsInitialized[pdrv])
+	{
+		return RES_NOTRDY;
+	}
+
+#if _USE_WRITE_COMBINE == 1
+	if (RES_OK != diskio_flushOverlappedWrite(pdrv, sector, count))
 	{
 		return RES_ERROR;
 	}
+#endif /* _USE_WRITE_COMBINE == 1 */
+
+#if _USE_CACHE == 1
+	g_diskCacheStatistic.ui32DataSectors += count;
+	if (1 == count)
+	{
+		return diskio_readCachedSector(pdrv, buff, sector, DISKIO_SECTOR_DATA);
+	}
+	/* Multiple sectors are streaming data: bypass the cache,
+	 the write-through cache never hold newer data than the disk */
+#endif /* _USE_CACHE == 1 */
 
 	DRESULT diskResultReturn;
 	diskResultReturn = g_diskIODrivers.pDiskDriver[pdrv]->disk_read(
@@ -206,6 +629,96 @@ DRESULT disk_read(BYTE pdrv, BYTE* buff, DWORD sector, UINT count)
 	return diskResultReturn;
 }
 
+#if _USE_CACHE == 1
+/**
+ * @brief  Reads a FAT/directory sector.
+ *         These sectors are kept in the sector cache in preference to the data sectors.
+ * @param  pdrv: Physical drive number (0..)
+ * @param  *buff: Data buffer to store read data
+ * @param  sector: Sector address (LBA)
+ * @param  type: Sector class
+ * 			@arg DISKIO_SECTOR_DIR: Boot/directory sector
+ * 			@arg DISKIO_SECTOR_FAT: FAT sector
+ * @retval DRESULT: Operation result
+ * 			@arg RES_OK: Successful
+ * 			@arg RES_ERROR: R/W Error
+ */
+DRESULT diskio_readMetaSector(BYTE pdrv, BYTE* buff, DWORD sector, BYTE type)
+{
+	if (0 == g_diskIODrivers.pui32IsInitialized[pdrv])
+	{
+		return RES_NOTRDY;
+	}
+#if _USE_WRITE_COMBINE == 1
+	if (RES_OK != diskio_flushOverlappedWrite(pdrv, sector, 1))
+	{
+		return RES_ERROR;
+	}
+#endif /* _USE_WRITE_COMBINE == 1 */
+	if (DISKIO_SECTOR_FAT == type)
+	{
+		g_diskCacheStatistic.ui32FatReads++;
+#if _USE_FAT_CACHE == 1
+		return diskio_readFatSector(pdrv, buff, sector);
+#endif /* _USE_FAT_CACHE == 1 */
+	}
+	return diskio_readCachedSector(pdrv, buff, sector, type);
+}
+
+/**
+ * @brief  Drop the cached copy of sector(s).
+ *         Must be called when the disk is written without passing by disk_write().
+ * @param  pdrv: Physical drive number (0..)
+ * @param  sector: First sector address (LBA)
+ * @param  count: Number of sectors
+ * @retval None
+ */
+void diskio_invalidateCache(BYTE pdrv, DWORD sector, UINT count)
+{
+	int i, j;
+	for (i = 0; i < _CACHE_SETS; i++)
+	{
+		for (j = 0; j < _CACHE_WAYS; j++)
+		{
+			diskio_cache_line_t *pLine = &g_pDiskCache[i][j];
+			if ((pLine->ui8Drive == pdrv) && (pLine->ui32Sector >= sector)
+					&& ((pLine->ui32Sector - sector) < count))
+			{
+				pLine->bValid = 0;
+			}
+		}
+	}
+#if _USE_FAT_CACHE == 1
+	if ((0 != g_diskFatCache.ui32Count) && (g_diskFatCache.ui8Drive == pdrv)
+			&& ((g_diskFatCache.ui32Sector + g_diskFatCache.ui32Count) > sector)
+			&& ((g_diskFatCache.ui32Sector < sector)
+					|| ((g_diskFatCache.ui32Sector - sector) < count)))
+	{
+		g_diskFatCache.ui32Count = 0;
+	}
+#endif /* _USE_FAT_CACHE == 1 */
+}
+
+/**
+ * @brief  Get the statistic of the sector cache.
+ * @param  pStatistic: pointer to the statistic output structure.
+ * @retval None
+ */
+void diskio_getCacheStatistic(diskio_cache_statistic_t *pStatistic)
+{
+	*pStatistic = g_diskCacheStatistic;
+}
+
+/**
+ * @brief  Reset the statistic of the sector cache.
+ * @retval None
+ */
+void diskio_resetCacheStatistic(void)
+{
+	memset(&g_diskCacheStatistic, 0, sizeof(g_diskCacheStatistic));
+}
+#endif /* _USE_CACHE == 1 */
+
 #if _USE_WRITE == 1
 /**
  * @brief  Writes Sector(s)
@@ -224,12 +737,50 @@ DRESULT disk_write(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count)
 {
 	if (0 == g_diskIODrivers.pui32IsInitialized[pdrv])
 	{
-		return RES_ERROR;
+		return RES_NOTRDY;
 	}
 
 	DRESULT diskResultReturn;
+#if _USE_WRITE_COMBINE == 1
+	diskResultReturn = diskio_combineWrite(pdrv, buff, sector, count);
+#else
 	diskResultReturn = g_diskIODrivers.pDiskDriver[pdrv]->disk_write(
 			g_diskIODrivers.pui8Lun[pdrv], buff, sector, count);
+#endif /* _USE_WRITE_COMBINE == 1 */
+
+#if _USE_CACHE == 1
+	/* Write-through: keep the cached copies equal to the disk content */
+	UINT i;
+	for (i = 0; i < count; i++)
+	{
+		diskio_cache_line_t *pLine = diskio_lookupCache(pdrv, sector + i);
+		if (NULL != pLine)
+		{
+			if (RES_OK == diskResultReturn)
+			{
+				memcpy(pLine->pui32Data, buff + (i * _MAX_SS), _MAX_SS);
+			}
+			else
+			{
+				pLine->bValid = 0;
+			}
+		}
+#if _USE_FAT_CACHE == 1
+		BYTE *pui8Data = diskio_lookupFatCache(pdrv, sector + i);
+		if (NULL != pui8Data)
+		{
+			if (RES_OK == diskResultReturn)
+			{
+				memcpy(pui8Data, buff + (i * _MAX_SS), _MAX_SS);
+			}
+			else
+			{
+				g_diskFatCache.ui32Count = 0;
+			}
+		}
+#endif /* _USE_FAT_CACHE == 1 */
+	}
+#endif /* _USE_CACHE == 1 */
 	return diskResultReturn;
 }
 #endif /* _USE_WRITE == 1 */
@@ -251,16 +802,97 @@ DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void* buff)
 {
 	if (0 == g_diskIODrivers.pui32IsInitialized[pdrv])
 	{
-		return RES_ERROR;
+		return RES_NOTRDY;
 	}
 
 	DRESULT diskResultReturn;
+#if _USE_WRITE_COMBINE == 1
+	if (CTRL_SYNC == cmd)
+	{
+		diskResultReturn = diskio_flushWrite();
+		if (RES_OK != diskResultReturn)
+		{
+			return diskResultReturn;
+		}
+	}
+#if _USE_TRIM == 1
+	if (CTRL_TRIM == cmd)
+	{
+		/* Pending sectors of the range are written before being erased */
+		diskResultReturn = diskio_flushOverlappedWrite(pdrv, ((DWORD*) buff)[0],
+				((DWORD*) buff)[1] - ((DWORD*) buff)[0] + 1);
+		if (RES_OK != diskResultReturn)
+		{
+			return diskResultReturn;
+		}
+	}
+#endif /* _USE_TRIM == 1 */
+#endif /* _USE_WRITE_COMBINE == 1 */
 	diskResultReturn = g_diskIODrivers.pDiskDriver[pdrv]->disk_ioctl(
 			g_diskIODrivers.pui8Lun[pdrv], cmd, buff);
+
+#if (_USE_CACHE == 1) && (_USE_TRIM == 1)
+	if (CTRL_TRIM == cmd)
+	{
+		/* Erased sectors content is undefined (all 0 or all 1) */
+		diskio_invalidateCache(pdrv, ((DWORD*) buff)[0],
+				((DWORD*) buff)[1] - ((DWORD*) buff)[0] + 1);
+	}
+#endif /* (_USE_CACHE == 1) && (_USE_TRIM == 1) */
 	return diskResultReturn;
 }
 #endif /* _USE_IOCTL == 1 */
 
+#if _USE_WRITE_COMBINE == 1
+/**
+ * @brief  Write the pending sectors to the disk in one multi-sector write.
+ * @retval DRESULT: Operation result
+ * 			@arg RES_OK: Successful or nothing pending
+ * 			@arg RES_ERROR: R/W Error, the pending sectors are dropped
+ */
+DRESULT diskio_flushWrite(void)
+{
+	diskio_write_combine_t *pCombine = &g_diskWriteCombine;
+	if (0 == pCombine->ui32Count)
+	{
+		return RES_OK;
+	}
+
+	DRESULT diskResultReturn;
+	diskResultReturn =
+			g_diskIODrivers.pDiskDriver[pCombine->ui8Drive]->disk_write(
+					g_diskIODrivers.pui8Lun[pCombine->ui8Drive],
+					(const BYTE*) pCombine->pui32Data, pCombine->ui32Sector,
+					pCombine->ui32Count);
+	if (RES_OK != diskResultReturn)
+	{
+		/* The cache was updated when the sectors were accepted */
+		diskio_invalidateCache(pCombine->ui8Drive, pCombine->ui32Sector,
+				pCombine->ui32Count);
+	}
+	pCombine->ui32Count = 0;
+	return diskResultReturn;
+}
+
+/**
+ * @brief  Flush the pending sectors not completed since _WRITE_COMBINE_TIMEOUT ms.
+ *         Should be called periodically (main loop) to bound the data at risk.
+ * @retval DRESULT: Operation result
+ * 			@arg RES_OK: Successful or nothing to flush
+ * 			@arg RES_ERROR: R/W Error
+ */
+DRESULT diskio_flushIdleWrite(void)
+{
+	if ((0 != g_diskWriteCombine.ui32Count)
+			&& ((HAL_GetTick() - g_diskWriteCombine.ui32LastWriteTick)
+					>= _WRITE_COMBINE_TIMEOUT))
+	{
+		return diskio_flushWrite();
+	}
+	return RES_OK;
+}
+#endif /* _USE_WRITE_COMBINE == 1 */
+
 /**
  * @brief  Gets Time from RTC
  * @retval Time in DWORD
@@ -0,0 +1,1086 @@
+/**
+ ****************************************************************************
+ * @file        exfat.c
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       This file implement an exFAT volume reader for the media files
+ *              of SDXC cards and a writer of contiguous files.
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/** @addtogroup LIB_FATFS_EXFAT
+ * @{
+ */
+/** @defgroup LIB_FATFS_EXFAT_PRIVATE exFAT (Private)
+ * @{
+ *
+ * FatFs R0.11 does not know exFAT, which SDXC cards (64GB and more) are
+ * formatted with. This module covers what the player and a recorder need:
+ * mount the volume (at sector 0 or in the first MBR partition), look a path
+ * up and map a file position to its sector. Data are then read with
+ * disk_read() and written with disk_write().
+ *
+ * A file whose stream extension has the NoFatChain flag is contiguous: its
+ * sectors are computed without any FAT access. Other files follow the FAT.
+ *
+ * exfat_create() makes such a contiguous file for a recording: the clusters
+ * are allocated from the allocation bitmap (first fit) and the entry set is
+ * written with its checksum and name hash. The FAT is never written. The
+ * recording is then written by sector and exfat_close() sets its final size,
+ * giving the unused clusters back to the bitmap. The volume is flagged dirty
+ * in between, so that a card removed while recording gets checked by the PC.
+ *
+ * Not supported: fragmented allocation and FAT chains (a recording needs a
+ * free run of its maximum size), growing a full directory, deleting or
+ * renaming, non-ASCII names, sector sizes other than 512 bytes, boot region
+ * checksum and non-ASCII case folding (the up-case table is not loaded,
+ * names compare exactly outside a-z). Files are not written through FatFs:
+ * f_open() still fails with FR_NO_FILESYSTEM on these volumes.
+ */
+/* Includes ------------------------------------------------------------------*/
+#include "exfat.h"
+#include <string.h>
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+#define EXFAT_SECTOR_SIZE		(512)
+#define EXFAT_SECTOR_SHIFT		(9)
+#define EXFAT_ENTRY_SIZE		(32)
+
+/* Boot sector fields */
+#define EXFAT_BS_NAME			(3)
+#define EXFAT_BS_FAT_OFFSET		(80)
+#define EXFAT_BS_HEAP_OFFSET	(88)
+#define EXFAT_BS_CLUSTER_COUNT	(92)
+#define EXFAT_BS_ROOT_CLUSTER	(96)
+#define EXFAT_BS_FAT_LENGTH		(84)
+#define EXFAT_BS_VOLUME_FLAGS	(106)
+#define EXFAT_BS_SECTOR_SHIFT	(108)
+#define EXFAT_BS_CLUSTER_SHIFT	(109)
+#define EXFAT_BS_NUMBER_OF_FATS	(110)
+#define EXFAT_BS_SIGNATURE		(510)
+
+/* MBR first partition entry */
+#define EXFAT_MBR_PARTITION		(446)
+#define EXFAT_MBR_TYPE_EXFAT	(0x07)
+
+/* Directory entry types and fields */
+#define EXFAT_ENTRY_END			(0x00)
+#define EXFAT_ENTRY_IN_USE		(0x80)
+#define EXFAT_ENTRY_BITMAP		(0x81)
+#define EXFAT_ENTRY_FILE		(0x85)
+#define EXFAT_ENTRY_STREAM		(0xC0)
+#define EXFAT_ENTRY_NAME		(0xC1)
+#define EXFAT_FILE_COUNT		(1)
+#define EXFAT_FILE_CHECKSUM		(2)
+#define EXFAT_FILE_ATTRIBUTES	(4)
+#define EXFAT_FILE_CREATE_TIME	(8)
+#define EXFAT_FILE_MODIFY_TIME	(12)
+#define EXFAT_FILE_ACCESS_TIME	(16)
+#define EXFAT_STREAM_FLAGS		(1)
+#define EXFAT_STREAM_NAME_LENGTH	(3)
+#define EXFAT_STREAM_NAME_HASH	(4)
+#define EXFAT_STREAM_VALID_LENGTH	(8)
+#define EXFAT_STREAM_CLUSTER	(20)
+#define EXFAT_STREAM_LENGTH		(24)
+#define EXFAT_NAME_CHARACTERS	(2)
+#define EXFAT_NAME_PER_ENTRY	(15)
+#define EXFAT_NAME_MAX			(255)
+#define EXFAT_BITMAP_CLUSTER	(20)
+
+#define EXFAT_ATTRIBUTE_DIRECTORY	(0x10)
+#define EXFAT_ATTRIBUTE_ARCHIVE	(0x20)
+#define EXFAT_FLAG_ALLOCATION	(0x01)
+#define EXFAT_FLAG_NO_FAT_CHAIN	(0x02)
+#define EXFAT_VOLUME_DIRTY		(0x0002)
+#define EXFAT_BS_PERCENT_IN_USE	(112)
+#define EXFAT_PERCENT_UNKNOWN	(0xFF)
+#define EXFAT_BITS_PER_SECTOR	(EXFAT_SECTOR_SIZE * 8)
+
+/* Private macro -------------------------------------------------------------*/
+#define EXFAT_LD_WORD(p)	((WORD) (((WORD) (p)[1] << 8) | (p)[0]))
+#define EXFAT_LD_DWORD(p)	((DWORD) (((DWORD) (p)[3] << 24) | ((DWORD) (p)[2] << 16) | ((DWORD) (p)[1] << 8) | (p)[0]))
+#define EXFAT_TO_UPPER(c)	((((c) >= 'a') && ((c) <= 'z')) ? ((c) - 'a' + 'A') : (c))
+#define EXFAT_ST_WORD(p, v)	do { (p)[0] = (BYTE) (v); (p)[1] = (BYTE) ((v) >> 8); } while (0)
+#define EXFAT_ST_DWORD(p, v)	do { EXFAT_ST_WORD(p, v); EXFAT_ST_WORD((p) + 2, (v) >> 16); } while (0)
+#define EXFAT_CLUSTERS(v, n)	((0 == (n)) ? 0 : ((((n) - 1) >> ((v)->ui8ClusterShift + EXFAT_SECTOR_SHIFT)) + 1))
+
+/* Private variables ---------------------------------------------------------*/
+/* Private functions declaration ---------------------------------------------*/
+static bool exfat_readWindow(exfat_volume_t *pVolume, DWORD ui32Sector,
+		BYTE ui8Class);
+static bool exfat_isBootSector(const BYTE *pui8Sector);
+static DWORD exfat_getNextCluster(exfat_volume_t *pVolume, DWORD ui32Cluster);
+static bool exfat_findEntry(exfat_file_t *pDirectory, const char *pcName,
+		UINT ui32NameLength, exfat_file_t *pFile);
+static bool exfat_openPath(exfat_volume_t *pVolume, const char *pcPath,
+		const char *pcEnd, exfat_file_t *pFile);
+static bool exfat_writeWindow(exfat_volume_t *pVolume);
+static BYTE *exfat_loadEntry(exfat_file_t *pDirectory, DWORD ui32Position);
+static WORD exfat_sumEntry(WORD ui16Checksum, const BYTE *pui8Entry,
+		bool bPrimary);
+static bool exfat_findBitmap(exfat_volume_t *pVolume);
+static DWORD exfat_allocate(exfat_volume_t *pVolume, DWORD ui32Count);
+static bool exfat_setBitmap(exfat_volume_t *pVolume, DWORD ui32Cluster,
+		DWORD ui32Count, bool bUsed);
+static bool exfat_setVolumeDirty(exfat_volume_t *pVolume, bool bDirty);
+static bool exfat_findFreeEntries(exfat_file_t *pDirectory, UINT uiCount,
+		DWORD *pui32Position);
+static void exfat_buildEntry(BYTE *pui8Entry, UINT uiIndex,
+		const char *pcName, UINT uiNameLength, const exfat_file_t *pFile,
+		DWORD ui32Time);
+static void exfat_initFile(exfat_file_t *pFile, exfat_volume_t *pVolume,
+		DWORD ui32FirstCluster, DWORD ui32Size, bool bNoFatChain,
+		bool bDirectory);
+
+/* Private function prototypes -----------------------------------------------*/
+/**
+ * @brief  Load a sector in the window of the volume.
+ * @param  pVolume: volume object.
+ * @param  ui32Sector: sector address (LBA).
+ * @param  ui8Class: sector class for the disk I/O cache.
+ *			@arg DISKIO_SECTOR_DIR: boot/directory sector
+ *			@arg DISKIO_SECTOR_FAT: FAT sector
+ * @retval bool: process status
+ *			@arg true: the sector is in the window
+ *			@arg false: disk error
+ */
+static bool exfat_readWindow(exfat_volume_t *pVolume, DWORD ui32Sector,
+		BYTE ui8Class)
+{
+	if (ui32Sector == pVolume->ui32WindowSector)
+	{
+		return true;
+	}
+	if (RES_OK
+			!= diskio_readMetaSector(pVolume->ui8Drive,
+					(BYTE *) pVolume->pui32Window, ui32Sector, ui8Class))
+	{
+		pVolume->ui32WindowSector = 0xFFFFFFFF;
+		return false;
+	}
+	pVolume->ui32WindowSector = ui32Sector;
+	return true;
+}
+
+/**
+ * @brief  Check the signature of an exFAT boot sector.
+ * @param  pui8Sector: sector data.
+ * @retval bool: true if the sector is an exFAT boot sector
+ */
+static bool exfat_isBootSector(const BYTE *pui8Sector)
+{
+	return (0xAA55 == EXFAT_LD_WORD(&pui8Sector[EXFAT_BS_SIGNATURE]))
+			&& (0 == memcmp(&pui8Sector[EXFAT_BS_NAME], "EXFAT   ", 8));
+}
+
+/**
+ * @brief  Read the FAT entry of a cluster.
+ * @param  pVolume: volume object.
+ * @param  ui32Cluster: cluster number.
+ * @retval DWORD: next cluster, 0xFFFFFFFF at the end of the chain or on error
+ */
+static DWORD exfat_getNextCluster(exfat_volume_t *pVolume, DWORD ui32Cluster)
+{
+	DWORD ui32Sector = pVolume->ui32FatSector
+			+ (ui32Cluster / (EXFAT_SECTOR_SIZE / 4));
+
+	if (ui32Sector != pVolume->ui32WindowSector)
+	{
+		pVolume->ui32FatReads++;
+		if (!exfat_readWindow(pVolume, ui32Sector, DISKIO_SECTOR_FAT))
+		{
+			return 0xFFFFFFFF;
+		}
+	}
+	return EXFAT_LD_DWORD(
+			(BYTE *) pVolume->pui32Window + (4 * (ui32Cluster % (EXFAT_SECTOR_SIZE / 4))));
+}
+
+/**
+ * @brief  Look a name up in a directory.
+ * @param  pDirectory: directory object.
+ * @param  pcName: name to find, not terminated.
+ * @param  ui32NameLength: number of characters of the name.
+ * @param  pFile: object of the entry found.
+ * @retval bool: process status
+ *			@arg true: entry found
+ *			@arg false: no such entry or disk error
+ */
+static bool exfat_findEntry(exfat_file_t *pDirectory, const char *pcName,
+		UINT ui32NameLength, exfat_file_t *pFile)
+{
+	exfat_volume_t *pVolume = pDirectory->pVolume;
+	const BYTE *pui8Entry;
+	DWORD ui32Position;
+	DWORD ui32Sector;
+	DWORD ui32Count;
+	UINT ui32Remaining = 0; /* Secondary entries left in the current set */
+	UINT ui32NameOffset = 0;
+	UINT i;
+	WORD ui16Character;
+	bool bMatch = false;
+	bool bStream = false;
+
+	for (ui32Position = 0;; ui32Position += EXFAT_SECTOR_SIZE)
+	{
+		if (!exfat_mapSector(pDirectory, ui32Position, &ui32Sector, &ui32Count)
+				|| !exfat_readWindow(pVolume, ui32Sector, DISKIO_SECTOR_DIR))
+		{
+			return false;
+		}
+
+		for (pui8Entry = (const BYTE *) pVolume->pui32Window;
+				pui8Entry < (const BYTE *) pVolume->pui32Window + EXFAT_SECTOR_SIZE;
+				pui8Entry += EXFAT_ENTRY_SIZE)
+		{
+			if (EXFAT_ENTRY_END == pui8Entry[0])
+			{
+				return false;
+			}
+			if (EXFAT_ENTRY_FILE == pui8Entry[0])
+			{
+				ui32Remaining = pui8Entry[EXFAT_FILE_COUNT];
+				ui32NameOffset = 0;
+				bMatch = true;
+				bStream = false;
+				pFile->bDirectory = (0
+						!= (EXFAT_LD_WORD(&pui8Entry[EXFAT_FILE_ATTRIBUTES])
+								& EXFAT_ATTRIBUTE_DIRECTORY));
+				continue;
+			}
+			if (0 == ui32Remaining)
+			{
+				/* Bitmap, up-case table, label or deleted entries */
+				continue;
+			}
+			if (0 == (pui8Entry[0] & EXFAT_ENTRY_IN_USE))
+			{
+				/* Broken entry set */
+				ui32Remaining = 0;
+				continue;
+			}
+			ui32Remaining--;
+
+			if (EXFAT_ENTRY_STREAM == pui8Entry[0])
+			{
+				bStream = true;
+				bMatch = bMatch
+						&& (ui32NameLength == pui8Entry[EXFAT_STREAM_NAME_LENGTH]);
+				pFile->bNoFatChain = (0
+						!= (pui8Entry[EXFAT_STREAM_FLAGS] & EXFAT_FLAG_NO_FAT_CHAIN));
+				pFile->ui32FirstCluster = EXFAT_LD_DWORD(&pui8Entry[EXFAT_STREAM_CLUSTER]);
+				/* Clip the 64-bit length to 4GB - 1 */
+				pFile->ui32Size =
+						(0 != EXFAT_LD_DWORD(&pui8Entry[EXFAT_STREAM_LENGTH + 4])) ?
+								(0xFFFFFFFF) :
+								(EXFAT_LD_DWORD(&pui8Entry[EXFAT_STREAM_LENGTH]));
+			}
+			else if ((EXFAT_ENTRY_NAME == pui8Entry[0]) && bMatch)
+			{
+				for (i = 0;
+						(EXFAT_NAME_PER_ENTRY > i)
+								&& (ui32NameLength > (ui32NameOffset + i)); i++)
+				{
+					ui16Character = EXFAT_LD_WORD(
+							&pui8Entry[EXFAT_NAME_CHARACTERS + (2 * i)]);
+					if (EXFAT_TO_UPPER(ui16Character)
+							!= EXFAT_TO_UPPER((BYTE) pcName[ui32NameOffset + i]))
+					{
+						bMatch = false;
+						break;
+					}
+				}
+				ui32NameOffset += EXFAT_NAME_PER_ENTRY;
+			}
+
+			if ((0 == ui32Remaining) && bMatch && bStream)
+			{
+				pFile->pVolume = pVolume;
+				pFile->ui32Cluster = pFile->ui32FirstCluster;
+				pFile->ui32ClusterIndex = 0;
+				return true;
+			}
+		}
+	}
+}
+
+/**
+ * @brief  Initialize a file object on its first cluster.
+ * @param  pFile: file object to initialize.
+ * @param  pVolume: volume of the file.
+ * @param  ui32FirstCluster: first cluster.
+ * @param  ui32Size: size in byte unit.
+ * @param  bNoFatChain: the clusters are contiguous.
+ * @param  bDirectory: the file is a directory.
+ * @retval None
+ */
+static void exfat_initFile(exfat_file_t *pFile, exfat_volume_t *pVolume,
+		DWORD ui32FirstCluster, DWORD ui32Size, bool bNoFatChain,
+		bool bDirectory)
+{
+	memset(pFile, 0, sizeof(exfat_file_t));
+	pFile->pVolume = pVolume;
+	pFile->ui32FirstCluster = ui32FirstCluster;
+	pFile->ui32Cluster = ui32FirstCluster;
+	pFile->ui32Size = ui32Size;
+	pFile->bNoFatChain = bNoFatChain;
+	pFile->bDirectory = bDirectory;
+}
+
+/**
+ * @brief  Open the file or directory of a path.
+ * @param  pVolume: mounted volume object.
+ * @param  pcPath: path of the file, without the drive prefix.
+ * @param  pcEnd: end of the path, the rest of the string is ignored.
+ * @param  pFile: file object to initialize, the root directory for an empty path.
+ * @retval bool: process status
+ *			@arg true: file opened
+ *			@arg false: no such file or disk error
+ */
+static bool exfat_openPath(exfat_volume_t *pVolume, const char *pcPath,
+		const char *pcEnd, exfat_file_t *pFile)
+{
+	exfat_file_t directory;
+	UINT ui32NameLength;
+
+	/* Start from the root directory, which always follows the FAT */
+	exfat_initFile(pFile, pVolume, pVolume->ui32RootCluster, 0, false, true);
+
+	while (pcPath < pcEnd)
+	{
+		if (('/' == *pcPath) || ('\\' == *pcPath))
+		{
+			pcPath++;
+			continue;
+		}
+		if (!pFile->bDirectory)
+		{
+			return false;
+		}
+		for (ui32NameLength = 0;
+				((pcPath + ui32NameLength) < pcEnd) && ('/' != pcPath[ui32NameLength])
+						&& ('\\' != pcPath[ui32NameLength]); ui32NameLength++)
+		{
+		}
+		directory = *pFile;
+		if (!exfat_findEntry(&directory, pcPath, ui32NameLength, pFile))
+		{
+			return false;
+		}
+		pcPath += ui32NameLength;
+	}
+	return true;
+}
+
+/**
+ * @brief  Write the window of the volume back to its sector.
+ * @param  pVolume: volume object.
+ * @retval bool: process status
+ *			@arg true: sector written
+ *			@arg false: disk error
+ */
+static bool exfat_writeWindow(exfat_volume_t *pVolume)
+{
+	return (RES_OK
+			== disk_write(pVolume->ui8Drive, (const BYTE *) pVolume->pui32Window,
+					pVolume->ui32WindowSector, 1));
+}
+
+/**
+ * @brief  Load the sector holding a directory entry in the window.
+ * @note   Mapping a position of the cluster of the previous one does not
+ * 			read the FAT: the window holding a modified entry is only replaced
+ * 			when the next entry is in another sector.
+ * @param  pDirectory: directory object.
+ * @param  ui32Position: position of the entry in byte unit.
+ * @retval BYTE*: entry in the window, NULL at the end of the directory or on disk error
+ */
+static BYTE *exfat_loadEntry(exfat_file_t *pDirectory, DWORD ui32Position)
+{
+	exfat_volume_t *pVolume = pDirectory->pVolume;
+	DWORD ui32Sector;
+	DWORD ui32Count;
+
+	if (!exfat_mapSector(pDirectory, ui32Position, &ui32Sector, &ui32Count)
+			|| !exfat_readWindow(pVolume, ui32Sector, DISKIO_SECTOR_DIR))
+	{
+		return NULL;
+	}
+	return (BYTE *) pVolume->pui32Window + (ui32Position % EXFAT_SECTOR_SIZE);
+}
+
+/**
+ * @brief  Add a directory entry to the checksum of its entry set.
+ * @param  ui16Checksum: checksum of the previous entries of the set.
+ * @param  pui8Entry: directory entry.
+ * @param  bPrimary: the entry is the file entry, its checksum field is skipped.
+ * @retval WORD: checksum
+ */
+static WORD exfat_sumEntry(WORD ui16Checksum, const BYTE *pui8Entry,
+		bool bPrimary)
+{
+	UINT i;
+
+	for (i = 0; EXFAT_ENTRY_SIZE > i; i++)
+	{
+		if (bPrimary
+				&& ((EXFAT_FILE_CHECKSUM == i) || ((EXFAT_FILE_CHECKSUM + 1) == i)))
+		{
+			continue;
+		}
+		ui16Checksum = (WORD) (((ui16Checksum & 1) ? 0x8000 : 0)
+				+ (ui16Checksum >> 1) + pui8Entry[i]);
+	}
+	return ui16Checksum;
+}
+
+/**
+ * @brief  Find the allocation bitmap in the root directory.
+ * @param  pVolume: volume object with its root cluster.
+ * @retval bool: process status
+ *			@arg true: bitmap found
+ *			@arg false: no bitmap or disk error
+ */
+static bool exfat_findBitmap(exfat_volume_t *pVolume)
+{
+	exfat_file_t root;
+	const BYTE *pui8Entry;
+	DWORD ui32Position;
+
+	exfat_initFile(&root, pVolume, pVolume->ui32RootCluster, 0, false, true);
+	for (ui32Position = 0;; ui32Position += EXFAT_ENTRY_SIZE)
+	{
+		pui8Entry = exfat_loadEntry(&root, ui32Position);
+		if ((NULL == pui8Entry) || (EXFAT_ENTRY_END == pui8Entry[0]))
+		{
+			return false;
+		}
+		if (EXFAT_ENTRY_BITMAP == pui8Entry[0])
+		{
+			pVolume->ui32BitmapCluster = EXFAT_LD_DWORD(&pui8Entry[EXFAT_BITMAP_CLUSTER]);
+			return ((pVolume->ui32BitmapCluster - 2) < pVolume->ui32ClusterCount);
+		}
+	}
+}
+
+/**
+ * @brief  Find the first run of free clusters in the allocation bitmap.
+ * @param  pVolume: volume object.
+ * @param  ui32Count: number of contiguous clusters.
+ * @retval DWORD: first cluster of the run, 0 if no run is large enough or on disk error
+ */
+static DWORD exfat_allocate(exfat_volume_t *pVolume, DWORD ui32Count)
+{
+	const BYTE *pui8Bits = (const BYTE *) pVolume->pui32Window;
+	exfat_file_t bitmap;
+	DWORD ui32Index; /* Bit of the cluster: cluster number - 2 */
+	DWORD ui32Start = 0;
+	DWORD ui32Run = 0;
+	DWORD ui32Sector;
+	DWORD ui32SectorCount;
+
+	exfat_initFile(&bitmap, pVolume, pVolume->ui32BitmapCluster,
+			(pVolume->ui32ClusterCount + 7) / 8, false, false);
+	for (ui32Index = 0; ui32Index < pVolume->ui32ClusterCount; ui32Index++)
+	{
+		if ((0 == (ui32Index % EXFAT_BITS_PER_SECTOR))
+				&& (!exfat_mapSector(&bitmap, ui32Index / 8, &ui32Sector,
+						&ui32SectorCount)
+						|| !exfat_readWindow(pVolume, ui32Sector, DISKIO_SECTOR_FAT)))
+		{
+			return 0;
+		}
+		if (0 != (pui8Bits[(ui32Index % EXFAT_BITS_PER_SECTOR) / 8]
+				& (1 << (ui32Index % 8))))
+		{
+			ui32Run = 0;
+			continue;
+		}
+		if (0 == ui32Run)
+		{
+			ui32Start = ui32Index;
+		}
+		if (ui32Count == ++ui32Run)
+		{
+			return ui32Start + 2;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief  Set or clear the allocation bitmap bits of a run of clusters.
+ * @param  pVolume: volume object.
+ * @param  ui32Cluster: first cluster of the run.
+ * @param  ui32Count: number of clusters.
+ * @param  bUsed: true to allocate the clusters, false to free them.
+ * @retval bool: process status
+ *			@arg true: bitmap written
+ *			@arg false: disk error
+ */
+static bool exfat_setBitmap(exfat_volume_t *pVolume, DWORD ui32Cluster,
+		DWORD ui32Count, bool bUsed)
+{
+	BYTE *pui8Bits = (BYTE *) pVolume->pui32Window;
+	exfat_file_t bitmap;
+	DWORD ui32Index = ui32Cluster - 2;
+	DWORD ui32Sector;
+	DWORD ui32SectorCount;
+	BYTE ui8Mask;
+
+	if (0 == ui32Count)
+	{
+		return true;
+	}
+	exfat_initFile(&bitmap, pVolume, pVolume->ui32BitmapCluster,
+			(pVolume->ui32ClusterCount + 7) / 8, false, false);
+	for (; ui32Count; ui32Count--, ui32Index++)
+	{
+		/* Write the previous bitmap sector before mapping the next one */
+		if ((ui32Index == (ui32Cluster - 2))
+				|| (0 == (ui32Index % EXFAT_BITS_PER_SECTOR)))
+		{
+			if (((ui32Index != (ui32Cluster - 2)) && !exfat_writeWindow(pVolume))
+					|| !exfat_mapSector(&bitmap, ui32Index / 8, &ui32Sector,
+							&ui32SectorCount)
+					|| !exfat_readWindow(pVolume, ui32Sector, DISKIO_SECTOR_FAT))
+			{
+				return false;
+			}
+		}
+		ui8Mask = (BYTE) (1 << (ui32Index % 8));
+		if (bUsed)
+		{
+			pui8Bits[(ui32Index % EXFAT_BITS_PER_SECTOR) / 8] |= ui8Mask;
+		}
+		else
+		{
+			pui8Bits[(ui32Index % EXFAT_BITS_PER_SECTOR) / 8] &= (BYTE) ~ui8Mask;
+		}
+	}
+	return exfat_writeWindow(pVolume);
+}
+
+/**
+ * @brief  Set or clear the VolumeDirty flag of the boot sector.
+ * @note   The PercentInUse field is set to not available, it is not
+ * 			maintained. Both fields are outside of the boot region checksum.
+ * 			A volume mounted dirty is left dirty.
+ * @param  pVolume: volume object.
+ * @param  bDirty: true before a modification, false once it is complete.
+ * @retval bool: process status
+ *			@arg true: boot sector written
+ *			@arg false: disk error
+ */
+static bool exfat_setVolumeDirty(exfat_volume_t *pVolume, bool bDirty)
+{
+	BYTE *pui8Sector = (BYTE *) pVolume->pui32Window;
+	WORD ui16Flags;
+
+	if (!exfat_readWindow(pVolume, pVolume->ui32VolumeSector, DISKIO_SECTOR_DIR))
+	{
+		return false;
+	}
+	ui16Flags = EXFAT_LD_WORD(&pui8Sector[EXFAT_BS_VOLUME_FLAGS]);
+	if (bDirty || pVolume->bMountedDirty)
+	{
+		ui16Flags |= EXFAT_VOLUME_DIRTY;
+	}
+	else
+	{
+		ui16Flags &= (WORD) ~EXFAT_VOLUME_DIRTY;
+	}
+	EXFAT_ST_WORD(&pui8Sector[EXFAT_BS_VOLUME_FLAGS], ui16Flags);
+	pui8Sector[EXFAT_BS_PERCENT_IN_USE] = EXFAT_PERCENT_UNKNOWN;
+	return exfat_writeWindow(pVolume);
+}
+
+/**
+ * @brief  Find consecutive unused entries in a directory.
+ * @param  pDirectory: directory object.
+ * @param  uiCount: number of entries.
+ * @param  pui32Position: position of the first entry storage pointer.
+ * @retval bool: process status
+ *			@arg true: entries found
+ *			@arg false: directory full or disk error
+ */
+static bool exfat_findFreeEntries(exfat_file_t *pDirectory, UINT uiCount,
+		DWORD *pui32Position)
+{
+	const BYTE *pui8Entry;
+	DWORD ui32Position;
+	UINT uiFree = 0;
+
+	for (ui32Position = 0;; ui32Position += EXFAT_ENTRY_SIZE)
+	{
+		pui8Entry = exfat_loadEntry(pDirectory, ui32Position);
+		if (NULL == pui8Entry)
+		{
+			return false;
+		}
+		if (0 != (pui8Entry[0] & EXFAT_ENTRY_IN_USE))
+		{
+			uiFree = 0;
+			continue;
+		}
+		if (0 == uiFree++)
+		{
+			*pui32Position = ui32Position;
+		}
+		if (uiCount == uiFree)
+		{
+			return true;
+		}
+	}
+}
+
+/**
+ * @brief  Build one entry of the entry set of a new contiguous file.
+ * @param  pui8Entry: entry storage, EXFAT_ENTRY_SIZE bytes.
+ * @param  uiIndex: index in the set: 0 file, 1 stream extension, 2.. file name.
+ * @param  pcName: ASCII file name, not terminated.
+ * @param  uiNameLength: number of characters of the name.
+ * @param  pFile: file object with its first cluster, size and entry count.
+ * @param  ui32Time: creation time stamp, get_fattime() format.
+ * @retval None
+ */
+static void exfat_buildEntry(BYTE *pui8Entry, UINT uiIndex,
+		const char *pcName, UINT uiNameLength, const exfat_file_t *pFile,
+		DWORD ui32Time)
+{
+	WORD ui16Hash = 0;
+	UINT i;
+
+	memset(pui8Entry, 0, EXFAT_ENTRY_SIZE);
+	if (0 == uiIndex)
+	{
+		pui8Entry[0] = EXFAT_ENTRY_FILE;
+		pui8Entry[EXFAT_FILE_COUNT] = pFile->ui8EntryCount - 1;
+		EXFAT_ST_WORD(&pui8Entry[EXFAT_FILE_ATTRIBUTES], EXFAT_ATTRIBUTE_ARCHIVE);
+		EXFAT_ST_DWORD(&pui8Entry[EXFAT_FILE_CREATE_TIME], ui32Time);
+		EXFAT_ST_DWORD(&pui8Entry[EXFAT_FILE_MODIFY_TIME], ui32Time);
+		EXFAT_ST_DWORD(&pui8Entry[EXFAT_FILE_ACCESS_TIME], ui32Time);
+	}
+	else if (1 == uiIndex)
+	{
+		pui8Entry[0] = EXFAT_ENTRY_STREAM;
+		pui8Entry[EXFAT_STREAM_FLAGS] = EXFAT_FLAG_ALLOCATION | EXFAT_FLAG_NO_FAT_CHAIN;
+		pui8Entry[EXFAT_STREAM_NAME_LENGTH] = (BYTE) uiNameLength;
+		/* Hash of the up-cased UTF-16 name: low byte, then the null high byte */
+		for (i = 0; i < uiNameLength; i++)
+		{
+			ui16Hash = (WORD) (((ui16Hash & 1) ? 0x8000 : 0) + (ui16Hash >> 1)
+					+ (BYTE) EXFAT_TO_UPPER(pcName[i]));
+			ui16Hash = (WORD) (((ui16Hash & 1) ? 0x8000 : 0) + (ui16Hash >> 1));
+		}
+		EXFAT_ST_WORD(&pui8Entry[EXFAT_STREAM_NAME_HASH], ui16Hash);
+		/* Nothing is recorded yet: the valid data length is set by exfat_close() */
+		EXFAT_ST_DWORD(&pui8Entry[EXFAT_STREAM_CLUSTER], pFile->ui32FirstCluster);
+		EXFAT_ST_DWORD(&pui8Entry[EXFAT_STREAM_LENGTH], pFile->ui32Size);
+	}
+	else
+	{
+		pui8Entry[0] = EXFAT_ENTRY_NAME;
+		for (i = (uiIndex - 2) * EXFAT_NAME_PER_ENTRY;
+				(i < uiNameLength)
+						&& (i < ((uiIndex - 1) * EXFAT_NAME_PER_ENTRY)); i++)
+		{
+			EXFAT_ST_WORD(
+					&pui8Entry[EXFAT_NAME_CHARACTERS + 2 * (i % EXFAT_NAME_PER_ENTRY)],
+					(BYTE) pcName[i]);
+		}
+	}
+}
+
+/**
+ * @brief  Mount the exFAT volume of a drive.
+ * @param  pVolume: volume object to initialize.
+ * @param  ui8Drive: physical drive number, initialized by disk_initialize().
+ * @retval bool: process status
+ *			@arg true: exFAT volume mounted
+ *			@arg false: no exFAT volume or disk error
+ */
+bool exfat_mount(exfat_volume_t *pVolume, BYTE ui8Drive)
+{
+	const BYTE *pui8Sector = (const BYTE *) pVolume->pui32Window;
+	DWORD ui32VolumeSector = 0;
+
+	pVolume->ui8Drive = ui8Drive;
+	pVolume->ui32WindowSector = 0xFFFFFFFF;
+	pVolume->ui32FatReads = 0;
+	pVolume->ui32BitmapCluster = 0;
+	if (!exfat_readWindow(pVolume, 0, DISKIO_SECTOR_DIR))
+	{
+		return false;
+	}
+
+	/* Volume at sector 0 or in the first partition */
+	if (!exfat_isBootSector(pui8Sector))
+	{
+		if ((0xAA55 != EXFAT_LD_WORD(&pui8Sector[EXFAT_BS_SIGNATURE]))
+				|| (EXFAT_MBR_TYPE_EXFAT != pui8Sector[EXFAT_MBR_PARTITION + 4]))
+		{
+			return false;
+		}
+		ui32VolumeSector = EXFAT_LD_DWORD(&pui8Sector[EXFAT_MBR_PARTITION + 8]);
+		if (!exfat_readWindow(pVolume, ui32VolumeSector, DISKIO_SECTOR_DIR)
+				|| !exfat_isBootSector(pui8Sector))
+		{
+			return false;
+		}
+	}
+
+	if ((EXFAT_SECTOR_SHIFT != pui8Sector[EXFAT_BS_SECTOR_SHIFT])
+			|| ((25 - EXFAT_SECTOR_SHIFT) < pui8Sector[EXFAT_BS_CLUSTER_SHIFT]))
+	{
+		return false;
+	}
+
+	pVolume->ui8ClusterShift = pui8Sector[EXFAT_BS_CLUSTER_SHIFT];
+	pVolume->ui32FatSector = ui32VolumeSector
+			+ EXFAT_LD_DWORD(&pui8Sector[EXFAT_BS_FAT_OFFSET]);
+	if ((2 == pui8Sector[EXFAT_BS_NUMBER_OF_FATS])
+			&& (EXFAT_LD_WORD(&pui8Sector[EXFAT_BS_VOLUME_FLAGS]) & 0x0001))
+	{
+		/* TexFAT: the second FAT is the active one */
+		pVolume->ui32FatSector += EXFAT_LD_DWORD(&pui8Sector[EXFAT_BS_FAT_LENGTH]);
+	}
+	pVolume->ui32HeapSector = ui32VolumeSector
+			+ EXFAT_LD_DWORD(&pui8Sector[EXFAT_BS_HEAP_OFFSET]);
+	pVolume->ui32ClusterCount = EXFAT_LD_DWORD(&pui8Sector[EXFAT_BS_CLUSTER_COUNT]);
+	pVolume->ui32RootCluster = EXFAT_LD_DWORD(&pui8Sector[EXFAT_BS_ROOT_CLUSTER]);
+	pVolume->ui32VolumeSector = ui32VolumeSector;
+	pVolume->bMountedDirty = (0
+			!= (EXFAT_LD_WORD(&pui8Sector[EXFAT_BS_VOLUME_FLAGS]) & EXFAT_VOLUME_DIRTY));
+	if ((pVolume->ui32RootCluster - 2) >= pVolume->ui32ClusterCount)
+	{
+		return false;
+	}
+
+	/* Files can be created on volumes with one FAT (TexFAT has two bitmaps) */
+	if (1 == pui8Sector[EXFAT_BS_NUMBER_OF_FATS])
+	{
+		exfat_findBitmap(pVolume);
+	}
+	return true;
+}
+
+/**
+ * @brief  Open a file or a directory of a mounted exFAT volume.
+ * @param  pVolume: mounted volume object.
+ * @param  pcPath: path of the file, '/' or '\' separated, an optional drive
+ * 			prefix ("0:") is ignored. ASCII names are case insensitive.
+ * @param  pFile: file object to initialize.
+ * @retval bool: process status
+ *			@arg true: file opened
+ *			@arg false: no such file or disk error
+ */
+bool exfat_open(exfat_volume_t *pVolume, const char *pcPath,
+		exfat_file_t *pFile)
+{
+	if ((0 != pcPath[0]) && (':' == pcPath[1]))
+	{
+		pcPath += 2;
+	}
+	return exfat_openPath(pVolume, pcPath, pcPath + strlen(pcPath), pFile);
+}
+
+/**
+ * @brief  Get the sector holding a position of a file.
+ * @note   A NoFatChain file is mapped arithmetically. Otherwise the FAT chain
+ * 			is followed from the last mapped cluster (from the first cluster when
+ * 			the position goes backward), so sequential reads cost one FAT entry
+ * 			per cluster.
+ * @param  pFile: opened file object.
+ * @param  ui32Position: position in byte unit.
+ * @param  pui32Sector: sector address (LBA) storage pointer.
+ * @param  pui32Count: number of consecutive sectors of the file from this
+ * 			sector storage pointer.
+ * @retval bool: process status
+ *			@arg true: sector mapped
+ *			@arg false: end of the file or disk error
+ */
+bool exfat_mapSector(exfat_file_t *pFile, DWORD ui32Position,
+		DWORD *pui32Sector, DWORD *pui32Count)
+{
+	exfat_volume_t *pVolume = pFile->pVolume;
+	DWORD ui32ClusterIndex = ui32Position
+			>> (pVolume->ui8ClusterShift + EXFAT_SECTOR_SHIFT);
+	DWORD ui32SectorInCluster = (ui32Position >> EXFAT_SECTOR_SHIFT)
+			& ((1UL << pVolume->ui8ClusterShift) - 1);
+	DWORD ui32Cluster;
+
+	if ((0 == pFile->ui32FirstCluster)
+			|| ((!pFile->bDirectory || pFile->bNoFatChain)
+					&& (ui32Position >= pFile->ui32Size)))
+	{
+		return false;
+	}
+
+	if (pFile->bNoFatChain)
+	{
+		ui32Cluster = pFile->ui32FirstCluster + ui32ClusterIndex;
+		*pui32Count = ((pFile->ui32Size - 1) >> EXFAT_SECTOR_SHIFT)
+				- (ui32Position >> EXFAT_SECTOR_SHIFT) + 1;
+	}
+	else
+	{
+		if (ui32ClusterIndex < pFile->ui32ClusterIndex)
+		{
+			pFile->ui32Cluster = pFile->ui32FirstCluster;
+			pFile->ui32ClusterIndex = 0;
+		}
+		while (pFile->ui32ClusterIndex < ui32ClusterIndex)
+		{
+			ui32Cluster = exfat_getNextCluster(pVolume, pFile->ui32Cluster);
+			if ((ui32Cluster - 2) >= pVolume->ui32ClusterCount)
+			{
+				return false;
+			}
+			pFile->ui32Cluster = ui32Cluster;
+			pFile->ui32ClusterIndex++;
+		}
+		ui32Cluster = pFile->ui32Cluster;
+		*pui32Count = (1UL << pVolume->ui8ClusterShift) - ui32SectorInCluster;
+	}
+
+	if ((ui32Cluster - 2) >= pVolume->ui32ClusterCount)
+	{
+		return false;
+	}
+	*pui32Sector = pVolume->ui32HeapSector
+			+ ((ui32Cluster - 2) << pVolume->ui8ClusterShift) + ui32SectorInCluster;
+	return true;
+}
+
+/**
+ * @brief  Create a contiguous file for a recording.
+ * @note   The clusters of ui32Size bytes are allocated in one run and the file
+ * 			is NoFatChain. Its data are written with disk_write() at the sectors
+ * 			given by exfat_mapSector(), then exfat_close() sets the recorded size.
+ * 			The volume stays dirty until then.
+ * @param  pVolume: mounted volume object.
+ * @param  pcPath: path of the new file, the parent directory must exist.
+ * 			The name is printable ASCII without "*:<>?| characters.
+ * @param  ui32Size: maximum size of the recording in byte unit.
+ * @param  pFile: file object to initialize.
+ * @retval bool: process status
+ *			@arg true: file created
+ *			@arg false: bad name, file exists, directory full, no free run of
+ *			clusters, volume not writable (no bitmap, TexFAT) or disk error
+ */
+bool exfat_create(exfat_volume_t *pVolume, const char *pcPath, DWORD ui32Size,
+		exfat_file_t *pFile)
+{
+	exfat_file_t directory;
+	exfat_file_t existing;
+	BYTE pui8Entry[EXFAT_ENTRY_SIZE];
+	BYTE *pui8WindowEntry;
+	const char *pcName;
+	DWORD ui32Clusters;
+	DWORD ui32Position;
+	DWORD ui32Time;
+	WORD ui16Checksum = 0;
+	UINT uiNameLength;
+	UINT i;
+
+	if ((0 == pVolume->ui32BitmapCluster) || (0 == ui32Size))
+	{
+		return false;
+	}
+
+	/* The name is the last component of the path */
+	if ((0 != pcPath[0]) && (':' == pcPath[1]))
+	{
+		pcPath += 2;
+	}
+	pcName = pcPath + strlen(pcPath);
+	while ((pcName > pcPath) && ('/' != pcName[-1]) && ('\\' != pcName[-1]))
+	{
+		pcName--;
+	}
+	uiNameLength = strlen(pcName);
+	if ((0 == uiNameLength) || (EXFAT_NAME_MAX < uiNameLength))
+	{
+		return false;
+	}
+	for (i = 0; i < uiNameLength; i++)
+	{
+		if ((' ' > pcName[i]) || ('~' < pcName[i])
+				|| (NULL != strchr("\"*:<>?|", pcName[i])))
+		{
+			return false;
+		}
+	}
+
+	if (!exfat_openPath(pVolume, pcPath, pcName, &directory)
+			|| !directory.bDirectory)
+	{
+		return false;
+	}
+	existing = directory;
+	if (exfat_findEntry(&existing, pcName, uiNameLength, pFile))
+	{
+		return false;
+	}
+
+	exfat_initFile(pFile, pVolume, 0, ui32Size, true, false);
+	pFile->ui8EntryCount = 2
+			+ ((uiNameLength + EXFAT_NAME_PER_ENTRY - 1) / EXFAT_NAME_PER_ENTRY);
+	ui32Clusters = EXFAT_CLUSTERS(pVolume, ui32Size);
+	if (!exfat_findFreeEntries(&directory, pFile->ui8EntryCount,
+			&pFile->ui32EntryPosition))
+	{
+		return false;
+	}
+	pFile->ui32FirstCluster = exfat_allocate(pVolume, ui32Clusters);
+	if (0 == pFile->ui32FirstCluster)
+	{
+		return false;
+	}
+	pFile->ui32Cluster = pFile->ui32FirstCluster;
+	pFile->ui32DirectoryCluster = directory.ui32FirstCluster;
+	pFile->ui32DirectorySize = directory.ui32Size;
+	pFile->bDirectoryNoFatChain = directory.bNoFatChain;
+
+	/* Clusters first, then the entry set which points to them */
+	if (!exfat_setVolumeDirty(pVolume, true)
+			|| !exfat_setBitmap(pVolume, pFile->ui32FirstCluster, ui32Clusters, true))
+	{
+		return false;
+	}
+
+	ui32Time = get_fattime();
+	for (i = 0; i < pFile->ui8EntryCount; i++)
+	{
+		exfat_buildEntry(pui8Entry, i, pcName, uiNameLength, pFile, ui32Time);
+		ui16Checksum = exfat_sumEntry(ui16Checksum, pui8Entry, (0 == i));
+	}
+	for (i = 0; i < pFile->ui8EntryCount; i++)
+	{
+		ui32Position = pFile->ui32EntryPosition + (i * EXFAT_ENTRY_SIZE);
+		if ((0 != i) && (0 == (ui32Position % EXFAT_SECTOR_SIZE))
+				&& !exfat_writeWindow(pVolume))
+		{
+			return false;
+		}
+		pui8WindowEntry = exfat_loadEntry(&directory, ui32Position);
+		if (NULL == pui8WindowEntry)
+		{
+			return false;
+		}
+		exfat_buildEntry(pui8WindowEntry, i, pcName, uiNameLength, pFile,
+				ui32Time);
+		if (0 == i)
+		{
+			EXFAT_ST_WORD(&pui8WindowEntry[EXFAT_FILE_CHECKSUM], ui16Checksum);
+		}
+	}
+	return exfat_writeWindow(pVolume);
+}
+
+/**
+ * @brief  Close a file created by exfat_create() with its recorded size.
+ * @note   The clusters after the recorded size go back to the bitmap, the
+ * 			entry set is updated, then the volume is flagged clean and the
+ * 			disk synchronized.
+ * @param  pFile: file object created by exfat_create().
+ * @param  ui32Size: recorded size in byte unit, up to the created size.
+ * @retval bool: process status
+ *			@arg true: file closed
+ *			@arg false: not a created file, size too large or disk error
+ */
+bool exfat_close(exfat_file_t *pFile, DWORD ui32Size)
+{
+	exfat_volume_t *pVolume = pFile->pVolume;
+	exfat_file_t directory;
+	DWORD ui32Clusters;
+	BYTE *pui8Entry;
+	WORD ui16Checksum = 0;
+	UINT i;
+
+	if ((0 == pFile->ui32DirectoryCluster) || (ui32Size > pFile->ui32Size))
+	{
+		return false;
+	}
+	ui32Clusters = EXFAT_CLUSTERS(pVolume, ui32Size);
+	if (!exfat_setBitmap(pVolume, pFile->ui32FirstCluster + ui32Clusters,
+			EXFAT_CLUSTERS(pVolume, pFile->ui32Size) - ui32Clusters, false))
+	{
+		return false;
+	}
+	if (0 == ui32Size)
+	{
+		pFile->ui32FirstCluster = 0;
+	}
+
+	/* Stream extension: sizes and first cluster (the high 32 bits stay 0) */
+	exfat_initFile(&directory, pVolume, pFile->ui32DirectoryCluster,
+			pFile->ui32DirectorySize, pFile->bDirectoryNoFatChain, true);
+	pui8Entry = exfat_loadEntry(&directory,
+			pFile->ui32EntryPosition + EXFAT_ENTRY_SIZE);
+	if (NULL == pui8Entry)
+	{
+		return false;
+	}
+	EXFAT_ST_DWORD(&pui8Entry[EXFAT_STREAM_VALID_LENGTH], ui32Size);
+	EXFAT_ST_DWORD(&pui8Entry[EXFAT_STREAM_CLUSTER], pFile->ui32FirstCluster);
+	EXFAT_ST_DWORD(&pui8Entry[EXFAT_STREAM_LENGTH], ui32Size);
+	if (!exfat_writeWindow(pVolume))
+	{
+		return false;
+	}
+
+	/* Checksum of the updated set, stored in the file entry */
+	for (i = 0; i < pFile->ui8EntryCount; i++)
+	{
+		pui8Entry = exfat_loadEntry(&directory,
+				pFile->ui32EntryPosition + (i * EXFAT_ENTRY_SIZE));
+		if (NULL == pui8Entry)
+		{
+			return false;
+		}
+		ui16Checksum = exfat_sumEntry(ui16Checksum, pui8Entry, (0 == i));
+	}
+	pui8Entry = exfat_loadEntry(&directory, pFile->ui32EntryPosition);
+	if (NULL == pui8Entry)
+	{
+		return false;
+	}
+	EXFAT_ST_WORD(&pui8Entry[EXFAT_FILE_CHECKSUM], ui16Checksum);
+	if (!exfat_writeWindow(pVolume))
+	{
+		return false;
+	}
+
+	pFile->ui32Size = ui32Size;
+	pFile->ui32DirectoryCluster = 0;
+	return exfat_setVolumeDirty(pVolume, false)
+			&& (RES_OK == disk_ioctl(pVolume->ui8Drive, CTRL_SYNC, NULL));
+}
+
+/**@}LIB_FATFS_EXFAT_PRIVATE*/
+/**@}LIB_FATFS_EXFAT*/
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
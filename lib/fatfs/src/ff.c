@@ -817,7 +817,8 @@ FRESULT move_window (
 		res = sync_window(fs);		/* Write-back changes */
 #endif
 		if (res == FR_OK) {			/* Fill sector window with new data */
-			if (disk_read(fs->drv, fs->win.d8, sector, 1) != RES_OK) {
+			if (diskio_readMetaSector(fs->drv, fs->win.d8, sector,	/* FAT/directory sector */
+					(sector - fs->fatbase < fs->fsize * fs->n_fats) ? DISKIO_SECTOR_FAT : DISKIO_SECTOR_DIR) != RES_OK) {
 				sector = 0xFFFFFFFF;	/* Invalidate window if data is not reliable */
 				res = FR_DISK_ERR;
 			}
@@ -1035,10 +1036,13 @@ FRESULT remove_chain (
 			if (nxt == 0xFFFFFFFF) { res = FR_DISK_ERR; break; }	/* Disk error? */
 			res = put_fat(fs, clst, 0);			/* Mark the cluster "empty" */
 			if (res != FR_OK) break;
-			if (fs->free_clust != 0xFFFFFFFF) {	/* Update FSINFO */
+			if (fs->free_clust <= fs->n_fatent - 2) {	/* Update FSINFO if the count is valid */
 				fs->free_clust++;
 				fs->fsi_flag |= 1;
 			}
+			else if (clst < fs->scan_clust) {	/* Freed behind the background scan */
+				fs->scan_free++;
+			}
 #if _USE_TRIM
 			if (ecl + 1 == nxt) {	/* Is next cluster contiguous? */
 				ecl = nxt;
@@ -1106,10 +1110,13 @@ DWORD create_chain (	/* 0:No free cluster, 1:Internal error, 0xFFFFFFFF:Disk err
 	}
 	if (res == FR_OK) {
 		fs->last_clust = ncl;			/* Update FSINFO */
-		if (fs->free_clust != 0xFFFFFFFF) {
+		if (fs->free_clust <= fs->n_fatent - 2) {	/* Update FSINFO if the count is valid */
 			fs->free_clust--;
 			fs->fsi_flag |= 1;
 		}
+		else if (ncl < fs->scan_clust) {	/* Allocated behind the background scan */
+			fs->scan_free--;
+		}
 	} else {
 		ncl = (res == FR_DISK_ERR) ? 0xFFFFFFFF : 1;
 	}
@@ -1150,6 +1157,35 @@ DWORD clmt_clust (	/* <2:Error, >=2:Cluster number */
 
 
 
+/*-----------------------------------------------------------------------*/
+/* FAT handling - Check if a cluster chain is contiguous                 */
+/*-----------------------------------------------------------------------*/
+
+#if _FS_CONTIGUOUS
+static
+int chain_contiguous (	/* 1:Contiguous, 0:Fragmented or error */
+	FATFS* fs,		/* File system object */
+	DWORD clst,		/* Start cluster of the chain */
+	DWORD fsize		/* File size in byte unit */
+)
+{
+	DWORD ncl, nxt;
+
+
+	if (clst < 2 || !fsize) return 0;
+	ncl = (fsize - 1) / SS(fs) / fs->csize;	/* Number of links to follow */
+	if (clst + ncl >= fs->n_fatent) return 0;
+	for ( ; ncl; ncl--, clst++) {			/* Stops at the first gap */
+		nxt = get_fat(fs, clst);
+		if (nxt != clst + 1) return 0;
+	}
+	return 1;
+}
+#endif	/* _FS_CONTIGUOUS */
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* Directory handling - Set directory index                              */
 /*-----------------------------------------------------------------------*/
@@ -2404,6 +2440,7 @@ FRESULT find_volume (	/* FR_OK(0): successful, !=0: any error occurred */
 #if !_FS_READONLY
 	/* Initialize cluster allocation information */
 	fs->last_clust = fs->free_clust = 0xFFFFFFFF;
+	fs->scan_clust = fs->scan_free = 0;	/* Restart the background free cluster scan */
 
 	/* Get fsinfo if available */
 	fs->fsi_flag = 0x80;
@@ -2692,6 +2729,11 @@ FRESULT f_read (
 				if (fp->fptr == 0) {			/* On the top of the file? */
 					clst = fp->sclust;			/* Follow from the origin */
 				} else {						/* Middle or end of the file */
+#if _FS_CONTIGUOUS
+					if (fp->flag & FA__CONTIG)
+						clst = fp->clust + 1;				/* Next cluster of a contiguous file */
+					else
+#endif
 #if _USE_FASTSEEK
 					if (fp->cltbl)
 						clst = clmt_clust(fp, fp->fptr);	/* Get cluster# from the CLMT */
@@ -3214,6 +3256,11 @@ FRESULT f_lseek (
 							ofs = bcs; break;
 						}
 					} else
+#endif
+#if _FS_CONTIGUOUS
+					if (fp->flag & FA__CONTIG)
+						clst++;							/* Next cluster of a contiguous file */
+					else
 #endif
 						clst = get_fat(fp->fs, clst);	/* Follow cluster chain if not in write mode */
 					if (clst == 0xFFFFFFFF) ABORT(fp->fs, FR_DISK_ERR);
@@ -3257,6 +3304,41 @@ FRESULT f_lseek (
 
 
 
+
+#if _FS_CONTIGUOUS
+/*-----------------------------------------------------------------------*/
+/* Get the Physical Sector of a Contiguous File                          */
+/*-----------------------------------------------------------------------*/
+/* A contiguous file occupies consecutive sectors, so the sector holding
+/  the file offset ofs is the returned value + ofs / sector size. The
+/  caller can read it with disk_read() without walking the FAT. Only files
+/  opened without write access are checked. The cluster chain is walked
+/  here, not at f_open(), so that only the files to be streamed pay for it;
+/  a contiguous file keeps the result in its file object.
+*/
+
+DWORD f_getlba (	/* Sector of the top of the file, 0:Not contiguous or invalid object */
+	FIL* fp			/* Pointer to the file object */
+)
+{
+	DWORD sect = 0;
+
+
+	if (validate(fp) == FR_OK) {		/* Lock volume */
+		if (!(fp->flag & (FA_WRITE | FA__CONTIG)) && chain_contiguous(fp->fs, fp->sclust, fp->fsize))
+			fp->flag |= FA__CONTIG;			/* Clusters follow each other, no FAT walk on read */
+		if (fp->flag & FA__CONTIG)
+			sect = clust2sect(fp->fs, fp->sclust);
+#if _FS_REENTRANT
+		unlock_fs(fp->fs, FR_OK);		/* Unlock volume */
+#endif
+	}
+	return sect;
+}
+#endif
+
+
+
 #if _FS_MINIMIZE <= 1
 /*-----------------------------------------------------------------------*/
 /* Create a Directory Object                                             */
@@ -3542,6 +3624,80 @@ FRESULT f_getfree (
 
 
 
+/*-----------------------------------------------------------------------*/
+/* Get Number of Free Clusters with a Bounded Background Scan            */
+/*-----------------------------------------------------------------------*/
+/* Unlike f_getfree(), this function never scans the whole FAT. Each call
+/  counts the free entries of at most nsect FAT sectors and resumes where
+/  the previous call stopped, so it can run from an idle loop. Clusters
+/  allocated or freed behind the scan position are accounted on the fly.
+/  When the scan completes, the count is cached in the file system object
+/  and the FSINFO sector is written back (FAT32). A remount restarts the
+/  scan. Call it with nsect = 0 to only read the cached count.
+*/
+
+FRESULT f_scanfree (
+	const TCHAR* path,	/* Path name of the logical drive number */
+	UINT nsect,			/* Maximum number of FAT sectors to scan in this call */
+	DWORD* nclst,		/* Pointer to return the number of free clusters, 0xFFFFFFFF while unknown */
+	FATFS** fatfs		/* Pointer to return pointer to corresponding file system object */
+)
+{
+	FRESULT res;
+	FATFS *fs;
+	DWORD clst, n, sect;
+	UINT i, ent;
+	BYTE *p;
+
+
+	*nclst = 0xFFFFFFFF;
+	res = find_volume(fatfs, &path, 0);
+	fs = *fatfs;
+	if (res == FR_OK) {
+		if (fs->fs_type == FS_FAT12 && nsect && fs->free_clust > fs->n_fatent - 2) {
+			/* A FAT12 FAT is a few sectors at most, count it at once */
+			n = 0;
+			for (clst = 2; clst < fs->n_fatent; clst++) {
+				sect = get_fat(fs, clst);
+				if (sect == 0xFFFFFFFF) { res = FR_DISK_ERR; break; }
+				if (sect == 1) { res = FR_INT_ERR; break; }
+				if (sect == 0) n++;
+			}
+			fs->scan_free = n;
+			fs->scan_clust = fs->n_fatent;
+		}
+		while (res == FR_OK && nsect && fs->free_clust > fs->n_fatent - 2 && fs->scan_clust < fs->n_fatent) {
+			ent = SS(fs) / ((fs->fs_type == FS_FAT16) ? 2 : 4);	/* FAT entries per sector */
+			res = move_window(fs, fs->fatbase + fs->scan_clust / ent);
+			if (res != FR_OK) break;
+			i = fs->scan_clust % ent;
+			n = ent - i;
+			if (n > fs->n_fatent - fs->scan_clust) n = fs->n_fatent - fs->scan_clust;
+			fs->scan_clust += n;
+			if (fs->fs_type == FS_FAT16) {
+				for (p = fs->win.d8 + i * 2; n; n--, p += 2) {
+					if (LD_WORD(p) == 0) fs->scan_free++;
+				}
+			} else {
+				for (p = fs->win.d8 + i * 4; n; n--, p += 4) {
+					if ((LD_DWORD(p) & 0x0FFFFFFF) == 0) fs->scan_free++;
+				}
+			}
+			nsect--;
+		}
+		if (res == FR_OK && fs->free_clust > fs->n_fatent - 2 && fs->scan_clust >= fs->n_fatent) {
+			fs->free_clust = fs->scan_free;		/* Scan completed */
+			fs->fsi_flag |= 1;
+			res = sync_fs(fs);					/* Write back the FSINFO */
+		}
+		if (fs->free_clust <= fs->n_fatent - 2) *nclst = fs->free_clust;
+	}
+	LEAVE_FF(fs, res);
+}
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* Truncate File                                                         */
 /*-----------------------------------------------------------------------*/
@@ -4192,6 +4348,8 @@ FRESULT f_mkfs (
 		if (disk_ioctl(pdrv, GET_SECTOR_COUNT, &n_vol) != RES_OK || n_vol < 128)
 			return FR_DISK_ERR;
 		b_vol = (sfd) ? 0 : 63;		/* Volume start sector */
+		if (!sfd && disk_ioctl(pdrv, GET_BLOCK_SIZE, &n) == RES_OK && n > 63 && n <= 32768 && !(n & (n - 1)))
+			b_vol = n;				/* Start the partition on an erase block boundary (flash memory media) */
 		n_vol -= b_vol;				/* Volume size */
 	}
 
@@ -4269,15 +4427,16 @@ FRESULT f_mkfs (
 		} else {	/* Create partition table (FDISK) */
 			mem_set(fs->win.d8, 0, SS(fs));
 			tbl = fs->win.d8 + MBR_Table;	/* Create partition table for single partition in the drive */
-			tbl[1] = 1;						/* Partition start head */
-			tbl[2] = 1;						/* Partition start sector */
-			tbl[3] = 0;						/* Partition start cylinder */
+			n = b_vol / 63;
+			tbl[1] = (BYTE)(n % 255);		/* Partition start head */
+			tbl[2] = (BYTE)((b_vol % 63 + 1) | (n / 255 >> 2 & 0xC0));	/* Partition start sector */
+			tbl[3] = (BYTE)(n / 255);		/* Partition start cylinder */
 			tbl[4] = sys;					/* System type */
 			tbl[5] = 254;					/* Partition end head */
 			n = (b_vol + n_vol) / 63 / 255;
 			tbl[6] = (BYTE)(n >> 2 | 63);	/* Partition end sector */
 			tbl[7] = (BYTE)n;				/* End cylinder */
-			ST_DWORD(tbl + 8, 63);			/* Partition start in LBA */
+			ST_DWORD(tbl + 8, b_vol);		/* Partition start in LBA */
 			ST_DWORD(tbl + 12, n_vol);		/* Partition size in LBA */
 			ST_WORD(fs->win.d8 + BS_55AA, 0xAA55);	/* MBR signature */
 			if (disk_write(pdrv, fs->win.d8, 0, 1) != RES_OK)	/* Write it to the MBR */
@@ -4382,6 +4541,53 @@ FRESULT f_mkfs (
 
 
 
+
+/*-----------------------------------------------------------------------*/
+/* Create a file system tuned for media files on a flash memory card     */
+/*-----------------------------------------------------------------------*/
+
+FRESULT f_mkfs_media (
+	const TCHAR* path	/* Logical drive number */
+)
+{
+	const TCHAR *p = path;
+	int vol;
+	BYTE pdrv;
+	DWORD n_vol, n_blk;
+	UINT au;
+	FRESULT res;
+
+
+	vol = get_ldnumber(&p);
+	if (vol < 0) return FR_INVALID_DRIVE;
+	pdrv = LD2PD(vol);
+	if (disk_initialize(pdrv) & STA_NOINIT) return FR_NOT_READY;
+	if (disk_ioctl(pdrv, GET_SECTOR_COUNT, &n_vol) != RES_OK) return FR_DISK_ERR;
+	if (disk_ioctl(pdrv, GET_BLOCK_SIZE, &n_blk) != RES_OK || !n_blk) n_blk = 1;
+
+	/* Large clusters keep the FAT small and the media files contiguous:
+	   32KB from 256MB, 16KB from 64MB, FatFs default below (SD Card Association layout) */
+	if (n_vol >= 0x80000) {
+		au = 32768;
+	} else if (n_vol >= 0x20000) {
+		au = 16384;
+	} else {
+		au = 0;
+	}
+	while (au > _MIN_SS && au > n_blk * _MIN_SS) au /= 2;	/* A cluster never crosses an erase block */
+
+	/* Partition and data area are aligned on the erase block (allocation unit) by f_mkfs,
+	   the alignment may leave too few clusters for the FAT type on small media: halve the cluster */
+	for (;;) {
+		res = f_mkfs(path, 0, au);
+		if (res != FR_MKFS_ABORTED || au <= _MIN_SS) break;
+		au /= 2;
+	}
+	return res;
+}
+
+
+
 #if _MULTI_PARTITION
 /*-----------------------------------------------------------------------*/
 /* Create partition table on the physical drive                          */
@@ -3,7 +3,6 @@
 /* (C)ChaN, 2014                                                          */
 /*------------------------------------------------------------------------*/
 
-#include <stdlib.h>		/* ANSI memory controls */
 #include "ff.h"
 
 #if _FS_REENTRANT
@@ -91,6 +90,25 @@ void ff_rel_grant (
 
 
 #if _USE_LFN == 3	/* LFN with a working buffer on the heap */
+/*------------------------------------------------------------------------*/
+/* LFN Working Buffer Pool                                                */
+/*------------------------------------------------------------------------*/
+/* FatFs asks for one (_MAX_LFN + 1) * 2 bytes buffer per directory
+/  operation. Instead of malloc(), which fragments the small heap and takes
+/  a variable time, the buffers come from _LFN_POOL_SLOTS static slots.
+/  Slots are taken inside a critical section so that any context can call
+/  the file functions.
+*/
+
+#define	LFN_BUF_SIZE	((_MAX_LFN + 1) * 2)
+
+static DWORD LfnPool[_LFN_POOL_SLOTS][(LFN_BUF_SIZE + 3) / 4];	/* On 32-bit boundary */
+static BYTE LfnPoolUsed[_LFN_POOL_SLOTS];	/* Non-zero while the slot is allocated */
+static UINT LfnPoolCount;					/* Number of allocated slots */
+static UINT LfnPoolPeak;					/* High-water mark of LfnPoolCount */
+static DWORD LfnPoolFails;					/* Number of failed allocations */
+
+
 /*------------------------------------------------------------------------*/
 /* Allocate a memory block                                                */
 /*------------------------------------------------------------------------*/
@@ -101,7 +119,26 @@ void* ff_memalloc (	/* Returns pointer to the allocated memory block */
 	UINT msize		/* Number of bytes to allocate */
 )
 {
-	return malloc(msize);	/* Allocate a new memory block with POSIX API */
+	uint32_t primask;
+	void* mblock = 0;
+	UINT i;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	if (msize <= sizeof LfnPool[0]) {
+		for (i = 0; i < _LFN_POOL_SLOTS; i++) {
+			if (!LfnPoolUsed[i]) {
+				LfnPoolUsed[i] = 1;
+				if (++LfnPoolCount > LfnPoolPeak) LfnPoolPeak = LfnPoolCount;
+				mblock = LfnPool[i];
+				break;
+			}
+		}
+	}
+	if (!mblock) LfnPoolFails++;
+	__set_PRIMASK(primask);
+
+	return mblock;
 }
 
 
@@ -113,7 +150,35 @@ void ff_memfree (
 	void* mblock	/* Pointer to the memory block to free */
 )
 {
-	free(mblock);	/* Discard the memory block with POSIX API */
+	uint32_t primask;
+	UINT i;
+
+	for (i = 0; i < _LFN_POOL_SLOTS; i++) {
+		if (mblock == LfnPool[i]) {
+			primask = __get_PRIMASK();
+			__disable_irq();
+			if (LfnPoolUsed[i]) {
+				LfnPoolUsed[i] = 0;
+				LfnPoolCount--;
+			}
+			__set_PRIMASK(primask);
+			break;
+		}
+	}
+}
+
+
+/*------------------------------------------------------------------------*/
+/* Get the Pool Statistics                                                */
+/*------------------------------------------------------------------------*/
+
+void ff_get_pool_stat (
+	UINT* peak,		/* Pointer to return the high-water mark of allocated slots */
+	DWORD* fails	/* Pointer to return the number of failed allocations */
+)
+{
+	*peak = LfnPoolPeak;
+	*fails = LfnPoolFails;
 }
 
 #endif
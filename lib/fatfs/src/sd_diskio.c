@@ -40,6 +40,7 @@
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
+#define SD_DISKIO_MAX_BLOCK_SIZE	(32768) /*!< Largest erase block size accepted by f_mkfs */
 /* Private macro -------------------------------------------------------------*/
 
 /* Private variables ---------------------------------------------------------*/
@@ -99,8 +100,7 @@ DSTATUS diskio_sd_status(BYTE lun)
 DRESULT diskio_sd_read(BYTE lun, BYTE *buff, DWORD sector, UINT count)
 {
 	UNUSED(lun);
-	if (!sd_readBlocks((uint32_t*) buff, (uint64_t) (sector * SD_BLOCK_SIZE),
-	SD_BLOCK_SIZE, count))
+	if (!sd_readBlocks((uint32_t*) buff, (uint32_t) sector, count))
 	{
 		return RES_ERROR;
 	}
@@ -121,8 +121,7 @@ DRESULT diskio_sd_read(BYTE lun, BYTE *buff, DWORD sector, UINT count)
 DRESULT diskio_sd_write(BYTE lun, const BYTE *buff, DWORD sector, UINT count)
 {
 	UNUSED(lun);
-	if (!sd_writeBlocks((uint32_t*) buff, (uint64_t) (sector * SD_BLOCK_SIZE),
-	SD_BLOCK_SIZE, count))
+	if (!sd_writeBlocks((uint32_t*) buff, (uint32_t) sector, count))
 	{
 		return RES_ERROR;
 	}
@@ -144,7 +143,6 @@ DRESULT diskio_sd_ioctl(BYTE lun, BYTE cmd, void *buff)
 {
 	UNUSED(lun);
 	DRESULT diskResult = RES_ERROR;
-	sd_card_info_t CardInfo;
 
 	if (STA_NOINIT & g_diskStatus)
 	{
@@ -155,14 +153,17 @@ DRESULT diskio_sd_ioctl(BYTE lun, BYTE cmd, void *buff)
 	{
 	/* Make sure that no pending write process */
 	case CTRL_SYNC:
-		diskResult = RES_OK;
+		if (sd_waitReady())
+		{
+			diskResult = RES_OK;
+		}
 		break;
 
 		/* Get number of sectors on the disk (DWORD) */
 	case GET_SECTOR_COUNT:
-		if (sd_getCardInfo(&CardInfo))
+		*(DWORD*) buff = sd_getBlockNumber();
+		if (0 != *(DWORD*) buff)
 		{
-			*(DWORD*) buff = CardInfo.CardCapacity / SD_BLOCK_SIZE;
 			diskResult = RES_OK;
 		}
 		break;
@@ -175,7 +176,33 @@ DRESULT diskio_sd_ioctl(BYTE lun, BYTE cmd, void *buff)
 
 		/* Get erase block size in unit of sector (DWORD) */
 	case GET_BLOCK_SIZE:
-		*(DWORD*) buff = SD_BLOCK_SIZE;
+	{
+		sd_card_info_t sdCardInfo;
+		if (sd_getCardInfo(&sdCardInfo))
+		{
+			/* Prefer the allocation unit, f_mkfs aligns the data area on it
+			 (up to 32768 sectors) */
+			*(DWORD*) buff = (0 != sdCardInfo.CardAllocationUnit) ?
+					(sdCardInfo.CardAllocationUnit) :
+					(sdCardInfo.CardEraseBlockSize);
+			if (*(DWORD*) buff > SD_DISKIO_MAX_BLOCK_SIZE)
+			{
+				*(DWORD*) buff = SD_DISKIO_MAX_BLOCK_SIZE;
+			}
+			/* 12MB and 24MB AU are not power of 2: keep the largest power of 2 dividing it */
+			*(DWORD*) buff &= ~(*(DWORD*) buff) + 1;
+			diskResult = RES_OK;
+		}
+		break;
+	}
+
+		/* Erase the sectors from start to end sector (DWORD[2]) */
+	case CTRL_TRIM:
+		if (sd_eraseBlocks(((DWORD*) buff)[0],
+				((DWORD*) buff)[1] - ((DWORD*) buff)[0] + 1))
+		{
+			diskResult = RES_OK;
+		}
 		break;
 
 	default:
@@ -45,6 +45,39 @@ static uint8_t *g_pui8GraphicBuffer = NULL; /*!< Pointer to the display buffer o
 
 /* Private functions declaration ---------------------------------------------*/
 /* Private function prototypes -----------------------------------------------*/
+/**
+ * @brief  Apply a pixel mask to one byte of the Graphic buffer.
+ * @note   A changed byte is marked dirty before it is stored, see display_markDirty().
+ * @param  pui8Byte: Pointer to the buffer byte.
+ * @param  ui8PixelMask: Pixels to draw in this byte.
+ * @param  color: Selected pixel state.
+ * @param  ui8Page: Page of the byte.
+ * @param  ui8Column: Column of the byte.
+ * @retval None
+ */
+static inline void graphic_writeByte(uint8_t *pui8Byte, uint8_t ui8PixelMask,
+		pixel_color_t color, uint8_t ui8Page, uint8_t ui8Column)
+{
+	uint8_t ui8Old = *pui8Byte;
+	uint8_t ui8New;
+	switch (color)
+	{
+	case WHITE:
+		ui8New = ui8Old | ui8PixelMask;
+		break;
+	case BLACK:
+		ui8New = ui8Old & ~ui8PixelMask;
+		break;
+	default: /* INVERSE */
+		ui8New = ui8Old ^ ui8PixelMask;
+		break;
+	}
+	if (ui8New != ui8Old)
+	{
+		display_markDirty(ui8Page, ui8Column, ui8Column);
+		*pui8Byte = ui8New;
+	}
+}
 
 /* Exported functions prototype ----------------------------------------------*/
 /**
@@ -86,18 +119,8 @@ void graphic_drawPixel(int16_t x, int16_t y, pixel_color_t color)
 	}
 
 	int32_t i32PageColumnIndex = x + (y / 8) * DISPLAY_WIDTH;
-	switch (color)
-	{
-	case WHITE:
-		g_pui8GraphicBuffer[i32PageColumnIndex] |= (1 << (y & 7));
-		break;
-	case BLACK:
-		g_pui8GraphicBuffer[i32PageColumnIndex] &= ~(1 << (y & 7));
-		break;
-	case INVERSE:
-		g_pui8GraphicBuffer[i32PageColumnIndex] ^= (1 << (y & 7));
-		break;
-	}
+	graphic_writeByte(&g_pui8GraphicBuffer[i32PageColumnIndex], (1 << (y & 7)),
+			color, y / 8, x);
 }
 
 /**
@@ -148,27 +171,10 @@ void graphic_drawFastHLine(int16_t x, int16_t y, int16_t w, pixel_color_t color)
 
 	register uint8_t ui8PixelMask = 1 << (y & 7);
 
-	switch (color)
+	/* Only the changed columns are marked, redrawing the same line does not need a render */
+	for (int16_t i = x; i < x + w; i++)
 	{
-	case WHITE:
-		while (w--)
-		{
-			*pui8BufferPointer++ |= ui8PixelMask;
-		}
-		break;
-	case BLACK:
-		ui8PixelMask = ~ui8PixelMask;
-		while (w--)
-		{
-			*pui8BufferPointer++ &= ui8PixelMask;
-		}
-		break;
-	case INVERSE:
-		while (w--)
-		{
-			*pui8BufferPointer++ ^= ui8PixelMask;
-		}
-		break;
+		graphic_writeByte(pui8BufferPointer++, ui8PixelMask, color, y / 8, i);
 	}
 }
 
@@ -225,6 +231,9 @@ void graphic_drawFastVLine(int16_t x, int16_t __y, int16_t __h,
 	/* and offset x columns in */
 	pui8BufferPointer += x;
 
+	/* Page of the byte under the pointer, to mark the changed bytes */
+	uint8_t ui8Page = y / 8;
+
 	/* 1. Do the first partial byte, if necessary - this requires some masking */
 	register uint8_t mod = (y & 7);
 	if (mod)
@@ -244,18 +253,7 @@ void graphic_drawFastVLine(int16_t x, int16_t __y, int16_t __h,
 			ui8PixelMask &= (0XFF >> (mod - h));
 		}
 
-		switch (color)
-		{
-		case WHITE:
-			*pui8BufferPointer |= ui8PixelMask;
-			break;
-		case BLACK:
-			*pui8BufferPointer &= ~ui8PixelMask;
-			break;
-		case INVERSE:
-			*pui8BufferPointer ^= ui8PixelMask;
-			break;
-		}
+		graphic_writeByte(pui8BufferPointer, ui8PixelMask, color, ui8Page, x);
 
 		/* Fast exit if we're done here! */
 		if (h < mod)
@@ -266,6 +264,7 @@ void graphic_drawFastVLine(int16_t x, int16_t __y, int16_t __h,
 		h -= mod;
 
 		pui8BufferPointer += DISPLAY_WIDTH;
+		ui8Page++;
 	}
 
 	/* 2. Write solid bytes while we can - effectively doing 8 rows at a time */
@@ -276,10 +275,12 @@ void graphic_drawFastVLine(int16_t x, int16_t __y, int16_t __h,
 		 of the black/white write version with an extra comparison per loop */
 			do
 			{
+				display_markDirty(ui8Page, x, x);
 				*pui8BufferPointer = ~(*pui8BufferPointer);
 
 				/* Adjust the buffer forward 8 rows worth of data */
 				pui8BufferPointer += DISPLAY_WIDTH;
+				ui8Page++;
 
 				/* Adjust h & y (there's got to be a faster way for me to do this,
 				 but this should still help a fair bit for now) */
@@ -294,10 +295,15 @@ void graphic_drawFastVLine(int16_t x, int16_t __y, int16_t __h,
 			do
 			{
 				/* Write our value in */
-				*pui8BufferPointer = val;
+				if (val != *pui8BufferPointer)
+				{
+					display_markDirty(ui8Page, x, x);
+					*pui8BufferPointer = val;
+				}
 
 				/* Adjust the buffer forward 8 rows worth of data */
 				pui8BufferPointer += DISPLAY_WIDTH;
+				ui8Page++;
 
 				/* Adjust h & y (there's got to be a faster way for me to do this,
 				 but this should still help a fair bit for now) */
@@ -318,18 +324,7 @@ void graphic_drawFastVLine(int16_t x, int16_t __y, int16_t __h,
 		static uint8_t pui8PixelPostMask[8] =
 		{ 0x00, 0x01, 0x03, 0x07, 0x0F, 0x1F, 0x3F, 0x7F };
 		register uint8_t ui8PixelMask = pui8PixelPostMask[mod];
-		switch (color)
-		{
-		case WHITE:
-			*pui8BufferPointer |= ui8PixelMask;
-			break;
-		case BLACK:
-			*pui8BufferPointer &= ~ui8PixelMask;
-			break;
-		case INVERSE:
-			*pui8BufferPointer ^= ui8PixelMask;
-			break;
-		}
+		graphic_writeByte(pui8BufferPointer, ui8PixelMask, color, ui8Page, x);
 	}
 }
 
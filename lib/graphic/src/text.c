@@ -346,9 +346,8 @@ void text_putString(const char *pcString, text_speed_t speed)
 	{
 		text_write(*pcString);
 		pcString++;
-		/* FIXME: Render request update entire screen that cause power waste here.
-		 Should only commit the difference part. */
-		graphic_render();
+		/* Only the new character cell is dirty, it is sent while the next one is drawn */
+		graphic_present();
 		graphic_delay_ms(speed);
 	}
 }
@@ -60,7 +60,22 @@
  
 
 #define MSC_EPIN_ADDR                0x81 
-#define MSC_EPOUT_ADDR               0x01 
+#define MSC_EPOUT_ADDR               0x02 /* Not 0x01: a double buffered endpoint is unidirectional */
+
+#if (MSC_STAGING_SIZE < (2 * MSC_MEDIA_PACKET)) || (MSC_STAGING_SIZE > 4096) || \
+    ((MSC_STAGING_SIZE % (2 * MSC_MEDIA_PACKET)) != 0)
+#error "MSC_STAGING_SIZE must be 1024 to 4096 bytes, two halves of whole media packets"
+#endif
+#define MSC_STAGE_HALF               (MSC_STAGING_SIZE / 2)
+
+#define MSC_STAGE_MEDIUM_BUSY        0x01 /* The medium reads or writes a staging half */
+#define MSC_STAGE_EP_BUSY            0x02 /* The endpoint sends or receives a staging half */
+#define MSC_STAGE_ERROR              0x04 /* The medium read failed, fail once the endpoint is free */
+
+/* Storage status besides USBD_OK and USBD_BUSY (IsReady, Read, Write, Sync, Benchmark) */
+#define MSC_STORAGE_MEDIUM_ERROR     (-1) /* The medium failed the access: MEDIUM ERROR */
+#define MSC_STORAGE_NOT_READY        (-2) /* No medium or medium not initialized: NOT READY */
+#define MSC_STORAGE_MEDIUM_CHANGED   (-3) /* IsReady: new medium, reported once as UNIT ATTENTION */
 
 /**
   * @}
@@ -79,6 +94,10 @@ typedef struct _USBD_STORAGE
   int8_t (* Write)(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len);
   int8_t (* GetMaxLun)(void);
   int8_t *pInquiry;
+  int8_t (* Unmap)(uint8_t lun, uint32_t blk_addr, uint32_t blk_len);
+  int8_t (* Sync)(uint8_t lun);
+  int8_t (* GetCounters)(uint8_t lun, uint8_t *buf, uint16_t *len, uint8_t flags);
+  int8_t (* Benchmark)(uint8_t lun, uint8_t type, uint8_t *buf, uint32_t blk_addr, uint32_t blk_len);
   
 }USBD_StorageTypeDef;
 
@@ -90,7 +109,7 @@ typedef struct
   uint8_t                  bot_state;
   uint8_t                  bot_status;  
   uint16_t                 bot_data_length;
-  uint8_t                  bot_data[MSC_MEDIA_PACKET];  
+  uint8_t                  bot_data[MSC_STAGING_SIZE]; /* READ10/WRITE10 ping-pong halves */
   USBD_MSC_BOT_CBWTypeDef  cbw;
   USBD_MSC_BOT_CSWTypeDef  csw;
   
@@ -103,6 +122,13 @@ typedef struct
   
   uint32_t                 scsi_blk_addr;
   uint32_t                 scsi_blk_len;
+  
+  uint32_t                 scsi_stage_addr;     /* Next medium byte to stage (READ10) */
+  uint32_t                 scsi_stage_len;      /* Bytes left to stage from the medium (READ10) or the host (WRITE10) */
+  uint16_t                 scsi_stage_count[2]; /* Bytes held per half, 0 if free */
+  uint8_t                  scsi_stage_fill;     /* Half filled next: by the medium (READ10), the endpoint (WRITE10) */
+  uint8_t                  scsi_stage_drain;    /* Half drained next: by the endpoint (READ10), the medium (WRITE10) */
+  uint8_t                  scsi_stage_flags;    /* MSC_STAGE_xxx */
 }
 USBD_MSC_BOT_HandleTypeDef; 
 
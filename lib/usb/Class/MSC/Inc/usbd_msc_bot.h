@@ -55,6 +55,7 @@
 #define USBD_BOT_LAST_DATA_IN              3       /* Last Data In Last */
 #define USBD_BOT_SEND_DATA                 4       /* Send Immediate data */
 #define USBD_BOT_NO_DATA                   5       /* No data Stage */
+#define USBD_BOT_WAIT_MEDIUM               6       /* CSW deferred until the medium is synchronized */
 
 #define USBD_BOT_CBW_SIGNATURE             0x43425355
 #define USBD_BOT_CSW_SIGNATURE             0x53425355
@@ -48,9 +48,13 @@
 /** @defgroup USB_INFO_Exported_Defines
   * @{
   */ 
-#define MODE_SENSE6_LEN			 8
-#define MODE_SENSE10_LEN		 8
-#define LENGTH_INQUIRY_PAGE00		 7
+#define MODE_CACHING_PAGE		0x08
+#define MODE_CACHING_PAGE_LEN		20
+#define MODE_SENSE6_LEN			(4 + MODE_CACHING_PAGE_LEN)
+#define MODE_SENSE10_LEN		(8 + MODE_CACHING_PAGE_LEN)
+#define LENGTH_INQUIRY_PAGE00		 9
+#define LENGTH_INQUIRY_PAGEB0		64
+#define LENGTH_INQUIRY_PAGEB2		 8
 #define LENGTH_FORMAT_CAPACITIES    	20
 
 /**
@@ -79,6 +83,8 @@
   * @{
   */ 
 extern const uint8_t MSC_Page00_Inquiry_Data[];  
+extern const uint8_t MSC_PageB0_Inquiry_Data[];  
+extern const uint8_t MSC_PageB2_Inquiry_Data[];  
 extern const uint8_t MSC_Mode_Sense6_data[];
 extern const uint8_t MSC_Mode_Sense10_data[] ;
 
@@ -66,6 +66,8 @@
 
 #define SCSI_READ_CAPACITY10                        0x25
 #define SCSI_READ_CAPACITY16                        0x9E
+#define SCSI_SA_READ_CAPACITY16                     0x10
+#define SCSI_UNMAP                                  0x42
 
 #define SCSI_REQUEST_SENSE                          0x03
 #define SCSI_START_STOP_UNIT                        0x1B
@@ -79,9 +81,13 @@
 #define SCSI_VERIFY12                               0xAF
 #define SCSI_VERIFY16                               0x8F
 
+#define SCSI_SYNCHRONIZE_CACHE10                    0x35
+
 #define SCSI_SEND_DIAGNOSTIC                        0x1D
 #define SCSI_READ_FORMAT_CAPACITIES                 0x23
 
+#define SCSI_VENDOR_PERF                            0xC0 /* USBD_PERF_OPCODE */
+
 #define NO_SENSE                                    0
 #define RECOVERED_ERROR                             1
 #define NOT_READY                                   2
@@ -111,6 +117,9 @@
 
 #define READ_FORMAT_CAPACITY_DATA_LEN               0x0C
 #define READ_CAPACITY10_DATA_LEN                    0x08
+#define READ_CAPACITY16_DATA_LEN                    0x20
+#define UNMAP_HEADER_LEN                            0x08
+#define UNMAP_DESCRIPTOR_LEN                        0x10
 #define MODE_SENSE10_DATA_LEN                       0x08
 #define MODE_SENSE6_DATA_LEN                        0x04
 #define REQUEST_SENSE_DATA_LEN                      0x12
@@ -145,6 +154,14 @@ typedef struct _SENSE_ITEM {
     char *pData;
   } w;
 } USBD_SCSI_SenseTypeDef; 
+
+/* Time the endpoints are left NAKing the host while the medium works */
+typedef struct _SCSI_STATISTIC {
+  uint32_t in_nak_windows;   /* READ10: IN endpoint idle, no staging half read yet */
+  uint32_t in_nak_us;
+  uint32_t out_nak_windows;  /* WRITE10: OUT endpoint not armed, both halves waiting for the medium */
+  uint32_t out_nak_us;
+} USBD_SCSI_StatisticTypeDef;
 /**
   * @}
   */ 
@@ -176,6 +193,14 @@ void   SCSI_SenseCode(USBD_HandleTypeDef  *pdev,
                       uint8_t sKey, 
                       uint8_t ASC);
 
+void   SCSI_CompleteTransfer(USBD_HandleTypeDef  *pdev,
+                             uint8_t lun,
+                             int8_t status);
+
+void   SCSI_GetStatistic(USBD_SCSI_StatisticTypeDef *stat);
+
+void   SCSI_ResetStatistic(void);
+
 /**
   * @}
   */ 
@@ -76,29 +76,75 @@ const uint8_t  MSC_Page00_Inquiry_Data[] = {//7
 	(LENGTH_INQUIRY_PAGE00 - 4),
 	0x00, 
 	0x80, 
-	0x83 
+	0x83,
+	0xB0,
+	0xB2
 };  
-/* USB Mass storage sense 6  Data */
-const uint8_t  MSC_Mode_Sense6_data[] = {
+/* USB Mass storage Page B0 (Block Limits) Inquiry Data */
+const uint8_t  MSC_PageB0_Inquiry_Data[] = {
 	0x00,
+	0xB0,
 	0x00,
+	(LENGTH_INQUIRY_PAGEB0 - 4),
+	0x00, 0x00, 0x00, 0x00,			/* No transfer length limits */
+	0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00,
+	0xFF, 0xFF, 0xFF, 0xFF,			/* Maximum unmap LBA count: unlimited */
+	0x00, 0x00, 0x00,			/* Maximum unmap descriptor count: erased one by one */
+	MSC_UNMAP_DESCRIPTORS,
+	0x00, 0x00, 0x00, 0x00,			/* Optimal unmap granularity: not reported */
+	0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00
+};
+/* USB Mass storage Page B2 (Logical Block Provisioning) Inquiry Data */
+const uint8_t  MSC_PageB2_Inquiry_Data[] = {
 	0x00,
+	0xB2,
 	0x00,
+	(LENGTH_INQUIRY_PAGEB2 - 4),
 	0x00,
-	0x00, 
+	0x80,					/* LBPU: UNMAP command supported */
 	0x00,
 	0x00
+};
+/* USB Mass storage sense 6  Data */
+const uint8_t  MSC_Mode_Sense6_data[] = {
+	(MODE_SENSE6_LEN - 1),			/* Mode data length, set per request */
+	0x00,
+	0x10,					/* DPOFUA: FUA honored by WRITE10 */
+	0x00,
+	MODE_CACHING_PAGE,			/* Caching mode page */
+	(MODE_CACHING_PAGE_LEN - 2),
+	0x04,					/* WCE: write back cache, see SYNCHRONIZE CACHE */
+	0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00
 };	
 /* USB Mass storage sense 10  Data */
 const uint8_t  MSC_Mode_Sense10_data[] = {
 	0x00,
-	0x06, 
+	(MODE_SENSE10_LEN - 2),			/* Mode data length, set per request */
 	0x00, 
+	0x10,					/* DPOFUA: FUA honored by WRITE10 */
 	0x00, 
 	0x00, 
 	0x00, 
-	0x00, 
-	0x00
+	0x00,
+	MODE_CACHING_PAGE,			/* Caching mode page */
+	(MODE_CACHING_PAGE_LEN - 2),
+	0x04,					/* WCE: write back cache, see SYNCHRONIZE CACHE */
+	0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00
 };
 /**
   * @}
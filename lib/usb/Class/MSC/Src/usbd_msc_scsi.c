@@ -30,6 +30,7 @@
 #include "usbd_msc_scsi.h"
 #include "usbd_msc.h"
 #include "usbd_msc_data.h"
+#include "usbd_perf.h"
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-parameter"
@@ -55,6 +56,8 @@
 /** @defgroup MSC_SCSI_Private_Defines
   * @{
   */ 
+#define SCSI_NAK_IN                  0x01 /* READ10 window open on the IN endpoint */
+#define SCSI_NAK_OUT                 0x02 /* WRITE10 window open on the OUT endpoint */
 
 /**
   * @}
@@ -72,6 +75,11 @@
 /** @defgroup MSC_SCSI_Private_Variables
   * @{
   */ 
+/* NAK windows timed with the cycle counter: the FS peripheral has no NAK
+   counter, a window starts when the endpoint is left idle for the medium */
+static USBD_SCSI_StatisticTypeDef scsi_statistic;
+static uint32_t scsi_nak_start;
+static uint8_t scsi_nak_open;
 
 /**
   * @}
@@ -85,6 +93,7 @@ static int8_t SCSI_TestUnitReady(USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t
 static int8_t SCSI_Inquiry(USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *params);
 static int8_t SCSI_ReadFormatCapacity(USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *params);
 static int8_t SCSI_ReadCapacity10(USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *params);
+static int8_t SCSI_ReadCapacity16(USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *params);
 static int8_t SCSI_RequestSense (USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *params);
 static int8_t SCSI_StartStopUnit(USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *params);
 static int8_t SCSI_ModeSense6 (USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *params);
@@ -92,6 +101,13 @@ static int8_t SCSI_ModeSense10 (USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t
 static int8_t SCSI_Write10(USBD_HandleTypeDef  *pdev, uint8_t lun , uint8_t *params);
 static int8_t SCSI_Read10(USBD_HandleTypeDef  *pdev, uint8_t lun , uint8_t *params);
 static int8_t SCSI_Verify10(USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *params);
+static int8_t SCSI_Unmap(USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *params);
+static int8_t SCSI_UnmapNext(USBD_HandleTypeDef  *pdev, uint8_t lun);
+static int8_t SCSI_AllowMediumRemoval(USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *params);
+static int8_t SCSI_SynchronizeCache10(USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *params);
+static int8_t SCSI_VendorPerf(USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *params);
+static void SCSI_OpenNakWindow(uint8_t window);
+static void SCSI_CloseNakWindow(uint8_t window);
 static int8_t SCSI_CheckAddressRange (USBD_HandleTypeDef  *pdev, 
                                       uint8_t lun , 
                                       uint32_t blk_offset , 
@@ -101,6 +117,29 @@ static int8_t SCSI_ProcessRead (USBD_HandleTypeDef  *pdev,
 
 static int8_t SCSI_ProcessWrite (USBD_HandleTypeDef  *pdev,
                                  uint8_t lun);
+
+static int8_t SCSI_ReadDone (USBD_HandleTypeDef  *pdev,
+                             uint8_t lun,
+                             int8_t status);
+
+static int8_t SCSI_WriteDone (USBD_HandleTypeDef  *pdev,
+                              uint8_t lun,
+                              int8_t status);
+
+static int8_t SCSI_SyncMedium (USBD_HandleTypeDef  *pdev,
+                               uint8_t lun);
+
+static int8_t SCSI_SyncDone (USBD_HandleTypeDef  *pdev,
+                             uint8_t lun,
+                             int8_t status);
+
+static int8_t SCSI_CheckReady (USBD_HandleTypeDef  *pdev,
+                               uint8_t lun);
+
+static void SCSI_StorageError (USBD_HandleTypeDef  *pdev,
+                               uint8_t lun,
+                               int8_t status,
+                               uint8_t ASC);
 /**
   * @}
   */ 
@@ -138,7 +177,7 @@ int8_t SCSI_ProcessCmd(USBD_HandleTypeDef  *pdev,
     return SCSI_StartStopUnit(pdev, lun, params);
     
   case SCSI_ALLOW_MEDIUM_REMOVAL:
-    return SCSI_StartStopUnit(pdev, lun, params);
+    return SCSI_AllowMediumRemoval(pdev, lun, params);
     
   case SCSI_MODE_SENSE6:
     return SCSI_ModeSense6 (pdev, lun, params);
@@ -152,6 +191,9 @@ int8_t SCSI_ProcessCmd(USBD_HandleTypeDef  *pdev,
   case SCSI_READ_CAPACITY10:
     return SCSI_ReadCapacity10(pdev, lun, params);
     
+  case SCSI_READ_CAPACITY16:
+    return SCSI_ReadCapacity16(pdev, lun, params);
+    
   case SCSI_READ10:
     return SCSI_Read10(pdev, lun, params); 
     
@@ -161,6 +203,15 @@ int8_t SCSI_ProcessCmd(USBD_HandleTypeDef  *pdev,
   case SCSI_VERIFY10:
     return SCSI_Verify10(pdev, lun, params);
     
+  case SCSI_UNMAP:
+    return SCSI_Unmap(pdev, lun, params);
+    
+  case SCSI_SYNCHRONIZE_CACHE10:
+    return SCSI_SynchronizeCache10(pdev, lun, params);
+    
+  case SCSI_VENDOR_PERF:
+    return SCSI_VendorPerf(pdev, lun, params);
+    
   default:
     SCSI_SenseCode(pdev, 
                    lun,
@@ -192,13 +243,8 @@ static int8_t SCSI_TestUnitReady(USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t
     return -1;
   }  
   
-  if(((USBD_StorageTypeDef *)pdev->pUserData)->IsReady(lun) !=0 )
+  if(SCSI_CheckReady(pdev, lun) < 0)
   {
-    SCSI_SenseCode(pdev,
-                   lun,
-                   NOT_READY, 
-                   MEDIUM_NOT_PRESENT);
-    
     hmsc->bot_state = USBD_BOT_NO_DATA;
     return -1;
   } 
@@ -221,8 +267,28 @@ static int8_t  SCSI_Inquiry(USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *par
   
   if (params[1] & 0x01)/*Evpd is set*/
   {
-    pPage = (uint8_t *)MSC_Page00_Inquiry_Data;
-    len = LENGTH_INQUIRY_PAGE00;
+    switch (params[2])
+    {
+    case 0xB0: /* Block Limits */
+      pPage = (uint8_t *)MSC_PageB0_Inquiry_Data;
+      len = LENGTH_INQUIRY_PAGEB0;
+      break;
+      
+    case 0xB2: /* Logical Block Provisioning */
+      pPage = (uint8_t *)MSC_PageB2_Inquiry_Data;
+      len = LENGTH_INQUIRY_PAGEB2;
+      break;
+      
+    default:
+      pPage = (uint8_t *)MSC_Page00_Inquiry_Data;
+      len = LENGTH_INQUIRY_PAGE00;
+      break;
+    }
+    
+    if (params[4] <= len)
+    {
+      len = params[4];
+    }
   }
   else
   {
@@ -281,6 +347,64 @@ static int8_t SCSI_ReadCapacity10(USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_
     return 0;
   }
 }
+/**
+* @brief  SCSI_ReadCapacity16
+*         Process Read Capacity 16 command (Service Action In 16)
+* @param  lun: Logical unit number
+* @param  params: Command parameters
+* @retval status
+*/
+static int8_t SCSI_ReadCapacity16(USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *params)
+{
+  USBD_MSC_BOT_HandleTypeDef  *hmsc = (USBD_MSC_BOT_HandleTypeDef*)pdev->pClassData; 
+  uint32_t len;
+  uint16_t i;
+  
+  if ((params[1] & 0x1F) != SCSI_SA_READ_CAPACITY16)
+  {
+    SCSI_SenseCode(pdev,
+                   lun,
+                   ILLEGAL_REQUEST, 
+                   INVALID_CDB);
+    return -1;
+  }
+  
+  if(((USBD_StorageTypeDef *)pdev->pUserData)->GetCapacity(lun, &hmsc->scsi_blk_nbr, &hmsc->scsi_blk_size) != 0)
+  {
+    SCSI_SenseCode(pdev,
+                   lun,
+                   NOT_READY, 
+                   MEDIUM_NOT_PRESENT);
+    return -1;
+  } 
+  
+  for(i=0 ; i < READ_CAPACITY16_DATA_LEN ; i++) 
+  {
+    hmsc->bot_data[i] = 0;
+  }
+  
+  /* Last LBA on 64 bits, the upper 32 bits stay 0 */
+  hmsc->bot_data[4] = (uint8_t)((hmsc->scsi_blk_nbr - 1) >> 24);
+  hmsc->bot_data[5] = (uint8_t)((hmsc->scsi_blk_nbr - 1) >> 16);
+  hmsc->bot_data[6] = (uint8_t)((hmsc->scsi_blk_nbr - 1) >>  8);
+  hmsc->bot_data[7] = (uint8_t)(hmsc->scsi_blk_nbr - 1);
+  
+  hmsc->bot_data[8] = (uint8_t)(hmsc->scsi_blk_size >>  24);
+  hmsc->bot_data[9] = (uint8_t)(hmsc->scsi_blk_size >>  16);
+  hmsc->bot_data[10] = (uint8_t)(hmsc->scsi_blk_size >>  8);
+  hmsc->bot_data[11] = (uint8_t)(hmsc->scsi_blk_size);
+  
+  /* LBPME: the storage support UNMAP */
+  if (((USBD_StorageTypeDef *)pdev->pUserData)->Unmap != NULL)
+  {
+    hmsc->bot_data[14] = 0x80;
+  }
+  
+  len = (params[10] << 24) | (params[11] << 16) | (params[12] << 8) | params[13];
+  hmsc->bot_data_length = MIN(len, READ_CAPACITY16_DATA_LEN);
+  return 0;
+}
+
 /**
 * @brief  SCSI_ReadFormatCapacity
 *         Process Read Format Capacity command
@@ -336,7 +460,13 @@ static int8_t SCSI_ReadFormatCapacity(USBD_HandleTypeDef  *pdev, uint8_t lun, ui
 static int8_t SCSI_ModeSense6 (USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *params)
 {
   USBD_MSC_BOT_HandleTypeDef  *hmsc = (USBD_MSC_BOT_HandleTypeDef*)pdev->pClassData; 
-  uint16_t len = 8 ;
+  uint16_t len = MODE_SENSE6_LEN;
+  
+  /* Caching page for the page code 08h or all pages (3Fh), header only otherwise */
+  if (((params[2] & 0x3F) != MODE_CACHING_PAGE) && ((params[2] & 0x3F) != 0x3F))
+  {
+    len = MODE_SENSE6_DATA_LEN;
+  }
   hmsc->bot_data_length = len;
   
   while (len) 
@@ -344,6 +474,7 @@ static int8_t SCSI_ModeSense6 (USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *
     len--;
     hmsc->bot_data[len] = MSC_Mode_Sense6_data[len];
   }
+  hmsc->bot_data[0] = hmsc->bot_data_length - 1;
   return 0;
 }
 
@@ -356,9 +487,14 @@ static int8_t SCSI_ModeSense6 (USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *
 */
 static int8_t SCSI_ModeSense10 (USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *params)
 {
-  uint16_t len = 8;
+  uint16_t len = MODE_SENSE10_LEN;
   USBD_MSC_BOT_HandleTypeDef  *hmsc = (USBD_MSC_BOT_HandleTypeDef*)pdev->pClassData; 
   
+  /* Caching page for the page code 08h or all pages (3Fh), header only otherwise */
+  if (((params[2] & 0x3F) != MODE_CACHING_PAGE) && ((params[2] & 0x3F) != 0x3F))
+  {
+    len = MODE_SENSE10_DATA_LEN;
+  }
   hmsc->bot_data_length = len;
 
   while (len) 
@@ -366,6 +502,7 @@ static int8_t SCSI_ModeSense10 (USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t
     len--;
     hmsc->bot_data[len] = MSC_Mode_Sense10_data[len];
   }
+  hmsc->bot_data[1] = hmsc->bot_data_length - 2;
   return 0;
 }
 
@@ -440,12 +577,146 @@ void SCSI_SenseCode(USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t sKey, uint8_
 * @retval status
 */
 static int8_t SCSI_StartStopUnit(USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *params)
+{
+  USBD_MSC_BOT_HandleTypeDef  *hmsc = (USBD_MSC_BOT_HandleTypeDef*) pdev->pClassData;   
+  hmsc->bot_data_length = 0;
+  
+  /* START = 0: stop or eject (LOEJ), the cached writes reach the medium first */
+  if ((params[4] & 0x01) == 0)
+  {
+    return SCSI_SyncMedium(pdev, lun);
+  }
+  return 0;
+}
+
+/**
+* @brief  SCSI_AllowMediumRemoval
+*         Process Prevent Allow Medium Removal command
+* @param  lun: Logical unit number
+* @param  params: Command parameters
+* @retval status
+*/
+static int8_t SCSI_AllowMediumRemoval(USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *params)
 {
   USBD_MSC_BOT_HandleTypeDef  *hmsc = (USBD_MSC_BOT_HandleTypeDef*) pdev->pClassData;   
   hmsc->bot_data_length = 0;
   return 0;
 }
 
+/**
+* @brief  SCSI_SynchronizeCache10
+*         Process Synchronize Cache (10) command: the whole cache is written
+*         back whatever the LBA range
+* @param  lun: Logical unit number
+* @param  params: Command parameters
+* @retval status
+*/
+static int8_t SCSI_SynchronizeCache10(USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *params)
+{
+  USBD_MSC_BOT_HandleTypeDef  *hmsc = (USBD_MSC_BOT_HandleTypeDef*) pdev->pClassData;   
+  hmsc->bot_data_length = 0;
+  return SCSI_SyncMedium(pdev, lun);
+}
+
+/**
+* @brief  SCSI_VendorPerf
+*         Process the performance probe command (usbd_perf.h): return the
+*         counters, or run a benchmark on the medium before the status
+* @param  lun: Logical unit number
+* @param  params: Command parameters
+* @retval status
+*/
+static int8_t SCSI_VendorPerf(USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *params)
+{
+  USBD_MSC_BOT_HandleTypeDef  *hmsc = (USBD_MSC_BOT_HandleTypeDef*) pdev->pClassData; 
+  USBD_StorageTypeDef *pStorage = (USBD_StorageTypeDef *)pdev->pUserData;
+  uint16_t len = (params[7] << 8) | params[8];
+  uint32_t blk_addr;
+  int8_t status;
+  
+  switch (params[1])
+  {
+  case USBD_PERF_GET_COUNTERS:
+    /* case 10 : Ho <> Di */
+    if ((pStorage->GetCounters == NULL) || \
+        ((hmsc->cbw.dDataLength != 0) && ((hmsc->cbw.bmFlags & 0x80) != 0x80)))
+    {
+      SCSI_SenseCode(pdev,
+                     lun, 
+                     ILLEGAL_REQUEST, 
+                     INVALID_CDB);
+      return -1;
+    }
+    
+    /* The blob is built in the staging buffer, idle between two commands.
+       No data phase (clear only) when the host expects no data */
+    len = MIN(len, MIN(hmsc->cbw.dDataLength, MSC_STAGING_SIZE));
+    if (pStorage->GetCounters(lun, hmsc->bot_data, &len, params[2]) < 0)
+    {
+      SCSI_SenseCode(pdev,
+                     lun, 
+                     ILLEGAL_REQUEST, 
+                     INVALID_FIELED_IN_COMMAND);
+      return -1;
+    }
+    hmsc->bot_data_length = len;
+    return 0;
+    
+  case USBD_PERF_BENCHMARK:
+    /* case 2,3 : the status follows the benchmark, no data phase */
+    if ((pStorage->Benchmark == NULL) || (hmsc->cbw.dDataLength != 0) || \
+        (len == 0) || (len > USBD_PERF_MAX_SECTORS))
+    {
+      SCSI_SenseCode(pdev,
+                     lun, 
+                     ILLEGAL_REQUEST, 
+                     INVALID_FIELED_IN_COMMAND);
+      return -1;
+    }
+    
+    if(SCSI_CheckReady(pdev, lun) < 0)
+    {
+      return -1;
+    } 
+    
+    if ((params[2] != USBD_PERF_BENCH_READ) && \
+        (pStorage->IsWriteProtected(lun) != 0))
+    {
+      SCSI_SenseCode(pdev,
+                     lun,
+                     NOT_READY, 
+                     WRITE_PROTECTED);
+      return -1;
+    } 
+    
+    blk_addr = (params[3] << 24) | \
+      (params[4] << 16) | \
+        (params[5] <<  8) | \
+          params[6];
+    if (SCSI_CheckAddressRange(pdev, lun, blk_addr, len) < 0)
+    {
+      return -1;
+    }
+    
+    /* The staging buffer is lent to the benchmark until the status */
+    hmsc->bot_data_length = 0;
+    status = pStorage->Benchmark(lun, params[2], hmsc->bot_data, blk_addr, len);
+    if (status == USBD_BUSY)
+    {
+      hmsc->bot_state = USBD_BOT_WAIT_MEDIUM;
+      return 0;
+    }
+    return SCSI_SyncDone(pdev, lun, status);
+    
+  default:
+    SCSI_SenseCode(pdev,
+                   lun, 
+                   ILLEGAL_REQUEST, 
+                   INVALID_FIELED_IN_COMMAND);
+    return -1;
+  }
+}
+
 /**
 * @brief  SCSI_Read10
 *         Process Read10 command
@@ -471,12 +742,8 @@ static int8_t SCSI_Read10(USBD_HandleTypeDef  *pdev, uint8_t lun , uint8_t *para
       return -1;
     }    
     
-    if(((USBD_StorageTypeDef *)pdev->pUserData)->IsReady(lun) !=0 )
+    if(SCSI_CheckReady(pdev, lun) < 0)
     {
-      SCSI_SenseCode(pdev,
-                     lun,
-                     NOT_READY, 
-                     MEDIUM_NOT_PRESENT);
       return -1;
     } 
     
@@ -508,6 +775,22 @@ static int8_t SCSI_Read10(USBD_HandleTypeDef  *pdev, uint8_t lun , uint8_t *para
                      INVALID_CDB);
       return -1;
     }
+    
+    /* Both staging halves are free, the medium fills half 0 first */
+    scsi_nak_open = 0;
+    hmsc->scsi_stage_addr = hmsc->scsi_blk_addr;
+    hmsc->scsi_stage_len = hmsc->scsi_blk_len;
+    hmsc->scsi_stage_count[0] = 0;
+    hmsc->scsi_stage_count[1] = 0;
+    hmsc->scsi_stage_fill = 0;
+    hmsc->scsi_stage_drain = 0;
+    hmsc->scsi_stage_flags = 0;
+  }
+  else /* The endpoint has sent a staging half */
+  {
+    hmsc->scsi_stage_count[hmsc->scsi_stage_drain] = 0;
+    hmsc->scsi_stage_drain ^= 1;
+    hmsc->scsi_stage_flags &= ~MSC_STAGE_EP_BUSY;
   }
   hmsc->bot_data_length = MSC_MEDIA_PACKET;  
   
@@ -525,6 +808,7 @@ static int8_t SCSI_Read10(USBD_HandleTypeDef  *pdev, uint8_t lun , uint8_t *para
 static int8_t SCSI_Write10 (USBD_HandleTypeDef  *pdev, uint8_t lun , uint8_t *params)
 {
   USBD_MSC_BOT_HandleTypeDef  *hmsc = (USBD_MSC_BOT_HandleTypeDef*) pdev->pClassData; 
+  uint32_t len;
   
   if (hmsc->bot_state == USBD_BOT_IDLE) /* Idle */
   {
@@ -541,12 +825,8 @@ static int8_t SCSI_Write10 (USBD_HandleTypeDef  *pdev, uint8_t lun , uint8_t *pa
     }
     
     /* Check whether Media is ready */
-    if(((USBD_StorageTypeDef *)pdev->pUserData)->IsReady(lun) !=0 )
+    if(SCSI_CheckReady(pdev, lun) < 0)
     {
-      SCSI_SenseCode(pdev,
-                     lun,
-                     NOT_READY, 
-                     MEDIUM_NOT_PRESENT);
       return -1;
     } 
     
@@ -590,18 +870,25 @@ static int8_t SCSI_Write10 (USBD_HandleTypeDef  *pdev, uint8_t lun , uint8_t *pa
       return -1;
     }
     
-    /* Prepare EP to receive first data packet */
+    /* Both staging halves are free, the endpoint fills half 0 first */
+    scsi_nak_open = 0;
     hmsc->bot_state = USBD_BOT_DATA_OUT;  
-    USBD_LL_PrepareReceive (pdev,
-                      MSC_EPOUT_ADDR,
-                      hmsc->bot_data, 
-                      MIN (hmsc->scsi_blk_len, MSC_MEDIA_PACKET));  
+    hmsc->scsi_stage_len = hmsc->scsi_blk_len;
+    hmsc->scsi_stage_count[0] = 0;
+    hmsc->scsi_stage_count[1] = 0;
+    hmsc->scsi_stage_fill = 0;
+    hmsc->scsi_stage_drain = 0;
+    hmsc->scsi_stage_flags = 0;
   }
-  else /* Write Process ongoing */
+  else /* The endpoint has received a staging half */
   {
-    return SCSI_ProcessWrite(pdev, lun);
+    len = MIN(hmsc->scsi_stage_len , MSC_STAGE_HALF); 
+    hmsc->scsi_stage_count[hmsc->scsi_stage_fill] = len;
+    hmsc->scsi_stage_fill ^= 1;
+    hmsc->scsi_stage_len -= len;
+    hmsc->scsi_stage_flags &= ~MSC_STAGE_EP_BUSY;
   }
-  return 0;
+  return SCSI_ProcessWrite(pdev, lun);
 }
 
 
@@ -637,6 +924,180 @@ static int8_t SCSI_Verify10(USBD_HandleTypeDef  *pdev, uint8_t lun , uint8_t *pa
   return 0;
 }
 
+/**
+* @brief  SCSI_Unmap
+*         Process Unmap command: the parameter list is received in the
+*         data-out phase, checked, then the block descriptors are passed to
+*         the storage one by one (SCSI_UnmapNext)
+* @param  lun: Logical unit number
+* @param  params: Command parameters
+* @retval status
+*/
+static int8_t SCSI_Unmap(USBD_HandleTypeDef  *pdev, uint8_t lun, uint8_t *params)
+{
+  USBD_MSC_BOT_HandleTypeDef  *hmsc = (USBD_MSC_BOT_HandleTypeDef*) pdev->pClassData; 
+  USBD_StorageTypeDef *pStorage = (USBD_StorageTypeDef *)pdev->pUserData;
+  uint16_t len = (params[7] << 8) | params[8];
+  uint16_t desc_len;
+  uint16_t i;
+  uint32_t blk_addr;
+  uint32_t blk_len;
+  
+  if (hmsc->bot_state == USBD_BOT_IDLE) /* Idle */
+  {
+    if (pStorage->Unmap == NULL)
+    {
+      SCSI_SenseCode(pdev,
+                     lun, 
+                     ILLEGAL_REQUEST, 
+                     INVALID_CDB);
+      return -1;
+    }
+    
+    /* case 8 : Hi <> Do */
+    if ((hmsc->cbw.bmFlags & 0x80) == 0x80)
+    {
+      SCSI_SenseCode(pdev,
+                     hmsc->cbw.bLUN, 
+                     ILLEGAL_REQUEST, 
+                     INVALID_CDB);
+      return -1;
+    }
+    
+    if(SCSI_CheckReady(pdev, lun) < 0)
+    {
+      return -1;
+    } 
+    
+    if(pStorage->IsWriteProtected(lun) !=0 )
+    {
+      SCSI_SenseCode(pdev,
+                     lun,
+                     NOT_READY, 
+                     WRITE_PROTECTED);
+      return -1;
+    } 
+    
+    /* Nothing to unmap */
+    if (len == 0)
+    {
+      hmsc->bot_data_length = 0;
+      return 0;
+    }
+    
+    /* The header and the whole parameter list must fit in one packet */
+    if ((len < UNMAP_HEADER_LEN) || (len > MSC_MEDIA_PACKET) || (hmsc->cbw.dDataLength != len))
+    {
+      SCSI_SenseCode(pdev,
+                     lun, 
+                     ILLEGAL_REQUEST, 
+                     PARAMETER_LIST_LENGTH_ERROR);
+      return -1;
+    }
+    
+    /* Prepare EP to receive the parameter list */
+    hmsc->bot_state = USBD_BOT_DATA_OUT;  
+    USBD_LL_PrepareReceive (pdev,
+                            MSC_EPOUT_ADDR,
+                            hmsc->bot_data, 
+                            len);  
+  }
+  else /* Parameter list received */
+  {
+    desc_len = (hmsc->bot_data[2] << 8) | hmsc->bot_data[3];
+    if (desc_len > (len - UNMAP_HEADER_LEN))
+    {
+      desc_len = len - UNMAP_HEADER_LEN;
+    }
+    
+    for (i = UNMAP_HEADER_LEN; (i + UNMAP_DESCRIPTOR_LEN) <= (UNMAP_HEADER_LEN + desc_len); i += UNMAP_DESCRIPTOR_LEN)
+    {
+      blk_addr = (hmsc->bot_data[i + 4] << 24) | \
+        (hmsc->bot_data[i + 5] << 16) | \
+          (hmsc->bot_data[i + 6] <<  8) | \
+            hmsc->bot_data[i + 7];
+      blk_len = (hmsc->bot_data[i + 8] << 24) | \
+        (hmsc->bot_data[i + 9] << 16) | \
+          (hmsc->bot_data[i + 10] <<  8) | \
+            hmsc->bot_data[i + 11];
+      
+      if (blk_len == 0)
+      {
+        continue;
+      }
+      
+      /* Upper 32 bits of the LBA must be 0 */
+      if ((hmsc->bot_data[i] | hmsc->bot_data[i + 1] | hmsc->bot_data[i + 2] | hmsc->bot_data[i + 3]) || \
+        (blk_addr >= hmsc->scsi_blk_nbr) || (blk_len > (hmsc->scsi_blk_nbr - blk_addr)))
+      {
+        SCSI_SenseCode(pdev,
+                       lun, 
+                       ILLEGAL_REQUEST, 
+                       ADDRESS_OUT_OF_RANGE);
+        return -1;
+      }
+    }
+    
+    /* Nothing is erased before the whole list is checked. The list stays in
+       bot_data, scsi_blk_addr/scsi_blk_len hold the next and end offsets */
+    hmsc->csw.dDataResidue -= len;
+    hmsc->scsi_blk_addr = UNMAP_HEADER_LEN;
+    hmsc->scsi_blk_len = UNMAP_HEADER_LEN + desc_len;
+    return SCSI_UnmapNext(pdev, lun);
+  }
+  return 0;
+}
+
+/**
+* @brief  SCSI_UnmapNext
+*         Pass the next block descriptors of the Unmap parameter list to the
+*         storage. A deferred range resumes in SCSI_CompleteTransfer, the CSW
+*         is sent once the last range is erased
+* @param  lun: Logical unit number
+* @retval status
+*/
+static int8_t SCSI_UnmapNext(USBD_HandleTypeDef  *pdev, uint8_t lun)
+{
+  USBD_MSC_BOT_HandleTypeDef  *hmsc = (USBD_MSC_BOT_HandleTypeDef*) pdev->pClassData; 
+  uint32_t i;
+  uint32_t blk_addr;
+  uint32_t blk_len;
+  int8_t status;
+  
+  while ((hmsc->scsi_blk_addr + UNMAP_DESCRIPTOR_LEN) <= hmsc->scsi_blk_len)
+  {
+    i = hmsc->scsi_blk_addr;
+    hmsc->scsi_blk_addr += UNMAP_DESCRIPTOR_LEN;
+    blk_addr = (hmsc->bot_data[i + 4] << 24) | \
+      (hmsc->bot_data[i + 5] << 16) | \
+        (hmsc->bot_data[i + 6] <<  8) | \
+          hmsc->bot_data[i + 7];
+    blk_len = (hmsc->bot_data[i + 8] << 24) | \
+      (hmsc->bot_data[i + 9] << 16) | \
+        (hmsc->bot_data[i + 10] <<  8) | \
+          hmsc->bot_data[i + 11];
+    if (blk_len == 0)
+    {
+      continue;
+    }
+    
+    status = ((USBD_StorageTypeDef *)pdev->pUserData)->Unmap(lun, blk_addr, blk_len);
+    if (status == USBD_BUSY)
+    {
+      hmsc->bot_state = USBD_BOT_WAIT_MEDIUM;
+      return 0;
+    }
+    if (status < 0)
+    {
+      SCSI_StorageError(pdev, lun, status, WRITE_FAULT);
+      return -1;
+    }
+  }
+  
+  MSC_BOT_SendCSW (pdev, USBD_CSW_CMD_PASSED);
+  return 0;
+}
+
 /**
 * @brief  SCSI_CheckAddressRange
 *         Check address range
@@ -662,7 +1123,8 @@ static int8_t SCSI_CheckAddressRange (USBD_HandleTypeDef  *pdev, uint8_t lun , u
 
 /**
 * @brief  SCSI_ProcessRead
-*         Handle Read Process
+*         Handle Read Process: send the staged half while the medium
+*         fills the other one
 * @param  lun: Logical unit number
 * @retval status
 */
@@ -670,45 +1132,111 @@ static int8_t SCSI_ProcessRead (USBD_HandleTypeDef  *pdev, uint8_t lun)
 {
   USBD_MSC_BOT_HandleTypeDef  *hmsc = (USBD_MSC_BOT_HandleTypeDef*)pdev->pClassData;   
   uint32_t len;
+  uint8_t half;
+  int8_t status;
   
-  len = MIN(hmsc->scsi_blk_len , MSC_MEDIA_PACKET); 
-  
-  if( ((USBD_StorageTypeDef *)pdev->pUserData)->Read(lun ,
-                              hmsc->bot_data, 
-                              hmsc->scsi_blk_addr / hmsc->scsi_blk_size, 
-                              len / hmsc->scsi_blk_size) < 0)
+  if ((hmsc->scsi_stage_flags & MSC_STAGE_EP_BUSY) != 0)
   {
+    if ((hmsc->scsi_stage_flags & MSC_STAGE_ERROR) != 0)
+    {
+      /* The CSW waits for the end of the half on the endpoint */
+      return 0;
+    }
+  }
+  else if ((hmsc->scsi_stage_flags & MSC_STAGE_ERROR) != 0)
+  {
+    return -1;
+  }
+  else if (hmsc->scsi_stage_count[hmsc->scsi_stage_drain] != 0)
+  {
+    half = hmsc->scsi_stage_drain;
+    len = hmsc->scsi_stage_count[half];
+    hmsc->scsi_stage_flags |= MSC_STAGE_EP_BUSY;
+    SCSI_CloseNakWindow(SCSI_NAK_IN);
     
-    SCSI_SenseCode(pdev,
-                   lun, 
-                   HARDWARE_ERROR, 
-                   UNRECOVERED_READ_ERROR);
-    return -1; 
+    USBD_LL_Transmit (pdev, 
+               MSC_EPIN_ADDR,
+               &hmsc->bot_data[half * MSC_STAGE_HALF],
+               len);
+    
+    hmsc->scsi_blk_addr   += len; 
+    hmsc->scsi_blk_len    -= len;  
+    
+    /* case 6 : Hi = Di */
+    hmsc->csw.dDataResidue -= len;
+    
+    if (hmsc->scsi_blk_len == 0)
+    {
+      hmsc->bot_state = USBD_BOT_LAST_DATA_IN;
+    }
+  }
+  else
+  {
+    /* Nothing to send: the host is NAKed until the medium fills a half */
+    SCSI_OpenNakWindow(SCSI_NAK_IN);
   }
   
+  /* Multi-block read into the free half, once at a time: one storage request,
+     one CMD18 transaction of MSC_STAGE_HALF bytes on the card */
+  half = hmsc->scsi_stage_fill;
+  if (((hmsc->scsi_stage_flags & MSC_STAGE_MEDIUM_BUSY) != 0) ||
+      (hmsc->scsi_stage_len == 0) ||
+      (hmsc->scsi_stage_count[half] != 0))
+  {
+    return 0;
+  }
   
-  USBD_LL_Transmit (pdev, 
-             MSC_EPIN_ADDR,
-             hmsc->bot_data,
-             len);
+  len = MIN(hmsc->scsi_stage_len , MSC_STAGE_HALF); 
+  hmsc->scsi_stage_flags |= MSC_STAGE_MEDIUM_BUSY;
   
+  status = ((USBD_StorageTypeDef *)pdev->pUserData)->Read(lun ,
+                              &hmsc->bot_data[half * MSC_STAGE_HALF], 
+                              hmsc->scsi_stage_addr / hmsc->scsi_blk_size, 
+                              len / hmsc->scsi_blk_size);
   
-  hmsc->scsi_blk_addr   += len; 
-  hmsc->scsi_blk_len    -= len;  
+  /* Deferred read: the staging resumes in SCSI_CompleteTransfer */
+  if (status == USBD_BUSY)
+  {
+    return 0;
+  }
+  return SCSI_ReadDone(pdev, lun, status);
+}
+
+/**
+* @brief  SCSI_ReadDone
+*         Hand the half read from the medium to the endpoint
+* @param  lun: Logical unit number
+* @param  status: Result of the storage Read
+* @retval status
+*/
+static int8_t SCSI_ReadDone (USBD_HandleTypeDef  *pdev, uint8_t lun, int8_t status)
+{
+  USBD_MSC_BOT_HandleTypeDef  *hmsc = (USBD_MSC_BOT_HandleTypeDef*)pdev->pClassData;   
+  uint32_t len;
   
-  /* case 6 : Hi = Di */
-  hmsc->csw.dDataResidue -= len;
+  hmsc->scsi_stage_flags &= ~MSC_STAGE_MEDIUM_BUSY;
   
-  if (hmsc->scsi_blk_len == 0)
+  if (status < 0)
   {
-    hmsc->bot_state = USBD_BOT_LAST_DATA_IN;
+    SCSI_StorageError(pdev, lun, status, UNRECOVERED_READ_ERROR);
+    hmsc->scsi_stage_flags |= MSC_STAGE_ERROR;
   }
-  return 0;
+  else
+  {
+    len = MIN(hmsc->scsi_stage_len , MSC_STAGE_HALF); 
+    hmsc->scsi_stage_count[hmsc->scsi_stage_fill] = len;
+    hmsc->scsi_stage_fill ^= 1;
+    hmsc->scsi_stage_addr += len;
+    hmsc->scsi_stage_len  -= len;
+  }
+  
+  return SCSI_ProcessRead(pdev, lun);
 }
 
 /**
 * @brief  SCSI_ProcessWrite
-*         Handle Write Process
+*         Handle Write Process: receive a half while the medium writes
+*         the other one
 * @param  lun: Logical unit number
 * @retval status
 */
@@ -717,21 +1245,76 @@ static int8_t SCSI_ProcessWrite (USBD_HandleTypeDef  *pdev, uint8_t lun)
 {
   uint32_t len;
   USBD_MSC_BOT_HandleTypeDef  *hmsc = (USBD_MSC_BOT_HandleTypeDef*) pdev->pClassData; 
+  uint8_t half;
+  int8_t status;
+  
+  half = hmsc->scsi_stage_fill;
+  if (((hmsc->scsi_stage_flags & MSC_STAGE_EP_BUSY) == 0) &&
+      (hmsc->scsi_stage_len != 0) &&
+      (hmsc->scsi_stage_count[half] == 0))
+  {
+    hmsc->scsi_stage_flags |= MSC_STAGE_EP_BUSY;
+    SCSI_CloseNakWindow(SCSI_NAK_OUT);
+    USBD_LL_PrepareReceive (pdev,
+                            MSC_EPOUT_ADDR,
+                            &hmsc->bot_data[half * MSC_STAGE_HALF], 
+                            MIN (hmsc->scsi_stage_len, MSC_STAGE_HALF)); 
+  }
+  else if (((hmsc->scsi_stage_flags & MSC_STAGE_EP_BUSY) == 0) &&
+           (hmsc->scsi_stage_len != 0))
+  {
+    /* Both halves wait for the medium: the host is NAKed until one is written */
+    SCSI_OpenNakWindow(SCSI_NAK_OUT);
+  }
+  
+  /* Multi-block write of the received half, once at a time (one storage request) */
+  half = hmsc->scsi_stage_drain;
+  if (((hmsc->scsi_stage_flags & MSC_STAGE_MEDIUM_BUSY) != 0) ||
+      (hmsc->scsi_stage_count[half] == 0))
+  {
+    return 0;
+  }
   
-  len = MIN(hmsc->scsi_blk_len , MSC_MEDIA_PACKET); 
+  len = hmsc->scsi_stage_count[half];
+  hmsc->scsi_stage_flags |= MSC_STAGE_MEDIUM_BUSY;
   
-  if(((USBD_StorageTypeDef *)pdev->pUserData)->Write(lun ,
-                              hmsc->bot_data, 
+  status = ((USBD_StorageTypeDef *)pdev->pUserData)->Write(lun ,
+                              &hmsc->bot_data[half * MSC_STAGE_HALF], 
                               hmsc->scsi_blk_addr / hmsc->scsi_blk_size, 
-                              len / hmsc->scsi_blk_size) < 0)
+                              len / hmsc->scsi_blk_size);
+  
+  /* Deferred write: the staging resumes in SCSI_CompleteTransfer */
+  if (status == USBD_BUSY)
   {
-    SCSI_SenseCode(pdev,
-                   lun, 
-                   HARDWARE_ERROR, 
-                   WRITE_FAULT);     
+    return 0;
+  }
+  return SCSI_WriteDone(pdev, lun, status);
+}
+
+/**
+* @brief  SCSI_WriteDone
+*         Release the half written to the medium, send the status once
+*         the last one is written
+* @param  lun: Logical unit number
+* @param  status: Result of the storage Write
+* @retval status
+*/
+static int8_t SCSI_WriteDone (USBD_HandleTypeDef  *pdev, uint8_t lun, int8_t status)
+{
+  uint32_t len;
+  USBD_MSC_BOT_HandleTypeDef  *hmsc = (USBD_MSC_BOT_HandleTypeDef*) pdev->pClassData; 
+  
+  hmsc->scsi_stage_flags &= ~MSC_STAGE_MEDIUM_BUSY;
+  
+  if (status < 0)
+  {
+    SCSI_StorageError(pdev, lun, status, WRITE_FAULT);
     return -1; 
   }
   
+  len = hmsc->scsi_stage_count[hmsc->scsi_stage_drain];
+  hmsc->scsi_stage_count[hmsc->scsi_stage_drain] = 0;
+  hmsc->scsi_stage_drain ^= 1;
   
   hmsc->scsi_blk_addr  += len; 
   hmsc->scsi_blk_len   -= len; 
@@ -739,21 +1322,258 @@ static int8_t SCSI_ProcessWrite (USBD_HandleTypeDef  *pdev, uint8_t lun)
   /* case 12 : Ho = Do */
   hmsc->csw.dDataResidue -= len;
   
-  if (hmsc->scsi_blk_len == 0)
+  if (hmsc->scsi_blk_len != 0)
   {
-    MSC_BOT_SendCSW (pdev, USBD_CSW_CMD_PASSED);
+    return SCSI_ProcessWrite(pdev, lun);
   }
-  else
+  
+  /* FUA: the data must be on the medium, not in its cache, before the status */
+  if ((hmsc->cbw.CB[1] & 0x08) != 0)
   {
-    /* Prepare EP to Receive next packet */
-    USBD_LL_PrepareReceive (pdev,
-                            MSC_EPOUT_ADDR,
-                            hmsc->bot_data, 
-                            MIN (hmsc->scsi_blk_len, MSC_MEDIA_PACKET)); 
+    if (SCSI_SyncMedium(pdev, lun) < 0)
+    {
+      return -1;
+    }
+    if (hmsc->bot_state == USBD_BOT_WAIT_MEDIUM)
+    {
+      return 0;
+    }
   }
+  MSC_BOT_SendCSW (pdev, USBD_CSW_CMD_PASSED);
+  return 0;
+}
+
+/**
+* @brief  SCSI_SyncMedium
+*         Write the cached sectors back to the medium. When deferred, the
+*         CSW is sent by SCSI_CompleteTransfer (USBD_BOT_WAIT_MEDIUM)
+* @param  lun: Logical unit number
+* @retval status
+*/
+static int8_t SCSI_SyncMedium (USBD_HandleTypeDef  *pdev, uint8_t lun)
+{
+  USBD_MSC_BOT_HandleTypeDef  *hmsc = (USBD_MSC_BOT_HandleTypeDef*) pdev->pClassData; 
+  int8_t status;
   
+  status = ((USBD_StorageTypeDef *)pdev->pUserData)->Sync(lun);
+  if (status == USBD_BUSY)
+  {
+    hmsc->bot_state = USBD_BOT_WAIT_MEDIUM;
+    return 0;
+  }
+  return SCSI_SyncDone(pdev, lun, status);
+}
+
+/**
+* @brief  SCSI_SyncDone
+*         Check the write back of the cached sectors
+* @param  lun: Logical unit number
+* @param  status: Result of the storage Sync
+* @retval status
+*/
+static int8_t SCSI_SyncDone (USBD_HandleTypeDef  *pdev, uint8_t lun, int8_t status)
+{
+  USBD_MSC_BOT_HandleTypeDef  *hmsc = (USBD_MSC_BOT_HandleTypeDef*) pdev->pClassData; 
+  
+  if (status < 0)
+  {
+    /* A read benchmark only fails reading, the others on a write */
+    if ((hmsc->cbw.CB[0] == SCSI_VENDOR_PERF) && (hmsc->cbw.CB[1] == USBD_PERF_BENCHMARK) && \
+        (hmsc->cbw.CB[2] == USBD_PERF_BENCH_READ))
+    {
+      SCSI_StorageError(pdev, lun, status, UNRECOVERED_READ_ERROR);
+    }
+    else
+    {
+      SCSI_StorageError(pdev, lun, status, WRITE_FAULT);
+    }
+    return -1;
+  }
   return 0;
 }
+
+/**
+* @brief  SCSI_CheckReady
+*         Check the medium before an access, report a new medium once
+* @param  lun: Logical unit number
+* @retval status
+*/
+static int8_t SCSI_CheckReady (USBD_HandleTypeDef  *pdev, uint8_t lun)
+{
+  switch (((USBD_StorageTypeDef *)pdev->pUserData)->IsReady(lun))
+  {
+  case USBD_OK:
+    return 0;
+    
+  case MSC_STORAGE_MEDIUM_CHANGED:
+    /* The host must read the capacity again and drop its cached sectors */
+    SCSI_SenseCode(pdev,
+                   lun,
+                   UNIT_ATTENTION, 
+                   MEDIUM_HAVE_CHANGED);
+    return -1;
+    
+  default:
+    SCSI_SenseCode(pdev,
+                   lun,
+                   NOT_READY, 
+                   MEDIUM_NOT_PRESENT);
+    return -1;
+  }
+}
+
+/**
+* @brief  SCSI_StorageError
+*         Set the sense of a failed storage Read, Write or Sync
+* @param  lun: Logical unit number
+* @param  status: Result of the storage access
+* @param  ASC: Additional sense code of a medium error
+* @retval None
+*/
+static void SCSI_StorageError (USBD_HandleTypeDef  *pdev, uint8_t lun, int8_t status, uint8_t ASC)
+{
+  if (status == MSC_STORAGE_NOT_READY)
+  {
+    /* The card left its slot: the host waits for a medium instead of retrying */
+    SCSI_SenseCode(pdev,
+                   lun,
+                   NOT_READY, 
+                   MEDIUM_NOT_PRESENT);
+  }
+  else
+  {
+    SCSI_SenseCode(pdev,
+                   lun, 
+                   MEDIUM_ERROR, 
+                   ASC);
+  }
+}
+
+/**
+* @brief  SCSI_CompleteTransfer
+*         Resume a READ10/WRITE10, an UNMAP or a synchronization whose
+*         storage Read, Write, Unmap or Sync returned USBD_BUSY.
+*         Must be called with the USB interrupt masked.
+* @param  lun: Logical unit number
+* @param  status: Result of the deferred storage access (negative on error)
+* @retval None
+*/
+void SCSI_CompleteTransfer(USBD_HandleTypeDef  *pdev, uint8_t lun, int8_t status)
+{
+  USBD_MSC_BOT_HandleTypeDef  *hmsc = (USBD_MSC_BOT_HandleTypeDef*) pdev->pClassData; 
+  
+  if (hmsc == NULL)
+  {
+    return;
+  }
+  
+  switch (hmsc->bot_state)
+  {
+  case USBD_BOT_DATA_IN:
+    if (SCSI_ReadDone(pdev, lun, status) < 0)
+    {
+      MSC_BOT_SendCSW (pdev, USBD_CSW_CMD_FAILED);
+    }
+    break;
+    
+  case USBD_BOT_DATA_OUT:
+    if (SCSI_WriteDone(pdev, lun, status) < 0)
+    {
+      MSC_BOT_SendCSW (pdev, USBD_CSW_CMD_FAILED);
+    }
+    break;
+    
+  case USBD_BOT_WAIT_MEDIUM:
+    if (SCSI_SyncDone(pdev, lun, status) < 0)
+    {
+      MSC_BOT_SendCSW (pdev, USBD_CSW_CMD_FAILED);
+    }
+    else if (hmsc->cbw.CB[0] == SCSI_UNMAP)
+    {
+      /* The CSW follows the last block descriptor */
+      if (SCSI_UnmapNext(pdev, lun) < 0)
+      {
+        MSC_BOT_SendCSW (pdev, USBD_CSW_CMD_FAILED);
+      }
+    }
+    else
+    {
+      MSC_BOT_SendCSW (pdev, USBD_CSW_CMD_PASSED);
+    }
+    break;
+    
+  default:
+    /* The transfer was reset by the host meanwhile */
+    break;
+  }
+}
+
+/**
+* @brief  SCSI_OpenNakWindow
+*         Start timing an endpoint left idle for the medium
+* @param  window: SCSI_NAK_IN or SCSI_NAK_OUT
+* @retval None
+*/
+static void SCSI_OpenNakWindow(uint8_t window)
+{
+  if ((scsi_nak_open & window) == 0)
+  {
+    scsi_nak_open |= window;
+    scsi_nak_start = DWT->CYCCNT;
+  }
+}
+
+/**
+* @brief  SCSI_CloseNakWindow
+*         Account the window once the endpoint is given a half again
+* @param  window: SCSI_NAK_IN or SCSI_NAK_OUT
+* @retval None
+*/
+static void SCSI_CloseNakWindow(uint8_t window)
+{
+  uint32_t us;
+  
+  if ((scsi_nak_open & window) == 0)
+  {
+    return;
+  }
+  scsi_nak_open &= ~window;
+  us = (DWT->CYCCNT - scsi_nak_start) / (SystemCoreClock / 1000000);
+  if (window == SCSI_NAK_IN)
+  {
+    scsi_statistic.in_nak_windows++;
+    scsi_statistic.in_nak_us += us;
+  }
+  else
+  {
+    scsi_statistic.out_nak_windows++;
+    scsi_statistic.out_nak_us += us;
+  }
+}
+
+/**
+* @brief  SCSI_GetStatistic
+*         Get the NAK windows of the READ10/WRITE10 staging
+* @param  stat: statistic storage pointer
+* @retval None
+*/
+void SCSI_GetStatistic(USBD_SCSI_StatisticTypeDef *stat)
+{
+  *stat = scsi_statistic;
+}
+
+/**
+* @brief  SCSI_ResetStatistic
+*         Clear the NAK windows of the READ10/WRITE10 staging
+* @retval None
+*/
+void SCSI_ResetStatistic(void)
+{
+  scsi_statistic.in_nak_windows = 0;
+  scsi_statistic.in_nak_us = 0;
+  scsi_statistic.out_nak_windows = 0;
+  scsi_statistic.out_nak_us = 0;
+}
 /**
   * @}
   */ 
@@ -38,12 +38,18 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "stm32f1xx_bsp.h"
+#include "usbd_conf.h"
 
 /* Exported types ------------------------------------------------------------*/
 /* Exported constants --------------------------------------------------------*/
 /* Exported macro ------------------------------------------------------------*/
 /* Exported functions --------------------------------------------------------*/
+#if USBD_AUDIO_ENABLE == 1
+void usbd_startSpeakerDeviceMode(void);
+#else
 void usbd_startMassStorageDeviceMode(void);
+#endif /* USBD_AUDIO_ENABLE == 1 */
+void usbd_setMediumChanged(void);
 
 /**@}LIB_USBD*/
 #endif /* USBD_H_ */
@@ -0,0 +1,116 @@
+/**
+ ****************************************************************************
+ * @file        usbd_audio.h
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       This is the header of the USB Audio Class 1 speaker function.
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef USBD_AUDIO_H_
+#define USBD_AUDIO_H_
+
+/** @addtogroup LIB_USBD_AUDIO
+ * @{
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_def.h"
+#include "usbd_perf.h"
+#include <stdbool.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define AUDIO_CONTROL_INTERFACE		(0) /*!< Audio control interface, no unit: the host scales the volume */
+#define AUDIO_STREAMING_INTERFACE	(1) /*!< Audio streaming interface, alternate setting 1 streams */
+
+#define AUDIO_OUT_EP				(0x01) /*!< PCM samples from the host (isochronous OUT, asynchronous) */
+#define AUDIO_FEEDBACK_EP			(0x82) /*!< Rate feedback to the host (isochronous IN) */
+
+#define AUDIO_FRAME_SIZE			(4) /*!< Stereo 16-bit: 2 channels x 2 bytes per sample frame */
+#define AUDIO_RATE_44K1				(44100) /*!< Sampling frequencies in Hz */
+#define AUDIO_RATE_48K				(48000)
+#define AUDIO_OUT_PACKET_SIZE		(((AUDIO_RATE_48K / 1000) + 1) * AUDIO_FRAME_SIZE) /*!< One frame more than 48kHz needs, for the feedback */
+#define AUDIO_FEEDBACK_PACKET_SIZE	(3) /*!< 10.14 format: sample frames per USB frame (1ms) */
+#define AUDIO_FEEDBACK_REFRESH		(4) /*!< The host reads the feedback every 2^4 = 16ms */
+
+#define AUDIO_RING_SIZE				(2048) /*!< PCM buffered for the CODEC: ~11ms at 48kHz, the VS1003 FIFO holds as much */
+
+/* Exported types ------------------------------------------------------------*/
+/**
+ * @struct _usbd_audio_statistic_t
+ * This type define the statistic of the speaker stream.
+ */
+typedef struct _usbd_audio_statistic_t
+{
+	uint32_t ui32Packets; /*!< Isochronous packets received */
+	uint32_t ui32Overruns; /*!< Packets dropped on a full ring: the host ignores the feedback */
+	uint32_t ui32Underruns; /*!< Ring emptied while the CODEC asked for samples, once settled */
+	uint32_t ui32FillLevel; /*!< Bytes in the ring after the last packet */
+	uint32_t ui32FillMin; /*!< Lowest fill level before a packet since the ring settled */
+	uint32_t ui32FillMax; /*!< Highest fill level after a packet since the ring settled */
+	uint32_t ui32Feedback; /*!< Last rate feedback sent, 10.14 sample frames per ms */
+	uint32_t ui32HostRate; /*!< Sample frames received per 1000 packets: the host rate in Hz */
+	uint32_t ui32SampleRate; /*!< Sampling frequency selected by the host in Hz */
+} usbd_audio_statistic_t;
+
+/**
+ * @struct _usbd_audio_handle_t
+ * This type define the state of the speaker stream, allocated by USBD_malloc().
+ */
+typedef struct _usbd_audio_handle_t
+{
+	uint8_t pui8Ring[AUDIO_RING_SIZE + AUDIO_OUT_PACKET_SIZE]; /*!< PCM ring, a packet crossing its end is received in the tail and moved to the front */
+	volatile uint32_t ui32Head; /*!< Free running write index, advanced by the USB interrupt */
+	volatile uint32_t ui32Tail; /*!< Free running read index, advanced by usbd_audio_releaseData() */
+	bool bDropping; /*!< The armed packet is received in the tail and dropped, the ring is full */
+	volatile bool bStreaming; /*!< Alternate setting 1 selected */
+	volatile bool bBuffering; /*!< usbd_audio_getData() waits for a half full ring: stream start or underrun */
+	volatile bool bSettled; /*!< The ring reached half full since the stream started */
+	volatile uint32_t ui32Generation; /*!< Incremented on each stream start and sampling frequency change */
+	uint32_t ui32FillFiltered; /*!< Fill level after the packets, low pass filtered, 1/16 byte unit */
+	uint32_t ui32RateBytes; /*!< Bytes received in the rate measurement window */
+	uint32_t ui32RatePackets; /*!< Packets received in the rate measurement window */
+	uint8_t ui8AltSetting; /*!< Alternate setting of the streaming interface */
+	uint8_t ui8ControlRequest; /*!< Class request waiting for its data stage, 0 if none */
+	uint8_t pui8Control[4]; /*!< Data stage of the sampling frequency requests */
+	uint8_t pui8Feedback[4]; /*!< Rate feedback packet */
+	uint32_t pui32Counters[sizeof(usbd_perf_counters_t) / 4]; /*!< Data stage of the performance probe request */
+	usbd_audio_statistic_t statistic; /*!< Stream statistic */
+} usbd_audio_handle_t;
+
+/* Exported macro ------------------------------------------------------------*/
+/* Exported functions --------------------------------------------------------*/
+extern USBD_ClassTypeDef USBD_AUDIO;
+
+bool usbd_audio_getStream(uint32_t *pui32SampleRate, uint32_t *pui32Generation);
+const uint8_t *usbd_audio_getData(uint32_t ui32Size);
+void usbd_audio_releaseData(uint32_t ui32Size);
+void usbd_audio_getStatistic(usbd_audio_statistic_t *pStatistic);
+void usbd_audio_resetStatistic(void);
+
+/**@}LIB_USBD_AUDIO*/
+#endif /* USBD_AUDIO_H_ */
+
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
@@ -0,0 +1,85 @@
+/**
+ ****************************************************************************
+ * @file        usbd_cdc.h
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       This is the header of the USB CDC-ACM telemetry/control channel.
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef USBD_CDC_H_
+#define USBD_CDC_H_
+
+/** @addtogroup LIB_USBD_CDC
+ * @{
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_def.h"
+#include <stdbool.h>
+
+/* Exported types ------------------------------------------------------------*/
+/**
+ * @struct _usbd_cdc_statistic_t
+ * This type define the statistic of the CDC channel.
+ */
+typedef struct _usbd_cdc_statistic_t
+{
+	uint32_t ui32TxBytes; /*!< Bytes sent to the host */
+	uint32_t ui32TxDropped; /*!< Bytes of the records dropped by usbd_cdc_write() on a full TX ring */
+	uint32_t ui32TxPackets; /*!< IN packets sent, zero length packets included */
+	uint32_t ui32RxBytes; /*!< Bytes received from the host */
+} usbd_cdc_statistic_t;
+
+/* Exported constants --------------------------------------------------------*/
+#define CDC_COMM_INTERFACE			(1) /*!< Communication class interface, MSC is interface 0 */
+#define CDC_DATA_INTERFACE			(2) /*!< Data class interface */
+
+#define CDC_CMD_EP					(0x84) /*!< Notification endpoint (interrupt IN) */
+#define CDC_IN_EP					(0x83) /*!< Data endpoint to the host (bulk IN) */
+#define CDC_OUT_EP					(0x03) /*!< Data endpoint from the host (bulk OUT) */
+
+#define CDC_CMD_PACKET_SIZE			(8) /*!< Notification: serial state is 10 bytes, never sent */
+#define CDC_DATA_IN_PACKET_SIZE		(64)
+#define CDC_DATA_OUT_PACKET_SIZE	(16) /*!< Control commands are short, the PMA is full */
+
+#define CDC_TX_RING_SIZE			(512) /*!< Telemetry buffered while the host is not reading */
+#define CDC_RX_RING_SIZE			(64) /*!< Control commands waiting for usbd_cdc_read() */
+
+/* Exported macro ------------------------------------------------------------*/
+/* Exported functions --------------------------------------------------------*/
+extern USBD_ClassTypeDef USBD_CDC;
+
+bool usbd_cdc_write(const uint8_t *pui8Data, uint32_t ui32Size);
+uint32_t usbd_cdc_getTxRoom(void);
+uint32_t usbd_cdc_read(uint8_t *pui8Data, uint32_t ui32Size);
+bool usbd_cdc_isConnected(void);
+void usbd_cdc_process(void);
+void usbd_cdc_getStatistic(usbd_cdc_statistic_t *pStatistic);
+
+/**@}LIB_USBD_CDC*/
+#endif /* USBD_CDC_H_ */
+
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
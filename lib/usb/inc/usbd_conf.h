@@ -43,7 +43,6 @@ extern "C"
 #include <string.h>
 #include "stm32f1xx.h"
 #include "stm32f1xx_hal.h"
-#include "usbd_def.h"
 
 /** @addtogroup BSP_INT_PRIORITY
  * @{
@@ -66,7 +65,23 @@ extern "C"
  */
 
 /*---------- -----------*/
+#ifndef USBD_AUDIO_ENABLE
+#define USBD_AUDIO_ENABLE     0 /* 1: USB speaker (UAC1) streaming to the audio CODEC instead of the mass storage */
+#endif /* USBD_AUDIO_ENABLE */
+/*---------- -----------*/
+#if USBD_AUDIO_ENABLE == 1
+#define USBD_CDC_ENABLE     0 /* The PMA only holds the speaker endpoints */
+#else
+#define USBD_CDC_ENABLE     1 /* 1: Composite device, MSC plus a CDC-ACM telemetry/control channel */
+#endif /* USBD_AUDIO_ENABLE == 1 */
+/*---------- -----------*/
+#if USBD_AUDIO_ENABLE == 1
+#define USBD_MAX_NUM_INTERFACES     2
+#elif USBD_CDC_ENABLE == 1
+#define USBD_MAX_NUM_INTERFACES     3
+#else
 #define USBD_MAX_NUM_INTERFACES     1
+#endif /* USBD_AUDIO_ENABLE == 1 */
 /*---------- -----------*/
 #define USBD_MAX_NUM_CONFIGURATION     1
 /*---------- -----------*/
@@ -79,10 +94,23 @@ extern "C"
 #define USBD_SELF_POWERED     1
 /*---------- -----------*/
 #define MSC_MEDIA_PACKET     512
+/*---------- -----------*/
+#define MSC_STAGING_SIZE     2048 /* READ10/WRITE10 ping-pong staging: 1024 to 4096, the medium works on one half while USB moves the other */
+/*---------- -----------*/
+#define MSC_UNMAP_DESCRIPTORS     8 /* UNMAP block descriptors per command, reported in the Block Limits page */
+/*---------- -----------*/
+#define USBD_MSC_DBL_BUF     1 /* 1: Double buffer the MSC bulk endpoints in the PMA */
+/*---------- -----------*/
+#if USBD_AUDIO_ENABLE == 1
+#define USB_MAX_EP0_SIZE     32 /* PMA room for the double buffered isochronous endpoint */
+#endif /* USBD_AUDIO_ENABLE == 1 */
 /****************************************/
 /* #define for FS and HS identification */
 #define DEVICE_FS 		0
 
+/* After the defines: usbd_def.h keeps USB_MAX_EP0_SIZE when it is set above */
+#include "usbd_def.h"
+
 /** @defgroup USBD_Exported_Macros
  * @{
  */
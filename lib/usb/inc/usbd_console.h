@@ -0,0 +1,57 @@
+/**
+ ****************************************************************************
+ * @file        usbd_console.h
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       This is the header of the console of the CDC-ACM channel.
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef USBD_CONSOLE_H_
+#define USBD_CONSOLE_H_
+
+/** @addtogroup LIB_USBD_CONSOLE
+ * @{
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_conf.h"
+
+/* Exported types ------------------------------------------------------------*/
+/* Exported constants --------------------------------------------------------*/
+#define CONSOLE_LINE_SIZE			(32) /*!< Longest command line, CR or LF terminated */
+#define CONSOLE_TRACE_MIN_MS		(100) /*!< Shortest trace period */
+#define CONSOLE_TRACE_FIELDS		(8) /*!< Counters of a trace record */
+
+/* Exported macro ------------------------------------------------------------*/
+/* Exported functions --------------------------------------------------------*/
+#if USBD_CDC_ENABLE == 1
+void usbd_console_process(void);
+#endif /* USBD_CDC_ENABLE == 1 */
+
+/**@}LIB_USBD_CONSOLE*/
+#endif /* USBD_CONSOLE_H_ */
+
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
@@ -84,6 +84,11 @@ extern USBD_DescriptorsTypeDef FS_Desc;
 /** @defgroup USBD_DESC_Exported_FunctionsPrototype
  * @{
  */
+#if USBD_AUDIO_ENABLE == 1
+uint8_t * USBD_FS_SpeakerConfigDescriptor(uint16_t *length);
+#elif USBD_CDC_ENABLE == 1
+uint8_t * USBD_FS_CompositeConfigDescriptor(uint16_t *length);
+#endif /* USBD_AUDIO_ENABLE == 1 */
 
 /**
  * @}
@@ -0,0 +1,177 @@
+/**
+ ****************************************************************************
+ * @file        usbd_perf.h
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       This is the header of the vendor SCSI performance probe.
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef USBD_PERF_H_
+#define USBD_PERF_H_
+
+/** @addtogroup LIB_USBD_PERF
+ * @{
+ */
+
+/* Includes ------------------------------------------------------------------*/
+/* Only the C library: the header is shared with the host tool (tools/usbd_perf) */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Exported types ------------------------------------------------------------*/
+/**
+ * @typedef usbd_perf_benchmark_t
+ * This type define the built-in benchmarks, run on the raw card.
+ */
+typedef enum
+{
+	USBD_PERF_BENCH_NONE = 0, /*!< No benchmark run since the boot or the clear */
+	USBD_PERF_BENCH_READ = 1, /*!< Sequential read */
+	USBD_PERF_BENCH_REWRITE = 2 /*!< Sequential write of the sectors read back: the data is kept */
+} usbd_perf_benchmark_t;
+
+/**
+ * @typedef usbd_perf_state_t
+ * This type define the state of the last benchmark.
+ */
+typedef enum
+{
+	USBD_PERF_STATE_IDLE = 0, /*!< No benchmark run */
+	USBD_PERF_STATE_RUNNING = 1, /*!< Queued to the main loop */
+	USBD_PERF_STATE_DONE = 2, /*!< Completed */
+	USBD_PERF_STATE_FAILED = 3 /*!< Stopped by a card error */
+} usbd_perf_state_t;
+
+/**
+ * @struct _usbd_perf_counters_t
+ * This type define the counters blob returned to the host. Every field is a
+ * little endian 32-bit word, new fields are appended and ui32Size grows.
+ */
+typedef struct _usbd_perf_counters_t
+{
+	uint32_t ui32Magic; /*!< USBD_PERF_MAGIC */
+	uint32_t ui32Version; /*!< USBD_PERF_VERSION */
+	uint32_t ui32Size; /*!< Size of the blob in byte unit */
+	uint32_t ui32TickMs; /*!< Device uptime */
+	/* SD data commands, from the command to the last data byte */
+	uint32_t ui32SdReadCommands; /*!< CMD17/CMD18 transactions sent */
+	uint32_t ui32SdReadBlocks;
+	uint32_t ui32SdReadTotalUs;
+	uint32_t ui32SdReadMaxUs;
+	uint32_t ui32SdWriteCommands; /*!< CMD24/CMD25 transactions sent */
+	uint32_t ui32SdWriteBlocks;
+	uint32_t ui32SdWriteTotalUs;
+	uint32_t ui32SdWriteMaxUs;
+	/* SD programming (busy) time and bus errors */
+	uint32_t ui32SdDeferredWrites;
+	uint32_t ui32SdBusyHiddenMs;
+	uint32_t ui32SdBusyStalledMs;
+	uint32_t ui32SdCrcReadErrors;
+	uint32_t ui32SdCrcWriteErrors;
+	uint32_t ui32SdCrcFailures;
+	/* Sector cache of the disk I/O layer, 0 if built without */
+	uint32_t ui32CacheMetaHits;
+	uint32_t ui32CacheMetaMisses;
+	uint32_t ui32CacheDataHits;
+	uint32_t ui32CacheDataMisses;
+	/* Block device arbitration, per priority: USB, background */
+	uint32_t pui32BlockdevServed[2];
+	uint32_t pui32BlockdevMaxWaitMs[2];
+	uint32_t ui32BlockdevHostWrites;
+	/* MSC endpoints left NAKing the host while the card works */
+	uint32_t ui32UsbInNakWindows; /*!< READ10: IN endpoint idle, no staging half read yet */
+	uint32_t ui32UsbInNakUs;
+	uint32_t ui32UsbOutNakWindows; /*!< WRITE10: OUT endpoint idle, both staging halves waiting for the card */
+	uint32_t ui32UsbOutNakUs;
+	/* Audio CODEC fed by the song player */
+	uint32_t ui32CodecChunks; /*!< 32-byte chunks sent */
+	uint32_t ui32CodecStalls; /*!< DREQ found requesting data with no chunk ready: the CODEC waited for the card */
+	/* Last benchmark */
+	uint32_t ui32BenchType; /*!< usbd_perf_benchmark_t */
+	uint32_t ui32BenchState; /*!< usbd_perf_state_t */
+	uint32_t ui32BenchSector; /*!< First sector */
+	uint32_t ui32BenchCount; /*!< Sectors transferred */
+	uint32_t ui32BenchUs; /*!< Card time: the read back of a rewrite is not counted */
+	uint32_t ui32BenchMaxChunkUs; /*!< Slowest transfer of one buffer (MSC staging buffer) */
+	/* USB speaker stream (usbd_audio.h), 0 in the mass storage build */
+	uint32_t ui32SpeakerPackets; /*!< Isochronous packets received */
+	uint32_t ui32SpeakerOverruns; /*!< Packets dropped on a full ring */
+	uint32_t ui32SpeakerUnderruns; /*!< Ring emptied while the CODEC asked for samples */
+	uint32_t ui32SpeakerFillLevel; /*!< Bytes in the ring after the last packet */
+	uint32_t ui32SpeakerFillMin;
+	uint32_t ui32SpeakerFillMax;
+	uint32_t ui32SpeakerFeedback; /*!< Last rate feedback, 10.14 sample frames per ms */
+	uint32_t ui32SpeakerHostRate; /*!< Sample frames received per second */
+	uint32_t ui32SpeakerSampleRate; /*!< Sampling frequency selected by the host in Hz */
+} usbd_perf_counters_t;
+
+/**
+ * @typedef usbd_perf_complete_t
+ * Benchmark completion callback, called from the main loop.
+ */
+typedef void (*usbd_perf_complete_t)(bool bSuccess);
+
+/**
+ * @typedef usbd_perf_owned_t
+ * Check that the benchmark buffer is still lent (command not reset by the host).
+ */
+typedef bool (*usbd_perf_owned_t)(void);
+
+/* Exported constants --------------------------------------------------------*/
+/* Command descriptor block, 10 bytes:
+ [0] USBD_PERF_OPCODE
+ [1] USBD_PERF_GET_COUNTERS: [2] USBD_PERF_CLEAR or 0, [7..8] allocation length
+     USBD_PERF_BENCHMARK: [2] usbd_perf_benchmark_t, [3..6] first sector,
+     [7..8] number of sectors, no data: the status follows the benchmark */
+#define USBD_PERF_OPCODE			(0xC0) /*!< First vendor specific operation code */
+#define USBD_PERF_CDB_LENGTH		(10)
+#define USBD_PERF_GET_COUNTERS		(0x00)
+#define USBD_PERF_BENCHMARK			(0x01)
+#define USBD_PERF_CLEAR				(0x01) /*!< Clear the counters once copied, but the CRC and block device ones (since boot) */
+
+/* The speaker build has no mass storage: the counters are read by a vendor
+ control request to the audio control interface, no benchmark.
+ bmRequestType USBD_PERF_REQUEST_TYPE, bRequest USBD_PERF_OPCODE,
+ wValue USBD_PERF_CLEAR or 0, wIndex 0, wLength allocation length */
+#define USBD_PERF_REQUEST_TYPE		(0xC1) /*!< Device to host, vendor, interface */
+
+#define USBD_PERF_MAGIC				(0x46524550) /*!< "PERF" */
+#define USBD_PERF_VERSION			(3)
+#define USBD_PERF_MAX_SECTORS		(8192) /*!< 4MB: the host waits for the status meanwhile */
+
+/* Exported macro ------------------------------------------------------------*/
+/* Exported functions --------------------------------------------------------*/
+uint16_t usbd_perf_getCounters(uint8_t *pui8Blob, uint16_t ui16Size,
+		bool bClear);
+bool usbd_perf_startBenchmark(usbd_perf_benchmark_t eType, uint8_t *pui8Buffer,
+		uint32_t ui32BufferSize, uint32_t ui32Sector, uint32_t ui32Count,
+		usbd_perf_owned_t pfnOwned, usbd_perf_complete_t pfnComplete);
+void usbd_perf_process(void);
+
+/**@}LIB_USBD_PERF*/
+#endif /* USBD_PERF_H_ */
+
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
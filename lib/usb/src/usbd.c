@@ -40,6 +40,11 @@
 #include "usbd_desc.h"
 #include "usbd_msc.h"
 #include "usbd_storage_if.h"
+#if USBD_AUDIO_ENABLE == 1
+#include "usbd_audio.h"
+#elif USBD_CDC_ENABLE == 1
+#include "usbd_composite.h"
+#endif /* USBD_AUDIO_ENABLE == 1 */
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
@@ -51,8 +56,21 @@ USBD_HandleTypeDef hUsbDeviceFS; /*!< USB Device Core handle declaration */
 /* Private function prototypes -----------------------------------------------*/
 
 /* Exported functions prototype ----------------------------------------------*/
+#if USBD_AUDIO_ENABLE == 1
 /**
- * @brief  Start the USBD in MSC mode
+ * @brief  Start the USBD in speaker mode, the card is not exported
+ * @retval None
+ */
+void usbd_startSpeakerDeviceMode(void)
+{
+	USBD_Init(&hUsbDeviceFS, &FS_Desc, DEVICE_FS);
+	USBD_RegisterClass(&hUsbDeviceFS, &USBD_AUDIO);
+	USBD_Start(&hUsbDeviceFS);
+}
+#else
+/**
+ * @brief  Start the USBD in MSC mode, composite with the CDC-ACM channel
+ *         when USBD_CDC_ENABLE is set
  * @retval None
  */
 void usbd_startMassStorageDeviceMode(void)
@@ -60,12 +78,27 @@ void usbd_startMassStorageDeviceMode(void)
 	/* Init Device Library,Add Supported Class and Start the library*/
 	USBD_Init(&hUsbDeviceFS, &FS_Desc, DEVICE_FS);
 
+#if USBD_CDC_ENABLE == 1
+	USBD_RegisterClass(&hUsbDeviceFS, &USBD_COMPOSITE);
+#else
 	USBD_RegisterClass(&hUsbDeviceFS, &USBD_MSC);
+#endif /* USBD_CDC_ENABLE == 1 */
 
 	USBD_MSC_RegisterStorage(&hUsbDeviceFS, &USBD_Storage_Interface_fops_FS);
 
 	USBD_Start(&hUsbDeviceFS);
 }
+#endif /* USBD_AUDIO_ENABLE == 1 */
+
+/**
+ * @brief  Report the card inserted or removed to the USB host.
+ *         Should be called from the main loop once the new card is initialized.
+ * @retval None
+ */
+void usbd_setMediumChanged(void)
+{
+	STORAGE_MediumChanged_FS();
+}
 
 /**@}LIB_USBD_PRIVATE*/
 /**@}LIB_USBD*/
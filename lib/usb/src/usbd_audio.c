@@ -0,0 +1,597 @@
+/**
+ ****************************************************************************
+ * @file        usbd_audio.c
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       This file implement the USB Audio Class 1 speaker function.
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/** @addtogroup LIB_USBD_AUDIO
+ * @{
+ */
+/** @defgroup LIB_USBD_AUDIO_PRIVATE USB Audio Speaker (Private)
+ * @{
+ *
+ * The host streams 16-bit stereo PCM at 44.1kHz or 48kHz on an isochronous
+ * OUT endpoint every millisecond. The samples are played by the VS1003 from its
+ * own crystal, so the speaker is asynchronous: the host clock and the CODEC
+ * clock drift apart and the feedback endpoint tells the host how many sample
+ * frames per millisecond to send. The feedback follows the fill level of the
+ * PCM ring, kept around its half: a ring filling up slows the host down.
+ *
+ * The packets are received in place in the ring, the USB interrupt never waits
+ * and never copies more than the bytes crossing the end of the ring. The main
+ * loop drains the ring to the CODEC by 32 bytes with usbd_audio_getData() and
+ * usbd_audio_releaseData().
+ *
+ * The speaker has no mass storage: the host reads the statistic with the
+ * counters of the performance probe by a vendor request to the control
+ * interface (usbd_perf.h). Linux lets usbfs send vendor requests to an
+ * interface bound to its audio driver.
+ */
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_audio.h"
+#include "usbd_core.h"
+#include "usbd_desc.h"
+
+#if USBD_AUDIO_ENABLE == 1
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+#if (0 != (AUDIO_RING_SIZE & (AUDIO_RING_SIZE - 1))) || (0 != (AUDIO_RING_SIZE % 32))
+#error "AUDIO_RING_SIZE must be a power of 2 and a multiple of the CODEC chunk"
+#endif
+
+#define AUDIO_RING_TARGET			(AUDIO_RING_SIZE / 2) /*!< Fill level the feedback keeps */
+#define AUDIO_FILL_SHIFT			(4) /*!< Low pass filter of the fill level: 1/16 per packet */
+#define AUDIO_FEEDBACK_RANGE		(8192) /*!< Largest correction: 1/2 sample frame per ms, 10.14 format */
+#define AUDIO_RATE_WINDOW			(1000) /*!< Packets of the host rate measurement: 1 second */
+
+/* Class requests of the endpoint */
+#define AUDIO_REQ_SET_CUR			(0x01)
+#define AUDIO_REQ_GET_CUR			(0x81)
+#define AUDIO_SAMPLING_FREQ_CONTROL	(0x01) /*!< Control selector, high byte of wValue */
+
+/* Private macro -------------------------------------------------------------*/
+#define AUDIO_ENTER_CRITICAL(ui32Primask)	do { (ui32Primask) = __get_PRIMASK(); __disable_irq(); } while (0)
+#define AUDIO_EXIT_CRITICAL(ui32Primask)	__set_PRIMASK(ui32Primask)
+
+/* Private variables ---------------------------------------------------------*/
+static usbd_audio_handle_t *g_pUsbdAudio = NULL; /*!< Speaker stream, NULL if not configured */
+static uint8_t g_ui8ControlAltSetting = 0; /*!< The control interface has the alternate setting 0 only */
+
+/* Private functions declaration ---------------------------------------------*/
+static uint8_t usbd_audio_init(USBD_HandleTypeDef *pdev, uint8_t ui8CfgIdx);
+static uint8_t usbd_audio_deInit(USBD_HandleTypeDef *pdev, uint8_t ui8CfgIdx);
+static uint8_t usbd_audio_setup(USBD_HandleTypeDef *pdev,
+		USBD_SetupReqTypedef *req);
+static uint8_t usbd_audio_ep0RxReady(USBD_HandleTypeDef *pdev);
+static uint8_t usbd_audio_dataIn(USBD_HandleTypeDef *pdev, uint8_t ui8EpNum);
+static uint8_t usbd_audio_dataOut(USBD_HandleTypeDef *pdev, uint8_t ui8EpNum);
+static uint8_t *usbd_audio_getConfigDescriptor(uint16_t *pui16Length);
+static void usbd_audio_startStream(USBD_HandleTypeDef *pdev);
+static void usbd_audio_receive(USBD_HandleTypeDef *pdev);
+static void usbd_audio_sendFeedback(USBD_HandleTypeDef *pdev);
+
+/**
+ * @brief  USB speaker class, registered alone in place of the mass storage.
+ */
+USBD_ClassTypeDef USBD_AUDIO =
+{ usbd_audio_init, usbd_audio_deInit, usbd_audio_setup, NULL, /* EP0_TxSent */
+usbd_audio_ep0RxReady, usbd_audio_dataIn, usbd_audio_dataOut, NULL, /* SOF */
+NULL, NULL, usbd_audio_getConfigDescriptor, usbd_audio_getConfigDescriptor,
+usbd_audio_getConfigDescriptor, NULL, /* Device qualifier: full speed only */
+};
+
+/* Private function prototypes -----------------------------------------------*/
+/**
+ * @brief  Allocate the stream once the host selected the configuration.
+ *         The endpoints are opened with the alternate setting 1.
+ * @param  pdev: device instance
+ * @param  ui8CfgIdx: configuration index
+ * @retval uint8_t: USBD_OK or USBD_FAIL
+ */
+static uint8_t usbd_audio_init(USBD_HandleTypeDef *pdev, uint8_t ui8CfgIdx)
+{
+	UNUSED(ui8CfgIdx);
+	pdev->pClassData = USBD_malloc(sizeof(usbd_audio_handle_t));
+	if (NULL == pdev->pClassData)
+	{
+		return USBD_FAIL;
+	}
+	memset(pdev->pClassData, 0, sizeof(usbd_audio_handle_t));
+	((usbd_audio_handle_t*) pdev->pClassData)->statistic.ui32SampleRate =
+			AUDIO_RATE_48K;
+	g_pUsbdAudio = (usbd_audio_handle_t*) pdev->pClassData;
+	return USBD_OK;
+}
+
+/**
+ * @brief  Stop the stream and close the endpoints.
+ * @param  pdev: device instance
+ * @param  ui8CfgIdx: configuration index
+ * @retval uint8_t: USBD_OK
+ */
+static uint8_t usbd_audio_deInit(USBD_HandleTypeDef *pdev, uint8_t ui8CfgIdx)
+{
+	UNUSED(ui8CfgIdx);
+	if ((NULL != g_pUsbdAudio) && (0 != g_pUsbdAudio->ui8AltSetting))
+	{
+		g_pUsbdAudio->bStreaming = false;
+		USBD_LL_CloseEP(pdev, AUDIO_OUT_EP);
+		USBD_LL_CloseEP(pdev, AUDIO_FEEDBACK_EP);
+	}
+	g_pUsbdAudio = NULL;
+	if (NULL != pdev->pClassData)
+	{
+		USBD_free(pdev->pClassData);
+		pdev->pClassData = NULL;
+	}
+	return USBD_OK;
+}
+
+/**
+ * @brief  Handle the alternate setting of the streaming interface, the
+ *         sampling frequency requests of the OUT endpoint and the performance
+ *         probe request of the control interface.
+ * @param  pdev: device instance
+ * @param  req: USB request
+ * @retval uint8_t: USBD_OK or USBD_FAIL
+ */
+static uint8_t usbd_audio_setup(USBD_HandleTypeDef *pdev,
+		USBD_SetupReqTypedef *req)
+{
+	usbd_audio_handle_t *pAudio = (usbd_audio_handle_t*) pdev->pClassData;
+	if (NULL == pAudio)
+	{
+		USBD_CtlError(pdev, req);
+		return USBD_FAIL;
+	}
+
+	switch (req->bmRequest & USB_REQ_TYPE_MASK)
+	{
+	case USB_REQ_TYPE_CLASS:
+		if ((USB_REQ_RECIPIENT_ENDPOINT
+				!= (req->bmRequest & USB_REQ_RECIPIENT_MASK))
+				|| (AUDIO_OUT_EP != LOBYTE(req->wIndex))
+				|| (AUDIO_SAMPLING_FREQ_CONTROL != HIBYTE(req->wValue))
+				|| (3 > req->wLength))
+		{
+			/* No feature unit: the host scales the volume itself */
+			USBD_CtlError(pdev, req);
+			return USBD_FAIL;
+		}
+		if (AUDIO_REQ_SET_CUR == req->bRequest)
+		{
+			pAudio->ui8ControlRequest = AUDIO_REQ_SET_CUR;
+			USBD_CtlPrepareRx(pdev, pAudio->pui8Control, 3);
+		}
+		else if (AUDIO_REQ_GET_CUR == req->bRequest)
+		{
+			pAudio->pui8Control[0] = (uint8_t) pAudio->statistic.ui32SampleRate;
+			pAudio->pui8Control[1] = (uint8_t) (pAudio->statistic.ui32SampleRate
+					>> 8);
+			pAudio->pui8Control[2] = (uint8_t) (pAudio->statistic.ui32SampleRate
+					>> 16);
+			USBD_CtlSendData(pdev, pAudio->pui8Control, 3);
+		}
+		else
+		{
+			USBD_CtlError(pdev, req);
+			return USBD_FAIL;
+		}
+		break;
+
+	case USB_REQ_TYPE_VENDOR:
+		if ((USBD_PERF_REQUEST_TYPE != req->bmRequest)
+				|| (USBD_PERF_OPCODE != req->bRequest)
+				|| (AUDIO_CONTROL_INTERFACE != LOBYTE(req->wIndex))
+				|| (0 == req->wLength))
+		{
+			USBD_CtlError(pdev, req);
+			return USBD_FAIL;
+		}
+		USBD_CtlSendData(pdev, (uint8_t*) pAudio->pui32Counters,
+				usbd_perf_getCounters((uint8_t*) pAudio->pui32Counters,
+						MIN(req->wLength, sizeof(pAudio->pui32Counters)),
+						0 != (LOBYTE(req->wValue) & USBD_PERF_CLEAR)));
+		break;
+
+	case USB_REQ_TYPE_STANDARD:
+		switch (req->bRequest)
+		{
+		case USB_REQ_GET_INTERFACE:
+			USBD_CtlSendData(pdev,
+					(AUDIO_STREAMING_INTERFACE == LOBYTE(req->wIndex)) ?
+							&pAudio->ui8AltSetting : &g_ui8ControlAltSetting, 1);
+			break;
+
+		case USB_REQ_SET_INTERFACE:
+			if (AUDIO_STREAMING_INTERFACE != LOBYTE(req->wIndex))
+			{
+				break;
+			}
+			if (1 < req->wValue)
+			{
+				USBD_CtlError(pdev, req);
+				return USBD_FAIL;
+			}
+			if (pAudio->ui8AltSetting == (uint8_t) req->wValue)
+			{
+				break;
+			}
+			pAudio->ui8AltSetting = (uint8_t) req->wValue;
+			if (0 != pAudio->ui8AltSetting)
+			{
+				USBD_LL_OpenEP(pdev, AUDIO_OUT_EP, USBD_EP_TYPE_ISOC,
+						AUDIO_OUT_PACKET_SIZE);
+				USBD_LL_OpenEP(pdev, AUDIO_FEEDBACK_EP, USBD_EP_TYPE_ISOC,
+						AUDIO_FEEDBACK_PACKET_SIZE);
+				usbd_audio_startStream(pdev);
+			}
+			else
+			{
+				/* The ring is left to the CODEC, it ends the song */
+				pAudio->bStreaming = false;
+				USBD_LL_CloseEP(pdev, AUDIO_OUT_EP);
+				USBD_LL_CloseEP(pdev, AUDIO_FEEDBACK_EP);
+			}
+			break;
+
+		default:
+			break;
+		}
+		break;
+
+	default:
+		break;
+	}
+	return USBD_OK;
+}
+
+/**
+ * @brief  Apply the sampling frequency sent by the host.
+ * @param  pdev: device instance
+ * @retval uint8_t: USBD_OK
+ */
+static uint8_t usbd_audio_ep0RxReady(USBD_HandleTypeDef *pdev)
+{
+	usbd_audio_handle_t *pAudio = (usbd_audio_handle_t*) pdev->pClassData;
+	uint32_t ui32SampleRate;
+	if ((NULL == pAudio) || (AUDIO_REQ_SET_CUR != pAudio->ui8ControlRequest))
+	{
+		return USBD_OK;
+	}
+	pAudio->ui8ControlRequest = 0;
+
+	ui32SampleRate = pAudio->pui8Control[0]
+			| ((uint32_t) pAudio->pui8Control[1] << 8)
+			| ((uint32_t) pAudio->pui8Control[2] << 16);
+	if (((AUDIO_RATE_44K1 != ui32SampleRate)
+			&& (AUDIO_RATE_48K != ui32SampleRate))
+			|| (pAudio->statistic.ui32SampleRate == ui32SampleRate))
+	{
+		/* The descriptor lists the discrete frequencies, others are ignored */
+		return USBD_OK;
+	}
+	pAudio->statistic.ui32SampleRate = ui32SampleRate;
+	if (pAudio->bStreaming)
+	{
+		/* The CODEC restarts on the new header */
+		usbd_audio_startStream(pdev);
+	}
+	return USBD_OK;
+}
+
+/**
+ * @brief  Load the next feedback once the host read the previous one.
+ * @param  pdev: device instance
+ * @param  ui8EpNum: endpoint index
+ * @retval uint8_t: USBD_OK
+ */
+static uint8_t usbd_audio_dataIn(USBD_HandleTypeDef *pdev, uint8_t ui8EpNum)
+{
+	if (((AUDIO_FEEDBACK_EP & 0x7F) == ui8EpNum) && (NULL != g_pUsbdAudio)
+			&& g_pUsbdAudio->bStreaming)
+	{
+		usbd_audio_sendFeedback(pdev);
+	}
+	return USBD_OK;
+}
+
+/**
+ * @brief  Commit the packet received in the ring and arm the next one.
+ * @param  pdev: device instance
+ * @param  ui8EpNum: endpoint index
+ * @retval uint8_t: USBD_OK
+ */
+static uint8_t usbd_audio_dataOut(USBD_HandleTypeDef *pdev, uint8_t ui8EpNum)
+{
+	usbd_audio_handle_t *pAudio = g_pUsbdAudio;
+	uint32_t ui32Size, ui32Offset, ui32Fill;
+	if ((AUDIO_OUT_EP != ui8EpNum) || (NULL == pAudio) || !pAudio->bStreaming)
+	{
+		return USBD_OK;
+	}
+
+	/* A sample frame is never split */
+	ui32Size = USBD_LL_GetRxDataSize(pdev, ui8EpNum) & ~(AUDIO_FRAME_SIZE - 1);
+	pAudio->statistic.ui32Packets++;
+	if (pAudio->bDropping)
+	{
+		pAudio->statistic.ui32Overruns++;
+	}
+	else
+	{
+		ui32Offset = pAudio->ui32Head & (AUDIO_RING_SIZE - 1);
+		if (AUDIO_RING_SIZE < (ui32Offset + ui32Size))
+		{
+			memcpy(pAudio->pui8Ring, &pAudio->pui8Ring[AUDIO_RING_SIZE],
+					ui32Offset + ui32Size - AUDIO_RING_SIZE);
+		}
+		pAudio->ui32Head += ui32Size;
+	}
+
+	/* Fill level after the packet: the CODEC drains between two packets */
+	ui32Fill = pAudio->ui32Head - pAudio->ui32Tail;
+	pAudio->statistic.ui32FillLevel = ui32Fill;
+	pAudio->ui32FillFiltered += ui32Fill
+			- (pAudio->ui32FillFiltered >> AUDIO_FILL_SHIFT);
+	if (!pAudio->bSettled && (AUDIO_RING_TARGET <= ui32Fill))
+	{
+		/* The extremes are tracked once the CODEC runs from a half full ring */
+		pAudio->bSettled = true;
+		pAudio->ui32FillFiltered = ui32Fill << AUDIO_FILL_SHIFT;
+		pAudio->statistic.ui32FillMin = ui32Fill;
+		pAudio->statistic.ui32FillMax = ui32Fill;
+	}
+	else if (pAudio->bSettled)
+	{
+		pAudio->statistic.ui32FillMin = MIN(pAudio->statistic.ui32FillMin,
+				ui32Fill - MIN(ui32Fill, ui32Size));
+		pAudio->statistic.ui32FillMax = MAX(pAudio->statistic.ui32FillMax,
+				ui32Fill);
+	}
+
+	pAudio->ui32RateBytes += ui32Size;
+	if (AUDIO_RATE_WINDOW <= ++pAudio->ui32RatePackets)
+	{
+		pAudio->statistic.ui32HostRate = pAudio->ui32RateBytes
+				/ AUDIO_FRAME_SIZE;
+		pAudio->ui32RateBytes = 0;
+		pAudio->ui32RatePackets = 0;
+	}
+
+	usbd_audio_receive(pdev);
+	return USBD_OK;
+}
+
+/**
+ * @brief  Returns the configuration descriptor of the speaker.
+ * @param  pui16Length: length of the descriptor
+ * @retval uint8_t*: Configuration descriptor
+ */
+static uint8_t *usbd_audio_getConfigDescriptor(uint16_t *pui16Length)
+{
+	return USBD_FS_SpeakerConfigDescriptor(pui16Length);
+}
+
+/**
+ * @brief  Start the stream from an empty ring at the selected frequency.
+ *         The CODEC waits for a half full ring before playing.
+ * @param  pdev: device instance
+ * @retval None
+ */
+static void usbd_audio_startStream(USBD_HandleTypeDef *pdev)
+{
+	usbd_audio_handle_t *pAudio = (usbd_audio_handle_t*) pdev->pClassData;
+	pAudio->bStreaming = false;
+	pAudio->ui32Head = 0;
+	pAudio->ui32Tail = 0;
+	pAudio->bBuffering = true;
+	pAudio->bSettled = false;
+	pAudio->ui32FillFiltered = AUDIO_RING_TARGET << AUDIO_FILL_SHIFT;
+	pAudio->ui32RateBytes = 0;
+	pAudio->ui32RatePackets = 0;
+	pAudio->ui32Generation++;
+	pAudio->bStreaming = true;
+	usbd_audio_receive(pdev);
+	usbd_audio_sendFeedback(pdev);
+}
+
+/**
+ * @brief  Arm the OUT endpoint at the head of the ring, or in the tail of the
+ *         ring to drop the packet when the ring has not room for it.
+ * @param  pdev: device instance
+ * @retval None
+ */
+static void usbd_audio_receive(USBD_HandleTypeDef *pdev)
+{
+	usbd_audio_handle_t *pAudio = g_pUsbdAudio;
+	pAudio->bDropping = ((AUDIO_RING_SIZE
+			- (pAudio->ui32Head - pAudio->ui32Tail)) < AUDIO_OUT_PACKET_SIZE);
+	USBD_LL_PrepareReceive(pdev, AUDIO_OUT_EP,
+			pAudio->bDropping ?
+					&pAudio->pui8Ring[AUDIO_RING_SIZE] :
+					&pAudio->pui8Ring[pAudio->ui32Head & (AUDIO_RING_SIZE - 1)],
+			AUDIO_OUT_PACKET_SIZE);
+}
+
+/**
+ * @brief  Load the rate feedback: the nominal sample frames per ms corrected
+ *         by the distance of the fill level to the half of the ring.
+ * @param  pdev: device instance
+ * @retval None
+ */
+static void usbd_audio_sendFeedback(USBD_HandleTypeDef *pdev)
+{
+	usbd_audio_handle_t *pAudio = g_pUsbdAudio;
+	/* 10.14 format: 1 sample frame = 16384, a frame of error = 64 (1/16 byte = 1) */
+	int32_t i32Correction = (int32_t) (AUDIO_RING_TARGET << AUDIO_FILL_SHIFT)
+			- (int32_t) pAudio->ui32FillFiltered;
+	uint32_t ui32Feedback;
+
+	if (AUDIO_FEEDBACK_RANGE < i32Correction)
+	{
+		i32Correction = AUDIO_FEEDBACK_RANGE;
+	}
+	else if (-AUDIO_FEEDBACK_RANGE > i32Correction)
+	{
+		i32Correction = -AUDIO_FEEDBACK_RANGE;
+	}
+	ui32Feedback = (uint32_t) ((int32_t) ((pAudio->statistic.ui32SampleRate
+			<< 14) / 1000) + i32Correction);
+
+	pAudio->statistic.ui32Feedback = ui32Feedback;
+	pAudio->pui8Feedback[0] = (uint8_t) ui32Feedback;
+	pAudio->pui8Feedback[1] = (uint8_t) (ui32Feedback >> 8);
+	pAudio->pui8Feedback[2] = (uint8_t) (ui32Feedback >> 16);
+	USBD_LL_Transmit(pdev, AUDIO_FEEDBACK_EP, pAudio->pui8Feedback,
+			AUDIO_FEEDBACK_PACKET_SIZE);
+}
+
+/* Exported functions prototype ----------------------------------------------*/
+/**
+ * @brief  Returns the stream selected by the host.
+ * @param  pui32SampleRate: sampling frequency in Hz
+ * @param  pui32Generation: incremented on each stream start or frequency
+ *         change: the CODEC is restarted when it changes
+ * @retval bool: The stream status
+ *			@arg true: The host streams
+ *			@arg false: Not configured or alternate setting 0
+ */
+bool usbd_audio_getStream(uint32_t *pui32SampleRate, uint32_t *pui32Generation)
+{
+	usbd_audio_handle_t *pAudio = g_pUsbdAudio;
+	if (NULL == pAudio)
+	{
+		return false;
+	}
+	*pui32SampleRate = pAudio->statistic.ui32SampleRate;
+	*pui32Generation = pAudio->ui32Generation;
+	return pAudio->bStreaming;
+}
+
+/**
+ * @brief  Returns the oldest PCM bytes of the ring, never waits.
+ *         Should be called from a single context (main loop).
+ * @param  ui32Size: number of bytes wanted, must divide AUDIO_RING_SIZE
+ * @retval const uint8_t*: ui32Size contiguous bytes, NULL if the ring has not
+ *         enough bytes or fills up again after an underrun
+ */
+const uint8_t *usbd_audio_getData(uint32_t ui32Size)
+{
+	usbd_audio_handle_t *pAudio = g_pUsbdAudio;
+	uint32_t ui32Fill;
+	if (NULL == pAudio)
+	{
+		return NULL;
+	}
+
+	ui32Fill = pAudio->ui32Head - pAudio->ui32Tail;
+	if (pAudio->bBuffering)
+	{
+		if ((AUDIO_RING_TARGET > ui32Fill) && pAudio->bStreaming)
+		{
+			return NULL;
+		}
+		pAudio->bBuffering = false;
+	}
+	if (ui32Size > ui32Fill)
+	{
+		if (pAudio->bStreaming)
+		{
+			/* The host paused or the CODEC drained faster than the feedback
+			 allows: the ring fills up to its half again */
+			pAudio->statistic.ui32Underruns++;
+			pAudio->bBuffering = true;
+		}
+		return NULL;
+	}
+	return &pAudio->pui8Ring[pAudio->ui32Tail & (AUDIO_RING_SIZE - 1)];
+}
+
+/**
+ * @brief  Release the bytes returned by usbd_audio_getData() to the USB interrupt.
+ * @param  ui32Size: number of bytes played
+ * @retval None
+ */
+void usbd_audio_releaseData(uint32_t ui32Size)
+{
+	usbd_audio_handle_t *pAudio = g_pUsbdAudio;
+	uint32_t ui32Primask;
+	if (NULL == pAudio)
+	{
+		return;
+	}
+	AUDIO_ENTER_CRITICAL(ui32Primask);
+	pAudio->ui32Tail += MIN(ui32Size, pAudio->ui32Head - pAudio->ui32Tail);
+	AUDIO_EXIT_CRITICAL(ui32Primask);
+}
+
+/**
+ * @brief  Returns the statistic of the speaker stream.
+ * @param  pStatistic: statistic copy
+ * @retval None
+ */
+void usbd_audio_getStatistic(usbd_audio_statistic_t *pStatistic)
+{
+	uint32_t ui32Primask;
+	if (NULL == g_pUsbdAudio)
+	{
+		memset(pStatistic, 0, sizeof(usbd_audio_statistic_t));
+		return;
+	}
+	AUDIO_ENTER_CRITICAL(ui32Primask);
+	*pStatistic = g_pUsbdAudio->statistic;
+	AUDIO_EXIT_CRITICAL(ui32Primask);
+}
+
+/**
+ * @brief  Clear the event counters of the speaker stream, the fill extremes
+ *         restart from the current fill level.
+ * @retval None
+ */
+void usbd_audio_resetStatistic(void)
+{
+	uint32_t ui32Primask;
+	if (NULL == g_pUsbdAudio)
+	{
+		return;
+	}
+	AUDIO_ENTER_CRITICAL(ui32Primask);
+	g_pUsbdAudio->statistic.ui32Packets = 0;
+	g_pUsbdAudio->statistic.ui32Overruns = 0;
+	g_pUsbdAudio->statistic.ui32Underruns = 0;
+	g_pUsbdAudio->statistic.ui32FillMin = g_pUsbdAudio->statistic.ui32FillLevel;
+	g_pUsbdAudio->statistic.ui32FillMax = g_pUsbdAudio->statistic.ui32FillLevel;
+	AUDIO_EXIT_CRITICAL(ui32Primask);
+}
+
+#endif /* USBD_AUDIO_ENABLE == 1 */
+
+/**@}LIB_USBD_AUDIO_PRIVATE*/
+/**@}LIB_USBD_AUDIO*/
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
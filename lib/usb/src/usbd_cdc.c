@@ -0,0 +1,427 @@
+/**
+ ****************************************************************************
+ * @file        usbd_cdc.c
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       This file implement the USB CDC-ACM telemetry/control channel.
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/** @addtogroup LIB_USBD_CDC
+ * @{
+ */
+/** @defgroup LIB_USBD_CDC_PRIVATE USB CDC-ACM Channel (Private)
+ * @{
+ *
+ * The CDC-ACM function of the composite device gives a serial channel for the
+ * performance counters, the trace dumps and the remote control while the card
+ * stays exported to the host by the mass storage function.
+ *
+ * usbd_cdc_write() never waits: a record is copied into the TX ring or dropped
+ * as a whole when the ring is full (host not reading). The endpoints belong to
+ * the USB interrupt: the writer and the reader only pend that interrupt, which
+ * starts the IN packet or arms the OUT packet in usbd_cdc_process(), so the PCD
+ * driver is never entered from two contexts.
+ */
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_cdc.h"
+#include "usbd_core.h"
+
+#if USBD_CDC_ENABLE == 1
+
+/* Private typedef -----------------------------------------------------------*/
+/**
+ * @struct _usbd_cdc_handle_t
+ * This type define the state of the CDC channel.
+ */
+typedef struct _usbd_cdc_handle_t
+{
+	USBD_HandleTypeDef *pDevice; /*!< Device of the configured channel, NULL if not configured */
+	uint8_t pui8TxRing[CDC_TX_RING_SIZE]; /*!< Telemetry waiting for the host */
+	volatile uint32_t ui32TxHead; /*!< Free running write index, advanced by usbd_cdc_write() */
+	volatile uint32_t ui32TxTail; /*!< Free running read index, advanced once the host got the packet */
+	uint32_t ui32TxLength; /*!< Length of the IN packet in flight */
+	volatile bool bTxBusy; /*!< An IN packet is armed */
+	uint8_t pui8RxRing[CDC_RX_RING_SIZE]; /*!< Commands waiting for usbd_cdc_read() */
+	volatile uint32_t ui32RxHead; /*!< Free running write index, advanced by the USB interrupt */
+	volatile uint32_t ui32RxTail; /*!< Free running read index, advanced by usbd_cdc_read() */
+	uint8_t pui8RxPacket[CDC_DATA_OUT_PACKET_SIZE]; /*!< Last OUT packet */
+	uint32_t ui32RxLength; /*!< Length of the OUT packet held */
+	volatile bool bRxHeld; /*!< OUT packet not copied yet: the host is NAKed until the RX ring has room */
+	uint8_t pui8LineCoding[7]; /*!< Line coding set by the host, meaningless for a USB channel */
+	uint8_t ui8AltSetting; /*!< Alternate setting of the interfaces, always 0 */
+	volatile bool bDtr; /*!< Terminal opened by the host (DTR) */
+	usbd_cdc_statistic_t statistic; /*!< Channel statistic */
+} usbd_cdc_handle_t;
+
+/* Private define ------------------------------------------------------------*/
+#if (0 != (CDC_TX_RING_SIZE & (CDC_TX_RING_SIZE - 1))) || (0 != (CDC_RX_RING_SIZE & (CDC_RX_RING_SIZE - 1)))
+#error "CDC_TX_RING_SIZE and CDC_RX_RING_SIZE must be powers of 2"
+#endif
+
+/* Class requests of the Abstract Control Model (PSTN) */
+#define CDC_SET_LINE_CODING			(0x20)
+#define CDC_GET_LINE_CODING			(0x21)
+#define CDC_SET_CONTROL_LINE_STATE	(0x22)
+#define CDC_SEND_BREAK				(0x23)
+#define CDC_CONTROL_LINE_DTR		(0x0001) /*!< SET_CONTROL_LINE_STATE: Data Terminal Ready */
+
+/* Private macro -------------------------------------------------------------*/
+#define CDC_ENTER_CRITICAL(ui32Primask)	do { (ui32Primask) = __get_PRIMASK(); __disable_irq(); } while (0)
+#define CDC_EXIT_CRITICAL(ui32Primask)	__set_PRIMASK(ui32Primask)
+
+/* Private variables ---------------------------------------------------------*/
+static usbd_cdc_handle_t g_usbdCdc =
+{ .pDevice = NULL, .pui8LineCoding =
+{ 0x00, 0xC2, 0x01, 0x00, 0x00, 0x00, 0x08 } }; /*!< CDC channel, 115200 8N1 until the host sets it */
+
+/* Private functions declaration ---------------------------------------------*/
+static uint8_t usbd_cdc_init(USBD_HandleTypeDef *pdev, uint8_t ui8CfgIdx);
+static uint8_t usbd_cdc_deInit(USBD_HandleTypeDef *pdev, uint8_t ui8CfgIdx);
+static uint8_t usbd_cdc_setup(USBD_HandleTypeDef *pdev,
+		USBD_SetupReqTypedef *req);
+static uint8_t usbd_cdc_dataIn(USBD_HandleTypeDef *pdev, uint8_t ui8EpNum);
+static uint8_t usbd_cdc_dataOut(USBD_HandleTypeDef *pdev, uint8_t ui8EpNum);
+static bool usbd_cdc_transmit(void);
+static void usbd_cdc_receive(void);
+
+/**
+ * @brief  CDC-ACM function, only registered through the composite class
+ *         which owns the configuration descriptor.
+ */
+USBD_ClassTypeDef USBD_CDC =
+{ usbd_cdc_init, usbd_cdc_deInit, usbd_cdc_setup, NULL, /* EP0_TxSent */
+NULL, /* EP0_RxReady: the line coding is only stored */
+usbd_cdc_dataIn, usbd_cdc_dataOut, NULL, /* SOF */
+NULL, NULL, NULL, NULL, NULL, NULL, };
+
+/* Private function prototypes -----------------------------------------------*/
+/**
+ * @brief  Open the CDC endpoints once the host selected the configuration.
+ * @param  pdev: device instance
+ * @param  ui8CfgIdx: configuration index
+ * @retval uint8_t: USBD_OK
+ */
+static uint8_t usbd_cdc_init(USBD_HandleTypeDef *pdev, uint8_t ui8CfgIdx)
+{
+	UNUSED(ui8CfgIdx);
+	USBD_LL_OpenEP(pdev, CDC_IN_EP, USBD_EP_TYPE_BULK, CDC_DATA_IN_PACKET_SIZE);
+	USBD_LL_OpenEP(pdev, CDC_OUT_EP, USBD_EP_TYPE_BULK,
+			CDC_DATA_OUT_PACKET_SIZE);
+	USBD_LL_OpenEP(pdev, CDC_CMD_EP, USBD_EP_TYPE_INTR, CDC_CMD_PACKET_SIZE);
+
+	/* The telemetry queued before the enumeration is kept, a packet lost
+	 by a bus reset is sent again */
+	g_usbdCdc.bTxBusy = false;
+	g_usbdCdc.bRxHeld = false;
+	g_usbdCdc.bDtr = false;
+	g_usbdCdc.pDevice = pdev;
+	USBD_LL_PrepareReceive(pdev, CDC_OUT_EP, g_usbdCdc.pui8RxPacket,
+			CDC_DATA_OUT_PACKET_SIZE);
+	usbd_cdc_transmit();
+	return USBD_OK;
+}
+
+/**
+ * @brief  Close the CDC endpoints.
+ * @param  pdev: device instance
+ * @param  ui8CfgIdx: configuration index
+ * @retval uint8_t: USBD_OK
+ */
+static uint8_t usbd_cdc_deInit(USBD_HandleTypeDef *pdev, uint8_t ui8CfgIdx)
+{
+	UNUSED(ui8CfgIdx);
+	g_usbdCdc.pDevice = NULL;
+	g_usbdCdc.bDtr = false;
+	USBD_LL_CloseEP(pdev, CDC_IN_EP);
+	USBD_LL_CloseEP(pdev, CDC_OUT_EP);
+	USBD_LL_CloseEP(pdev, CDC_CMD_EP);
+	return USBD_OK;
+}
+
+/**
+ * @brief  Handle the requests to the CDC interfaces.
+ * @param  pdev: device instance
+ * @param  req: USB request
+ * @retval uint8_t: USBD_OK or USBD_FAIL
+ */
+static uint8_t usbd_cdc_setup(USBD_HandleTypeDef *pdev,
+		USBD_SetupReqTypedef *req)
+{
+	switch (req->bmRequest & USB_REQ_TYPE_MASK)
+	{
+	case USB_REQ_TYPE_CLASS:
+		switch (req->bRequest)
+		{
+		case CDC_SET_LINE_CODING:
+			USBD_CtlPrepareRx(pdev, g_usbdCdc.pui8LineCoding,
+					MIN(req->wLength, sizeof(g_usbdCdc.pui8LineCoding)));
+			break;
+
+		case CDC_GET_LINE_CODING:
+			USBD_CtlSendData(pdev, g_usbdCdc.pui8LineCoding,
+					MIN(req->wLength, sizeof(g_usbdCdc.pui8LineCoding)));
+			break;
+
+		case CDC_SET_CONTROL_LINE_STATE:
+			g_usbdCdc.bDtr = (0 != (req->wValue & CDC_CONTROL_LINE_DTR));
+			break;
+
+		case CDC_SEND_BREAK:
+			break;
+
+		default:
+			USBD_CtlError(pdev, req);
+			return USBD_FAIL;
+		}
+		break;
+
+	case USB_REQ_TYPE_STANDARD:
+		switch (req->bRequest)
+		{
+		case USB_REQ_GET_INTERFACE:
+			USBD_CtlSendData(pdev, &g_usbdCdc.ui8AltSetting, 1);
+			break;
+
+		default:
+			/* SET_INTERFACE: only the alternate setting 0 exists,
+			 CLEAR_FEATURE: the stall is already cleared by the core */
+			break;
+		}
+		break;
+
+	default:
+		break;
+	}
+	return USBD_OK;
+}
+
+/**
+ * @brief  Release the IN packet received by the host and send the next one.
+ * @param  pdev: device instance
+ * @param  ui8EpNum: endpoint index
+ * @retval uint8_t: USBD_OK
+ */
+static uint8_t usbd_cdc_dataIn(USBD_HandleTypeDef *pdev, uint8_t ui8EpNum)
+{
+	bool bFullPacket;
+	if ((CDC_IN_EP & 0x7F) != ui8EpNum)
+	{
+		return USBD_OK;
+	}
+
+	g_usbdCdc.statistic.ui32TxPackets++;
+	g_usbdCdc.statistic.ui32TxBytes += g_usbdCdc.ui32TxLength;
+	bFullPacket = (CDC_DATA_IN_PACKET_SIZE == g_usbdCdc.ui32TxLength);
+	g_usbdCdc.ui32TxTail += g_usbdCdc.ui32TxLength;
+	g_usbdCdc.bTxBusy = false;
+	if (!usbd_cdc_transmit() && bFullPacket)
+	{
+		/* The host completes its read on a short packet */
+		g_usbdCdc.ui32TxLength = 0;
+		g_usbdCdc.bTxBusy = true;
+		USBD_LL_Transmit(pdev, CDC_IN_EP, g_usbdCdc.pui8TxRing, 0);
+	}
+	return USBD_OK;
+}
+
+/**
+ * @brief  Store the OUT packet sent by the host.
+ * @param  pdev: device instance
+ * @param  ui8EpNum: endpoint index
+ * @retval uint8_t: USBD_OK
+ */
+static uint8_t usbd_cdc_dataOut(USBD_HandleTypeDef *pdev, uint8_t ui8EpNum)
+{
+	if (CDC_OUT_EP != ui8EpNum)
+	{
+		return USBD_OK;
+	}
+	g_usbdCdc.ui32RxLength = USBD_LL_GetRxDataSize(pdev, ui8EpNum);
+	g_usbdCdc.bRxHeld = true;
+	usbd_cdc_receive();
+	return USBD_OK;
+}
+
+/**
+ * @brief  Start the IN packet of the oldest bytes of the TX ring.
+ *         Called from the USB interrupt only.
+ * @retval bool: A packet is started
+ */
+static bool usbd_cdc_transmit(void)
+{
+	uint32_t ui32Pending = g_usbdCdc.ui32TxHead - g_usbdCdc.ui32TxTail;
+	uint32_t ui32Offset = g_usbdCdc.ui32TxTail & (CDC_TX_RING_SIZE - 1);
+	if (g_usbdCdc.bTxBusy || (NULL == g_usbdCdc.pDevice) || (0 == ui32Pending))
+	{
+		return false;
+	}
+
+	/* The ring is sent in place: its tail is released once the host got the packet */
+	g_usbdCdc.ui32TxLength = MIN(MIN(ui32Pending, CDC_TX_RING_SIZE - ui32Offset),
+			CDC_DATA_IN_PACKET_SIZE);
+	g_usbdCdc.bTxBusy = true;
+	USBD_LL_Transmit(g_usbdCdc.pDevice, CDC_IN_EP,
+			&g_usbdCdc.pui8TxRing[ui32Offset], g_usbdCdc.ui32TxLength);
+	return true;
+}
+
+/**
+ * @brief  Copy the OUT packet held into the RX ring and arm the next one.
+ *         Called from the USB interrupt only.
+ * @retval None
+ */
+static void usbd_cdc_receive(void)
+{
+	uint32_t i;
+	if (!g_usbdCdc.bRxHeld || (NULL == g_usbdCdc.pDevice)
+			|| ((CDC_RX_RING_SIZE
+					- (g_usbdCdc.ui32RxHead - g_usbdCdc.ui32RxTail))
+					< g_usbdCdc.ui32RxLength))
+	{
+		/* The OUT endpoint stays NAKed until usbd_cdc_read() makes room */
+		return;
+	}
+
+	for (i = 0; i < g_usbdCdc.ui32RxLength; i++)
+	{
+		g_usbdCdc.pui8RxRing[(g_usbdCdc.ui32RxHead + i) & (CDC_RX_RING_SIZE - 1)] =
+				g_usbdCdc.pui8RxPacket[i];
+	}
+	g_usbdCdc.ui32RxHead += g_usbdCdc.ui32RxLength;
+	g_usbdCdc.statistic.ui32RxBytes += g_usbdCdc.ui32RxLength;
+	g_usbdCdc.bRxHeld = false;
+	USBD_LL_PrepareReceive(g_usbdCdc.pDevice, CDC_OUT_EP,
+			g_usbdCdc.pui8RxPacket, CDC_DATA_OUT_PACKET_SIZE);
+}
+
+/* Exported functions prototype ----------------------------------------------*/
+/**
+ * @brief  Queue a record to the host, never waits.
+ *         Callable from any context, the transfer is started by the USB interrupt.
+ * @param  pui8Data: record to send
+ * @param  ui32Size: size of the record in byte unit
+ * @retval bool: The record status
+ *			@arg true: Queued
+ *			@arg false: Dropped, the TX ring has not enough room
+ */
+bool usbd_cdc_write(const uint8_t *pui8Data, uint32_t ui32Size)
+{
+	uint32_t ui32Primask, ui32Offset, ui32Span;
+
+	CDC_ENTER_CRITICAL(ui32Primask);
+	if ((CDC_TX_RING_SIZE - (g_usbdCdc.ui32TxHead - g_usbdCdc.ui32TxTail))
+			< ui32Size)
+	{
+		g_usbdCdc.statistic.ui32TxDropped += ui32Size;
+		CDC_EXIT_CRITICAL(ui32Primask);
+		return false;
+	}
+	ui32Offset = g_usbdCdc.ui32TxHead & (CDC_TX_RING_SIZE - 1);
+	ui32Span = MIN(ui32Size, CDC_TX_RING_SIZE - ui32Offset);
+	memcpy(&g_usbdCdc.pui8TxRing[ui32Offset], pui8Data, ui32Span);
+	memcpy(g_usbdCdc.pui8TxRing, &pui8Data[ui32Span], ui32Size - ui32Span);
+	g_usbdCdc.ui32TxHead += ui32Size;
+	CDC_EXIT_CRITICAL(ui32Primask);
+
+	if (!g_usbdCdc.bTxBusy)
+	{
+		HAL_NVIC_SetPendingIRQ(USB_LP_CAN1_RX0_IRQn);
+	}
+	return true;
+}
+
+/**
+ * @brief  Returns the room left in the TX ring, a record up to this size is
+ *         queued by the next usbd_cdc_write() of the same context.
+ * @retval uint32_t: Free bytes of the TX ring
+ */
+uint32_t usbd_cdc_getTxRoom(void)
+{
+	return CDC_TX_RING_SIZE - (g_usbdCdc.ui32TxHead - g_usbdCdc.ui32TxTail);
+}
+
+/**
+ * @brief  Read the bytes received from the host, never waits.
+ *         Should be called from a single context (main loop).
+ * @param  pui8Data: buffer of the bytes read
+ * @param  ui32Size: size of the buffer in byte unit
+ * @retval uint32_t: Number of bytes read
+ */
+uint32_t usbd_cdc_read(uint8_t *pui8Data, uint32_t ui32Size)
+{
+	uint32_t ui32Count = MIN(ui32Size,
+			g_usbdCdc.ui32RxHead - g_usbdCdc.ui32RxTail);
+	uint32_t i;
+	for (i = 0; i < ui32Count; i++)
+	{
+		pui8Data[i] = g_usbdCdc.pui8RxRing[(g_usbdCdc.ui32RxTail + i)
+				& (CDC_RX_RING_SIZE - 1)];
+	}
+	g_usbdCdc.ui32RxTail += ui32Count;
+
+	if (g_usbdCdc.bRxHeld)
+	{
+		HAL_NVIC_SetPendingIRQ(USB_LP_CAN1_RX0_IRQn);
+	}
+	return ui32Count;
+}
+
+/**
+ * @brief  Returns the terminal status of the host.
+ * @retval bool: The channel status
+ *			@arg true: Configured and opened by a terminal (DTR set)
+ *			@arg false: Nobody reads the channel
+ */
+bool usbd_cdc_isConnected(void)
+{
+	return ((NULL != g_usbdCdc.pDevice) && g_usbdCdc.bDtr);
+}
+
+/**
+ * @brief  Start the transfers requested by usbd_cdc_write() and usbd_cdc_read().
+ *         Must be called from the USB interrupt handler.
+ * @retval None
+ */
+void usbd_cdc_process(void)
+{
+	usbd_cdc_transmit();
+	usbd_cdc_receive();
+}
+
+/**
+ * @brief  Get the statistic of the CDC channel.
+ * @param  pStatistic: pointer to the statistic output structure.
+ * @retval None
+ */
+void usbd_cdc_getStatistic(usbd_cdc_statistic_t *pStatistic)
+{
+	*pStatistic = g_usbdCdc.statistic;
+}
+
+#endif /* USBD_CDC_ENABLE == 1 */
+
+/**@}LIB_USBD_CDC_PRIVATE*/
+/**@}LIB_USBD_CDC*/
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
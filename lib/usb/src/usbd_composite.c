@@ -0,0 +1,215 @@
+/**
+ ****************************************************************************
+ * @file        usbd_composite.c
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       This file implement the USB composite (MSC + CDC-ACM) class.
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/** @addtogroup LIB_USBD_COMPOSITE
+ * @{
+ */
+/** @defgroup LIB_USBD_COMPOSITE_PRIVATE USB Composite Class (Private)
+ * @{
+ *
+ * The core drives a single class: this one forwards each event to the mass
+ * storage class (interface 0, endpoints MSC_EPIN_ADDR/MSC_EPOUT_ADDR) or to the
+ * CDC-ACM class (interfaces 1 and 2, endpoints CDC_*_EP). The MSC class keeps
+ * the class data and the user data of the device handle for itself, the CDC
+ * class holds its state statically.
+ */
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_composite.h"
+#include "usbd_desc.h"
+#include "usbd_msc.h"
+#include "usbd_cdc.h"
+
+#if USBD_CDC_ENABLE == 1
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+#define COMPOSITE_IS_CDC_EP(ui8EpNum)	(((CDC_IN_EP & 0x7F) == (ui8EpNum)) \
+		|| ((CDC_OUT_EP & 0x7F) == (ui8EpNum)) || ((CDC_CMD_EP & 0x7F) == (ui8EpNum)))
+
+/* Private variables ---------------------------------------------------------*/
+/* Private functions declaration ---------------------------------------------*/
+static uint8_t usbd_composite_init(USBD_HandleTypeDef *pdev, uint8_t ui8CfgIdx);
+static uint8_t usbd_composite_deInit(USBD_HandleTypeDef *pdev,
+		uint8_t ui8CfgIdx);
+static uint8_t usbd_composite_setup(USBD_HandleTypeDef *pdev,
+		USBD_SetupReqTypedef *req);
+static uint8_t usbd_composite_ep0RxReady(USBD_HandleTypeDef *pdev);
+static uint8_t usbd_composite_dataIn(USBD_HandleTypeDef *pdev,
+		uint8_t ui8EpNum);
+static uint8_t usbd_composite_dataOut(USBD_HandleTypeDef *pdev,
+		uint8_t ui8EpNum);
+static uint8_t *usbd_composite_getConfigDescriptor(uint16_t *pui16Length);
+static uint8_t *usbd_composite_getDeviceQualifierDescriptor(
+		uint16_t *pui16Length);
+
+USBD_ClassTypeDef USBD_COMPOSITE =
+{ usbd_composite_init, usbd_composite_deInit, usbd_composite_setup, NULL, /* EP0_TxSent */
+usbd_composite_ep0RxReady, usbd_composite_dataIn, usbd_composite_dataOut, NULL, /* SOF */
+NULL, NULL, usbd_composite_getConfigDescriptor,
+		usbd_composite_getConfigDescriptor, usbd_composite_getConfigDescriptor,
+		usbd_composite_getDeviceQualifierDescriptor, };
+
+/* Private function prototypes -----------------------------------------------*/
+/**
+ * @brief  Initialize both functions once the host selected the configuration.
+ * @param  pdev: device instance
+ * @param  ui8CfgIdx: configuration index
+ * @retval uint8_t: USBD_OK or USBD_FAIL
+ */
+static uint8_t usbd_composite_init(USBD_HandleTypeDef *pdev, uint8_t ui8CfgIdx)
+{
+	if (USBD_OK != USBD_CDC.Init(pdev, ui8CfgIdx))
+	{
+		return USBD_FAIL;
+	}
+	return USBD_MSC.Init(pdev, ui8CfgIdx);
+}
+
+/**
+ * @brief  De-initialize both functions.
+ * @param  pdev: device instance
+ * @param  ui8CfgIdx: configuration index
+ * @retval uint8_t: USBD_OK
+ */
+static uint8_t usbd_composite_deInit(USBD_HandleTypeDef *pdev,
+		uint8_t ui8CfgIdx)
+{
+	USBD_CDC.DeInit(pdev, ui8CfgIdx);
+	return USBD_MSC.DeInit(pdev, ui8CfgIdx);
+}
+
+/**
+ * @brief  Forward a request to the function owning its interface or endpoint.
+ * @param  pdev: device instance
+ * @param  req: USB request
+ * @retval uint8_t: Status of the function
+ */
+static uint8_t usbd_composite_setup(USBD_HandleTypeDef *pdev,
+		USBD_SetupReqTypedef *req)
+{
+	switch (req->bmRequest & USB_REQ_RECIPIENT_MASK)
+	{
+	case USB_REQ_RECIPIENT_INTERFACE:
+		if ((CDC_COMM_INTERFACE == LOBYTE(req->wIndex))
+				|| (CDC_DATA_INTERFACE == LOBYTE(req->wIndex)))
+		{
+			return USBD_CDC.Setup(pdev, req);
+		}
+		break;
+
+	case USB_REQ_RECIPIENT_ENDPOINT:
+		if (COMPOSITE_IS_CDC_EP(LOBYTE(req->wIndex) & 0x7F))
+		{
+			return USBD_CDC.Setup(pdev, req);
+		}
+		break;
+
+	default:
+		break;
+	}
+	return USBD_MSC.Setup(pdev, req);
+}
+
+/**
+ * @brief  Forward the data stage of a control write: only the CDC function
+ *         receives some (SET_LINE_CODING).
+ * @param  pdev: device instance
+ * @retval uint8_t: USBD_OK
+ */
+static uint8_t usbd_composite_ep0RxReady(USBD_HandleTypeDef *pdev)
+{
+	if (NULL != USBD_CDC.EP0_RxReady)
+	{
+		return USBD_CDC.EP0_RxReady(pdev);
+	}
+	return USBD_OK;
+}
+
+/**
+ * @brief  Forward an IN transfer completion to the function owning the endpoint.
+ * @param  pdev: device instance
+ * @param  ui8EpNum: endpoint index
+ * @retval uint8_t: Status of the function
+ */
+static uint8_t usbd_composite_dataIn(USBD_HandleTypeDef *pdev,
+		uint8_t ui8EpNum)
+{
+	if (COMPOSITE_IS_CDC_EP(ui8EpNum))
+	{
+		return USBD_CDC.DataIn(pdev, ui8EpNum);
+	}
+	return USBD_MSC.DataIn(pdev, ui8EpNum);
+}
+
+/**
+ * @brief  Forward an OUT transfer completion to the function owning the endpoint.
+ * @param  pdev: device instance
+ * @param  ui8EpNum: endpoint index
+ * @retval uint8_t: Status of the function
+ */
+static uint8_t usbd_composite_dataOut(USBD_HandleTypeDef *pdev,
+		uint8_t ui8EpNum)
+{
+	if (COMPOSITE_IS_CDC_EP(ui8EpNum))
+	{
+		return USBD_CDC.DataOut(pdev, ui8EpNum);
+	}
+	return USBD_MSC.DataOut(pdev, ui8EpNum);
+}
+
+/**
+ * @brief  Returns the configuration descriptor of both functions.
+ *         The device is full speed only: the same descriptor for every speed.
+ * @param  pui16Length: pointer to the descriptor length
+ * @retval uint8_t*: pointer to the descriptor
+ */
+static uint8_t *usbd_composite_getConfigDescriptor(uint16_t *pui16Length)
+{
+	return USBD_FS_CompositeConfigDescriptor(pui16Length);
+}
+
+/**
+ * @brief  Returns the device qualifier descriptor, never requested from a
+ *         full speed device.
+ * @param  pui16Length: pointer to the descriptor length
+ * @retval uint8_t*: pointer to the descriptor
+ */
+static uint8_t *usbd_composite_getDeviceQualifierDescriptor(
+		uint16_t *pui16Length)
+{
+	return USBD_MSC.GetDeviceQualifierDescriptor(pui16Length);
+}
+
+#endif /* USBD_CDC_ENABLE == 1 */
+
+/**@}LIB_USBD_COMPOSITE_PRIVATE*/
+/**@}LIB_USBD_COMPOSITE*/
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
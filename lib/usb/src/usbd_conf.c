@@ -37,10 +37,51 @@
 #include "usbd_def.h"
 #include "usbd_core.h"
 #include "usbd_msc.h"
+#include "usbd_cdc.h"
+#include "usbd_audio.h"
 #include "led.h"
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
+#define PMA_SIZE			(512) /*!< Packet memory of the USB FS peripheral */
+#if USBD_AUDIO_ENABLE == 1
+#define PMA_BTABLE_SIZE		(0x18) /*!< Buffer descriptors of EP0 to EP2 */
+#define PMA_EP0_OUT_ADDR	(PMA_BTABLE_SIZE)
+#define PMA_EP0_IN_ADDR		(PMA_EP0_OUT_ADDR + USB_MAX_EP0_SIZE)
+/* An isochronous endpoint always uses both buffers */
+#define PMA_AUDIO_OUT_ADDR	(PMA_EP0_IN_ADDR + USB_MAX_EP0_SIZE)
+#define PMA_AUDIO_FB_ADDR	(PMA_AUDIO_OUT_ADDR + (2 * AUDIO_OUT_PACKET_SIZE))
+#define PMA_AUDIO_FB_SIZE	(4) /*!< Feedback buffer rounded to a PMA word */
+#define PMA_END_ADDR		(PMA_AUDIO_FB_ADDR + (2 * PMA_AUDIO_FB_SIZE))
+#else
+#if USBD_CDC_ENABLE == 1
+#define PMA_BTABLE_SIZE		(0x28) /*!< Buffer descriptors of EP0 to EP4 */
+#else
+#define PMA_BTABLE_SIZE		(0x18) /*!< Buffer descriptors of EP0 to EP2 */
+#endif /* USBD_CDC_ENABLE == 1 */
+#define PMA_EP0_OUT_ADDR	(PMA_BTABLE_SIZE)
+#define PMA_EP0_IN_ADDR		(PMA_EP0_OUT_ADDR + USB_MAX_EP0_SIZE)
+#define PMA_MSC_IN_ADDR		(PMA_EP0_IN_ADDR + USB_MAX_EP0_SIZE)
+#if USBD_MSC_DBL_BUF == 1
+#define PMA_MSC_OUT_ADDR	(PMA_MSC_IN_ADDR + (2 * MSC_MAX_FS_PACKET))
+#define PMA_MSC_END_ADDR	(PMA_MSC_OUT_ADDR + (2 * MSC_MAX_FS_PACKET))
+#else
+#define PMA_MSC_OUT_ADDR	(PMA_MSC_IN_ADDR + MSC_MAX_FS_PACKET)
+#define PMA_MSC_END_ADDR	(PMA_MSC_OUT_ADDR + MSC_MAX_FS_PACKET)
+#endif /* USBD_MSC_DBL_BUF == 1 */
+#if USBD_CDC_ENABLE == 1
+#define PMA_CDC_CMD_ADDR	(PMA_MSC_END_ADDR)
+#define PMA_CDC_IN_ADDR		(PMA_CDC_CMD_ADDR + CDC_CMD_PACKET_SIZE)
+#define PMA_CDC_OUT_ADDR	(PMA_CDC_IN_ADDR + CDC_DATA_IN_PACKET_SIZE)
+#define PMA_END_ADDR		(PMA_CDC_OUT_ADDR + CDC_DATA_OUT_PACKET_SIZE)
+#else
+#define PMA_END_ADDR		(PMA_MSC_END_ADDR)
+#endif /* USBD_CDC_ENABLE == 1 */
+#endif /* USBD_AUDIO_ENABLE == 1 */
+
+#if PMA_END_ADDR > PMA_SIZE
+#error "The endpoint buffers do not fit in the PMA"
+#endif
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
 PCD_HandleTypeDef hpcd_USB_FS;
@@ -256,6 +297,10 @@ void USB_LP_CAN1_RX0_IRQHandler(void)
 	/* USER CODE END USB_LP_CAN1_RX0_IRQn 0 */
 	HAL_PCD_IRQHandler(&hpcd_USB_FS);
 	/* USER CODE BEGIN USB_LP_CAN1_RX0_IRQn 1 */
+#if USBD_CDC_ENABLE == 1
+	/* usbd_cdc_write()/usbd_cdc_read() pend this interrupt to start a transfer */
+	usbd_cdc_process();
+#endif /* USBD_CDC_ENABLE == 1 */
 
 	/* USER CODE END USB_LP_CAN1_RX0_IRQn 1 */
 }
@@ -287,14 +332,36 @@ USBD_StatusTypeDef USBD_LL_Init(USBD_HandleTypeDef *pdev)
 		while (1);
 	}
 
+	/* PMA (512 bytes): the buffer table is followed by the packet buffers */
 	HAL_PCDEx_PMAConfig((PCD_HandleTypeDef*) pdev->pData, 0x00, PCD_SNG_BUF,
-			0x18);
+			PMA_EP0_OUT_ADDR);
 	HAL_PCDEx_PMAConfig((PCD_HandleTypeDef*) pdev->pData, 0x80, PCD_SNG_BUF,
-			0x58);
-	HAL_PCDEx_PMAConfig((PCD_HandleTypeDef*) pdev->pData, 0x81, PCD_SNG_BUF,
-			0x98);
-	HAL_PCDEx_PMAConfig((PCD_HandleTypeDef*) pdev->pData, 0x01, PCD_SNG_BUF,
-			0xD8);
+			PMA_EP0_IN_ADDR);
+#if USBD_AUDIO_ENABLE == 1
+	HAL_PCDEx_PMAConfig((PCD_HandleTypeDef*) pdev->pData, AUDIO_OUT_EP,
+			PCD_DBL_BUF, PMA_AUDIO_OUT_ADDR | ((PMA_AUDIO_OUT_ADDR + AUDIO_OUT_PACKET_SIZE) << 16));
+	HAL_PCDEx_PMAConfig((PCD_HandleTypeDef*) pdev->pData, AUDIO_FEEDBACK_EP,
+			PCD_DBL_BUF, PMA_AUDIO_FB_ADDR | ((PMA_AUDIO_FB_ADDR + PMA_AUDIO_FB_SIZE) << 16));
+#elif USBD_MSC_DBL_BUF == 1
+	/* The host transfers a packet while the other buffer is copied */
+	HAL_PCDEx_PMAConfig((PCD_HandleTypeDef*) pdev->pData, MSC_EPIN_ADDR,
+			PCD_DBL_BUF, PMA_MSC_IN_ADDR | ((PMA_MSC_IN_ADDR + MSC_MAX_FS_PACKET) << 16));
+	HAL_PCDEx_PMAConfig((PCD_HandleTypeDef*) pdev->pData, MSC_EPOUT_ADDR,
+			PCD_DBL_BUF, PMA_MSC_OUT_ADDR | ((PMA_MSC_OUT_ADDR + MSC_MAX_FS_PACKET) << 16));
+#else
+	HAL_PCDEx_PMAConfig((PCD_HandleTypeDef*) pdev->pData, MSC_EPIN_ADDR,
+			PCD_SNG_BUF, PMA_MSC_IN_ADDR);
+	HAL_PCDEx_PMAConfig((PCD_HandleTypeDef*) pdev->pData, MSC_EPOUT_ADDR,
+			PCD_SNG_BUF, PMA_MSC_OUT_ADDR);
+#endif /* USBD_MSC_DBL_BUF == 1 */
+#if USBD_CDC_ENABLE == 1
+	HAL_PCDEx_PMAConfig((PCD_HandleTypeDef*) pdev->pData, CDC_CMD_EP,
+			PCD_SNG_BUF, PMA_CDC_CMD_ADDR);
+	HAL_PCDEx_PMAConfig((PCD_HandleTypeDef*) pdev->pData, CDC_IN_EP,
+			PCD_SNG_BUF, PMA_CDC_IN_ADDR);
+	HAL_PCDEx_PMAConfig((PCD_HandleTypeDef*) pdev->pData, CDC_OUT_EP,
+			PCD_SNG_BUF, PMA_CDC_OUT_ADDR);
+#endif /* USBD_CDC_ENABLE == 1 */
 	return USBD_OK;
 }
 
@@ -486,8 +553,17 @@ void USBD_LL_Delay(uint32_t Delay)
  */
 void *USBD_static_malloc(uint32_t size)
 {
-	UNUSED(size);
+#if USBD_AUDIO_ENABLE == 1
+	/* Sized for the speaker handle, which holds the PCM ring */
+	static uint32_t mem[(sizeof(usbd_audio_handle_t) / 4) + 1];/* On 32-bit boundary */
+#else
+	/* Sized for the MSC handle, which holds the MSC_STAGING_SIZE halves */
 	static uint32_t mem[(sizeof(USBD_MSC_BOT_HandleTypeDef) / 4) + 1];/* On 32-bit boundary */
+#endif /* USBD_AUDIO_ENABLE == 1 */
+	if (size > sizeof(mem))
+	{
+		return NULL;
+	}
 	return mem;
 }
 
@@ -0,0 +1,478 @@
+/**
+ ****************************************************************************
+ * @file        usbd_console.c
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       This file implement the console of the CDC-ACM channel.
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/** @addtogroup LIB_USBD_CONSOLE
+ * @{
+ */
+/** @defgroup LIB_USBD_CONSOLE_PRIVATE USB Console (Private)
+ * @{
+ *
+ * Line commands sent by a terminal on the CDC-ACM channel, served from the
+ * main loop while the card stays exported by the mass storage function:
+ *   stat         print the counters of the performance probe (usbd_perf.h)
+ *                and of the channel, one "name value" line each
+ *   clear        clear the counters, as the vendor SCSI command does
+ *   trace MS|off print a trace record every MS milliseconds: the counters
+ *                of the storage path gained since the previous record
+ *   help         print the commands
+ *
+ * The output goes through the TX ring of usbd_cdc_write() and never waits:
+ * the stat lines are written as the ring drains, a trace record is dropped
+ * (and counted by the channel) when the host does not read.
+ */
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_console.h"
+#include "usbd_cdc.h"
+#include "usbd_perf.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if USBD_CDC_ENABLE == 1
+
+/* Private typedef -----------------------------------------------------------*/
+/**
+ * @struct _console_snapshot_t
+ * This type define the counters printed by the stat command.
+ */
+typedef struct _console_snapshot_t
+{
+	usbd_perf_counters_t perf; /*!< Performance probe */
+	usbd_cdc_statistic_t cdc; /*!< CDC-ACM channel */
+} console_snapshot_t;
+
+/**
+ * @struct _console_field_t
+ * This type define a counter printed by the console.
+ */
+typedef struct _console_field_t
+{
+	const char *pcName;
+	uint16_t ui16Offset; /*!< Offset of the 32-bit counter in its structure */
+} console_field_t;
+
+/**
+ * @struct _usbd_console_handle_t
+ * This type define the state of the console.
+ */
+typedef struct _usbd_console_handle_t
+{
+	char pcLine[CONSOLE_LINE_SIZE + 1]; /*!< Command line received, NUL terminated */
+	uint32_t ui32LineLength; /*!< Characters received in the line */
+	bool bLineOverflow; /*!< Line too long: dropped up to its end */
+	bool bConnected; /*!< Terminal opened at the last call */
+	console_snapshot_t snapshot; /*!< Counters printed by the stat command */
+	uint32_t ui32DumpField; /*!< Next stat line, CONSOLE_DUMP_IDLE if none */
+	uint32_t ui32TracePeriodMs; /*!< Trace period, 0 if the trace is off */
+	uint32_t ui32TraceTick; /*!< HAL tick of the last trace record */
+	uint32_t pui32TraceLast[CONSOLE_TRACE_FIELDS]; /*!< Counters of the last trace record */
+} usbd_console_handle_t;
+
+/* Private define ------------------------------------------------------------*/
+#define CONSOLE_OUTPUT_SIZE		(48) /*!< Longest "name value" line */
+#define CONSOLE_TRACE_SIZE		(192) /*!< Longest trace record */
+#define CONSOLE_DUMP_IDLE		(0xFFFFFFFF) /*!< No stat lines left to print */
+#define CONSOLE_READ_CHUNK		(16) /*!< Bytes read from the channel at once */
+
+/* Private macro -------------------------------------------------------------*/
+#define CONSOLE_FIELD(group, member)	{ #member, offsetof(console_snapshot_t, group.member) }
+#define CONSOLE_TRACE(name, member)		{ name, offsetof(usbd_perf_counters_t, member) }
+#define CONSOLE_COUNTER(pBase, ui16Offset)	(*(const uint32_t *) ((const uint8_t *) (pBase) + (ui16Offset)))
+#define CONSOLE_COUNT_OF(pArray)		(sizeof(pArray) / sizeof((pArray)[0]))
+
+/* Private variables ---------------------------------------------------------*/
+static const console_field_t g_pConsoleFields[] =
+{
+CONSOLE_FIELD(perf, ui32TickMs),
+CONSOLE_FIELD(perf, ui32SdReadCommands),
+CONSOLE_FIELD(perf, ui32SdReadBlocks),
+CONSOLE_FIELD(perf, ui32SdReadTotalUs),
+CONSOLE_FIELD(perf, ui32SdReadMaxUs),
+CONSOLE_FIELD(perf, ui32SdWriteCommands),
+CONSOLE_FIELD(perf, ui32SdWriteBlocks),
+CONSOLE_FIELD(perf, ui32SdWriteTotalUs),
+CONSOLE_FIELD(perf, ui32SdWriteMaxUs),
+CONSOLE_FIELD(perf, ui32SdDeferredWrites),
+CONSOLE_FIELD(perf, ui32SdBusyHiddenMs),
+CONSOLE_FIELD(perf, ui32SdBusyStalledMs),
+CONSOLE_FIELD(perf, ui32SdCrcReadErrors),
+CONSOLE_FIELD(perf, ui32SdCrcWriteErrors),
+CONSOLE_FIELD(perf, ui32SdCrcFailures),
+CONSOLE_FIELD(perf, ui32CacheMetaHits),
+CONSOLE_FIELD(perf, ui32CacheMetaMisses),
+CONSOLE_FIELD(perf, ui32CacheDataHits),
+CONSOLE_FIELD(perf, ui32CacheDataMisses),
+CONSOLE_FIELD(perf, pui32BlockdevServed[0]),
+CONSOLE_FIELD(perf, pui32BlockdevServed[1]),
+CONSOLE_FIELD(perf, pui32BlockdevMaxWaitMs[0]),
+CONSOLE_FIELD(perf, pui32BlockdevMaxWaitMs[1]),
+CONSOLE_FIELD(perf, ui32BlockdevHostWrites),
+CONSOLE_FIELD(perf, ui32UsbInNakWindows),
+CONSOLE_FIELD(perf, ui32UsbInNakUs),
+CONSOLE_FIELD(perf, ui32UsbOutNakWindows),
+CONSOLE_FIELD(perf, ui32UsbOutNakUs),
+CONSOLE_FIELD(perf, ui32CodecChunks),
+CONSOLE_FIELD(perf, ui32CodecStalls),
+CONSOLE_FIELD(perf, ui32BenchType),
+CONSOLE_FIELD(perf, ui32BenchState),
+CONSOLE_FIELD(perf, ui32BenchSector),
+CONSOLE_FIELD(perf, ui32BenchCount),
+CONSOLE_FIELD(perf, ui32BenchUs),
+CONSOLE_FIELD(perf, ui32BenchMaxChunkUs),
+CONSOLE_FIELD(cdc, ui32TxBytes),
+CONSOLE_FIELD(cdc, ui32TxDropped),
+CONSOLE_FIELD(cdc, ui32TxPackets),
+CONSOLE_FIELD(cdc, ui32RxBytes), }; /*!< Lines of the stat command */
+
+static const console_field_t g_pConsoleTraceFields[CONSOLE_TRACE_FIELDS] =
+{
+CONSOLE_TRACE("rd", ui32SdReadBlocks),
+CONSOLE_TRACE("wr", ui32SdWriteBlocks),
+CONSOLE_TRACE("hit", ui32CacheDataHits),
+CONSOLE_TRACE("miss", ui32CacheDataMisses),
+CONSOLE_TRACE("usb", pui32BlockdevServed[0]),
+CONSOLE_TRACE("innak", ui32UsbInNakUs),
+CONSOLE_TRACE("outnak", ui32UsbOutNakUs),
+CONSOLE_TRACE("stall", ui32CodecStalls), }; /*!< Counters of a trace record, as gained since the previous one */
+
+static usbd_console_handle_t g_usbdConsole =
+{ .ui32DumpField = CONSOLE_DUMP_IDLE }; /*!< Console of the CDC-ACM channel */
+
+/* Private functions declaration ---------------------------------------------*/
+static char *usbd_console_formatNumber(char *pcText, uint32_t ui32Value);
+static char *usbd_console_formatText(char *pcText, const char *pcSource);
+static void usbd_console_print(const char *pcText);
+static void usbd_console_getCounters(usbd_perf_counters_t *pCounters,
+		bool bClear);
+static void usbd_console_startTrace(const usbd_perf_counters_t *pCounters);
+static void usbd_console_execute(char *pcLine);
+static void usbd_console_dump(void);
+static void usbd_console_trace(void);
+
+/* Private function prototypes -----------------------------------------------*/
+/**
+ * @brief  Write a number in decimal.
+ * @param  pcText: output, 10 characters at most, not terminated.
+ * @param  ui32Value: number to write.
+ * @retval char*: end of the number written
+ */
+static char *usbd_console_formatNumber(char *pcText, uint32_t ui32Value)
+{
+	char pcDigits[10];
+	uint32_t ui32Count = 0;
+
+	do
+	{
+		pcDigits[ui32Count++] = (char) ('0' + (ui32Value % 10));
+		ui32Value /= 10;
+	} while (0 != ui32Value);
+	while (0 != ui32Count)
+	{
+		*pcText++ = pcDigits[--ui32Count];
+	}
+	return pcText;
+}
+
+/**
+ * @brief  Copy a text without its terminator.
+ * @param  pcText: output.
+ * @param  pcSource: NUL terminated text.
+ * @retval char*: end of the text written
+ */
+static char *usbd_console_formatText(char *pcText, const char *pcSource)
+{
+	while ('\0' != *pcSource)
+	{
+		*pcText++ = *pcSource++;
+	}
+	return pcText;
+}
+
+/**
+ * @brief  Queue a reply to the terminal, dropped if the host does not read.
+ * 			Nothing is queued while the terminal is closed.
+ * @param  pcText: NUL terminated reply.
+ * @retval None
+ */
+static void usbd_console_print(const char *pcText)
+{
+	if (g_usbdConsole.bConnected)
+	{
+		usbd_cdc_write((const uint8_t *) pcText, strlen(pcText));
+	}
+}
+
+/**
+ * @brief  Copy the counters of the performance probe.
+ * @note   The USB interrupt is masked: the probe copies its counters for the
+ * 			vendor SCSI command from the interrupt, and clears them in place.
+ * @param  pCounters: counters output.
+ * @param  bClear: clear the counters once copied.
+ * @retval None
+ */
+static void usbd_console_getCounters(usbd_perf_counters_t *pCounters,
+		bool bClear)
+{
+	HAL_NVIC_DisableIRQ(USB_LP_CAN1_RX0_IRQn);
+	usbd_perf_getCounters((uint8_t *) pCounters, sizeof(usbd_perf_counters_t),
+			bClear);
+	HAL_NVIC_EnableIRQ(USB_LP_CAN1_RX0_IRQn);
+}
+
+/**
+ * @brief  Take the counters as the base of the next trace record.
+ * @param  pCounters: current counters, NULL once cleared.
+ * @retval None
+ */
+static void usbd_console_startTrace(const usbd_perf_counters_t *pCounters)
+{
+	uint32_t i;
+	for (i = 0; i < CONSOLE_TRACE_FIELDS; i++)
+	{
+		g_usbdConsole.pui32TraceLast[i] = (NULL == pCounters) ? (0) :
+				(CONSOLE_COUNTER(pCounters, g_pConsoleTraceFields[i].ui16Offset));
+	}
+	g_usbdConsole.ui32TraceTick = HAL_GetTick();
+}
+
+/**
+ * @brief  Run a command line.
+ * @param  pcLine: NUL terminated line, without its terminator.
+ * @retval None
+ */
+static void usbd_console_execute(char *pcLine)
+{
+	usbd_perf_counters_t counters;
+	char *pcEnd;
+	uint32_t ui32PeriodMs;
+
+	if ('\0' == pcLine[0])
+	{
+		return;
+	}
+	if (0 == strcmp(pcLine, "stat"))
+	{
+		usbd_console_getCounters(&g_usbdConsole.snapshot.perf, false);
+		usbd_cdc_getStatistic(&g_usbdConsole.snapshot.cdc);
+		g_usbdConsole.ui32DumpField = 0;
+	}
+	else if (0 == strcmp(pcLine, "clear"))
+	{
+		usbd_console_getCounters(&counters, true);
+		usbd_console_startTrace(NULL);
+		usbd_console_print("cleared\r\n");
+	}
+	else if (0 == strcmp(pcLine, "trace off"))
+	{
+		g_usbdConsole.ui32TracePeriodMs = 0;
+		usbd_console_print("trace off\r\n");
+	}
+	else if (0 == strncmp(pcLine, "trace ", 6))
+	{
+		ui32PeriodMs = strtoul(&pcLine[6], &pcEnd, 10);
+		if ((pcEnd == &pcLine[6]) || ('\0' != *pcEnd))
+		{
+			usbd_console_print("usage: trace MS|off\r\n");
+			return;
+		}
+		if (ui32PeriodMs < CONSOLE_TRACE_MIN_MS)
+		{
+			ui32PeriodMs = CONSOLE_TRACE_MIN_MS;
+		}
+		usbd_console_getCounters(&counters, false);
+		usbd_console_startTrace(&counters);
+		g_usbdConsole.ui32TracePeriodMs = ui32PeriodMs;
+		usbd_console_print("trace on\r\n");
+	}
+	else if (0 == strcmp(pcLine, "help"))
+	{
+		usbd_console_print("commands: stat, clear, trace MS|off, help\r\n");
+	}
+	else
+	{
+		usbd_console_print("unknown command, try help\r\n");
+	}
+}
+
+/**
+ * @brief  Print the stat lines which fit in the TX ring.
+ * @retval None
+ */
+static void usbd_console_dump(void)
+{
+	const console_field_t *pField;
+	char pcOutput[CONSOLE_OUTPUT_SIZE];
+	char *pcText;
+	uint32_t ui32Length;
+
+	while (CONSOLE_COUNT_OF(g_pConsoleFields) > g_usbdConsole.ui32DumpField)
+	{
+		pField = &g_pConsoleFields[g_usbdConsole.ui32DumpField];
+		pcText = usbd_console_formatText(pcOutput, pField->pcName);
+		*pcText++ = ' ';
+		pcText = usbd_console_formatNumber(pcText,
+				CONSOLE_COUNTER(&g_usbdConsole.snapshot, pField->ui16Offset));
+		*pcText++ = '\r';
+		*pcText++ = '\n';
+		ui32Length = pcText - pcOutput;
+		if (usbd_cdc_getTxRoom() < ui32Length)
+		{
+			/* Continued once the host read the ring */
+			return;
+		}
+		usbd_cdc_write((const uint8_t *) pcOutput, ui32Length);
+		g_usbdConsole.ui32DumpField++;
+	}
+	g_usbdConsole.ui32DumpField = CONSOLE_DUMP_IDLE;
+}
+
+/**
+ * @brief  Print a trace record once its period elapsed:
+ * 			"T tick rd=N wr=N hit=N miss=N usb=N innak=N outnak=N stall=N drop=N",
+ * 			drop is the number of bytes dropped by the channel since the boot.
+ * @retval None
+ */
+static void usbd_console_trace(void)
+{
+	usbd_perf_counters_t counters;
+	usbd_cdc_statistic_t cdc;
+	char pcOutput[CONSOLE_TRACE_SIZE];
+	char *pcText = pcOutput;
+	uint32_t ui32Value;
+	uint32_t i;
+
+	uint32_t ui32Elapsed = HAL_GetTick() - g_usbdConsole.ui32TraceTick;
+
+	if ((0 == g_usbdConsole.ui32TracePeriodMs)
+			|| (ui32Elapsed < g_usbdConsole.ui32TracePeriodMs))
+	{
+		return;
+	}
+	/* Keep the period, but restart after a terminal closed for a while */
+	g_usbdConsole.ui32TraceTick =
+			(ui32Elapsed < (2 * g_usbdConsole.ui32TracePeriodMs)) ?
+					(g_usbdConsole.ui32TraceTick + g_usbdConsole.ui32TracePeriodMs) :
+					(HAL_GetTick());
+	usbd_console_getCounters(&counters, false);
+	usbd_cdc_getStatistic(&cdc);
+
+	*pcText++ = 'T';
+	*pcText++ = ' ';
+	pcText = usbd_console_formatNumber(pcText, counters.ui32TickMs);
+	for (i = 0; i < CONSOLE_TRACE_FIELDS; i++)
+	{
+		ui32Value = CONSOLE_COUNTER(&counters,
+				g_pConsoleTraceFields[i].ui16Offset);
+		*pcText++ = ' ';
+		pcText = usbd_console_formatText(pcText, g_pConsoleTraceFields[i].pcName);
+		*pcText++ = '=';
+		/* Cleared meanwhile by the vendor SCSI command: counted from 0 */
+		pcText = usbd_console_formatNumber(pcText,
+				(ui32Value >= g_usbdConsole.pui32TraceLast[i]) ?
+						(ui32Value - g_usbdConsole.pui32TraceLast[i]) : (ui32Value));
+		g_usbdConsole.pui32TraceLast[i] = ui32Value;
+	}
+	pcText = usbd_console_formatText(pcText, " drop=");
+	pcText = usbd_console_formatNumber(pcText, cdc.ui32TxDropped);
+	*pcText++ = '\r';
+	*pcText++ = '\n';
+	usbd_cdc_write((const uint8_t *) pcOutput, pcText - pcOutput);
+}
+
+/* Exported functions prototype ----------------------------------------------*/
+/**
+ * @brief  Serve the console: run the commands received, print the pending
+ * 			stat lines and the trace record. Called from the main loop.
+ * @retval None
+ */
+void usbd_console_process(void)
+{
+	uint8_t pui8Received[CONSOLE_READ_CHUNK];
+	uint32_t ui32Count;
+	uint32_t i;
+	char cReceived;
+	bool bConnected = usbd_cdc_isConnected();
+
+	if (bConnected != g_usbdConsole.bConnected)
+	{
+		/* A new terminal gets the commands, a closed one no stat lines */
+		g_usbdConsole.bConnected = bConnected;
+		g_usbdConsole.ui32DumpField = CONSOLE_DUMP_IDLE;
+		if (bConnected)
+		{
+			usbd_console_print("Project Moon console, commands: stat, clear, trace MS|off, help\r\n");
+		}
+	}
+
+	while (0 != (ui32Count = usbd_cdc_read(pui8Received, sizeof(pui8Received))))
+	{
+		for (i = 0; i < ui32Count; i++)
+		{
+			cReceived = (char) pui8Received[i];
+			if (('\r' == cReceived) || ('\n' == cReceived))
+			{
+				g_usbdConsole.pcLine[g_usbdConsole.ui32LineLength] = '\0';
+				if (g_usbdConsole.bLineOverflow)
+				{
+					usbd_console_print("line too long\r\n");
+				}
+				else
+				{
+					usbd_console_execute(g_usbdConsole.pcLine);
+				}
+				g_usbdConsole.ui32LineLength = 0;
+				g_usbdConsole.bLineOverflow = false;
+			}
+			else if (CONSOLE_LINE_SIZE > g_usbdConsole.ui32LineLength)
+			{
+				g_usbdConsole.pcLine[g_usbdConsole.ui32LineLength++] = cReceived;
+			}
+			else
+			{
+				g_usbdConsole.bLineOverflow = true;
+			}
+		}
+	}
+
+	if (bConnected)
+	{
+		if (CONSOLE_DUMP_IDLE != g_usbdConsole.ui32DumpField)
+		{
+			usbd_console_dump();
+		}
+		usbd_console_trace();
+	}
+}
+
+#endif /* USBD_CDC_ENABLE == 1 */
+
+/**@}LIB_USBD_CONSOLE_PRIVATE*/
+/**@}LIB_USBD_CONSOLE*/
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
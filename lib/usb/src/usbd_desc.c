@@ -36,6 +36,12 @@
 #include "usbd_core.h"
 #include "usbd_desc.h"
 #include "usbd_conf.h"
+#if USBD_AUDIO_ENABLE == 1
+#include "usbd_audio.h"
+#elif USBD_CDC_ENABLE == 1
+#include "usbd_msc.h"
+#include "usbd_cdc.h"
+#endif /* USBD_AUDIO_ENABLE == 1 */
 
 /** @addtogroup STM32_USB_OTG_DEVICE_LIBRARY
  * @{
@@ -59,11 +65,36 @@
 #define USBD_VID     1155
 #define USBD_LANGID_STRING     1033
 #define USBD_MANUFACTURER_STRING     	((uint8_t*)"STMicroelectronics")
+#if USBD_AUDIO_ENABLE == 1
+#define USBD_PID_FS     22316 /* Neither the MSC nor the composite PID: another driver binding */
+#define USBD_DEVICE_CLASS     0x00 /* Defined by the interface */
+#define USBD_DEVICE_SUBCLASS     0x00
+#define USBD_DEVICE_PROTOCOL     0x00
+#elif USBD_CDC_ENABLE == 1
+#define USBD_PID_FS     22315 /* Not the MSC only PID: the host must not reuse its driver binding */
+#define USBD_DEVICE_CLASS     0xEF /* Miscellaneous: the functions are described by an IAD */
+#define USBD_DEVICE_SUBCLASS     0x02
+#define USBD_DEVICE_PROTOCOL     0x01
+#else
 #define USBD_PID_FS     22314
+#define USBD_DEVICE_CLASS     0x00 /* Defined by the interface */
+#define USBD_DEVICE_SUBCLASS     0x00
+#define USBD_DEVICE_PROTOCOL     0x00
+#endif /* USBD_AUDIO_ENABLE == 1 */
+#if USBD_AUDIO_ENABLE == 1
+#define USBD_PRODUCT_STRING_FS     		((uint8_t*)"STM32 Speaker")
+#define USBD_CONFIGURATION_STRING_FS    ((uint8_t*)"Speaker Config")
+#define USBD_INTERFACE_STRING_FS     	((uint8_t*)"Speaker Interface")
+#else
 #define USBD_PRODUCT_STRING_FS     		((uint8_t*)"STM32 Mass Storage")
-#define USBD_SERIALNUMBER_STRING_FS     ((uint8_t*)"00000000001A")
 #define USBD_CONFIGURATION_STRING_FS    ((uint8_t*)"MSC Config")
 #define USBD_INTERFACE_STRING_FS     	((uint8_t*)"MSC Interface")
+#endif /* USBD_AUDIO_ENABLE == 1 */
+#define USBD_SERIALNUMBER_STRING_FS     ((uint8_t*)"00000000001A")
+
+#define USBD_COMPOSITE_CONFIG_DESC_SIZ     98 /* Configuration, MSC (23), IAD (8), CDC-ACM (58) */
+#define USBD_SPEAKER_CONFIG_DESC_SIZ     112 /* Configuration, control (39), streaming (64) */
+#define USBD_SPEAKER_AC_DESC_SIZ     30 /* Class specific control descriptors: header and terminals */
 
 /* USER CODE BEGIN 0 */
 
@@ -111,9 +142,9 @@ __ALIGN_BEGIN uint8_t USBD_FS_DeviceDesc[USB_LEN_DEV_DESC] __ALIGN_END =
 { 0x12, /*bLength */
 USB_DESC_TYPE_DEVICE, /*bDescriptorType*/
 0x00, /* bcdUSB */
-0x02, 0x00, /*bDeviceClass*/
-0x00, /*bDeviceSubClass*/
-0x00, /*bDeviceProtocol*/
+0x02, USBD_DEVICE_CLASS, /*bDeviceClass*/
+USBD_DEVICE_SUBCLASS, /*bDeviceSubClass*/
+USBD_DEVICE_PROTOCOL, /*bDeviceProtocol*/
 USB_MAX_EP0_SIZE, /*bMaxPacketSize*/
 LOBYTE(USBD_VID), /*idVendor*/
 HIBYTE(USBD_VID), /*idVendor*/
@@ -142,6 +173,242 @@ USB_DESC_TYPE_STRING, LOBYTE(USBD_LANGID_STRING), HIBYTE(USBD_LANGID_STRING), };
 #pragma data_alignment=4
 #endif
 __ALIGN_BEGIN uint8_t USBD_StrDesc[USBD_MAX_STR_DESC_SIZ] __ALIGN_END;
+
+#if USBD_AUDIO_ENABLE == 1
+#if defined ( __ICCARM__ ) /*!< IAR Compiler */
+#pragma data_alignment=4
+#endif
+/* USB Speaker Configuration Descriptor: UAC1, asynchronous isochronous OUT with explicit feedback */
+__ALIGN_BEGIN uint8_t USBD_FS_SpeakerCfgDesc[USBD_SPEAKER_CONFIG_DESC_SIZ] __ALIGN_END =
+{ 0x09, /*bLength: Configuration Descriptor size*/
+USB_DESC_TYPE_CONFIGURATION, /*bDescriptorType: Configuration*/
+LOBYTE(USBD_SPEAKER_CONFIG_DESC_SIZ), /*wTotalLength*/
+HIBYTE(USBD_SPEAKER_CONFIG_DESC_SIZ), 0x02, /*bNumInterfaces: 2 interfaces*/
+0x01, /*bConfigurationValue*/
+USBD_IDX_CONFIG_STR, /*iConfiguration*/
+0xC0, /*bmAttributes: self powered*/
+0x32, /*MaxPower 100 mA*/
+
+/******************** Audio Control interface ********************/
+0x09, /*bLength: Interface Descriptor size*/
+USB_DESC_TYPE_INTERFACE, /*bDescriptorType*/
+AUDIO_CONTROL_INTERFACE, /*bInterfaceNumber*/
+0x00, /*bAlternateSetting*/
+0x00, /*bNumEndpoints*/
+0x01, /*bInterfaceClass: Audio*/
+0x01, /*bInterfaceSubClass: Audio Control*/
+0x00, /*bInterfaceProtocol*/
+USBD_IDX_INTERFACE_STR, /*iInterface*/
+
+0x09, /*bLength*/
+0x24, /*bDescriptorType: CS_INTERFACE*/
+0x01, /*bDescriptorSubtype: Header*/
+0x00, 0x01, /*bcdADC: 1.00*/
+LOBYTE(USBD_SPEAKER_AC_DESC_SIZ), /*wTotalLength*/
+HIBYTE(USBD_SPEAKER_AC_DESC_SIZ), 0x01, /*bInCollection: 1 streaming interface*/
+AUDIO_STREAMING_INTERFACE, /*baInterfaceNr*/
+
+0x0C, /*bLength*/
+0x24, /*bDescriptorType: CS_INTERFACE*/
+0x02, /*bDescriptorSubtype: Input Terminal*/
+0x01, /*bTerminalID*/
+0x01, 0x01, /*wTerminalType: USB streaming*/
+0x00, /*bAssocTerminal*/
+0x02, /*bNrChannels*/
+0x03, 0x00, /*wChannelConfig: left front, right front*/
+0x00, /*iChannelNames*/
+0x00, /*iTerminal*/
+
+0x09, /*bLength*/
+0x24, /*bDescriptorType: CS_INTERFACE*/
+0x03, /*bDescriptorSubtype: Output Terminal*/
+0x03, /*bTerminalID*/
+0x01, 0x03, /*wTerminalType: speaker*/
+0x00, /*bAssocTerminal*/
+0x01, /*bSourceID: the input terminal, no feature unit*/
+0x00, /*iTerminal*/
+
+/******************** Audio Streaming interface ********************/
+0x09, /*bLength: Interface Descriptor size*/
+USB_DESC_TYPE_INTERFACE, /*bDescriptorType*/
+AUDIO_STREAMING_INTERFACE, /*bInterfaceNumber*/
+0x00, /*bAlternateSetting: zero bandwidth*/
+0x00, /*bNumEndpoints*/
+0x01, /*bInterfaceClass: Audio*/
+0x02, /*bInterfaceSubClass: Audio Streaming*/
+0x00, /*bInterfaceProtocol*/
+0x00, /*iInterface*/
+
+0x09, /*bLength: Interface Descriptor size*/
+USB_DESC_TYPE_INTERFACE, /*bDescriptorType*/
+AUDIO_STREAMING_INTERFACE, /*bInterfaceNumber*/
+0x01, /*bAlternateSetting: streaming*/
+0x02, /*bNumEndpoints: samples and feedback*/
+0x01, /*bInterfaceClass: Audio*/
+0x02, /*bInterfaceSubClass: Audio Streaming*/
+0x00, /*bInterfaceProtocol*/
+0x00, /*iInterface*/
+
+0x07, /*bLength*/
+0x24, /*bDescriptorType: CS_INTERFACE*/
+0x01, /*bDescriptorSubtype: General*/
+0x01, /*bTerminalLink: the input terminal*/
+0x01, /*bDelay: 1 ms*/
+0x01, 0x00, /*wFormatTag: PCM*/
+
+0x0E, /*bLength*/
+0x24, /*bDescriptorType: CS_INTERFACE*/
+0x02, /*bDescriptorSubtype: Format Type*/
+0x01, /*bFormatType: Type I*/
+0x02, /*bNrChannels*/
+0x02, /*bSubFrameSize: 2 bytes*/
+0x10, /*bBitResolution: 16 bits*/
+0x02, /*bSamFreqType: 2 discrete frequencies*/
+LOBYTE(AUDIO_RATE_44K1), HIBYTE(AUDIO_RATE_44K1), (uint8_t) (AUDIO_RATE_44K1 >> 16), /*tSamFreq*/
+LOBYTE(AUDIO_RATE_48K), HIBYTE(AUDIO_RATE_48K), (uint8_t) (AUDIO_RATE_48K >> 16),
+
+0x09, /*bLength: Audio Endpoint Descriptor size*/
+USB_DESC_TYPE_ENDPOINT, /*bDescriptorType*/
+AUDIO_OUT_EP, /*bEndpointAddress*/
+0x05, /*bmAttributes: Isochronous, asynchronous*/
+LOBYTE(AUDIO_OUT_PACKET_SIZE), /*wMaxPacketSize*/
+HIBYTE(AUDIO_OUT_PACKET_SIZE), 0x01, /*bInterval: 1 ms*/
+0x00, /*bRefresh*/
+AUDIO_FEEDBACK_EP, /*bSynchAddress*/
+
+0x07, /*bLength*/
+0x25, /*bDescriptorType: CS_ENDPOINT*/
+0x01, /*bDescriptorSubtype: General*/
+0x01, /*bmAttributes: sampling frequency control*/
+0x00, /*bLockDelayUnits*/
+0x00, 0x00, /*wLockDelay*/
+
+0x09, /*bLength: Audio Endpoint Descriptor size*/
+USB_DESC_TYPE_ENDPOINT, /*bDescriptorType*/
+AUDIO_FEEDBACK_EP, /*bEndpointAddress*/
+0x11, /*bmAttributes: Isochronous, feedback*/
+LOBYTE(AUDIO_FEEDBACK_PACKET_SIZE), /*wMaxPacketSize*/
+HIBYTE(AUDIO_FEEDBACK_PACKET_SIZE), 0x01, /*bInterval: 1 ms*/
+AUDIO_FEEDBACK_REFRESH, /*bRefresh*/
+0x00 /*bSynchAddress*/
+};
+#elif USBD_CDC_ENABLE == 1
+#if defined ( __ICCARM__ ) /*!< IAR Compiler */
+#pragma data_alignment=4
+#endif
+/* USB Composite Configuration Descriptor: MSC on interface 0, CDC-ACM on interfaces 1 and 2 */
+__ALIGN_BEGIN uint8_t USBD_FS_CompositeCfgDesc[USBD_COMPOSITE_CONFIG_DESC_SIZ] __ALIGN_END =
+{ 0x09, /*bLength: Configuration Descriptor size*/
+USB_DESC_TYPE_CONFIGURATION, /*bDescriptorType: Configuration*/
+LOBYTE(USBD_COMPOSITE_CONFIG_DESC_SIZ), /*wTotalLength*/
+HIBYTE(USBD_COMPOSITE_CONFIG_DESC_SIZ), 0x03, /*bNumInterfaces: 3 interfaces*/
+0x01, /*bConfigurationValue*/
+USBD_IDX_CONFIG_STR, /*iConfiguration*/
+0xC0, /*bmAttributes: self powered*/
+0x32, /*MaxPower 100 mA*/
+
+/******************** Mass Storage interface ********************/
+0x09, /*bLength: Interface Descriptor size*/
+USB_DESC_TYPE_INTERFACE, /*bDescriptorType*/
+0x00, /*bInterfaceNumber*/
+0x00, /*bAlternateSetting*/
+0x02, /*bNumEndpoints*/
+0x08, /*bInterfaceClass: MSC Class*/
+0x06, /*bInterfaceSubClass: SCSI transparent*/
+0x50, /*bInterfaceProtocol: Bulk-Only Transport*/
+USBD_IDX_INTERFACE_STR, /*iInterface*/
+
+0x07, /*bLength: Endpoint Descriptor size*/
+USB_DESC_TYPE_ENDPOINT, /*bDescriptorType*/
+MSC_EPIN_ADDR, /*bEndpointAddress*/
+0x02, /*bmAttributes: Bulk*/
+LOBYTE(MSC_MAX_FS_PACKET), /*wMaxPacketSize*/
+HIBYTE(MSC_MAX_FS_PACKET), 0x00, /*bInterval*/
+
+0x07, /*bLength: Endpoint Descriptor size*/
+USB_DESC_TYPE_ENDPOINT, /*bDescriptorType*/
+MSC_EPOUT_ADDR, /*bEndpointAddress*/
+0x02, /*bmAttributes: Bulk*/
+LOBYTE(MSC_MAX_FS_PACKET), /*wMaxPacketSize*/
+HIBYTE(MSC_MAX_FS_PACKET), 0x00, /*bInterval*/
+
+/******************** CDC-ACM Interface Association ********************/
+0x08, /*bLength: IAD size*/
+0x0B, /*bDescriptorType: Interface Association*/
+CDC_COMM_INTERFACE, /*bFirstInterface*/
+0x02, /*bInterfaceCount*/
+0x02, /*bFunctionClass: Communication*/
+0x02, /*bFunctionSubClass: Abstract Control Model*/
+0x01, /*bFunctionProtocol: AT commands*/
+0x00, /*iFunction*/
+
+/******************** CDC Communication interface ********************/
+0x09, /*bLength: Interface Descriptor size*/
+USB_DESC_TYPE_INTERFACE, /*bDescriptorType*/
+CDC_COMM_INTERFACE, /*bInterfaceNumber*/
+0x00, /*bAlternateSetting*/
+0x01, /*bNumEndpoints*/
+0x02, /*bInterfaceClass: Communication*/
+0x02, /*bInterfaceSubClass: Abstract Control Model*/
+0x01, /*bInterfaceProtocol: AT commands*/
+0x00, /*iInterface*/
+
+0x05, /*bFunctionLength*/
+0x24, /*bDescriptorType: CS_INTERFACE*/
+0x00, /*bDescriptorSubtype: Header*/
+0x10, /*bcdCDC: 1.10*/
+0x01,
+
+0x05, /*bFunctionLength*/
+0x24, /*bDescriptorType: CS_INTERFACE*/
+0x01, /*bDescriptorSubtype: Call Management*/
+0x00, /*bmCapabilities: no call management*/
+CDC_DATA_INTERFACE, /*bDataInterface*/
+
+0x04, /*bFunctionLength*/
+0x24, /*bDescriptorType: CS_INTERFACE*/
+0x02, /*bDescriptorSubtype: Abstract Control Management*/
+0x02, /*bmCapabilities: line coding and control line state*/
+
+0x05, /*bFunctionLength*/
+0x24, /*bDescriptorType: CS_INTERFACE*/
+0x06, /*bDescriptorSubtype: Union*/
+CDC_COMM_INTERFACE, /*bMasterInterface*/
+CDC_DATA_INTERFACE, /*bSlaveInterface0*/
+
+0x07, /*bLength: Endpoint Descriptor size*/
+USB_DESC_TYPE_ENDPOINT, /*bDescriptorType*/
+CDC_CMD_EP, /*bEndpointAddress*/
+0x03, /*bmAttributes: Interrupt*/
+LOBYTE(CDC_CMD_PACKET_SIZE), /*wMaxPacketSize*/
+HIBYTE(CDC_CMD_PACKET_SIZE), 0xFF, /*bInterval: no notification is sent*/
+
+/******************** CDC Data interface ********************/
+0x09, /*bLength: Interface Descriptor size*/
+USB_DESC_TYPE_INTERFACE, /*bDescriptorType*/
+CDC_DATA_INTERFACE, /*bInterfaceNumber*/
+0x00, /*bAlternateSetting*/
+0x02, /*bNumEndpoints*/
+0x0A, /*bInterfaceClass: CDC Data*/
+0x00, /*bInterfaceSubClass*/
+0x00, /*bInterfaceProtocol*/
+0x00, /*iInterface*/
+
+0x07, /*bLength: Endpoint Descriptor size*/
+USB_DESC_TYPE_ENDPOINT, /*bDescriptorType*/
+CDC_OUT_EP, /*bEndpointAddress*/
+0x02, /*bmAttributes: Bulk*/
+LOBYTE(CDC_DATA_OUT_PACKET_SIZE), /*wMaxPacketSize*/
+HIBYTE(CDC_DATA_OUT_PACKET_SIZE), 0x00, /*bInterval*/
+
+0x07, /*bLength: Endpoint Descriptor size*/
+USB_DESC_TYPE_ENDPOINT, /*bDescriptorType*/
+CDC_IN_EP, /*bEndpointAddress*/
+0x02, /*bmAttributes: Bulk*/
+LOBYTE(CDC_DATA_IN_PACKET_SIZE), /*wMaxPacketSize*/
+HIBYTE(CDC_DATA_IN_PACKET_SIZE), 0x00 /*bInterval*/
+};
+#endif /* USBD_AUDIO_ENABLE == 1 */
 /**
  * @}
  */
@@ -281,6 +548,32 @@ uint8_t * USBD_FS_InterfaceStrDescriptor(USBD_SpeedTypeDef speed,
 	}
 	return USBD_StrDesc;
 }
+
+#if USBD_AUDIO_ENABLE == 1
+/**
+ * @brief  USBD_FS_SpeakerConfigDescriptor
+ *         return the configuration descriptor of the speaker
+ * @param  length : pointer to data length variable
+ * @retval pointer to descriptor buffer
+ */
+uint8_t * USBD_FS_SpeakerConfigDescriptor(uint16_t *length)
+{
+	*length = sizeof(USBD_FS_SpeakerCfgDesc);
+	return USBD_FS_SpeakerCfgDesc;
+}
+#elif USBD_CDC_ENABLE == 1
+/**
+ * @brief  USBD_FS_CompositeConfigDescriptor
+ *         return the configuration descriptor of the composite device
+ * @param  length : pointer to data length variable
+ * @retval pointer to descriptor buffer
+ */
+uint8_t * USBD_FS_CompositeConfigDescriptor(uint16_t *length)
+{
+	*length = sizeof(USBD_FS_CompositeCfgDesc);
+	return USBD_FS_CompositeCfgDesc;
+}
+#endif /* USBD_AUDIO_ENABLE == 1 */
 /**
  * @}
  */
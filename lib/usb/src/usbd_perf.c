@@ -0,0 +1,393 @@
+/**
+ ****************************************************************************
+ * @file        usbd_perf.c
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       This is the vendor SCSI performance probe: counters and benchmarks.
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/** @addtogroup LIB_USBD_PERF
+ * @{
+ */
+/** @defgroup LIB_USBD_PERF_PRIVATE USB Performance Probe (Private)
+ * @{
+ *
+ * The host reads the counters of the storage path and runs benchmarks on the
+ * raw card through a vendor SCSI command of the mass storage function
+ * (usbd_perf.h), so a release build is measured in place with a plain USB
+ * cable: no debugger, no serial console. The speaker build reads the counters
+ * by a vendor control request of the audio class instead.
+ *
+ * The counters are copied in the USB interrupt. A benchmark is started by the
+ * USB interrupt and run by usbd_perf_process() in the main loop, one staging
+ * buffer per call so the song player and the block device queue keep being
+ * served; the status of the command follows the last transfer. The transfers
+ * are background requests of the block device run by blockdev_transfer(), so
+ * they pass by the disk I/O layer as the FatFs ones: the write combining is
+ * written back (BLOCKDEV_SYNC) first, the cached copies of the sectors read
+ * are dropped so that the card is timed, and a rewrite stores the data read
+ * through the write-through cache.
+ */
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_perf.h"
+#include "usbd_conf.h"
+#include "usbd_msc_scsi.h"
+#include "sd.h"
+#include "diskio.h"
+#include "blockdev.h"
+#include "audio.h"
+#include "usbd_audio.h"
+#include <string.h>
+
+/* Private typedef -----------------------------------------------------------*/
+/**
+ * @struct _usbd_perf_handle_t
+ * This type define the state of the benchmark.
+ */
+typedef struct _usbd_perf_handle_t
+{
+	volatile usbd_perf_state_t eState; /*!< Set last by usbd_perf_startBenchmark() */
+	usbd_perf_benchmark_t eType; /*!< Benchmark run */
+	bool bSynced; /*!< Card written back, the transfers can start */
+	blockdev_request_t request; /*!< Background request of the transfers */
+	uint8_t *pui8Buffer; /*!< Buffer lent by the caller, 4-byte aligned */
+	uint32_t ui32BufferSectors; /*!< Sectors per transfer */
+	uint32_t ui32FirstSector; /*!< First sector of the benchmark */
+	uint32_t ui32NextSector; /*!< Next sector to transfer */
+	uint32_t ui32Left; /*!< Sectors left to transfer */
+	uint32_t ui32Count; /*!< Sectors transferred */
+	uint32_t ui32TotalUs; /*!< Card time of the transfers */
+	uint32_t ui32MaxChunkUs; /*!< Slowest transfer */
+	usbd_perf_owned_t pfnOwned; /*!< Buffer ownership check */
+	usbd_perf_complete_t pfnComplete; /*!< Completion callback */
+} usbd_perf_handle_t;
+
+/* Private define ------------------------------------------------------------*/
+#define USBD_PERF_SECTOR_SIZE	(512) /*!< Card sector size in byte unit */
+
+/* Private macro -------------------------------------------------------------*/
+#define USBD_PERF_CYCLES_TO_US(ui32Cycles)	((ui32Cycles) / (SystemCoreClock / 1000000))
+
+/* Private variables ---------------------------------------------------------*/
+static usbd_perf_handle_t g_usbdPerf; /*!< Last benchmark */
+
+/* Private functions declaration ---------------------------------------------*/
+static void usbd_perf_finish(bool bSuccess);
+static bool usbd_perf_transfer(blockdev_operation_t eOperation,
+		uint32_t ui32Sectors);
+
+/* Private function prototypes -----------------------------------------------*/
+/**
+ * @brief  End the benchmark and complete the command, the callback checks
+ * 			that the command was not reset meanwhile.
+ * @param  bSuccess: all sectors transferred.
+ * @retval None
+ */
+static void usbd_perf_finish(bool bSuccess)
+{
+	g_usbdPerf.eState = (bSuccess) ? (USBD_PERF_STATE_DONE) : (USBD_PERF_STATE_FAILED);
+	g_usbdPerf.pfnComplete(bSuccess);
+}
+
+/**
+ * @brief  Run one operation of the benchmark on the block device, from the
+ * 			main loop.
+ * @param  eOperation: BLOCKDEV_READ, BLOCKDEV_WRITE or BLOCKDEV_SYNC.
+ * @param  ui32Sectors: number of sectors from the next sector.
+ * @retval bool: the operation succeeded
+ */
+static bool usbd_perf_transfer(blockdev_operation_t eOperation,
+		uint32_t ui32Sectors)
+{
+	g_usbdPerf.request.eOperation = eOperation;
+	g_usbdPerf.request.pui8Buffer =
+			(BLOCKDEV_SYNC == eOperation) ? (NULL) : (g_usbdPerf.pui8Buffer);
+	g_usbdPerf.request.ui32Sector = g_usbdPerf.ui32NextSector;
+	g_usbdPerf.request.ui32Count = ui32Sectors;
+	return (RES_OK == blockdev_transfer(&g_usbdPerf.request));
+}
+
+/* Exported functions prototype ----------------------------------------------*/
+/**
+ * @brief  Copy the counters blob (usbd_perf_counters_t), called from the USB
+ * 			interrupt.
+ * @param  pui8Blob: output buffer.
+ * @param  ui16Size: size of the output buffer in byte unit, the blob is
+ * 			truncated to it.
+ * @param  bClear: clear the counters once copied.
+ * @retval uint16_t: number of bytes copied
+ */
+uint16_t usbd_perf_getCounters(uint8_t *pui8Blob, uint16_t ui16Size,
+		bool bClear)
+{
+	usbd_perf_counters_t counters;
+	sd_latency_statistic_t sdRead;
+	sd_latency_statistic_t sdWrite;
+	sd_busy_statistic_t sdBusy;
+	sd_crc_statistic_t sdCrc;
+	blockdev_statistic_t blockdev;
+	USBD_SCSI_StatisticTypeDef scsi;
+	audio_statistic_t audio;
+#if USBD_AUDIO_ENABLE == 1
+	usbd_audio_statistic_t speaker;
+#endif /* USBD_AUDIO_ENABLE == 1 */
+	uint32_t ui32Index;
+
+	memset(&counters, 0, sizeof(usbd_perf_counters_t));
+	counters.ui32Magic = USBD_PERF_MAGIC;
+	counters.ui32Version = USBD_PERF_VERSION;
+	counters.ui32Size = sizeof(usbd_perf_counters_t);
+	counters.ui32TickMs = HAL_GetTick();
+
+	sd_getLatencyStatistic(&sdRead, &sdWrite);
+	counters.ui32SdReadCommands = sdRead.ui32Commands;
+	counters.ui32SdReadBlocks = sdRead.ui32Blocks;
+	counters.ui32SdReadTotalUs = sdRead.ui32TotalUs;
+	counters.ui32SdReadMaxUs = sdRead.ui32MaxUs;
+	counters.ui32SdWriteCommands = sdWrite.ui32Commands;
+	counters.ui32SdWriteBlocks = sdWrite.ui32Blocks;
+	counters.ui32SdWriteTotalUs = sdWrite.ui32TotalUs;
+	counters.ui32SdWriteMaxUs = sdWrite.ui32MaxUs;
+
+	sd_getBusyStatistic(&sdBusy);
+	counters.ui32SdDeferredWrites = sdBusy.ui32DeferredWrites;
+	counters.ui32SdBusyHiddenMs = sdBusy.ui32HiddenTimeMs;
+	counters.ui32SdBusyStalledMs = sdBusy.ui32StalledTimeMs;
+	sd_getCrcStatistic(&sdCrc);
+	counters.ui32SdCrcReadErrors = sdCrc.ui32ReadErrors;
+	counters.ui32SdCrcWriteErrors = sdCrc.ui32WriteErrors;
+	counters.ui32SdCrcFailures = sdCrc.ui32Failures;
+
+#if _USE_CACHE == 1
+	diskio_cache_statistic_t cache;
+	diskio_getCacheStatistic(&cache);
+	counters.ui32CacheMetaHits = cache.ui32MetaHits;
+	counters.ui32CacheMetaMisses = cache.ui32MetaMisses;
+	counters.ui32CacheDataHits = cache.ui32DataHits;
+	counters.ui32CacheDataMisses = cache.ui32DataMisses;
+#endif /* _USE_CACHE == 1 */
+
+	blockdev_getStatistic(&blockdev);
+	for (ui32Index = 0; ui32Index < BLOCKDEV_PRIORITY_NUMBER; ui32Index++)
+	{
+		counters.pui32BlockdevServed[ui32Index] = blockdev.pui32Served[ui32Index];
+		counters.pui32BlockdevMaxWaitMs[ui32Index] = blockdev.pui32MaxWaitMs[ui32Index];
+	}
+	counters.ui32BlockdevHostWrites = blockdev.ui32HostWrites;
+
+	SCSI_GetStatistic(&scsi);
+	counters.ui32UsbInNakWindows = scsi.in_nak_windows;
+	counters.ui32UsbInNakUs = scsi.in_nak_us;
+	counters.ui32UsbOutNakWindows = scsi.out_nak_windows;
+	counters.ui32UsbOutNakUs = scsi.out_nak_us;
+
+	audio_getStatistic(&audio);
+	counters.ui32CodecChunks = audio.ui32Chunks;
+	counters.ui32CodecStalls = audio.ui32Stalls;
+
+	counters.ui32BenchType = g_usbdPerf.eType;
+	counters.ui32BenchState = g_usbdPerf.eState;
+	counters.ui32BenchSector = g_usbdPerf.ui32FirstSector;
+	counters.ui32BenchCount = g_usbdPerf.ui32Count;
+	counters.ui32BenchUs = g_usbdPerf.ui32TotalUs;
+	counters.ui32BenchMaxChunkUs = g_usbdPerf.ui32MaxChunkUs;
+
+#if USBD_AUDIO_ENABLE == 1
+	usbd_audio_getStatistic(&speaker);
+	counters.ui32SpeakerPackets = speaker.ui32Packets;
+	counters.ui32SpeakerOverruns = speaker.ui32Overruns;
+	counters.ui32SpeakerUnderruns = speaker.ui32Underruns;
+	counters.ui32SpeakerFillLevel = speaker.ui32FillLevel;
+	counters.ui32SpeakerFillMin = speaker.ui32FillMin;
+	counters.ui32SpeakerFillMax = speaker.ui32FillMax;
+	counters.ui32SpeakerFeedback = speaker.ui32Feedback;
+	counters.ui32SpeakerHostRate = speaker.ui32HostRate;
+	counters.ui32SpeakerSampleRate = speaker.ui32SampleRate;
+#endif /* USBD_AUDIO_ENABLE == 1 */
+
+	/* Only 32-bit words: the layout of the Cortex-M3 is the little endian blob */
+	if (ui16Size > sizeof(usbd_perf_counters_t))
+	{
+		ui16Size = sizeof(usbd_perf_counters_t);
+	}
+	memcpy(pui8Blob, &counters, ui16Size);
+
+	if (bClear)
+	{
+		sd_resetLatencyStatistic();
+		sd_resetBusyStatistic();
+#if _USE_CACHE == 1
+		diskio_resetCacheStatistic();
+#endif /* _USE_CACHE == 1 */
+		SCSI_ResetStatistic();
+		audio_resetStatistic();
+#if USBD_AUDIO_ENABLE == 1
+		usbd_audio_resetStatistic();
+#endif /* USBD_AUDIO_ENABLE == 1 */
+		if (USBD_PERF_STATE_RUNNING != g_usbdPerf.eState)
+		{
+			memset(&g_usbdPerf, 0, sizeof(usbd_perf_handle_t));
+		}
+	}
+	return ui16Size;
+}
+
+/**
+ * @brief  Start a benchmark on the card, called from the USB interrupt.
+ * @param  eType: benchmark to run.
+ *			@arg USBD_PERF_BENCH_READ: sequential read
+ *			@arg USBD_PERF_BENCH_REWRITE: sequential read back and write
+ * @param  pui8Buffer: 4-byte aligned buffer lent until the completion.
+ * @param  ui32BufferSize: size of the buffer in byte unit, at least one sector.
+ * @param  ui32Sector: first sector.
+ * @param  ui32Count: number of sectors.
+ * @param  pfnOwned: checked before each transfer, the benchmark is dropped
+ * 			without completion once the buffer is taken back.
+ * @param  pfnComplete: called from the main loop at the end.
+ * @retval bool: start status
+ *			@arg true: the benchmark is run by usbd_perf_process()
+ *			@arg false: a dropped benchmark is still running, or bad parameters
+ */
+bool usbd_perf_startBenchmark(usbd_perf_benchmark_t eType, uint8_t *pui8Buffer,
+		uint32_t ui32BufferSize, uint32_t ui32Sector, uint32_t ui32Count,
+		usbd_perf_owned_t pfnOwned, usbd_perf_complete_t pfnComplete)
+{
+	if ((USBD_PERF_STATE_RUNNING == g_usbdPerf.eState)
+			|| (USBD_PERF_SECTOR_SIZE > ui32BufferSize) || (0 == ui32Count)
+			|| ((USBD_PERF_BENCH_READ != eType)
+					&& (USBD_PERF_BENCH_REWRITE != eType)))
+	{
+		return false;
+	}
+	g_usbdPerf.eType = eType;
+	g_usbdPerf.bSynced = false;
+	blockdev_initRequest(&g_usbdPerf.request, 0, BLOCKDEV_PRIORITY_BACKGROUND,
+			NULL);
+	g_usbdPerf.pui8Buffer = pui8Buffer;
+	g_usbdPerf.ui32BufferSectors = ui32BufferSize / USBD_PERF_SECTOR_SIZE;
+	g_usbdPerf.ui32FirstSector = ui32Sector;
+	g_usbdPerf.ui32NextSector = ui32Sector;
+	g_usbdPerf.ui32Left = ui32Count;
+	g_usbdPerf.ui32Count = 0;
+	g_usbdPerf.ui32TotalUs = 0;
+	g_usbdPerf.ui32MaxChunkUs = 0;
+	g_usbdPerf.pfnOwned = pfnOwned;
+	g_usbdPerf.pfnComplete = pfnComplete;
+	g_usbdPerf.eState = USBD_PERF_STATE_RUNNING;
+	return true;
+}
+
+/**
+ * @brief  Run one transfer of the benchmark, called from the main loop.
+ * @note   The USB interrupt is masked while the buffer is transferred: a host
+ * 			resetting the command meanwhile would reuse the buffer. The USB
+ * 			requests of the block device are served before, the masked
+ * 			interrupt cannot queue new ones. The card programming time of a
+ * 			rewrite is waited with the interrupt enabled.
+ * @retval None
+ */
+void usbd_perf_process(void)
+{
+	uint32_t ui32Sectors;
+	uint32_t ui32Start;
+	uint32_t ui32Us;
+	bool bSuccess;
+
+	if (USBD_PERF_STATE_RUNNING != g_usbdPerf.eState)
+	{
+		return;
+	}
+	if (!g_usbdPerf.bSynced)
+	{
+		/* Untimed: held host writes and the previous programming */
+		if (!usbd_perf_transfer(BLOCKDEV_SYNC, 0))
+		{
+			usbd_perf_finish(false);
+			return;
+		}
+		g_usbdPerf.bSynced = true;
+		return;
+	}
+
+	ui32Sectors = g_usbdPerf.ui32Left;
+	if (ui32Sectors > g_usbdPerf.ui32BufferSectors)
+	{
+		ui32Sectors = g_usbdPerf.ui32BufferSectors;
+	}
+
+	blockdev_process(BLOCKDEV_PRIORITY_USB, BLOCKDEV_UNLIMITED);
+	HAL_NVIC_DisableIRQ(USB_LP_CAN1_RX0_IRQn);
+	if (!g_usbdPerf.pfnOwned())
+	{
+		/* Command reset by the host: nothing to complete */
+		g_usbdPerf.eState = USBD_PERF_STATE_FAILED;
+		HAL_NVIC_EnableIRQ(USB_LP_CAN1_RX0_IRQn);
+		return;
+	}
+	if (USBD_PERF_BENCH_REWRITE == g_usbdPerf.eType)
+	{
+		/* Untimed read back: the content of the card is kept. The write
+		 is timed to the end of the programming, the write combining holds
+		 a short last chunk until the sync */
+		bSuccess = usbd_perf_transfer(BLOCKDEV_READ, ui32Sectors);
+		ui32Start = DWT->CYCCNT;
+		bSuccess = bSuccess && usbd_perf_transfer(BLOCKDEV_WRITE, ui32Sectors);
+		HAL_NVIC_EnableIRQ(USB_LP_CAN1_RX0_IRQn);
+		bSuccess = bSuccess && usbd_perf_transfer(BLOCKDEV_SYNC, 0);
+	}
+	else
+	{
+#if _USE_CACHE == 1
+		/* A cached sector would time the cache, not the card */
+		diskio_invalidateCache(0, g_usbdPerf.ui32NextSector, ui32Sectors);
+#endif /* _USE_CACHE == 1 */
+		ui32Start = DWT->CYCCNT;
+		bSuccess = usbd_perf_transfer(BLOCKDEV_READ, ui32Sectors);
+		HAL_NVIC_EnableIRQ(USB_LP_CAN1_RX0_IRQn);
+	}
+	ui32Us = USBD_PERF_CYCLES_TO_US(DWT->CYCCNT - ui32Start);
+
+	if (!bSuccess)
+	{
+		usbd_perf_finish(false);
+		return;
+	}
+	g_usbdPerf.ui32TotalUs += ui32Us;
+	if (ui32Us > g_usbdPerf.ui32MaxChunkUs)
+	{
+		g_usbdPerf.ui32MaxChunkUs = ui32Us;
+	}
+	g_usbdPerf.ui32NextSector += ui32Sectors;
+	g_usbdPerf.ui32Left -= ui32Sectors;
+	g_usbdPerf.ui32Count += ui32Sectors;
+	if (0 == g_usbdPerf.ui32Left)
+	{
+		usbd_perf_finish(true);
+	}
+}
+
+/**@}LIB_USBD_PERF_PRIVATE*/
+/**@}LIB_USBD_PERF*/
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
@@ -34,6 +34,11 @@
 #include "usbd_storage_if.h"
 /* USER CODE BEGIN INCLUDE */
 #include "sd.h"
+#include "diskio.h"
+#include "blockdev.h"
+#include "usbd_msc_scsi.h"
+#include "usbd_msc_bot.h"
+#include "usbd_perf.h"
 /* USER CODE END INCLUDE */
 
 /** @addtogroup STM32_USB_OTG_DEVICE_LIBRARY
@@ -58,7 +63,6 @@
  * @{
  */
 #define STORAGE_LUN_NBR                  1  
-#define STORAGE_BLK_NBR                  0x10000  
 #define STORAGE_BLK_SIZ                  SD_BLOCK_SIZE
 
 /* USER CODE BEGIN PRIVATE_DEFINES */
@@ -91,10 +95,17 @@ const int8_t STORAGE_Inquirydata_FS[] =
 		'P', 'r', 'o', 'd', 'u', 'c', 't', ' ', /* Product      : 16 Bytes */
 		' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', '0', '.', '0', '1', /* Version      : 4 Bytes */
 };
-static sd_card_info_t g_card_info;
 /* USER CODE END INQUIRY_DATA_FS */
 
 /* USER CODE BEGIN PRIVATE_VARIABLES */
+/* The SD card is only accessed from the main loop: the SCSI READ10/WRITE10
+ accesses of the USB interrupt are queued to the block device layer. The host
+ writes are held by the write combining of the disk I/O layer (write back cache
+ of the caching mode page) until a sync, a non-consecutive sector or its timeout */
+static blockdev_request_t g_usbStorageRequest; /*!< Pending READ10/WRITE10 half, UNMAP range or sync */
+static volatile uint32_t g_ui32UsbStorageBlocks = 0; /*!< Card capacity cached once identified, 0: no card */
+static volatile bool g_bUsbStorageChanged = false; /*!< New card not reported to the host yet */
+static uint32_t g_ui32UsbBenchmarkTag = 0; /*!< CBW tag of the running benchmark command */
 /* USER CODE END PRIVATE_VARIABLES */
 
 /**
@@ -106,6 +117,7 @@ static sd_card_info_t g_card_info;
  */
 
 /* USER CODE BEGIN EXPORTED_VARIABLES */
+extern USBD_HandleTypeDef hUsbDeviceFS;
 /* USER CODE END EXPORTED_VARIABLES */
 
 /**
@@ -127,6 +139,19 @@ static int8_t STORAGE_Write_FS(uint8_t lun, uint8_t *buf, uint32_t blk_addr,
 static int8_t STORAGE_GetMaxLun_FS(void);
 
 /* USER CODE BEGIN PRIVATE_FUNCTIONS_DECLARATION */
+static int8_t STORAGE_Unmap_FS(uint8_t lun, uint32_t blk_addr,
+		uint32_t blk_len);
+static int8_t STORAGE_Sync_FS(uint8_t lun);
+static int8_t STORAGE_Submit_FS(blockdev_operation_t eOperation, uint8_t *buf,
+		uint32_t blk_addr, uint32_t blk_len);
+static void STORAGE_Complete_FS(blockdev_request_t *pRequest);
+static uint32_t STORAGE_GetBlockNumber_FS(void);
+static int8_t STORAGE_GetCounters_FS(uint8_t lun, uint8_t *buf, uint16_t *len,
+		uint8_t flags);
+static int8_t STORAGE_Benchmark_FS(uint8_t lun, uint8_t type, uint8_t *buf,
+		uint32_t blk_addr, uint32_t blk_len);
+static bool STORAGE_BenchmarkOwned_FS(void);
+static void STORAGE_BenchmarkDone_FS(bool bSuccess);
 /* USER CODE END PRIVATE_FUNCTIONS_DECLARATION */
 
 /**
@@ -136,7 +161,9 @@ static int8_t STORAGE_GetMaxLun_FS(void);
 USBD_StorageTypeDef USBD_Storage_Interface_fops_FS =
 { STORAGE_Init_FS, STORAGE_GetCapacity_FS, STORAGE_IsReady_FS,
 		STORAGE_IsWriteProtected_FS, STORAGE_Read_FS, STORAGE_Write_FS,
-		STORAGE_GetMaxLun_FS, (int8_t *) STORAGE_Inquirydata_FS, };
+		STORAGE_GetMaxLun_FS, (int8_t *) STORAGE_Inquirydata_FS,
+		STORAGE_Unmap_FS, STORAGE_Sync_FS, STORAGE_GetCounters_FS,
+		STORAGE_Benchmark_FS, };
 
 /* Private functions ---------------------------------------------------------*/
 /*******************************************************************************
@@ -150,7 +177,12 @@ int8_t STORAGE_Init_FS(uint8_t lun)
 {
 	UNUSED(lun);
 	/* USER CODE BEGIN 2 */
-	sd_init();
+	/* Called from the USB interrupt: the card is initialized by the main loop
+	 (FatFs mount), the disk I/O layer is shared with FatFs */
+	/* A request still pending from the previous configuration keeps its settings */
+	blockdev_initRequest(&g_usbStorageRequest, 0, BLOCKDEV_PRIORITY_USB,
+			STORAGE_Complete_FS);
+	STORAGE_GetBlockNumber_FS();
 	return (USBD_OK);
 	/* USER CODE END 2 */
 }
@@ -167,10 +199,9 @@ int8_t STORAGE_GetCapacity_FS(uint8_t lun, uint32_t *block_num,
 {
 	/* USER CODE BEGIN 3 */
 	UNUSED(lun);
-	sd_getCardInfo(&g_card_info);
-	*block_num = (g_card_info.CardCapacity) / STORAGE_BLK_SIZ;
+	*block_num = STORAGE_GetBlockNumber_FS();
 	*block_size = STORAGE_BLK_SIZ;
-	return (USBD_OK);
+	return ((0 != *block_num) ? (USBD_OK) : (MSC_STORAGE_NOT_READY));
 	/* USER CODE END 3 */
 }
 
@@ -185,6 +216,16 @@ int8_t STORAGE_IsReady_FS(uint8_t lun)
 {
 	/* USER CODE BEGIN 4 */
 	UNUSED(lun);
+	/* The pending sectors of the write combining are written back by the main loop */
+	if (0 == STORAGE_GetBlockNumber_FS())
+	{
+		return (MSC_STORAGE_NOT_READY);
+	}
+	if (g_bUsbStorageChanged)
+	{
+		g_bUsbStorageChanged = false;
+		return (MSC_STORAGE_MEDIUM_CHANGED);
+	}
 	return (USBD_OK);
 	/* USER CODE END 4 */
 }
@@ -216,9 +257,7 @@ int8_t STORAGE_Read_FS(uint8_t lun, uint8_t *buf, uint32_t blk_addr,
 {
 	/* USER CODE BEGIN 6 */
 	UNUSED(lun);
-	sd_readBlocks((uint32_t *) buf, blk_addr * STORAGE_BLK_SIZ, STORAGE_BLK_SIZ,
-			blk_len);
-	return (USBD_OK);
+	return STORAGE_Submit_FS(BLOCKDEV_READ, buf, blk_addr, blk_len);
 	/* USER CODE END 6 */
 }
 
@@ -234,9 +273,7 @@ int8_t STORAGE_Write_FS(uint8_t lun, uint8_t *buf, uint32_t blk_addr,
 {
 	/* USER CODE BEGIN 7 */
 	UNUSED(lun);
-	sd_writeBlocks((uint32_t *) buf, blk_addr * STORAGE_BLK_SIZ,
-	STORAGE_BLK_SIZ, blk_len);
-	return (USBD_OK);
+	return STORAGE_Submit_FS(BLOCKDEV_WRITE, buf, blk_addr, blk_len);
 	/* USER CODE END 7 */
 }
 
@@ -255,6 +292,202 @@ int8_t STORAGE_GetMaxLun_FS(void)
 }
 
 /* USER CODE BEGIN PRIVATE_FUNCTIONS_IMPLEMENTATION */
+/*******************************************************************************
+ * Function Name  : STORAGE_Unmap_FS
+ * Description    : Erase the blocks released by the host (SCSI UNMAP), one
+ *                  block descriptor at a time: the SCSI layer submits the next
+ *                  one from the completion and sends the status after the last.
+ * Input          : First block and number of blocks.
+ * Output         : None.
+ * Return         : USBD_BUSY, completed by STORAGE_Complete_FS, or an error.
+ *******************************************************************************/
+int8_t STORAGE_Unmap_FS(uint8_t lun, uint32_t blk_addr, uint32_t blk_len)
+{
+	UNUSED(lun);
+	return STORAGE_Submit_FS(BLOCKDEV_TRIM, NULL, blk_addr, blk_len);
+}
+
+/*******************************************************************************
+ * Function Name  : STORAGE_Sync_FS
+ * Description    : Write back the sectors held by the write combining of the
+ *                  disk I/O layer (SYNCHRONIZE CACHE, START STOP UNIT, FUA).
+ * Input          : None.
+ * Output         : None.
+ * Return         : USBD_BUSY, completed by STORAGE_Complete_FS, or an error.
+ *******************************************************************************/
+int8_t STORAGE_Sync_FS(uint8_t lun)
+{
+	UNUSED(lun);
+	return STORAGE_Submit_FS(BLOCKDEV_SYNC, NULL, 0, 0);
+}
+
+/*******************************************************************************
+ * Function Name  : STORAGE_Submit_FS
+ * Description    : Queue a READ10/WRITE10 half, an UNMAP range or a sync to the
+ *                  block device layer.
+ * Input          : Operation, buffer, first block and number of blocks.
+ * Output         : None.
+ * Return         : USBD_BUSY, completed by STORAGE_Complete_FS, or an error.
+ *******************************************************************************/
+int8_t STORAGE_Submit_FS(blockdev_operation_t eOperation, uint8_t *buf,
+		uint32_t blk_addr, uint32_t blk_len)
+{
+	if (0 == g_ui32UsbStorageBlocks)
+	{
+		/* Card removed since the command was accepted */
+		return (MSC_STORAGE_NOT_READY);
+	}
+	if (!blockdev_submit(&g_usbStorageRequest, eOperation, buf, blk_addr,
+			blk_len))
+	{
+		/* Previous packet still pending after a BOT reset */
+		return (MSC_STORAGE_MEDIUM_ERROR);
+	}
+	return (USBD_BUSY);
+}
+
+/*******************************************************************************
+ * Function Name  : STORAGE_Complete_FS
+ * Description    : Resume the SCSI layer once the half is read/written, the
+ *                  range erased or the card synced.
+ * Input          : Completed request.
+ * Output         : None.
+ * Return         : None.
+ *******************************************************************************/
+void STORAGE_Complete_FS(blockdev_request_t *pRequest)
+{
+	int8_t i8Status = USBD_OK;
+	if (RES_OK != pRequest->eResult)
+	{
+		/* A card pulled out fails before the card detect is debounced:
+		 NOT READY lets the host wait for a medium instead of retrying */
+		i8Status = ((RES_NOTRDY == pRequest->eResult) || !sd_isDetected()) ?
+				(MSC_STORAGE_NOT_READY) : (MSC_STORAGE_MEDIUM_ERROR);
+	}
+
+	/* Called from the main loop: keep the USB interrupt away from the BOT state */
+	HAL_NVIC_DisableIRQ(USB_LP_CAN1_RX0_IRQn);
+	SCSI_CompleteTransfer(&hUsbDeviceFS, 0, i8Status);
+	HAL_NVIC_EnableIRQ(USB_LP_CAN1_RX0_IRQn);
+}
+
+/*******************************************************************************
+ * Function Name  : STORAGE_GetBlockNumber_FS
+ * Description    : Cache the capacity of the card, the card may be identified
+ *                  by the main loop after the USB enumeration.
+ * Input          : None.
+ * Output         : None.
+ * Return         : Number of STORAGE_BLK_SIZ blocks, 0 if no card.
+ *******************************************************************************/
+uint32_t STORAGE_GetBlockNumber_FS(void)
+{
+	if (0 == g_ui32UsbStorageBlocks)
+	{
+		g_ui32UsbStorageBlocks = sd_getBlockNumber();
+	}
+	return g_ui32UsbStorageBlocks;
+}
+
+/*******************************************************************************
+ * Function Name  : STORAGE_GetCounters_FS
+ * Description    : Copy the performance counters (usbd_perf.h).
+ * Input          : Output buffer and its size, USBD_PERF_CLEAR flag.
+ * Output         : Number of bytes copied.
+ * Return         : USBD_OK.
+ *******************************************************************************/
+int8_t STORAGE_GetCounters_FS(uint8_t lun, uint8_t *buf, uint16_t *len,
+		uint8_t flags)
+{
+	UNUSED(lun);
+	*len = usbd_perf_getCounters(buf, *len, (0 != (flags & USBD_PERF_CLEAR)));
+	return (USBD_OK);
+}
+
+/*******************************************************************************
+ * Function Name  : STORAGE_Benchmark_FS
+ * Description    : Start a benchmark on the card (usbd_perf.h), run by the
+ *                  main loop in the staging buffer of the command.
+ * Input          : Benchmark, staging buffer, first block and number of blocks.
+ * Output         : None.
+ * Return         : USBD_BUSY, completed by STORAGE_BenchmarkDone_FS, or an error.
+ *******************************************************************************/
+int8_t STORAGE_Benchmark_FS(uint8_t lun, uint8_t type, uint8_t *buf,
+		uint32_t blk_addr, uint32_t blk_len)
+{
+	UNUSED(lun);
+	if (0 == g_ui32UsbStorageBlocks)
+	{
+		return (MSC_STORAGE_NOT_READY);
+	}
+	g_ui32UsbBenchmarkTag =
+			((USBD_MSC_BOT_HandleTypeDef *) hUsbDeviceFS.pClassData)->cbw.dTag;
+	if (!usbd_perf_startBenchmark((usbd_perf_benchmark_t) type, buf,
+			MSC_STAGING_SIZE, blk_addr, blk_len, STORAGE_BenchmarkOwned_FS,
+			STORAGE_BenchmarkDone_FS))
+	{
+		/* Previous benchmark still running after a BOT reset */
+		return (MSC_STORAGE_MEDIUM_ERROR);
+	}
+	return (USBD_BUSY);
+}
+
+/*******************************************************************************
+ * Function Name  : STORAGE_BenchmarkOwned_FS
+ * Description    : Check that the staging buffer still belongs to the
+ *                  benchmark: the host may reset the command on a timeout.
+ *                  Called with the USB interrupt masked.
+ * Input          : None.
+ * Output         : None.
+ * Return         : true if the benchmark command waits for its status.
+ *******************************************************************************/
+bool STORAGE_BenchmarkOwned_FS(void)
+{
+	USBD_MSC_BOT_HandleTypeDef *hmsc =
+			(USBD_MSC_BOT_HandleTypeDef *) hUsbDeviceFS.pClassData;
+	return ((NULL != hmsc) && (USBD_BOT_WAIT_MEDIUM == hmsc->bot_state)
+			&& (SCSI_VENDOR_PERF == hmsc->cbw.CB[0])
+			&& (g_ui32UsbBenchmarkTag == hmsc->cbw.dTag));
+}
+
+/*******************************************************************************
+ * Function Name  : STORAGE_BenchmarkDone_FS
+ * Description    : Send the status of the benchmark command.
+ * Input          : Benchmark result.
+ * Output         : None.
+ * Return         : None.
+ *******************************************************************************/
+void STORAGE_BenchmarkDone_FS(bool bSuccess)
+{
+	int8_t i8Status = USBD_OK;
+	if (!bSuccess)
+	{
+		i8Status = (!sd_isDetected()) ?
+				(MSC_STORAGE_NOT_READY) : (MSC_STORAGE_MEDIUM_ERROR);
+	}
+
+	/* Called from the main loop: keep the USB interrupt away from the BOT state */
+	HAL_NVIC_DisableIRQ(USB_LP_CAN1_RX0_IRQn);
+	if (STORAGE_BenchmarkOwned_FS())
+	{
+		SCSI_CompleteTransfer(&hUsbDeviceFS, 0, i8Status);
+	}
+	HAL_NVIC_EnableIRQ(USB_LP_CAN1_RX0_IRQn);
+}
+
+/*******************************************************************************
+ * Function Name  : STORAGE_MediumChanged_FS
+ * Description    : Take the card inserted or removed into account, called from
+ *                  the main loop once the new card is initialized. The host is
+ *                  told by a UNIT ATTENTION to read the capacity again.
+ * Input          : None.
+ * Output         : None.
+ * Return         : None.
+ *******************************************************************************/
+void STORAGE_MediumChanged_FS(void)
+{
+	g_ui32UsbStorageBlocks = sd_getBlockNumber();
+	g_bUsbStorageChanged = true;
+}
 /* USER CODE END PRIVATE_FUNCTIONS_IMPLEMENTATION */
 
 /**
@@ -285,6 +285,10 @@ typedef struct
   
   uint32_t  xfer_count;     /*!< Partial transfer length in case of multi packet transfer                 */
 
+  uint8_t   db_active;      /*!< Double buffer: OUT transfer armed, or IN packet handed to the peripheral  */
+
+  uint8_t   db_ready;       /*!< Double buffer: OUT packet held in the PMA, or IN packet preloaded         */
+
 } USB_EPTypeDef;
 #endif /* USB */
 /**
@@ -585,6 +589,8 @@ HAL_StatusTypeDef USB_ActivateRemoteWakeup(USB_TypeDef *USBx);
 HAL_StatusTypeDef USB_DeActivateRemoteWakeup(USB_TypeDef *USBx);
 void USB_WritePMA(USB_TypeDef  *USBx, uint8_t *pbUsrBuf, uint16_t wPMABufAddr, uint16_t wNBytes);
 void USB_ReadPMA(USB_TypeDef  *USBx, uint8_t *pbUsrBuf, uint16_t wPMABufAddr, uint16_t wNBytes);
+void USB_DBLoadPacket(USB_TypeDef *USBx, USB_EPTypeDef *ep);
+uint16_t USB_DBReadPacket(USB_TypeDef *USBx, USB_EPTypeDef *ep);
 #endif /* USB */
 /**
   * @}
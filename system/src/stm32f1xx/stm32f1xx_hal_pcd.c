@@ -104,6 +104,13 @@
   */ 
 #define PCD_MIN(a, b)  (((a) < (b)) ? (a) : (b))
 #define PCD_MAX(a, b)  (((a) > (b)) ? (a) : (b))
+#if defined (USB)
+#if defined(STM32F102x6) || defined(STM32F102xB)
+#define PCD_USB_IRQn  USB_LP_IRQn
+#else
+#define PCD_USB_IRQn  USB_LP_CAN1_RX0_IRQn
+#endif
+#endif /* USB */
 /**
   * @}
   */
@@ -118,6 +125,9 @@ static HAL_StatusTypeDef PCD_WriteEmptyTxFifo(PCD_HandleTypeDef *hpcd, uint32_t
 
 #if defined (USB)
 static HAL_StatusTypeDef PCD_EP_ISR_Handler(PCD_HandleTypeDef *hpcd);
+static void PCD_EP_DB_Receive(PCD_HandleTypeDef *hpcd, PCD_EPTypeDef *ep);
+static void PCD_EP_DB_Transmit(PCD_HandleTypeDef *hpcd, PCD_EPTypeDef *ep);
+static void PCD_EP_ISO_Receive(PCD_HandleTypeDef *hpcd, PCD_EPTypeDef *ep);
 #endif /* USB */
 /**
   * @}
@@ -571,6 +581,19 @@ void HAL_PCD_IRQHandler(PCD_HandleTypeDef *hpcd)
 void HAL_PCD_IRQHandler(PCD_HandleTypeDef *hpcd)
 {
   uint32_t wInterrupt_Mask = 0;
+  uint32_t epindex = 0;
+  PCD_EPTypeDef *ep = NULL;
+  
+  /* OUT packets held in a double buffer until their transfer was armed */
+  for (epindex = 1; epindex < hpcd->Init.dev_endpoints; epindex++)
+  {
+    ep = &hpcd->OUT_ep[epindex];
+    if ((ep->doublebuffer != 0) && (ep->db_ready != 0) && (ep->db_active != 0))
+    {
+      ep->db_ready = 0;
+      PCD_EP_DB_Receive(hpcd, ep);
+    }
+  }
   
   if (__HAL_PCD_GET_FLAG (hpcd, USB_ISTR_CTR))
   {
@@ -956,6 +979,14 @@ HAL_StatusTypeDef HAL_PCD_EP_Receive(PCD_HandleTypeDef *hpcd, uint8_t ep_addr, u
   }
   __HAL_UNLOCK(hpcd);
   
+#if defined (USB)
+  if ((ep->doublebuffer != 0) && (ep->db_ready != 0))
+  {
+    /* A packet arrived before the transfer was armed: read it from the interrupt */
+    HAL_NVIC_SetPendingIRQ(PCD_USB_IRQn);
+  }
+#endif /* USB */
+  
   return HAL_OK;
 }
 
@@ -1311,49 +1342,41 @@ static HAL_StatusTypeDef PCD_EP_ISR_Handler(PCD_HandleTypeDef *hpcd)
         PCD_CLEAR_RX_EP_CTR(hpcd->Instance, epindex);
         ep = &hpcd->OUT_ep[epindex];
         
+        if (ep->type == EP_TYPE_ISOC)
+        {
+          PCD_EP_ISO_Receive(hpcd, ep);
+        }
         /* OUT double Buffering*/
-        if (ep->doublebuffer == 0)
+        else if (ep->doublebuffer == 0)
         {
           count = PCD_GET_EP_RX_CNT(hpcd->Instance, ep->num);
           if (count != 0)
           {
             USB_ReadPMA(hpcd->Instance, ep->xfer_buff, ep->pmaadress, count);
           }
-        }
-        else
-        {
-          if (PCD_GET_ENDPOINT(hpcd->Instance, ep->num) & USB_EP_DTOG_RX)
+          /*multi-packet on the NON control OUT endpoint*/
+          ep->xfer_count+=count;
+          ep->xfer_buff+=count;
+         
+          if ((ep->xfer_len == 0) || (count < ep->maxpacket))
           {
-            /*read from endpoint BUF0Addr buffer*/
-            count = PCD_GET_EP_DBUF0_CNT(hpcd->Instance, ep->num);
-            if (count != 0)
-            {
-              USB_ReadPMA(hpcd->Instance, ep->xfer_buff, ep->pmaaddr0, count);
-            }
+            /* RX COMPLETE */
+            HAL_PCD_DataOutStageCallback(hpcd, ep->num);
           }
           else
           {
-            /*read from endpoint BUF1Addr buffer*/
-            count = PCD_GET_EP_DBUF1_CNT(hpcd->Instance, ep->num);
-            if (count != 0)
-            {
-              USB_ReadPMA(hpcd->Instance, ep->xfer_buff, ep->pmaaddr1, count);
-            }
+            HAL_PCD_EP_Receive(hpcd, ep->num, ep->xfer_buff, ep->xfer_len);
           }
-          PCD_FreeUserBuffer(hpcd->Instance, ep->num, PCD_EP_DBUF_OUT);  
         }
-        /*multi-packet on the NON control OUT endpoint*/
-        ep->xfer_count+=count;
-        ep->xfer_buff+=count;
-       
-        if ((ep->xfer_len == 0) || (count < ep->maxpacket))
+        else if (ep->db_active == 0)
         {
-          /* RX COMPLETE */
-          HAL_PCD_DataOutStageCallback(hpcd, ep->num);
+          /* No transfer armed: the packet stays in its buffer, SW_BUF is not
+             toggled so the peripheral NAKs the next one */
+          ep->db_ready = 1;
         }
         else
         {
-          HAL_PCD_EP_Receive(hpcd, ep->num, ep->xfer_buff, ep->xfer_len);
+          PCD_EP_DB_Receive(hpcd, ep);
         }
         
       } /* if((wEPVal & EP_CTR_RX) */
@@ -1365,56 +1388,127 @@ static HAL_StatusTypeDef PCD_EP_ISR_Handler(PCD_HandleTypeDef *hpcd)
         /* clear int flag */
         PCD_CLEAR_TX_EP_CTR(hpcd->Instance, epindex);
         
+        if (ep->type == EP_TYPE_ISOC)
+        {
+          /* The packet stays loaded: it is sent again on the next IN token */
+          HAL_PCD_DataInStageCallback(hpcd, ep->num);
+        }
         /* IN double Buffering*/
-        if (ep->doublebuffer == 0)
+        else if (ep->doublebuffer == 0)
         {
           ep->xfer_count = PCD_GET_EP_TX_CNT(hpcd->Instance, ep->num);
           if (ep->xfer_count != 0)
           {
             USB_WritePMA(hpcd->Instance, ep->xfer_buff, ep->pmaadress, ep->xfer_count);
           }
-        }
-        else
-        {
-          if (PCD_GET_ENDPOINT(hpcd->Instance, ep->num) & USB_EP_DTOG_TX)
+          /*multi-packet on the NON control IN endpoint*/
+          ep->xfer_count = PCD_GET_EP_TX_CNT(hpcd->Instance, ep->num);
+          ep->xfer_buff+=ep->xfer_count;
+         
+          /* Zero Length Packet? */
+          if (ep->xfer_len == 0)
           {
-            /*read from endpoint BUF0Addr buffer*/
-            ep->xfer_count = PCD_GET_EP_DBUF0_CNT(hpcd->Instance, ep->num);
-            if (ep->xfer_count != 0)
-            {
-              USB_WritePMA(hpcd->Instance, ep->xfer_buff, ep->pmaaddr0, ep->xfer_count);
-            }
+            /* TX COMPLETE */
+            HAL_PCD_DataInStageCallback(hpcd, ep->num);
           }
           else
           {
-            /*read from endpoint BUF1Addr buffer*/
-            ep->xfer_count = PCD_GET_EP_DBUF1_CNT(hpcd->Instance, ep->num);
-            if (ep->xfer_count != 0)
-            {
-              USB_WritePMA(hpcd->Instance, ep->xfer_buff, ep->pmaaddr1, ep->xfer_count);
-            }
+            HAL_PCD_EP_Transmit(hpcd, ep->num, ep->xfer_buff, ep->xfer_len);
           }
-          PCD_FreeUserBuffer(hpcd->Instance, ep->num, PCD_EP_DBUF_IN);  
-        }
-        /*multi-packet on the NON control IN endpoint*/
-        ep->xfer_count = PCD_GET_EP_TX_CNT(hpcd->Instance, ep->num);
-        ep->xfer_buff+=ep->xfer_count;
-       
-        /* Zero Length Packet? */
-        if (ep->xfer_len == 0)
-        {
-          /* TX COMPLETE */
-          HAL_PCD_DataInStageCallback(hpcd, ep->num);
         }
         else
         {
-          HAL_PCD_EP_Transmit(hpcd, ep->num, ep->xfer_buff, ep->xfer_len);
+          PCD_EP_DB_Transmit(hpcd, ep);
         }
       } 
     }
   }
   return HAL_OK;
 }
+
+/**
+  * @brief  Read a packet received on a double buffered OUT endpoint.
+  * @param  hpcd: PCD handle
+  * @param  ep: endpoint with an armed transfer
+  * @retval None
+  */
+static void PCD_EP_DB_Receive(PCD_HandleTypeDef *hpcd, PCD_EPTypeDef *ep)
+{
+  uint16_t count = USB_DBReadPacket(hpcd->Instance, ep);
+  
+  if ((ep->xfer_len == 0) || (count < ep->maxpacket))
+  {
+    /* RX COMPLETE */
+    ep->db_active = 0;
+    HAL_PCD_DataOutStageCallback(hpcd, ep->num);
+  }
+}
+
+/**
+  * @brief  Continue the transfer of a double buffered IN endpoint after a packet was sent.
+  *         The preloaded packet is handed over first, then the free buffer is filled
+  *         while it is on the wire.
+  * @param  hpcd: PCD handle
+  * @param  ep: endpoint
+  * @retval None
+  */
+static void PCD_EP_DB_Transmit(PCD_HandleTypeDef *hpcd, PCD_EPTypeDef *ep)
+{
+  ep->db_active = 0;
+  if (ep->db_ready != 0)
+  {
+    PCD_FreeUserBuffer(hpcd->Instance, ep->num, PCD_EP_DBUF_IN);
+    ep->db_active = 1;
+    ep->db_ready = 0;
+    if (ep->xfer_len != 0)
+    {
+      USB_DBLoadPacket(hpcd->Instance, ep);
+      ep->db_ready = 1;
+    }
+  }
+  
+  if (ep->db_active == 0)
+  {
+    /* TX COMPLETE */
+    HAL_PCD_DataInStageCallback(hpcd, ep->num);
+  }
+}
+
+/**
+  * @brief  Read a packet received on an isochronous OUT endpoint.
+  *         The peripheral toggled DTOG_RX after the reception: it now receives
+  *         in the other buffer, there is no handshake and no NAK.
+  * @param  hpcd: PCD handle
+  * @param  ep: endpoint, its transfer buffer holds at least maxpacket bytes
+  * @retval None
+  */
+static void PCD_EP_ISO_Receive(PCD_HandleTypeDef *hpcd, PCD_EPTypeDef *ep)
+{
+  uint16_t count = 0;
+  uint16_t pmabuffer = 0;
+  
+  if ((PCD_GET_ENDPOINT(hpcd->Instance, ep->num) & USB_EP_DTOG_RX) != 0)
+  {
+    count = PCD_GET_EP_DBUF0_CNT(hpcd->Instance, ep->num);
+    pmabuffer = ep->pmaaddr0;
+  }
+  else
+  {
+    count = PCD_GET_EP_DBUF1_CNT(hpcd->Instance, ep->num);
+    pmabuffer = ep->pmaaddr1;
+  }
+  
+  if (count > ep->maxpacket)
+  {
+    count = ep->maxpacket;
+  }
+  if (count != 0)
+  {
+    USB_ReadPMA(hpcd->Instance, ep->xfer_buff, pmabuffer, count);
+  }
+  ep->xfer_count = count;
+  HAL_PCD_DataOutStageCallback(hpcd, ep->num);
+}
 #endif /* USB */
 
 /**
@@ -1658,14 +1658,19 @@ HAL_StatusTypeDef USB_ActivateEndpoint(USB_TypeDef *USBx, USB_EPTypeDef *ep)
     PCD_SET_EP_DBUF(USBx, ep->num);
     /*Set buffer address for double buffered mode*/
     PCD_SET_EP_DBUF_ADDR(USBx, ep->num,ep->pmaaddr0, ep->pmaaddr1);
+    ep->db_active = 0;
+    ep->db_ready = 0;
     
     if (ep->is_in==0)
     {
+      /* Both buffers receive a full packet */
+      PCD_SET_EP_DBUF_CNT(USBx, ep->num, PCD_EP_DBUF_OUT, ep->maxpacket);
+      
       /* Clear the data toggle bits for the endpoint IN/OUT*/
       PCD_CLEAR_RX_DTOG(USBx, ep->num);
       PCD_CLEAR_TX_DTOG(USBx, ep->num);
       
-      /* Reset value of the data toggle bits for the endpoint out*/
+      /* SW_BUF = 1: the peripheral receives in buffer 0, buffer 1 is free */
       PCD_TX_DTOG(USBx, ep->num);
       
       PCD_SET_EP_RX_STATUS(USBx, ep->num, USB_EP_RX_VALID);
@@ -1676,9 +1681,10 @@ HAL_StatusTypeDef USB_ActivateEndpoint(USB_TypeDef *USBx, USB_EPTypeDef *ep)
       /* Clear the data toggle bits for the endpoint IN/OUT*/
       PCD_CLEAR_RX_DTOG(USBx, ep->num);
       PCD_CLEAR_TX_DTOG(USBx, ep->num);
-      PCD_RX_DTOG(USBx, ep->num);
-      /* Configure DISABLE status for the Endpoint*/
-      PCD_SET_EP_TX_STATUS(USBx, ep->num, USB_EP_TX_DIS);
+      
+      /* SW_BUF = DTOG: both buffers are free, IN tokens are NAKed until
+         USB_EPStartXfer hands a packet over */
+      PCD_SET_EP_TX_STATUS(USBx, ep->num, USB_EP_TX_VALID);
       PCD_SET_EP_RX_STATUS(USBx, ep->num, USB_EP_RX_DIS);
     }
   }
@@ -1747,8 +1753,52 @@ HAL_StatusTypeDef USB_DeactivateEndpoint(USB_TypeDef *USBx, USB_EPTypeDef *ep)
   */
 HAL_StatusTypeDef USB_EPStartXfer(USB_TypeDef *USBx , USB_EPTypeDef *ep)
 {
-  uint16_t pmabuffer = 0;
   uint32_t len = ep->xfer_len;
+
+  /* Isochronous endpoint: the peripheral uses both buffers, selected by DTOG */
+  if (ep->type == EP_TYPE_ISOC)
+  {
+    if (ep->is_in == 1)
+    {
+      /* The packet is loaded in both buffers and sent again on every IN token
+         until the next transfer, as the rate feedback of an audio stream is */
+      if (len > ep->maxpacket)
+      {
+        len = ep->maxpacket;
+      }
+      USB_WritePMA(USBx, ep->xfer_buff, ep->pmaaddr0, len);
+      USB_WritePMA(USBx, ep->xfer_buff, ep->pmaaddr1, len);
+      *PCD_EP_TX_CNT(USBx, ep->num) = len;
+      *PCD_EP_RX_CNT(USBx, ep->num) = len;
+      ep->xfer_count = len;
+      ep->xfer_len = 0;
+    }
+    /* OUT: a packet is received every frame and read by HAL_PCD_IRQHandler */
+    return HAL_OK;
+  }
+
+  /* Double buffered bulk endpoint: one buffer is serviced while the other is on the wire */
+  if (ep->doublebuffer == 1)
+  {
+    if (ep->is_in == 1)
+    {
+      /* Hand the first packet over, then preload the second one */
+      USB_DBLoadPacket(USBx, ep);
+      PCD_FreeUserBuffer(USBx, ep->num, PCD_EP_DBUF_IN);
+      ep->db_active = 1;
+      if (ep->xfer_len != 0)
+      {
+        USB_DBLoadPacket(USBx, ep);
+        ep->db_ready = 1;
+      }
+    }
+    else
+    {
+      /* A packet already held in the PMA is read by HAL_PCD_IRQHandler */
+      ep->db_active = 1;
+    }
+    return HAL_OK;
+  }
   
   /* IN endpoint */
   if (ep->is_in == 1)
@@ -1766,29 +1816,8 @@ HAL_StatusTypeDef USB_EPStartXfer(USB_TypeDef *USBx , USB_EPTypeDef *ep)
     }
     
     /* configure and validate Tx endpoint */
-    if (ep->doublebuffer == 0) 
-    {
-      USB_WritePMA(USBx, ep->xfer_buff, ep->pmaadress, len);
-      PCD_SET_EP_TX_CNT(USBx, ep->num, len);
-    }
-    else
-    {
-      /* Write the data to the USB endpoint */
-      if (PCD_GET_ENDPOINT(USBx, ep->num)& USB_EP_DTOG_TX)
-      {
-        /* Set the Double buffer counter for pmabuffer1 */
-        PCD_SET_EP_DBUF1_CNT(USBx, ep->num, ep->is_in, len);
-        pmabuffer = ep->pmaaddr1;
-      }
-      else
-      {
-        /* Set the Double buffer counter for pmabuffer0 */
-        PCD_SET_EP_DBUF0_CNT(USBx, ep->num, ep->is_in, len);
-        pmabuffer = ep->pmaaddr0;
-      }
-      USB_WritePMA(USBx, ep->xfer_buff, pmabuffer, len);
-      PCD_FreeUserBuffer(USBx, ep->num, ep->is_in);
-    }
+    USB_WritePMA(USBx, ep->xfer_buff, ep->pmaadress, len);
+    PCD_SET_EP_TX_CNT(USBx, ep->num, len);
     
     PCD_SET_EP_TX_STATUS(USBx, ep->num, USB_EP_TX_VALID);
   }
@@ -1806,17 +1835,8 @@ HAL_StatusTypeDef USB_EPStartXfer(USB_TypeDef *USBx , USB_EPTypeDef *ep)
       ep->xfer_len =0;
     }
     
-    /* configure and validate Rx endpoint */
-    if (ep->doublebuffer == 0) 
-    {
-      /*Set RX buffer count*/
-      PCD_SET_EP_RX_CNT(USBx, ep->num, len);
-    }
-    else
-    {
-      /*Set the Double buffer counter*/
-      PCD_SET_EP_DBUF_CNT(USBx, ep->num, ep->is_in, len);
-    }
+    /*Set RX buffer count*/
+    PCD_SET_EP_RX_CNT(USBx, ep->num, len);
     
     PCD_SET_EP_RX_STATUS(USBx, ep->num, USB_EP_RX_VALID);
   }
@@ -1894,6 +1914,25 @@ HAL_StatusTypeDef USB_EPSetStall(USB_TypeDef *USBx , USB_EPTypeDef *ep)
   */
 HAL_StatusTypeDef USB_EPClearStall(USB_TypeDef *USBx, USB_EPTypeDef *ep)
 {
+  if (ep->doublebuffer == 1)
+  {
+    /* Restart from DATA0 with both buffers free, the pending packets are dropped */
+    ep->db_ready = 0;
+    PCD_CLEAR_RX_DTOG(USBx, ep->num);
+    PCD_CLEAR_TX_DTOG(USBx, ep->num);
+    if (ep->is_in)
+    {
+      ep->db_active = 0;
+      PCD_SET_EP_TX_STATUS(USBx, ep->num, USB_EP_TX_VALID);
+    }
+    else
+    {
+      PCD_TX_DTOG(USBx, ep->num);
+      PCD_SET_EP_RX_STATUS(USBx, ep->num, USB_EP_RX_VALID);
+    }
+    return HAL_OK;
+  }
+  
   if (ep->is_in)
   {
     PCD_CLEAR_TX_DTOG(USBx, ep->num);
@@ -2145,6 +2184,78 @@ void USB_ReadPMA(USB_TypeDef *USBx, uint8_t *pbUsrBuf, uint16_t wPMABufAddr, uin
   }
 }
 
+/**
+  * @brief  Copy the next packet of an IN transfer into the free buffer of a
+  *         double buffered endpoint. The buffer is handed to the peripheral
+  *         by toggling SW_BUF.
+  * @param  USBx : pointer to USB register.
+  * @param  ep: pointer to endpoint structure
+  * @retval None
+  */
+void USB_DBLoadPacket(USB_TypeDef *USBx, USB_EPTypeDef *ep)
+{
+  uint32_t len = ep->xfer_len;
+  
+  if (len > ep->maxpacket)
+  {
+    len = ep->maxpacket;
+  }
+  
+  /* SW_BUF (DTOG_RX of an IN endpoint) selects the buffer owned by the application */
+  if ((PCD_GET_ENDPOINT(USBx, ep->num) & USB_EP_DTOG_RX) != 0)
+  {
+    USB_WritePMA(USBx, ep->xfer_buff, ep->pmaaddr1, len);
+    *PCD_EP_RX_CNT(USBx, ep->num) = len;
+  }
+  else
+  {
+    USB_WritePMA(USBx, ep->xfer_buff, ep->pmaaddr0, len);
+    *PCD_EP_TX_CNT(USBx, ep->num) = len;
+  }
+  ep->xfer_buff += len;
+  ep->xfer_len -= len;
+  ep->xfer_count += len;
+}
+
+/**
+  * @brief  Take the last received packet of a double buffered OUT endpoint.
+  *         SW_BUF is toggled first: the peripheral receives the next packet
+  *         in the other buffer while this one is copied.
+  * @param  USBx : pointer to USB register.
+  * @param  ep: pointer to endpoint structure
+  * @retval Size of the packet received
+  */
+uint16_t USB_DBReadPacket(USB_TypeDef *USBx, USB_EPTypeDef *ep)
+{
+  uint16_t count = 0;
+  uint16_t pmabuffer = 0;
+  uint32_t len = 0;
+  
+  PCD_FreeUserBuffer(USBx, ep->num, PCD_EP_DBUF_OUT);
+  
+  /* SW_BUF (DTOG_TX of an OUT endpoint) now selects the filled buffer */
+  if ((PCD_GET_ENDPOINT(USBx, ep->num) & USB_EP_DTOG_TX) != 0)
+  {
+    count = PCD_GET_EP_DBUF1_CNT(USBx, ep->num);
+    pmabuffer = ep->pmaaddr1;
+  }
+  else
+  {
+    count = PCD_GET_EP_DBUF0_CNT(USBx, ep->num);
+    pmabuffer = ep->pmaaddr0;
+  }
+  
+  len = (count < ep->xfer_len) ? count : ep->xfer_len;
+  if (len != 0)
+  {
+    USB_ReadPMA(USBx, ep->xfer_buff, pmabuffer, len);
+  }
+  ep->xfer_buff += len;
+  ep->xfer_len -= len;
+  ep->xfer_count += len;
+  return count;
+}
+
 #endif /* USB */
 
 /**
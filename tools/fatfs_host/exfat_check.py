@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+# Check the exFAT images of the host test (exfat_test.c) after the writer ran.
+#
+#   exfat_check.py IMAGE...
+#
+# The volume is found at sector 0 or in the first MBR partition. Every entry
+# set reached from the root must have a valid checksum and name hash. The
+# clusters of the files (NoFatChain runs or FAT chains), of the directories,
+# of the bitmap and of the up-case table must not overlap and must be exactly
+# the clusters set in the allocation bitmap. The volume must not be dirty.
+import struct
+import sys
+
+SECTOR = 512
+
+
+def entry_set_checksum(entries):
+    checksum = 0
+    for index, byte in enumerate(entries):
+        if index in (2, 3):
+            continue
+        checksum = (((checksum & 1) << 15) + (checksum >> 1) + byte) & 0xFFFF
+    return checksum
+
+
+def name_hash(name):
+    value = 0
+    for char in name.upper():
+        for byte in struct.pack('<H', ord(char)):
+            value = (((value & 1) << 15) + (value >> 1) + byte) & 0xFFFF
+    return value
+
+
+class Volume:
+    def __init__(self, image):
+        self.image = image
+        self.base = 0
+        if image[3:11] != b'EXFAT   ':
+            self.base = struct.unpack_from('<I', image, 446 + 8)[0] * SECTOR
+        boot = image[self.base:self.base + SECTOR]
+        if boot[3:11] != b'EXFAT   ':
+            raise ValueError('no exFAT volume')
+        (self.fat_offset, _, self.heap_offset, self.clusters, self.root,
+         _, _, self.flags) = struct.unpack_from('<IIIIIIHH', boot, 80)
+        self.cluster = SECTOR << boot[109]
+        self.used = {}
+
+    def read_cluster(self, cluster):
+        start = self.base + self.heap_offset * SECTOR \
+            + (cluster - 2) * self.cluster
+        return self.image[start:start + self.cluster]
+
+    def fat(self, cluster):
+        return struct.unpack_from(
+            '<I', self.image, self.base + self.fat_offset * SECTOR + 4 * cluster)[0]
+
+    def chain(self, first, length, no_fat_chain):
+        if first == 0:
+            return []
+        if no_fat_chain:
+            return list(range(first, first + (length + self.cluster - 1) // self.cluster))
+        clusters = [first]
+        while True:
+            following = self.fat(clusters[-1])
+            if following >= 0xFFFFFFF7:
+                return clusters
+            clusters.append(following)
+
+    def claim(self, owner, clusters):
+        for cluster in clusters:
+            if not 2 <= cluster < self.clusters + 2:
+                raise ValueError('%s: cluster %d out of the heap' % (owner, cluster))
+            if cluster in self.used:
+                raise ValueError('%s: cluster %d also used by %s'
+                                 % (owner, cluster, self.used[cluster]))
+            self.used[cluster] = owner
+
+    def walk(self, path, first, length, no_fat_chain):
+        clusters = self.chain(first, length, no_fat_chain)
+        self.claim(path or '/', clusters)
+        data = b''.join(self.read_cluster(cluster) for cluster in clusters)
+        files = 0
+        position = 0
+        while position < len(data) and data[position] != 0x00:
+            kind = data[position]
+            if kind == 0x81:
+                self.bitmap = struct.unpack_from('<IQ', data, position + 20)
+            elif kind == 0x82:
+                first_cluster, size = struct.unpack_from('<IQ', data, position + 20)
+                self.claim('up-case table', self.chain(first_cluster, size, False))
+            elif kind == 0x85:
+                count = data[position + 1]
+                entries = data[position:position + 32 * (count + 1)]
+                name_length = entries[35]
+                name = ''.join(
+                    chr(struct.unpack_from('<H', entries, 64 + 32 * (index // 15) + 2 + 2 * (index % 15))[0])
+                    for index in range(name_length))
+                full = path + '/' + name
+                if struct.unpack_from('<H', entries, 2)[0] != entry_set_checksum(entries):
+                    raise ValueError('%s: bad entry set checksum' % full)
+                if struct.unpack_from('<H', entries, 36)[0] != name_hash(name):
+                    raise ValueError('%s: bad name hash' % full)
+                valid, first_cluster, size = struct.unpack_from('<Q4xIQ', entries, 40)
+                if valid > size:
+                    raise ValueError('%s: valid data length over the size' % full)
+                no_chain = bool(entries[33] & 2)
+                if struct.unpack_from('<H', entries, 4)[0] & 0x10:
+                    files += self.walk(full, first_cluster, size, no_chain)
+                else:
+                    self.claim(full, self.chain(first_cluster, size, no_chain))
+                    files += 1
+                position += 32 * count
+            position += 32
+        return files
+
+    def check(self):
+        if self.flags & 0x0002:
+            raise ValueError('volume dirty')
+        files = self.walk('', self.root, 0, False)
+        first_cluster, size = self.bitmap
+        self.claim('bitmap', self.chain(first_cluster, size, False))
+        bits = b''.join(self.read_cluster(cluster)
+                        for cluster in self.chain(first_cluster, size, False))
+        marked = {index + 2 for index in range(self.clusters)
+                  if bits[index // 8] & (1 << (index % 8))}
+        if marked != set(self.used):
+            raise ValueError('bitmap: %d clusters not allocated, %d allocated and unused'
+                             % (len(set(self.used) - marked), len(marked - set(self.used))))
+        return files, len(marked)
+
+
+def main():
+    failures = 0
+    for path in sys.argv[1:]:
+        with open(path, 'rb') as image:
+            volume = Volume(image.read())
+        try:
+            files, clusters = volume.check()
+            print('%s: %d files, %d clusters in use OK' % (path, files, clusters))
+        except ValueError as error:
+            print('%s: %s Bad!!!' % (path, error))
+            failures += 1
+    return 1 if failures or len(sys.argv) < 2 else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,154 @@
+#!/usr/bin/env python3
+# Build a 64MB exFAT image for the exFAT reader host test (exfat_test.c).
+#
+#   exfat_image.py OUTPUT [mbr]
+#
+# 4KB clusters. The root holds a deleted entry set, CONT.MP3 (contiguous,
+# NoFatChain), FRAG.MP3 and FILL.BIN (FAT chains interleaved cluster by
+# cluster) and the Music directory (NoFatChain) with "Long Name Song.mp3"
+# (FAT chain, name over 15 characters). Every file is 2MB of the pattern
+# byte[i] = (i % 4096) * 7. With "mbr" the volume starts at sector 8192 of
+# a partition of type 07h. Entry sets carry their checksum and name hash,
+# exfat_check.py checks the image.
+import struct
+import sys
+
+from exfat_check import entry_set_checksum, name_hash
+
+SECTOR = 512
+CLUSTER_SHIFT = 3
+CLUSTER = SECTOR << CLUSTER_SHIFT
+TOTAL_SECTORS = 131072
+FAT_OFFSET = 128
+HEAP_OFFSET = 2048
+CLUSTERS = (TOTAL_SECTORS - HEAP_OFFSET) >> CLUSTER_SHIFT
+FAT_LENGTH = (CLUSTERS + 2) * 4 // SECTOR + 1
+FILE_SIZE = 2 * 1024 * 1024
+MBR_OFFSET = 8192
+
+image = bytearray(TOTAL_SECTORS * SECTOR)
+fat = [0] * (CLUSTERS + 2)
+fat[0] = 0xFFFFFFF8
+fat[1] = 0xFFFFFFFF
+next_cluster = 2
+
+
+def allocate(count):
+    global next_cluster
+    first = next_cluster
+    next_cluster += count
+    return first
+
+
+def chain(clusters):
+    for current, following in zip(clusters, clusters[1:]):
+        fat[current] = following
+    fat[clusters[-1]] = 0xFFFFFFFF
+
+
+def write_cluster(cluster, offset, data):
+    start = (HEAP_OFFSET + ((cluster - 2) << CLUSTER_SHIFT)) * SECTOR + offset
+    image[start:start + len(data)] = data
+
+
+def write_file(clusters, data):
+    for index, cluster in enumerate(clusters):
+        write_cluster(cluster, 0, data[index * CLUSTER:(index + 1) * CLUSTER])
+
+
+def entry_set(name, first, length, no_fat_chain, directory=False):
+    names = (len(name) + 14) // 15
+    entries = bytearray(32 * (2 + names))
+    entries[0] = 0x85
+    entries[1] = 1 + names
+    struct.pack_into('<H', entries, 4, 0x10 if directory else 0x20)
+    entries[32] = 0xC0
+    entries[33] = 1 | (2 if no_fat_chain else 0)
+    entries[35] = len(name)
+    struct.pack_into('<Q', entries, 40, length)
+    struct.pack_into('<I', entries, 52, first)
+    struct.pack_into('<Q', entries, 56, length)
+    for index in range(names):
+        offset = 64 + 32 * index
+        entries[offset] = 0xC1
+        for position, char in enumerate(name[index * 15:(index + 1) * 15]):
+            struct.pack_into('<H', entries, offset + 2 + 2 * position, ord(char))
+    struct.pack_into('<H', entries, 36, name_hash(name))
+    struct.pack_into('<H', entries, 2, entry_set_checksum(entries))
+    return entries
+
+
+data = bytes(((i % 4096) * 7) & 0xFF for i in range(FILE_SIZE))
+file_clusters = FILE_SIZE // CLUSTER
+
+bitmap = allocate(1)
+chain([bitmap])
+upcase = allocate(1)
+chain([upcase])
+root = allocate(1)
+chain([root])
+
+contiguous = allocate(file_clusters)
+write_file(range(contiguous, contiguous + file_clusters), data)
+
+fragmented = []
+filler = []
+for _ in range(file_clusters):
+    fragmented.append(allocate(1))
+    filler.append(allocate(1))
+chain(fragmented)
+chain(filler)
+write_file(fragmented, data)
+write_file(filler, data)
+
+music = allocate(1)
+song = list(range(allocate(file_clusters), next_cluster))
+chain(song)
+write_file(song, data)
+write_cluster(music, 0, entry_set("Long Name Song.mp3", song[0], FILE_SIZE, False))
+
+entries = bytearray(32)
+entries[0] = 0x83                                  # Volume label, empty
+allocation_bitmap = bytearray(32)
+allocation_bitmap[0] = 0x81
+struct.pack_into('<IQ', allocation_bitmap, 20, bitmap, (CLUSTERS + 7) // 8)
+entries += allocation_bitmap
+upcase_table = bytearray(32)
+upcase_table[0] = 0x82
+struct.pack_into('<IQ', upcase_table, 20, upcase, 128)
+entries += upcase_table
+deleted = entry_set("CONT.MP3", 999, 1, True)
+deleted[0] = 0x05
+deleted[32] = 0x40
+entries += deleted
+entries += entry_set("CONT.MP3", contiguous, FILE_SIZE, True)
+entries += entry_set("FRAG.MP3", fragmented[0], FILE_SIZE, False)
+entries += entry_set("FILL.BIN", filler[0], FILE_SIZE, False)
+entries += entry_set("Music", music, CLUSTER, True, True)
+write_cluster(root, 0, entries)
+
+bits = bytearray((CLUSTERS + 7) // 8)
+for cluster in range(2, next_cluster):
+    bits[(cluster - 2) // 8] |= 1 << ((cluster - 2) % 8)
+write_cluster(bitmap, 0, bits[:CLUSTER])
+
+for index, value in enumerate(fat[:next_cluster + 1]):
+    struct.pack_into('<I', image, FAT_OFFSET * SECTOR + 4 * index, value)
+
+boot = bytearray(SECTOR)
+boot[0:11] = b'\xEB\x76\x90EXFAT   '
+struct.pack_into('<QQIIIIIIHHBBBBB', boot, 64, 0, TOTAL_SECTORS, FAT_OFFSET,
+                 FAT_LENGTH, HEAP_OFFSET, CLUSTERS, root, 0x1234, 0x100, 0,
+                 9, CLUSTER_SHIFT, 1, 0x80, 0)
+boot[510:512] = b'\x55\xAA'
+image[0:SECTOR] = boot
+
+if len(sys.argv) > 2 and sys.argv[2] == 'mbr':
+    mbr = bytearray(SECTOR)
+    mbr[446 + 4] = 0x07
+    struct.pack_into('<II', mbr, 446 + 8, MBR_OFFSET, TOTAL_SECTORS)
+    mbr[510:512] = b'\x55\xAA'
+    image = mbr + bytearray((MBR_OFFSET - 1) * SECTOR) + image
+
+with open(sys.argv[1], 'wb') as output:
+    output.write(image)
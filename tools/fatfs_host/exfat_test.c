@@ -0,0 +1,280 @@
+/**
+ ****************************************************************************
+ * @file        exfat_test.c
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       Host test of the read-only exFAT reader (lib/fatfs/src/exfat.c).
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/*
+ * Mount the images built by exfat_image.py (bare and behind an MBR) with the
+ * exFAT reader and stream their files as the song player does: 2 sectors per
+ * refill, the position mapped by exfat_mapSector(). The data must match the
+ * pattern of the image, a NoFatChain file must be mapped without any FAT
+ * read, paths must resolve case-insensitively and FatFs itself must report
+ * FR_NO_FILESYSTEM (the player falls back to the reader on this result).
+ *
+ * Then record files with exfat_create() and exfat_close(): the recording
+ * must be contiguous, read back with its recorded size, and a file that
+ * exists or does not fit must be refused. The image is saved with the
+ * ".rec" suffix, exfat_check.py checks its entry sets and its bitmap.
+ *
+ * Build and run:  make -C tools/fatfs_host check
+ */
+/* Includes ------------------------------------------------------------------*/
+#include "ff.h"
+#include "diskio.h"
+#include "exfat.h"
+#include "ram_diskio.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define EXFAT_FILE_SIZE			(2 * 1024 * 1024) /*!< Size of every file of the image */
+#define EXFAT_STREAM_SECTORS	(2) /*!< Sectors per refill of the song player */
+#define EXFAT_RECORD_SIZE		(3 * 1024 * 1024) /*!< Maximum size of the recording */
+#define EXFAT_RECORDED_SIZE		(EXFAT_FILE_SIZE + 5000) /*!< Size written, not a cluster multiple */
+
+/* Private variables ---------------------------------------------------------*/
+static BYTE g_pui8Stream[EXFAT_STREAM_SECTORS * RAM_IMAGE_SECTOR_SIZE];
+
+/* Private function prototypes -----------------------------------------------*/
+/**
+ * @brief  Stream a file through exfat_mapSector() and check its data.
+ * @param  pVolume: mounted volume
+ * @param  pcPath: file path
+ * @param  bNoFatChain: expected NoFatChain flag of the file
+ * @param  ui32Size: expected size of the file
+ * @retval int: number of failed checks
+ */
+static int exfat_testStream(exfat_volume_t *pVolume, const char *pcPath,
+		bool bNoFatChain, DWORD ui32Size)
+{
+	exfat_file_t file;
+	DWORD ui32Position;
+	DWORD ui32FatReads;
+	DWORD ui32Sector;
+	DWORD ui32Count;
+	DWORD ui32Done;
+	DWORD i;
+	bool bDataOk = true;
+
+	if (!exfat_open(pVolume, pcPath, &file))
+	{
+		printf("  %s: open Bad!!!\n", pcPath);
+		return 1;
+	}
+	ui32FatReads = pVolume->ui32FatReads;
+	for (ui32Position = 0; bDataOk && (ui32Position < file.ui32Size);
+			ui32Position += sizeof(g_pui8Stream))
+	{
+		for (ui32Done = 0; bDataOk && (ui32Done < EXFAT_STREAM_SECTORS)
+				&& ((ui32Position + ui32Done * RAM_IMAGE_SECTOR_SIZE)
+						< file.ui32Size); ui32Done += ui32Count)
+		{
+			if (!exfat_mapSector(&file,
+					ui32Position + ui32Done * RAM_IMAGE_SECTOR_SIZE,
+					&ui32Sector, &ui32Count)
+					|| (RES_OK != disk_read(0,
+							&g_pui8Stream[ui32Done * RAM_IMAGE_SECTOR_SIZE],
+							ui32Sector, 1)))
+			{
+				bDataOk = false;
+			}
+			ui32Count = 1;
+		}
+		for (i = 0; bDataOk && (i < sizeof(g_pui8Stream))
+				&& ((ui32Position + i) < file.ui32Size); i++)
+		{
+			bDataOk = (g_pui8Stream[i] == (BYTE) (((ui32Position + i) % 4096) * 7));
+		}
+	}
+	ui32FatReads = pVolume->ui32FatReads - ui32FatReads;
+	printf("  %s: %u FAT reads ", pcPath, (unsigned) ui32FatReads);
+	if (bDataOk && (ui32Size == file.ui32Size)
+			&& (bNoFatChain == file.bNoFatChain)
+			&& (bNoFatChain == (0 == ui32FatReads)))
+	{
+		printf("OK\n");
+		return 0;
+	}
+	printf("Bad!!!\n");
+	return 1;
+}
+
+/**
+ * @brief  Record a file with the pattern of the image.
+ * @param  pVolume: mounted volume
+ * @param  pcPath: file path
+ * @param  ui32Size: maximum size given to exfat_create()
+ * @param  ui32Recorded: size written and given to exfat_close()
+ * @retval int: number of failed checks
+ */
+static int exfat_testRecord(exfat_volume_t *pVolume, const char *pcPath,
+		DWORD ui32Size, DWORD ui32Recorded)
+{
+	exfat_file_t file;
+	exfat_file_t opened;
+	DWORD ui32Position;
+	DWORD ui32Sector;
+	DWORD ui32Count;
+	DWORD i;
+	bool bDataOk = true;
+
+	if (!exfat_create(pVolume, pcPath, ui32Size, &file) || !file.bNoFatChain)
+	{
+		printf("  %s: create Bad!!!\n", pcPath);
+		return 1;
+	}
+	for (ui32Position = 0; bDataOk && (ui32Position < ui32Recorded);
+			ui32Position += RAM_IMAGE_SECTOR_SIZE)
+	{
+		for (i = 0; i < RAM_IMAGE_SECTOR_SIZE; i++)
+		{
+			g_pui8Stream[i] = (BYTE) (((ui32Position + i) % 4096) * 7);
+		}
+		bDataOk = exfat_mapSector(&file, ui32Position, &ui32Sector, &ui32Count)
+				&& (RES_OK == disk_write(0, g_pui8Stream, ui32Sector, 1));
+	}
+	if (!bDataOk || exfat_close(&file, ui32Size + 1)
+			|| !exfat_close(&file, ui32Recorded) || exfat_close(&file, 0)
+			|| !exfat_open(pVolume, pcPath, &opened)
+			|| exfat_close(&opened, 0))
+	{
+		printf("  %s: record Bad!!!\n", pcPath);
+		return 1;
+	}
+	return exfat_testStream(pVolume, pcPath, true, ui32Recorded);
+}
+
+/**
+ * @brief  Save the RAM image to a file.
+ * @param  pcImage: image file name, saved with the ".rec" suffix
+ * @retval int: number of failed checks
+ */
+static int exfat_saveImage(const char *pcImage)
+{
+	char pcName[256];
+	FILE *pImage;
+	size_t uiWritten = 0;
+
+	snprintf(pcName, sizeof(pcName), "%s.rec", pcImage);
+	pImage = fopen(pcName, "wb");
+	if (NULL != pImage)
+	{
+		uiWritten = fwrite(g_pui8RamImage, RAM_IMAGE_SECTOR_SIZE,
+				g_ui32RamImageSectors, pImage);
+		fclose(pImage);
+	}
+	if (g_ui32RamImageSectors != uiWritten)
+	{
+		printf("  %s: save Bad!!!\n", pcName);
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * @brief  Run the test on one image file.
+ * @param  pcImage: image file name
+ * @retval int: number of failed checks
+ */
+static int exfat_testImage(const char *pcImage)
+{
+	exfat_volume_t volume;
+	exfat_file_t file;
+	FATFS fatFs;
+	FILE *pImage;
+	int iFailures = 0;
+
+	memset(g_pui8RamImage, 0, sizeof(g_pui8RamImage));
+	pImage = fopen(pcImage, "rb");
+	if (NULL == pImage)
+	{
+		printf("%s: missing Bad!!!\n", pcImage);
+		return 1;
+	}
+	g_ui32RamImageSectors = fread(g_pui8RamImage, RAM_IMAGE_SECTOR_SIZE,
+			RAM_IMAGE_MAX_SECTORS, pImage);
+	fclose(pImage);
+	diskio_setMediumRemoved(0);
+	disk_initialize(0);
+
+	printf("%s:\n", pcImage);
+	if ((FR_NO_FILESYSTEM != f_mount(&fatFs, "0:", 1))
+			|| !exfat_mount(&volume, 0))
+	{
+		printf("  mount Bad!!!\n");
+		f_mount(NULL, "0:", 0);
+		return 1;
+	}
+	f_mount(NULL, "0:", 0);
+
+	if (exfat_open(&volume, "NOPE.MP3", &file)
+			|| exfat_open(&volume, "CONT.MP3/x", &file)
+			|| !exfat_open(&volume, "0:/cont.mp3", &file))
+	{
+		printf("  paths Bad!!!\n");
+		iFailures++;
+	}
+	iFailures += exfat_testStream(&volume, "CONT.MP3", true, EXFAT_FILE_SIZE);
+	iFailures += exfat_testStream(&volume, "FRAG.MP3", false, EXFAT_FILE_SIZE);
+	iFailures += exfat_testStream(&volume, "/music/long name song.MP3", false,
+			EXFAT_FILE_SIZE);
+
+	/* Recordings: in a subdirectory with a long name, in the root, empty */
+	iFailures += exfat_testRecord(&volume, "0:/Music/Recording of the day.wav",
+			EXFAT_RECORD_SIZE, EXFAT_RECORDED_SIZE);
+	iFailures += exfat_testRecord(&volume, "REC.WAV", EXFAT_RECORD_SIZE,
+			RAM_IMAGE_SECTOR_SIZE);
+	if (exfat_create(&volume, "/music/RECORDING OF THE DAY.WAV", 4096, &file)
+			|| exfat_create(&volume, "NOPE/REC.WAV", 4096, &file)
+			|| exfat_create(&volume, "BAD?.WAV", 4096, &file)
+			|| exfat_create(&volume, "HUGE.WAV", 0xFFFFFFFF, &file)
+			|| !exfat_create(&volume, "EMPTY.WAV", 4096, &file)
+			|| !exfat_close(&file, 0)
+			|| !exfat_open(&volume, "EMPTY.WAV", &file)
+			|| (0 != file.ui32Size) || (0 != file.ui32FirstCluster))
+	{
+		printf("  create refusals Bad!!!\n");
+		iFailures++;
+	}
+	return iFailures + exfat_saveImage(pcImage);
+}
+
+/* Exported functions prototype ----------------------------------------------*/
+int main(int argc, char **argv)
+{
+	int iFailures = 0;
+	int i;
+
+	for (i = 1; i < argc; i++)
+	{
+		iFailures += exfat_testImage(argv[i]);
+	}
+	return ((1 < argc) && (0 == iFailures)) ? (0) : (1);
+}
+
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
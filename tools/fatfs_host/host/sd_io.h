@@ -0,0 +1,78 @@
+/**
+ ****************************************************************************
+ * @file        sd_io.h
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       Host stand-in of the SD I/O controller header for the FatFs tests.
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef SDIO_H_
+#define SDIO_H_
+
+/* Includes ------------------------------------------------------------------*/
+/* ffconf.h includes the SD I/O header for the HAL: the tick and the interrupt
+ mask are variables of the test, the interrupts never run */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Exported macro ------------------------------------------------------------*/
+#define UNUSED(x)			((void) (x))
+#define __weak				__attribute__((weak))
+
+/* Exported variables --------------------------------------------------------*/
+extern uint32_t g_ui32HostTick; /*!< HAL_GetTick() value */
+extern uint32_t g_ui32HostPrimask; /*!< __get_PRIMASK() value */
+
+/* Exported functions --------------------------------------------------------*/
+static inline uint32_t HAL_GetTick(void)
+{
+	return g_ui32HostTick;
+}
+
+static inline uint32_t __get_PRIMASK(void)
+{
+	return g_ui32HostPrimask;
+}
+
+static inline uint32_t __get_IPSR(void)
+{
+	return 0; /* Thread mode */
+}
+
+static inline void __set_PRIMASK(uint32_t ui32Primask)
+{
+	g_ui32HostPrimask = ui32Primask;
+}
+
+static inline void __disable_irq(void)
+{
+	g_ui32HostPrimask = 1;
+}
+
+#endif /* SDIO_H_ */
+
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
@@ -0,0 +1,114 @@
+/**
+ ****************************************************************************
+ * @file        ram_diskio.c
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       Host stand-in of the SD disk I/O driver backed by a RAM image.
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/* Includes ------------------------------------------------------------------*/
+#include "ram_diskio.h"
+#include "sd_diskio.h"
+#include "ff.h"
+#include <string.h>
+
+/* Exported variables --------------------------------------------------------*/
+uint32_t g_ui32HostTick = 0;
+uint32_t g_ui32HostPrimask = 0;
+uint8_t g_pui8RamImage[RAM_IMAGE_MAX_SECTORS * RAM_IMAGE_SECTOR_SIZE];
+DWORD g_ui32RamImageSectors = RAM_IMAGE_MAX_SECTORS;
+
+/* Exported functions prototype ----------------------------------------------*/
+DSTATUS diskio_sd_initialize(BYTE lun)
+{
+	UNUSED(lun);
+	return 0;
+}
+
+DSTATUS diskio_sd_status(BYTE lun)
+{
+	UNUSED(lun);
+	return 0;
+}
+
+DRESULT diskio_sd_read(BYTE lun, BYTE *buff, DWORD sector, UINT count)
+{
+	UNUSED(lun);
+	if ((sector + count) > g_ui32RamImageSectors)
+	{
+		return RES_PARERR;
+	}
+	memcpy(buff, &g_pui8RamImage[(size_t) sector * RAM_IMAGE_SECTOR_SIZE],
+			(size_t) count * RAM_IMAGE_SECTOR_SIZE);
+	return RES_OK;
+}
+
+DRESULT diskio_sd_write(BYTE lun, const BYTE *buff, DWORD sector, UINT count)
+{
+	UNUSED(lun);
+	if ((sector + count) > g_ui32RamImageSectors)
+	{
+		return RES_PARERR;
+	}
+	memcpy(&g_pui8RamImage[(size_t) sector * RAM_IMAGE_SECTOR_SIZE], buff,
+			(size_t) count * RAM_IMAGE_SECTOR_SIZE);
+	return RES_OK;
+}
+
+DRESULT diskio_sd_ioctl(BYTE lun, BYTE cmd, void *buff)
+{
+	DWORD *pui32Range = (DWORD *) buff;
+
+	UNUSED(lun);
+	switch (cmd)
+	{
+	case CTRL_SYNC:
+		return RES_OK;
+
+	case CTRL_TRIM:
+		/* Erased sectors read as 0xFF, as on most SD cards */
+		memset(&g_pui8RamImage[(size_t) pui32Range[0] * RAM_IMAGE_SECTOR_SIZE],
+				0xFF, (size_t) (pui32Range[1] - pui32Range[0] + 1)
+						* RAM_IMAGE_SECTOR_SIZE);
+		return RES_OK;
+
+	case GET_SECTOR_COUNT:
+		*(DWORD *) buff = g_ui32RamImageSectors;
+		return RES_OK;
+
+	case GET_SECTOR_SIZE:
+		*(WORD *) buff = RAM_IMAGE_SECTOR_SIZE;
+		return RES_OK;
+
+	case GET_BLOCK_SIZE:
+		*(DWORD *) buff = 1;
+		return RES_OK;
+
+	default:
+		return RES_PARERR;
+	}
+}
+
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
@@ -0,0 +1,49 @@
+/**
+ ****************************************************************************
+ * @file        ram_diskio.h
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       This is the header of the RAM image used by the FatFs host tests.
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef RAM_DISKIO_H_
+#define RAM_DISKIO_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "diskio.h"
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define RAM_IMAGE_SECTOR_SIZE	(512)
+#define RAM_IMAGE_MAX_SECTORS	(139264) /*!< 68MB: the exFAT test image behind its MBR */
+
+/* Exported variables --------------------------------------------------------*/
+extern uint8_t g_pui8RamImage[RAM_IMAGE_MAX_SECTORS * RAM_IMAGE_SECTOR_SIZE];
+extern DWORD g_ui32RamImageSectors; /*!< Size of the card seen by FatFs */
+
+#endif /* RAM_DISKIO_H_ */
+
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
@@ -0,0 +1,239 @@
+/**
+ ****************************************************************************
+ * @file        scanfree_test.c
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       Host test of the background free cluster scan (f_scanfree).
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/*
+ * Format a RAM image as FAT12, FAT16 and FAT32, create files, then count the
+ * free clusters with f_scanfree() FREE_SCAN_SECTORS FAT sectors at a time while
+ * files are created and deleted in the middle of the scan. The result must
+ * match a full f_getfree() count, be written back to FSINFO (FAT32) and the
+ * scan must restart after a medium change.
+ *
+ * Build and run:  make -C tools/fatfs_host check
+ */
+/* Includes ------------------------------------------------------------------*/
+#include "ff.h"
+#include "diskio.h"
+#include "ram_diskio.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Private typedef -----------------------------------------------------------*/
+/**
+ * @struct _scanfree_format_t
+ * This type define one volume format of the test.
+ */
+typedef struct _scanfree_format_t
+{
+	const char *pcName;
+	BYTE ui8FsType; /*!< Expected FS_FATxx */
+	DWORD ui32Sectors; /*!< Image size */
+	UINT uiAllocationUnit; /*!< f_mkfs() cluster size in byte */
+} scanfree_format_t;
+
+/* Private define ------------------------------------------------------------*/
+#define FREE_SCAN_SECTORS		(2) /*!< Same step as the main loop (app/src/main.c) */
+#define SCANFREE_FILES			(20)
+
+/* Private variables ---------------------------------------------------------*/
+static const scanfree_format_t g_pFormat[] =
+{
+{ "FAT12", FS_FAT12, 8192, 4096 },
+{ "FAT16", FS_FAT16, 8192, 512 },
+{ "FAT32", FS_FAT32, 73728, 512 } };
+static FATFS g_fatFs;
+static BYTE g_pui8FileData[65536];
+
+/* Private function prototypes -----------------------------------------------*/
+/**
+ * @brief  Create a file of the given size.
+ * @param  pcName: file name
+ * @param  uiSize: file size in byte
+ * @retval FRESULT: FatFs result
+ */
+static FRESULT scanfree_createFile(const char *pcName, UINT uiSize)
+{
+	FIL file;
+	UINT uiWritten;
+	FRESULT eResult;
+
+	eResult = f_open(&file, pcName, FA_CREATE_ALWAYS | FA_WRITE);
+	if (FR_OK == eResult)
+	{
+		eResult = f_write(&file, g_pui8FileData, uiSize, &uiWritten);
+		f_close(&file);
+	}
+	return eResult;
+}
+
+/**
+ * @brief  Count the free clusters with a full FAT scan.
+ * @retval DWORD: number of free clusters
+ */
+static DWORD scanfree_countAll(void)
+{
+	DWORD ui32Saved = g_fatFs.free_clust;
+	DWORD ui32Free = 0;
+	FATFS *pFatFs;
+
+	g_fatFs.free_clust = 0xFFFFFFFF;
+	f_getfree("0:", &ui32Free, &pFatFs);
+	g_fatFs.free_clust = ui32Saved;
+	return ui32Free;
+}
+
+/**
+ * @brief  Read the free cluster count of the FSINFO sector.
+ * @retval DWORD: FSI_Free_Count
+ */
+static DWORD scanfree_readFsInfo(void)
+{
+	BYTE pui8Sector[RAM_IMAGE_SECTOR_SIZE];
+
+	disk_read(0, pui8Sector, g_fatFs.volbase + 1, 1);
+	return (DWORD) pui8Sector[488] | ((DWORD) pui8Sector[489] << 8)
+			| ((DWORD) pui8Sector[490] << 16) | ((DWORD) pui8Sector[491] << 24);
+}
+
+/**
+ * @brief  Run the test on one volume format.
+ * @param  pFormat: volume format
+ * @retval int: number of failed checks
+ */
+static int scanfree_testFormat(const scanfree_format_t *pFormat)
+{
+	BYTE pui8Sector[RAM_IMAGE_SECTOR_SIZE];
+	char pcName[8];
+	DWORD ui32Free;
+	DWORD ui32Full;
+	FATFS *pFatFs;
+	int iCalls = 0;
+	int iFailures = 0;
+	int i;
+
+	g_ui32RamImageSectors = pFormat->ui32Sectors;
+	memset(g_pui8RamImage, 0, sizeof(g_pui8RamImage));
+	f_mount(&g_fatFs, "0:", 0);
+	if ((FR_OK != f_mkfs("0:", 0, pFormat->uiAllocationUnit))
+			|| (FR_OK != f_mount(&g_fatFs, "0:", 1))
+			|| (pFormat->ui8FsType != g_fatFs.fs_type))
+	{
+		printf("%s: format Bad!!!\n", pFormat->pcName);
+		return 1;
+	}
+	for (i = 0; i < SCANFREE_FILES; i++)
+	{
+		snprintf(pcName, sizeof(pcName), "F%d", i);
+		scanfree_createFile(pcName, 1000 * i + 1);
+	}
+
+	/* Invalidate the FSINFO count so that FAT32 is scanned too, then remount.
+	 The count is out of range but not 0xFFFFFFFF, as left by some formatters */
+	if (FS_FAT32 == g_fatFs.fs_type)
+	{
+		disk_read(0, pui8Sector, g_fatFs.volbase + 1, 1);
+		memset(&pui8Sector[488], 0xFF, 4);
+		pui8Sector[488] = 0xF0;
+		disk_write(0, pui8Sector, g_fatFs.volbase + 1, 1);
+	}
+	diskio_setMediumChanged(0);
+
+	/* A query alone never scans */
+	f_scanfree("0:", 0, &ui32Free, &pFatFs);
+	if ((0xFFFFFFFF != ui32Free) || (0 != g_fatFs.scan_clust))
+	{
+		printf("%s: query %u Bad!!!\n", pFormat->pcName, (unsigned) ui32Free);
+		iFailures++;
+	}
+
+	/* Clusters allocated and freed on both sides of the scan position */
+	do
+	{
+		f_scanfree("0:", FREE_SCAN_SECTORS, &ui32Free, &pFatFs);
+		iCalls++;
+		if (3 == iCalls)
+		{
+			scanfree_createFile("NEW", 65000);
+			f_unlink("F3");
+		}
+		if (6 == iCalls)
+		{
+			f_unlink("F19");
+			scanfree_createFile("NEW2", 50000);
+		}
+	} while ((0xFFFFFFFF == ui32Free) && (100000 > iCalls));
+
+	ui32Full = scanfree_countAll();
+	printf("%s: %d calls, scan %u, full %u ", pFormat->pcName, iCalls,
+			(unsigned) ui32Free, (unsigned) ui32Full);
+	if (ui32Free != ui32Full)
+	{
+		printf("Bad!!!\n");
+		iFailures++;
+	}
+	else
+	{
+		printf("OK\n");
+	}
+
+	if ((FS_FAT32 == g_fatFs.fs_type) && (ui32Full != scanfree_readFsInfo()))
+	{
+		printf("%s: FSINFO %u Bad!!!\n", pFormat->pcName,
+				(unsigned) scanfree_readFsInfo());
+		iFailures++;
+	}
+
+	/* A medium change restarts the scan, FAT32 takes the count from FSINFO */
+	diskio_setMediumChanged(0);
+	f_scanfree("0:", 0, &ui32Free, &pFatFs);
+	if ((0 != g_fatFs.scan_clust) || (ui32Free
+			!= ((FS_FAT32 == g_fatFs.fs_type) ? (ui32Full) : (0xFFFFFFFF))))
+	{
+		printf("%s: remount %u Bad!!!\n", pFormat->pcName, (unsigned) ui32Free);
+		iFailures++;
+	}
+
+	f_mount(NULL, "0:", 0);
+	return iFailures;
+}
+
+/* Exported functions prototype ----------------------------------------------*/
+int main(void)
+{
+	int iFailures = 0;
+	unsigned i;
+
+	for (i = 0; i < (sizeof(g_pFormat) / sizeof(g_pFormat[0])); i++)
+	{
+		iFailures += scanfree_testFormat(&g_pFormat[i]);
+	}
+	return (0 == iFailures) ? (0) : (1);
+}
+
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
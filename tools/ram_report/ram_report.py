@@ -0,0 +1,190 @@
+#!/usr/bin/env python3
+# Static RAM (.data + .bss) of the firmware sources, per object and in total.
+#
+#   ram_report.py [-D NAME[=VALUE]]... [REV [REV]]
+#
+# No revision: the working tree is measured. One revision: the revision and
+# the working tree are compared. Two revisions: the two are compared. -D is
+# passed to the compiler, e.g. -D USBD_AUDIO_ENABLE=1 for the speaker build.
+# A comparison only lists the objects which changed.
+#
+# No ARM toolchain is needed: the sources of app/, bsp/, lib/ and system/
+# are compiled by the host gcc with -m32 (ILP32 as the Cortex-M3), the
+# Cortex-M inline assembly (#APP blocks) is dropped before assembling. These
+# are not the figures of an arm-none-eabi linker map: the code generation
+# and the alignment of 64-bit types differ, objects the linker would discard
+# (--gc-sections) are counted. The RAM left for the heap is LENGTH(RAM) of
+# ldscripts/mem.ld minus the static RAM and __Main_Stack_Size of
+# ldscripts/sections.ld. The newlib system calls are not measured (they need
+# the newlib headers), without semihosting they only hold errno and environ.
+import argparse
+import concurrent.futures
+import os
+import re
+import subprocess
+import sys
+import tarfile
+import tempfile
+
+SOURCE_DIRECTORIES = ('app', 'bsp', 'lib', 'system')
+SKIPPED = ('system/src/newlib/_syscalls.c',)
+DEFINES = ['STM32F103xB']
+DATA_SECTION = re.compile(r'^\.(data|bss)(\.|\s)')
+
+
+def git_root():
+    return subprocess.check_output(['git', 'rev-parse', '--show-toplevel'],
+                                   text=True).strip()
+
+
+def export_tree(revision, directory):
+    archive = subprocess.Popen(['git', 'archive', revision, 'app', 'bsp',
+                                'lib', 'system', 'ldscripts'],
+                               stdout=subprocess.PIPE, cwd=git_root())
+    with tarfile.open(fileobj=archive.stdout, mode='r|') as tar:
+        tar.extractall(directory)
+    if archive.wait() != 0:
+        sys.exit('ram_report: cannot export %s' % revision)
+
+
+def sources(tree):
+    for top in SOURCE_DIRECTORIES:
+        for directory, _, files in os.walk(os.path.join(tree, top)):
+            for name in sorted(files):
+                source = os.path.relpath(os.path.join(directory, name), tree)
+                if name.endswith('.c') and source not in SKIPPED:
+                    yield source
+
+
+def include_flags(tree):
+    flags = []
+    for top in SOURCE_DIRECTORIES:
+        for directory, _, _ in sorted(os.walk(os.path.join(tree, top))):
+            if os.path.basename(directory) in ('inc', 'Inc'):
+                flags.append('-I' + directory)
+    return flags + ['-I' + os.path.join(tree, 'system/inc/stm32f1xx'),
+                    '-I' + os.path.join(tree, 'system/inc/cmsis')]
+
+
+def measure_object(tree, source, flags, work):
+    """Return (.data, .bss) of one source, None if it does not build."""
+    base = os.path.join(work, source.replace('/', '_'))
+    compiled = subprocess.run(['gcc', '-m32', '-Os', '-std=gnu11', '-w',
+                               '-fno-common', '-fno-pic', '-fno-pie',
+                               '-S', '-o', base + '.s',
+                               os.path.join(tree, source)] + flags,
+                              capture_output=True, text=True)
+    if compiled.returncode != 0:
+        return None
+    with open(base + '.s') as assembly:
+        lines = assembly.readlines()
+    kept = []
+    inline = False
+    for line in lines:
+        if line.startswith('#APP'):
+            inline = True
+        elif line.startswith('#NO_APP'):
+            inline = False
+        elif not inline:
+            kept.append(line)
+    assembled = subprocess.run(['as', '--32', '-o', base + '.o'],
+                               input=''.join(kept), capture_output=True,
+                               text=True)
+    if assembled.returncode != 0:
+        return None
+    data = bss = 0
+    for line in subprocess.check_output(['size', '-A', base + '.o'],
+                                        text=True).splitlines():
+        match = DATA_SECTION.match(line)
+        if match:
+            size = int(line.split()[1])
+            if match.group(1) == 'data':
+                data += size
+            else:
+                bss += size
+    return data, bss
+
+
+def measure_tree(tree, defines):
+    with tempfile.TemporaryDirectory() as work:
+        # The host glibc headers need gnu/stubs-32.h with -m32, an empty one
+        # is enough as no libc function is linked.
+        os.makedirs(os.path.join(work, 'gnu'))
+        open(os.path.join(work, 'gnu', 'stubs-32.h'), 'w').close()
+        flags = (['-D' + define for define in DEFINES + defines]
+                 + ['-isystem', work, '-isystem',
+                    '/usr/include/x86_64-linux-gnu'] + include_flags(tree))
+        files = list(sources(tree))
+        with concurrent.futures.ThreadPoolExecutor(os.cpu_count()) as pool:
+            sizes = pool.map(lambda source: measure_object(tree, source,
+                                                           flags, work),
+                             files)
+            return dict(zip(files, sizes))
+
+
+def linker_value(tree, script, pattern):
+    with open(os.path.join(tree, 'ldscripts', script)) as ld:
+        match = re.search(pattern, ld.read())
+    value = int(match.group(1))
+    return value * 1024 if match.group(0).rstrip().endswith('K') else value
+
+
+def measure(revision, defines):
+    if revision is None:
+        tree = git_root()
+        return measure_tree(tree, defines), tree, None
+    directory = tempfile.TemporaryDirectory()
+    export_tree(revision, directory.name)
+    return measure_tree(directory.name, defines), directory.name, directory
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Static RAM per object.')
+    parser.add_argument('-D', dest='defines', action='append', default=[])
+    parser.add_argument('revisions', nargs='*', metavar='REV')
+    arguments = parser.parse_args()
+    if len(arguments.revisions) > 2:
+        parser.error('at most two revisions')
+    revisions = arguments.revisions + [None] * (
+        2 - len(arguments.revisions) if arguments.revisions else 1)
+
+    results = [measure(revision, arguments.defines) for revision in revisions]
+    names = [revision or 'work tree' for revision in revisions]
+    failed = sorted(source for sizes, _, _ in results
+                    for source, size in sizes.items() if size is None)
+    objects = sorted(set().union(*(sizes for sizes, _, _ in results)))
+
+    header = '%-44s' % 'object'
+    for name in names:
+        header += ' %20s' % ('%.12s data/bss' % name)
+    print(header)
+    totals = [[0, 0] for _ in results]
+    for source in objects:
+        row = [sizes.get(source) or (0, 0) for sizes, _, _ in results]
+        for total, (data, bss) in zip(totals, row):
+            total[0] += data
+            total[1] += bss
+        if any(data or bss for data, bss in row) and (
+                len(row) == 1 or row[0] != row[1]):
+            print('%-44s' % source + ''.join(' %9d %10d' % size
+                                             for size in row))
+    print('%-44s' % 'total' + ''.join(' %9d %10d' % tuple(total)
+                                      for total in totals))
+    for name, total, (_, tree, _) in zip(names, totals, results):
+        ram = linker_value(tree, 'mem.ld',
+                           r'RAM \(xrw\) : ORIGIN = \w+, LENGTH = (\d+)K?')
+        stack = linker_value(tree, 'sections.ld',
+                             r'__Main_Stack_Size = (\d+)')
+        print('%s: %d B static RAM, %d B main stack, %d B of %d B left for '
+              'the heap' % (name, sum(total), stack,
+                            ram - sum(total) - stack, ram))
+    if len(totals) == 2:
+        print('difference: %+d B .data, %+d B .bss' % (
+            totals[1][0] - totals[0][0], totals[1][1] - totals[0][1]))
+    for source in failed:
+        print('not measured (does not build): %s' % source, file=sys.stderr)
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
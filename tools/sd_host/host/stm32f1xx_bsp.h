@@ -0,0 +1,75 @@
+/**
+ ****************************************************************************
+ * @file        stm32f1xx_bsp.h
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       Host stand-in of the board header for the SD driver test.
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef STM32F1XX_BSP_H_
+#define STM32F1XX_BSP_H_
+
+/* Includes ------------------------------------------------------------------*/
+/* sd_io.h includes the board header: the tick and the cycle counter are
+ variables advanced by the card model with the bytes clocked on the bus */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+	volatile uint32_t CTRL;
+	volatile uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct
+{
+	volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+/* Exported macro ------------------------------------------------------------*/
+#define UNUSED(x)			((void) (x))
+#define DWT					(&g_hostDwt)
+#define CoreDebug			(&g_hostCoreDebug)
+#define DWT_CTRL_CYCCNTENA_Msk		(1UL)
+#define CoreDebug_DEMCR_TRCENA_Msk	(1UL << 24)
+
+/* Exported variables --------------------------------------------------------*/
+extern uint32_t g_ui32HostTick; /*!< HAL_GetTick() value */
+extern DWT_Type g_hostDwt; /*!< Cycle counter */
+extern CoreDebug_Type g_hostCoreDebug; /*!< Trace enable of the cycle counter */
+extern uint32_t SystemCoreClock;
+
+/* Exported functions --------------------------------------------------------*/
+static inline uint32_t HAL_GetTick(void)
+{
+	return g_ui32HostTick;
+}
+
+#endif /* STM32F1XX_BSP_H_ */
+
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
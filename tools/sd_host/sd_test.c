@@ -0,0 +1,429 @@
+/**
+ ****************************************************************************
+ * @file        sd_test.c
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       Host test of the SD card block reads (CMD17, CMD18 and CMD12).
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ */
+/*
+ * bsp/driver/src/sd.c is built unchanged over a byte level model of an SD card
+ * on the SPI bus, which stands for the SD I/O controller (bsp_sdio_*). The model
+ * answers CMD17, CMD18 and CMD12 like a card in SPI mode: R1 after one byte, the
+ * access time before each data token, the stuff byte, R1 and busy after CMD12.
+ * The tests check the commands sent for one and several blocks, the end of the
+ * card, the restart after a corrupted block and the data read. The bus time of
+ * a staging half is printed for one CMD17 per block and for one CMD18.
+ *
+ * Build and run:  make -C tools/sd_host check
+ */
+/* Includes ------------------------------------------------------------------*/
+#include "sd.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define CARD_BLOCKS				(64) /*!< Card size in SD_BLOCK_SIZE blocks */
+#define CARD_ACCESS_BYTES		(100) /*!< Bytes clocked before each data token (read access time) */
+#define CARD_STOP_BUSY_BYTES	(8) /*!< Busy bytes after the CMD12 response */
+#define CARD_STUFF_BYTE			(0x3C) /*!< Byte after CMD12, bit 7 cleared as a response */
+#define CARD_R1_ILLEGAL			(0x04)
+#define CARD_R1_ADDRESS_ERROR	(0x20)
+#define CARD_QUEUE_SIZE			(1024) /*!< MISO bytes queued, more than one data block */
+#define CARD_SPI_CLOCK			(18000000) /*!< 72MHz / 4 */
+#define CARD_CYCLES_PER_BYTE	(8 * 72000000 / CARD_SPI_CLOCK)
+#define CARD_BYTES_PER_MS		(CARD_SPI_CLOCK / 8 / 1000)
+#define CARD_NO_CORRUPTION		(0xFFFFFFFF)
+#define TEST_HALF_BLOCKS		(2) /*!< MSC_STAGE_HALF of the default 2KB staging */
+
+/* Private variables ---------------------------------------------------------*/
+uint32_t g_ui32HostTick = 0;
+DWT_Type g_hostDwt = { 0 };
+CoreDebug_Type g_hostCoreDebug = { 0 };
+uint32_t SystemCoreClock = 72000000;
+
+static uint8_t g_pui8CardImage[CARD_BLOCKS * SD_BLOCK_SIZE];
+static uint8_t g_pui8Queue[CARD_QUEUE_SIZE]; /*!< MISO bytes of the card */
+static uint32_t g_ui32QueueHead;
+static uint32_t g_ui32QueueTail;
+static uint8_t g_pui8Frame[6]; /*!< Command frame received on MOSI */
+static uint32_t g_ui32FrameLength;
+static bool g_bSelected; /*!< Chip select asserted */
+static bool g_bStreaming; /*!< CMD18 sending blocks until CMD12 */
+static uint32_t g_ui32StreamBlock; /*!< Next block of CMD18 */
+static uint8_t g_ui8StopResponse; /*!< R1 of the next CMD12 */
+static uint32_t g_ui32CorruptBlock = CARD_NO_CORRUPTION; /*!< Block sent with a wrong CRC */
+static uint32_t g_ui32CorruptCount; /*!< Times the block is corrupted */
+static uint32_t g_pui32Commands[64]; /*!< Commands received, by index */
+static uint32_t g_ui32BusBytes; /*!< Bytes clocked with the card selected */
+static uint32_t g_ui32DeselectWhileStreaming; /*!< Protocol errors: CS released in a CMD18 */
+static uint32_t g_pui32Buffer[(CARD_BLOCKS * SD_BLOCK_SIZE) / 4];
+
+/* Private function prototypes -----------------------------------------------*/
+/**
+ * @brief  Queue a byte on the MISO line of the card.
+ * @param  ui8Byte: byte to send
+ * @retval None
+ */
+static void card_push(uint8_t ui8Byte)
+{
+	g_pui8Queue[g_ui32QueueTail++ % CARD_QUEUE_SIZE] = ui8Byte;
+}
+
+/**
+ * @brief  Queue a data block: access time, data token, data and CRC16.
+ * @param  ui32Block: block number
+ * @param  ui8Token: data token
+ * @retval None
+ */
+static void card_pushBlock(uint32_t ui32Block, uint8_t ui8Token)
+{
+	const uint8_t *pui8Data = &g_pui8CardImage[ui32Block * SD_BLOCK_SIZE];
+	uint16_t ui16Crc = sd_computeCRC16(pui8Data, SD_BLOCK_SIZE);
+	uint32_t i;
+
+	if ((ui32Block == g_ui32CorruptBlock) && (0 < g_ui32CorruptCount))
+	{
+		g_ui32CorruptCount--;
+		ui16Crc ^= 0x0001;
+	}
+	for (i = 0; CARD_ACCESS_BYTES > i; i++)
+	{
+		card_push(0xFF);
+	}
+	card_push(ui8Token);
+	for (i = 0; SD_BLOCK_SIZE > i; i++)
+	{
+		card_push(pui8Data[i]);
+	}
+	card_push((uint8_t) (ui16Crc >> 8));
+	card_push((uint8_t) ui16Crc);
+}
+
+/**
+ * @brief  Execute the command frame received.
+ * @retval None
+ */
+static void card_execute(void)
+{
+	uint8_t ui8Command = g_pui8Frame[0] & 0x3F;
+	uint32_t ui32Block = (((uint32_t) g_pui8Frame[1] << 24)
+			| ((uint32_t) g_pui8Frame[2] << 16) | ((uint32_t) g_pui8Frame[3] << 8)
+			| g_pui8Frame[4]) / SD_BLOCK_SIZE; /* SDSC: byte address */
+
+	g_pui32Commands[ui8Command]++;
+	g_ui32QueueHead = g_ui32QueueTail = 0;
+
+	/* The response comes one byte after the command */
+	card_push(0xFF);
+	switch (ui8Command)
+	{
+	case 17:
+		card_push(0x00);
+		card_pushBlock(ui32Block, 0xFE);
+		break;
+	case 18:
+		card_push(0x00);
+		g_bStreaming = true;
+		g_ui32StreamBlock = ui32Block;
+		g_ui8StopResponse = 0x00;
+		break;
+	case 12:
+		g_bStreaming = false;
+		g_ui32QueueHead = g_ui32QueueTail = 0;
+		card_push(CARD_STUFF_BYTE);
+		card_push(g_ui8StopResponse);
+		for (uint32_t i = 0; CARD_STOP_BUSY_BYTES > i; i++)
+		{
+			card_push(0x00);
+		}
+		break;
+	default:
+		card_push(CARD_R1_ILLEGAL);
+		break;
+	}
+}
+
+/**
+ * @brief  Clock one byte on the SPI bus.
+ * @param  ui8Mosi: byte sent by the controller
+ * @retval uint8_t: byte sent by the card
+ */
+static uint8_t card_exchange(uint8_t ui8Mosi)
+{
+	uint8_t ui8Miso = 0xFF;
+
+	g_hostDwt.CYCCNT += CARD_CYCLES_PER_BYTE;
+	if (0 == (++g_ui32BusBytes % CARD_BYTES_PER_MS))
+	{
+		g_ui32HostTick++;
+	}
+	if (!g_bSelected)
+	{
+		return 0xFF;
+	}
+
+	/* CMD18 prefetches the next block, past the last one it flags an address error */
+	if (g_bStreaming && (g_ui32QueueHead == g_ui32QueueTail))
+	{
+		g_ui32QueueHead = g_ui32QueueTail = 0;
+		if (CARD_BLOCKS > g_ui32StreamBlock)
+		{
+			card_pushBlock(g_ui32StreamBlock++, 0xFE);
+		}
+		else
+		{
+			g_ui8StopResponse = CARD_R1_ADDRESS_ERROR;
+		}
+	}
+	if (g_ui32QueueHead != g_ui32QueueTail)
+	{
+		ui8Miso = g_pui8Queue[g_ui32QueueHead++ % CARD_QUEUE_SIZE];
+	}
+
+	/* Command frame: 01xxxxxx, argument, CRC */
+	if ((0 < g_ui32FrameLength) || (0x40 == (ui8Mosi & 0xC0)))
+	{
+		g_pui8Frame[g_ui32FrameLength++] = ui8Mosi;
+		if (sizeof(g_pui8Frame) == g_ui32FrameLength)
+		{
+			g_ui32FrameLength = 0;
+			card_execute();
+		}
+	}
+	return ui8Miso;
+}
+
+/* Exported functions --------------------------------------------------------*/
+/* SD I/O controller stand-in, same protocol helpers as bsp/device/src/sd_io.c */
+bool bsp_sdio_init(void)
+{
+	return true;
+}
+
+bool bsp_sdio_isDetected(void)
+{
+	return true;
+}
+
+uint32_t bsp_sdio_setClock(uint32_t ui32MaxFrequency)
+{
+	UNUSED(ui32MaxFrequency);
+	return CARD_SPI_CLOCK;
+}
+
+bool bsp_sdio_sendData(uint8_t * pui8Buffer, uint16_t ui16Size)
+{
+	while (ui16Size--)
+	{
+		card_exchange(*pui8Buffer++);
+	}
+	return true;
+}
+
+bool bsp_sdio_readData(uint8_t * pui8Buffer, uint16_t ui16Size)
+{
+	while (ui16Size--)
+	{
+		*pui8Buffer++ = card_exchange(0xFF);
+	}
+	return true;
+}
+
+bool bsp_sdio_waitReady(void)
+{
+	return true;
+}
+
+bool bsp_sdio_waitResponse(const uint8_t ui8ExpectedResponse)
+{
+	uint32_t ui32Timeout = 0xFFFF;
+
+	while (card_exchange(0xFF) != ui8ExpectedResponse)
+	{
+		if (0 == --ui32Timeout)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool bsp_sdio_sendCommand(uint8_t ui8Cmd, uint32_t ui32Arg, uint8_t ui8CRC,
+		uint8_t ui8ExpectedResponse)
+{
+	uint8_t pui8CommandPacket[6] =
+	{ (0x40 | (ui8Cmd & 0x3F)), (uint8_t) (ui32Arg >> 24),
+			(uint8_t) (ui32Arg >> 16), (uint8_t) (ui32Arg >> 8),
+			(uint8_t) (ui32Arg), ui8CRC };
+
+	bsp_sdio_sendData(pui8CommandPacket, sizeof(pui8CommandPacket));
+	if (SDIO_NO_RESPONSE_EXPECTED != ui8ExpectedResponse)
+	{
+		return bsp_sdio_waitResponse(ui8ExpectedResponse);
+	}
+	return true;
+}
+
+bool bsp_sdio_sendSpecialCommand(uint8_t ui8Cmd, uint32_t ui32Arg,
+		uint8_t ui8CRC, uint8_t ui8ExpectedResponse,
+		uint32_t *pui32TrailingResponse)
+{
+	UNUSED(pui32TrailingResponse);
+	return bsp_sdio_sendCommand(ui8Cmd, ui32Arg, ui8CRC, ui8ExpectedResponse);
+}
+
+void bsp_sdio_sendDummy(void)
+{
+	card_exchange(0xFF);
+}
+
+void bsp_sdio_activate(void)
+{
+	g_bSelected = true;
+}
+
+void bsp_sdio_deactivate(void)
+{
+	if (g_bStreaming)
+	{
+		g_ui32DeselectWhileStreaming++;
+		g_bStreaming = false;
+	}
+	g_bSelected = false;
+	g_ui32QueueHead = g_ui32QueueTail = 0;
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+ * @brief  Read blocks and check the commands sent and the data.
+ * @param  pcName: test name
+ * @param  ui32BlockAddr: first block
+ * @param  ui32NumberOfBlocks: number of blocks
+ * @param  ui32Cmd17: expected number of CMD17
+ * @param  ui32Cmd18: expected number of CMD18, also the number of CMD12
+ * @retval int: number of failed checks
+ */
+static int test_read(const char *pcName, uint32_t ui32BlockAddr,
+		uint32_t ui32NumberOfBlocks, uint32_t ui32Cmd17, uint32_t ui32Cmd18)
+{
+	bool bResult;
+
+	memset(g_pui32Commands, 0, sizeof(g_pui32Commands));
+	memset(g_pui32Buffer, 0, sizeof(g_pui32Buffer));
+	bResult = sd_readBlocks(g_pui32Buffer, ui32BlockAddr, ui32NumberOfBlocks);
+	if (!bResult
+			|| (0 != memcmp(g_pui32Buffer,
+					&g_pui8CardImage[ui32BlockAddr * SD_BLOCK_SIZE],
+					ui32NumberOfBlocks * SD_BLOCK_SIZE))
+			|| (ui32Cmd17 != g_pui32Commands[17])
+			|| (ui32Cmd18 != g_pui32Commands[18])
+			|| (ui32Cmd18 != g_pui32Commands[12])
+			|| (0 != g_ui32DeselectWhileStreaming))
+	{
+		printf("%s: FAIL (%d, CMD17 %u, CMD18 %u, CMD12 %u)\n", pcName,
+				bResult, g_pui32Commands[17], g_pui32Commands[18],
+				g_pui32Commands[12]);
+		return 1;
+	}
+	printf("%s: OK\n", pcName);
+	return 0;
+}
+
+/**
+ * @brief  Bus time of a staging half in us, from the bytes clocked on the bus.
+ * @param  ui32Blocks: blocks read per command
+ * @retval uint32_t: time in us
+ */
+static uint32_t test_halfTime(uint32_t ui32Blocks)
+{
+	uint32_t ui32Bytes = g_ui32BusBytes;
+	uint32_t i;
+
+	for (i = 0; TEST_HALF_BLOCKS > i; i += ui32Blocks)
+	{
+		sd_readBlocks(g_pui32Buffer, i, ui32Blocks);
+	}
+	return (g_ui32BusBytes - ui32Bytes) * 8 / (CARD_SPI_CLOCK / 1000000);
+}
+
+/**
+ * @brief  Main program.
+ * @retval int: 0 if every check passed
+ */
+int main(void)
+{
+	sd_latency_statistic_t readLatency, writeLatency;
+	sd_crc_statistic_t crcStatistic;
+	int iFailures = 0;
+	uint32_t i;
+
+	for (i = 0; sizeof(g_pui8CardImage) > i; i++)
+	{
+		g_pui8CardImage[i] = (uint8_t) ((i * 7) ^ (i >> 9));
+	}
+
+	iFailures += test_read("one block (CMD17)", 5, 1, 1, 0);
+	iFailures += test_read("8 blocks (CMD18, CMD12)", 9, 8, 0, 1);
+	iFailures += test_read("last blocks of the card", CARD_BLOCKS - 4, 4, 0, 1);
+
+	/* Latency statistic: one command per transaction */
+	sd_resetLatencyStatistic();
+	iFailures += test_read("latency of 16 blocks", 20, 16, 0, 1);
+	sd_getLatencyStatistic(&readLatency, &writeLatency);
+	if ((1 != readLatency.ui32Commands) || (16 != readLatency.ui32Blocks))
+	{
+		printf("latency statistic: FAIL (%u commands, %u blocks)\n",
+				readLatency.ui32Commands, readLatency.ui32Blocks);
+		iFailures++;
+	}
+
+	/* Corrupted block: the transaction restarts from it */
+	g_ui32CorruptBlock = 33;
+	g_ui32CorruptCount = 1;
+	sd_getCrcStatistic(&crcStatistic);
+	iFailures += test_read("CRC error in a CMD18", 30, 8, 0, 2);
+	i = crcStatistic.ui32ReadErrors;
+	sd_getCrcStatistic(&crcStatistic);
+	if (1 != (crcStatistic.ui32ReadErrors - i))
+	{
+		printf("CRC error count: FAIL\n");
+		iFailures++;
+	}
+
+	/* Persistent corruption: SD_CRC_RETRY restarts then failure */
+	g_ui32CorruptCount = 100;
+	i = crcStatistic.ui32Failures;
+	if (sd_readBlocks(g_pui32Buffer, 30, 8))
+	{
+		printf("persistent CRC error: FAIL (read succeeded)\n");
+		iFailures++;
+	}
+	sd_getCrcStatistic(&crcStatistic);
+	if ((1 != (crcStatistic.ui32Failures - i)) || (0 != g_ui32DeselectWhileStreaming))
+	{
+		printf("persistent CRC error: FAIL\n");
+		iFailures++;
+	}
+	else
+	{
+		printf("persistent CRC error: OK\n");
+	}
+	g_ui32CorruptBlock = CARD_NO_CORRUPTION;
+
+	/* The card model has the same access time before every block, so this
+	 is the command overhead only, not the read ahead of a real card */
+	printf("staging half of %d blocks at %u MHz: CMD17 per block %u us, CMD18 %u us\n",
+			TEST_HALF_BLOCKS, CARD_SPI_CLOCK / 1000000, test_halfTime(1),
+			test_halfTime(TEST_HALF_BLOCKS));
+
+	printf("%s\n", (0 == iFailures) ? "PASSED" : "FAILED");
+	return (0 == iFailures) ? 0 : 1;
+}
+
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
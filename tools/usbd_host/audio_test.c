@@ -0,0 +1,519 @@
+/**
+ ****************************************************************************
+ * @file        audio_test.c
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       Host test of the USB speaker class and its packet traces.
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/*
+ * Run the USB speaker class (lib/usb/src/usbd_audio.c) and the performance
+ * probe (lib/usb/src/usbd_perf.c) against the driver stand-in. The test is
+ * the host and the CODEC: the host sends one isochronous packet per 1ms frame
+ * sized by the rate feedback it reads every 16 frames, as an asynchronous
+ * sink wants, and the CODEC drains the ring by 32-byte chunks from a crystal
+ * off the USB frame clock by a given drift. Every byte played is checked
+ * against the byte sent.
+ *
+ * A packet trace holds one line per frame: the bytes of the OUT packet and
+ * the feedback read by the host in that frame. Replaying a trace sends its
+ * packets whatever the feedback says and checks that the device answers the
+ * recorded feedback: a change of the rate loop needs the traces recorded
+ * again (make traces). The committed traces are recorded from this host
+ * model, not from a bus analyzer.
+ *
+ * Build and run:  make -C tools/usbd_host check
+ * Record:         audio_test --record FILE RATE PPM FRAMES
+ * Replay:         audio_test FILE...
+ */
+/* Includes ------------------------------------------------------------------*/
+#include "host_usb.h"
+#include "usbd_audio.h"
+#include "usbd_desc.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Private typedef -----------------------------------------------------------*/
+/**
+ * @struct _audio_run_t
+ * This type define one stream: the host side, the CODEC side and the result.
+ */
+typedef struct _audio_run_t
+{
+	uint32_t ui32SampleRate; /*!< Sampling frequency in Hz */
+	int32_t i32CodecPpm; /*!< CODEC crystal drift against the USB frames */
+	uint32_t ui32Accumulator; /*!< Host: fraction of sample frame carried, 10.14 */
+	uint32_t ui32Feedback; /*!< Host: last feedback read, 10.14 */
+	uint32_t ui32Sent; /*!< Host: bytes of the stream sent */
+	uint32_t ui32Played; /*!< CODEC: bytes of the stream played */
+	int64_t i64Owed; /*!< CODEC: bytes wanted by its clock, 1e-6 byte unit */
+	bool bPlaying; /*!< CODEC: started on a half full ring */
+	uint32_t ui32Corrupted; /*!< Bytes played that differ from the bytes sent */
+	uint32_t ui32FeedbackErrors; /*!< Replay: feedback different from the trace */
+	FILE *pRecord; /*!< Trace recorded, NULL if none */
+} audio_run_t;
+
+/* Private define ------------------------------------------------------------*/
+#define AUDIO_TEST_OUT_EP		(AUDIO_OUT_EP)
+#define AUDIO_TEST_FEEDBACK_EP	(AUDIO_FEEDBACK_EP & 0x7F)
+#define AUDIO_TEST_CHUNK		(32) /*!< Bytes per CODEC DREQ */
+#define AUDIO_TEST_REFRESH		(1 << AUDIO_FEEDBACK_REFRESH) /*!< Frames between two feedback reads */
+#define AUDIO_TEST_FRAMES		(60000) /*!< Closed loop: 1 minute per drift */
+#define AUDIO_TEST_SETTLE		(2000) /*!< Frames before the host rate is checked */
+#define AUDIO_TEST_LINE_SIZE	(128)
+
+/* Private macro -------------------------------------------------------------*/
+/* Byte n of the stream, different from the byte one ring lap before */
+#define AUDIO_TEST_PATTERN(ui32Index)	((uint8_t) ((ui32Index) ^ ((ui32Index) >> 8)))
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t g_pui32Pool[(sizeof(usbd_audio_handle_t) / 4) + 1]; /*!< USBD_static_malloc() */
+static uint32_t g_ui32Failures = 0;
+
+/* Private function prototypes -----------------------------------------------*/
+/**
+ * @brief  Driver stand-ins of usbd_conf.c and usbd_desc.c.
+ */
+void *USBD_static_malloc(uint32_t size)
+{
+	return (size <= sizeof(g_pui32Pool)) ? (g_pui32Pool) : (NULL);
+}
+
+void USBD_static_free(void *p)
+{
+	UNUSED(p);
+}
+
+uint8_t *USBD_FS_SpeakerConfigDescriptor(uint16_t *length)
+{
+	*length = 0;
+	return NULL;
+}
+
+static void audio_check(bool bPassed, const char *pcName)
+{
+	printf("  %-44s %s\n", pcName, (bPassed) ? ("OK") : ("FAIL"));
+	if (!bPassed)
+	{
+		g_ui32Failures++;
+	}
+}
+
+/**
+ * @brief  Send a control request, returns false if the device stalled it.
+ */
+static bool audio_setup(uint8_t ui8Type, uint8_t ui8Request, uint16_t ui16Value,
+		uint16_t ui16Index, uint16_t ui16Length)
+{
+	USBD_SetupReqTypedef req;
+	uint32_t ui32Errors = g_ui32HostUsbControlErrors;
+
+	req.bmRequest = ui8Type;
+	req.bRequest = ui8Request;
+	req.wValue = ui16Value;
+	req.wIndex = ui16Index;
+	req.wLength = ui16Length;
+	g_pui8HostUsbControl = NULL;
+	g_ui32HostUsbControlSize = 0;
+	USBD_AUDIO.Setup(&g_hostUsbDevice, &req);
+	return (ui32Errors == g_ui32HostUsbControlErrors);
+}
+
+/**
+ * @brief  Configure the speaker and select the streaming alternate setting
+ *         at the sampling frequency of the run.
+ */
+static void audio_start(audio_run_t *pRun)
+{
+	uint8_t pui8Rate[3];
+
+	host_usb_reset();
+	USBD_AUDIO.Init(&g_hostUsbDevice, 0);
+	audio_setup(0x22, 0x01, 0x0100, AUDIO_OUT_EP, 3); /* SET_CUR sampling frequency */
+	pui8Rate[0] = (uint8_t) pRun->ui32SampleRate;
+	pui8Rate[1] = (uint8_t) (pRun->ui32SampleRate >> 8);
+	pui8Rate[2] = (uint8_t) (pRun->ui32SampleRate >> 16);
+	memcpy(g_pui8HostUsbControl, pui8Rate, 3);
+	USBD_AUDIO.EP0_RxReady(&g_hostUsbDevice);
+	audio_setup(0x01, USB_REQ_SET_INTERFACE, 1, AUDIO_STREAMING_INTERFACE, 0);
+	pRun->ui32Accumulator = 0;
+	pRun->ui32Feedback = (pRun->ui32SampleRate << 14) / 1000;
+}
+
+/**
+ * @brief  Host: read the feedback loaded by the device, then let it load the
+ *         next one.
+ * @retval uint32_t: feedback read, 10.14 sample frames per frame
+ */
+static uint32_t audio_readFeedback(void)
+{
+	host_usb_ep_t *pEp = &g_pHostUsbIn[AUDIO_TEST_FEEDBACK_EP];
+	uint32_t ui32Feedback;
+
+	if (!pEp->bArmed || (AUDIO_FEEDBACK_PACKET_SIZE != pEp->ui32Size))
+	{
+		return 0;
+	}
+	ui32Feedback = pEp->pui8Buffer[0] | ((uint32_t) pEp->pui8Buffer[1] << 8)
+			| ((uint32_t) pEp->pui8Buffer[2] << 16);
+	pEp->bArmed = false;
+	USBD_AUDIO.DataIn(&g_hostUsbDevice, AUDIO_TEST_FEEDBACK_EP);
+	return ui32Feedback;
+}
+
+/**
+ * @brief  Host: send one OUT packet of the stream pattern.
+ */
+static void audio_send(audio_run_t *pRun, uint32_t ui32Size)
+{
+	host_usb_ep_t *pEp = &g_pHostUsbOut[AUDIO_TEST_OUT_EP];
+	uint32_t i;
+
+	if (!pEp->bArmed || (ui32Size > pEp->ui32Size))
+	{
+		return;
+	}
+	for (i = 0; i < ui32Size; i++)
+	{
+		pEp->pui8Buffer[i] = AUDIO_TEST_PATTERN(pRun->ui32Sent);
+		pRun->ui32Sent++;
+	}
+	pEp->ui32Size = ui32Size;
+	pEp->bArmed = false;
+	USBD_AUDIO.DataOut(&g_hostUsbDevice, AUDIO_TEST_OUT_EP);
+}
+
+/**
+ * @brief  CODEC: play the chunks its clock asks for in one frame. It idles on
+ *         silence while the ring refills.
+ */
+static void audio_play(audio_run_t *pRun)
+{
+	const uint8_t *pui8Chunk;
+	uint32_t i;
+
+	pRun->i64Owed += (int64_t) pRun->ui32SampleRate * AUDIO_FRAME_SIZE
+			* (1000000 + pRun->i32CodecPpm) / 1000;
+	while (pRun->i64Owed >= (AUDIO_TEST_CHUNK * 1000000LL))
+	{
+		pui8Chunk = usbd_audio_getData(AUDIO_TEST_CHUNK);
+		if (NULL == pui8Chunk)
+		{
+			pRun->i64Owed = 0;
+			return;
+		}
+		for (i = 0; i < AUDIO_TEST_CHUNK; i++)
+		{
+			if (pui8Chunk[i] != AUDIO_TEST_PATTERN(pRun->ui32Played))
+			{
+				pRun->ui32Corrupted++;
+			}
+			pRun->ui32Played++;
+		}
+		usbd_audio_releaseData(AUDIO_TEST_CHUNK);
+		pRun->i64Owed -= AUDIO_TEST_CHUNK * 1000000LL;
+	}
+}
+
+/**
+ * @brief  Run one frame. The host sizes the packet from the feedback, or
+ *         takes it from a trace (ui32TraceSize and ui32TraceFeedback).
+ */
+static void audio_frame(audio_run_t *pRun, uint32_t ui32Frame,
+		int32_t i32TraceSize, uint32_t ui32TraceFeedback)
+{
+	uint32_t ui32Feedback = 0;
+	uint32_t ui32Size;
+
+	if (0 == (ui32Frame % AUDIO_TEST_REFRESH))
+	{
+		ui32Feedback = audio_readFeedback();
+		if (0 != ui32Feedback)
+		{
+			pRun->ui32Feedback = ui32Feedback;
+		}
+		if ((i32TraceSize >= 0) && (ui32Feedback != ui32TraceFeedback))
+		{
+			pRun->ui32FeedbackErrors++;
+		}
+	}
+	if (i32TraceSize >= 0)
+	{
+		ui32Size = (uint32_t) i32TraceSize;
+	}
+	else
+	{
+		pRun->ui32Accumulator += pRun->ui32Feedback;
+		ui32Size = (pRun->ui32Accumulator >> 14) * AUDIO_FRAME_SIZE;
+		pRun->ui32Accumulator &= (1 << 14) - 1;
+	}
+	if (NULL != pRun->pRecord)
+	{
+		fprintf(pRun->pRecord, "%u %u %u\n", ui32Frame, ui32Size, ui32Feedback);
+	}
+	audio_send(pRun, ui32Size);
+	audio_play(pRun);
+	g_ui32HostTick++;
+}
+
+/**
+ * @brief  Read the counters blob by the vendor request of the speaker.
+ * @retval bool: blob received
+ */
+static bool audio_readCounters(usbd_perf_counters_t *pCounters, bool bClear)
+{
+	if (!audio_setup(USBD_PERF_REQUEST_TYPE, USBD_PERF_OPCODE,
+			(bClear) ? (USBD_PERF_CLEAR) : (0), AUDIO_CONTROL_INTERFACE, 512)
+			|| (sizeof(usbd_perf_counters_t) != g_ui32HostUsbControlSize))
+	{
+		return false;
+	}
+	memcpy(pCounters, g_pui8HostUsbControl, sizeof(usbd_perf_counters_t));
+	return true;
+}
+
+/**
+ * @brief  Stream in closed loop and check the ring: no overrun, no underrun
+ *         once settled, no byte lost, the host follows the CODEC clock.
+ */
+static void audio_closedLoop(uint32_t ui32SampleRate, int32_t i32CodecPpm)
+{
+	audio_run_t run;
+	usbd_audio_statistic_t statistic;
+	usbd_perf_counters_t counters;
+	uint32_t ui32Underruns = 0;
+	int64_t i64Expected;
+	uint32_t ui32Frame;
+	char pcName[64];
+
+	memset(&run, 0, sizeof(run));
+	run.ui32SampleRate = ui32SampleRate;
+	run.i32CodecPpm = i32CodecPpm;
+	audio_start(&run);
+	for (ui32Frame = 0; ui32Frame < AUDIO_TEST_FRAMES; ui32Frame++)
+	{
+		audio_frame(&run, ui32Frame, -1, 0);
+		if (AUDIO_TEST_SETTLE == ui32Frame)
+		{
+			/* The start fills the ring to its half: counted from here */
+			usbd_audio_getStatistic(&statistic);
+			ui32Underruns = statistic.ui32Underruns;
+		}
+	}
+	usbd_audio_getStatistic(&statistic);
+	printf("  %u Hz %+d ppm: fill %u..%u, feedback %u.%04u, host %u Hz\n",
+			ui32SampleRate, i32CodecPpm, statistic.ui32FillMin,
+			statistic.ui32FillMax, statistic.ui32Feedback >> 14,
+			((statistic.ui32Feedback & 0x3FFF) * 10000) >> 14,
+			statistic.ui32HostRate);
+
+	snprintf(pcName, sizeof(pcName), "%u Hz %+d ppm: no overrun, no underrun",
+			ui32SampleRate, i32CodecPpm);
+	audio_check((0 == statistic.ui32Overruns)
+			&& (ui32Underruns == statistic.ui32Underruns), pcName);
+	snprintf(pcName, sizeof(pcName), "%u Hz %+d ppm: every byte played",
+			ui32SampleRate, i32CodecPpm);
+	audio_check(0 == run.ui32Corrupted, pcName);
+	/* The fill followed by the feedback moves by CODEC chunks: the 1 second
+	 window of the host rate is within one chunk of the CODEC rate */
+	i64Expected = (int64_t) ui32SampleRate * (1000000 + i32CodecPpm) / 1000000;
+	snprintf(pcName, sizeof(pcName), "%u Hz %+d ppm: host follows the CODEC",
+			ui32SampleRate, i32CodecPpm);
+	audio_check(llabs((int64_t) statistic.ui32HostRate - i64Expected)
+			<= (AUDIO_TEST_CHUNK / AUDIO_FRAME_SIZE), pcName);
+
+	snprintf(pcName, sizeof(pcName), "%u Hz %+d ppm: vendor request",
+			ui32SampleRate, i32CodecPpm);
+	audio_check(audio_readCounters(&counters, false)
+			&& (USBD_PERF_MAGIC == counters.ui32Magic)
+			&& (USBD_PERF_VERSION == counters.ui32Version)
+			&& (statistic.ui32Packets == counters.ui32SpeakerPackets)
+			&& (statistic.ui32FillMin == counters.ui32SpeakerFillMin)
+			&& (statistic.ui32FillMax == counters.ui32SpeakerFillMax)
+			&& (statistic.ui32HostRate == counters.ui32SpeakerHostRate)
+			&& (ui32SampleRate == counters.ui32SpeakerSampleRate), pcName);
+}
+
+/**
+ * @brief  Record a closed loop stream into a trace file.
+ * @retval int: process exit code
+ */
+static int audio_record(const char *pcFile, uint32_t ui32SampleRate,
+		int32_t i32CodecPpm, uint32_t ui32Frames)
+{
+	audio_run_t run;
+	uint32_t ui32Frame;
+
+	memset(&run, 0, sizeof(run));
+	run.pRecord = fopen(pcFile, "w");
+	if (NULL == run.pRecord)
+	{
+		perror(pcFile);
+		return EXIT_FAILURE;
+	}
+	run.ui32SampleRate = ui32SampleRate;
+	run.i32CodecPpm = i32CodecPpm;
+	fprintf(run.pRecord, "# USB speaker packet trace, recorded by audio_test from its host model\n"
+			"# rate %u\n# codec_ppm %d\n"
+			"# frame, OUT packet bytes, feedback read by the host (10.14, 0: not read)\n",
+			ui32SampleRate, i32CodecPpm);
+	audio_start(&run);
+	for (ui32Frame = 0; ui32Frame < ui32Frames; ui32Frame++)
+	{
+		audio_frame(&run, ui32Frame, -1, 0);
+	}
+	fclose(run.pRecord);
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief  Replay a trace file and check the device against it.
+ */
+static void audio_replay(const char *pcFile)
+{
+	audio_run_t run;
+	usbd_audio_statistic_t statistic;
+	char pcLine[AUDIO_TEST_LINE_SIZE];
+	char pcName[96];
+	uint32_t ui32Frame, ui32Size, ui32Feedback;
+	uint32_t ui32Frames = 0;
+	FILE *pTrace;
+	int iValue;
+
+	pTrace = fopen(pcFile, "r");
+	if (NULL == pTrace)
+	{
+		perror(pcFile);
+		g_ui32Failures++;
+		return;
+	}
+	memset(&run, 0, sizeof(run));
+	run.ui32SampleRate = AUDIO_RATE_48K;
+	while (NULL != fgets(pcLine, sizeof(pcLine), pTrace))
+	{
+		if ('#' == pcLine[0])
+		{
+			if (1 == sscanf(pcLine, "# rate %d", &iValue))
+			{
+				run.ui32SampleRate = (uint32_t) iValue;
+			}
+			else if (1 == sscanf(pcLine, "# codec_ppm %d", &iValue))
+			{
+				run.i32CodecPpm = iValue;
+			}
+			continue;
+		}
+		if (3 != sscanf(pcLine, "%u %u %u", &ui32Frame, &ui32Size, &ui32Feedback))
+		{
+			continue;
+		}
+		if (0 == ui32Frames)
+		{
+			audio_start(&run);
+		}
+		audio_frame(&run, ui32Frame, (int32_t) ui32Size, ui32Feedback);
+		ui32Frames++;
+	}
+	fclose(pTrace);
+
+	usbd_audio_getStatistic(&statistic);
+	printf("  %s: %u frames, %u Hz %+d ppm, fill %u..%u\n", pcFile, ui32Frames,
+			run.ui32SampleRate, run.i32CodecPpm, statistic.ui32FillMin,
+			statistic.ui32FillMax);
+	snprintf(pcName, sizeof(pcName), "replay: no overrun, every byte played");
+	audio_check((0 != ui32Frames) && (0 == statistic.ui32Overruns)
+			&& (0 == run.ui32Corrupted), pcName);
+	snprintf(pcName, sizeof(pcName), "replay: feedback as recorded");
+	audio_check(0 == run.ui32FeedbackErrors, pcName);
+}
+
+/* Exported functions prototype ----------------------------------------------*/
+int main(int argc, char *argv[])
+{
+	usbd_perf_counters_t counters;
+	audio_run_t run;
+	int i;
+
+	if ((6 == argc) && (0 == strcmp(argv[1], "--record")))
+	{
+		return audio_record(argv[2], (uint32_t) strtoul(argv[3], NULL, 0),
+				(int32_t) strtol(argv[4], NULL, 0),
+				(uint32_t) strtoul(argv[5], NULL, 0));
+	}
+
+	printf("closed loop:\n");
+	audio_closedLoop(AUDIO_RATE_48K, -300);
+	audio_closedLoop(AUDIO_RATE_48K, 0);
+	audio_closedLoop(AUDIO_RATE_48K, 300);
+	audio_closedLoop(AUDIO_RATE_44K1, -300);
+	audio_closedLoop(AUDIO_RATE_44K1, 300);
+
+	printf("vendor request:\n");
+	audio_check(audio_readCounters(&counters, true)
+			&& (0 != counters.ui32SpeakerPackets), "counters read, then cleared");
+	audio_check(audio_readCounters(&counters, false)
+			&& (0 == counters.ui32SpeakerPackets)
+			&& (counters.ui32SpeakerFillMin == counters.ui32SpeakerFillLevel),
+			"cleared: the fill extremes restart");
+	audio_check(!audio_setup(USBD_PERF_REQUEST_TYPE, USBD_PERF_OPCODE, 0,
+			AUDIO_STREAMING_INTERFACE, 512), "stall on the streaming interface");
+	audio_check(!audio_setup(0x41, USBD_PERF_OPCODE, 0, AUDIO_CONTROL_INTERFACE,
+			512), "stall host to device");
+	audio_check(audio_setup(USBD_PERF_REQUEST_TYPE, USBD_PERF_OPCODE, 0,
+			AUDIO_CONTROL_INTERFACE, 16) && (16 == g_ui32HostUsbControlSize),
+			"truncated to wLength");
+
+	/* A stream stopped by the host: the CODEC drains, no overrun */
+	memset(&run, 0, sizeof(run));
+	run.ui32SampleRate = AUDIO_RATE_48K;
+	audio_start(&run);
+	for (i = 0; i < 100; i++)
+	{
+		audio_frame(&run, (uint32_t) i, -1, 0);
+	}
+	audio_setup(0x01, USB_REQ_SET_INTERFACE, 0, AUDIO_STREAMING_INTERFACE, 0);
+	for (i = 0; i < 20; i++)
+	{
+		audio_play(&run);
+	}
+	audio_check((NULL == usbd_audio_getData(AUDIO_TEST_CHUNK))
+			&& (0 == run.ui32Corrupted), "alternate setting 0: ring drained");
+
+	if (argc > 1)
+	{
+		printf("traces:\n");
+		for (i = 1; i < argc; i++)
+		{
+			audio_replay(argv[i]);
+		}
+	}
+
+	printf("%s\n", (0 == g_ui32Failures) ? ("PASSED") : ("FAILED"));
+	return (0 == g_ui32Failures) ? (EXIT_SUCCESS) : (EXIT_FAILURE);
+}
+
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
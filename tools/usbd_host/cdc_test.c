@@ -0,0 +1,369 @@
+/**
+ ****************************************************************************
+ * @file        cdc_test.c
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       Host test of the CDC-ACM channel and its console.
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/*
+ * Run the CDC-ACM class (lib/usb/src/usbd_cdc.c) and the console
+ * (lib/usb/src/usbd_console.c) against the driver stand-in: the test is the
+ * host, it opens the terminal, sends the commands in 16-byte OUT packets and
+ * reads the IN packets. The performance probe is replaced by a counters blob
+ * owned by the test. Then the full speed bus time of the console output is
+ * compared with the bus time of the mass storage bulk packets.
+ *
+ * Build and run:  make -C tools/usbd_host check
+ */
+/* Includes ------------------------------------------------------------------*/
+#include "host_usb.h"
+#include "usbd_cdc.h"
+#include "usbd_console.h"
+#include "usbd_perf.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Private typedef -----------------------------------------------------------*/
+/**
+ * @struct _cdc_capture_t
+ * This type define the IN packets read by the host.
+ */
+typedef struct _cdc_capture_t
+{
+	char pcText[4096]; /*!< Bytes received, NUL terminated */
+	uint32_t ui32Length;
+	uint32_t ui32Packets; /*!< Packets, zero length ones included */
+	uint32_t ui32BusNs; /*!< Bus time of the packets */
+} cdc_capture_t;
+
+/* Private define ------------------------------------------------------------*/
+#define CDC_TEST_IN_EP			(CDC_IN_EP & 0x7F)
+#define CDC_TEST_MSC_PACKETS	(19) /*!< 64-byte bulk packets per 1ms frame at most, USB 2.0 table 5-9 */
+
+/* Private variables ---------------------------------------------------------*/
+static usbd_perf_counters_t g_testCounters; /*!< Counters of the probe stand-in */
+static uint32_t g_ui32UnmaskedReads = 0; /*!< Counters copied with the USB interrupt enabled */
+static uint32_t g_ui32Failures = 0;
+
+/* Private function prototypes -----------------------------------------------*/
+/**
+ * @brief  Probe stand-in: copy (and clear) the counters of the test.
+ */
+uint16_t usbd_perf_getCounters(uint8_t *pui8Blob, uint16_t ui16Size,
+		bool bClear)
+{
+	if (g_bHostUsbIrqEnabled)
+	{
+		g_ui32UnmaskedReads++;
+	}
+	g_testCounters.ui32TickMs = g_ui32HostTick;
+	if (ui16Size > sizeof(usbd_perf_counters_t))
+	{
+		ui16Size = sizeof(usbd_perf_counters_t);
+	}
+	memcpy(pui8Blob, &g_testCounters, ui16Size);
+	if (bClear)
+	{
+		memset(&g_testCounters.ui32SdReadCommands, 0,
+				sizeof(usbd_perf_counters_t)
+						- offsetof(usbd_perf_counters_t, ui32SdReadCommands));
+	}
+	return ui16Size;
+}
+
+static void cdc_check(bool bPassed, const char *pcName)
+{
+	printf("  %-40s %s\n", pcName, (bPassed) ? ("OK") : ("FAIL"));
+	if (!bPassed)
+	{
+		g_ui32Failures++;
+	}
+}
+
+/**
+ * @brief  Run the USB interrupt while it is pended.
+ */
+static void cdc_runIrq(void)
+{
+	while (host_usb_irqReady())
+	{
+		usbd_cdc_process();
+	}
+}
+
+/**
+ * @brief  Read the IN packets until the device has nothing left to send.
+ */
+static void cdc_read(cdc_capture_t *pCapture)
+{
+	host_usb_ep_t *pEp = &g_pHostUsbIn[CDC_TEST_IN_EP];
+
+	cdc_runIrq();
+	while (pEp->bArmed)
+	{
+		if ((pCapture->ui32Length + pEp->ui32Size) < sizeof(pCapture->pcText))
+		{
+			memcpy(&pCapture->pcText[pCapture->ui32Length], pEp->pui8Buffer,
+					pEp->ui32Size);
+			pCapture->ui32Length += pEp->ui32Size;
+			pCapture->pcText[pCapture->ui32Length] = '\0';
+		}
+		pCapture->ui32Packets++;
+		pCapture->ui32BusNs += HOST_USB_NS(HOST_USB_BULK_OVERHEAD + pEp->ui32Size);
+		pEp->bArmed = false;
+		USBD_CDC.DataIn(&g_hostUsbDevice, CDC_TEST_IN_EP);
+		cdc_runIrq();
+	}
+}
+
+/**
+ * @brief  Serve the console and read its output.
+ */
+static void cdc_serve(cdc_capture_t *pCapture)
+{
+	memset(pCapture, 0, sizeof(cdc_capture_t));
+	usbd_console_process();
+	cdc_read(pCapture);
+}
+
+/**
+ * @brief  Send a text in OUT packets, the main loop runs while the device NAKs.
+ */
+static void cdc_send(const char *pcText)
+{
+	host_usb_ep_t *pEp = &g_pHostUsbOut[CDC_OUT_EP];
+	uint32_t ui32Length = strlen(pcText);
+	uint32_t ui32Chunk;
+
+	while (0 != ui32Length)
+	{
+		while (!pEp->bArmed)
+		{
+			usbd_console_process();
+			cdc_runIrq();
+		}
+		ui32Chunk = (ui32Length < CDC_DATA_OUT_PACKET_SIZE) ?
+				(ui32Length) : (CDC_DATA_OUT_PACKET_SIZE);
+		memcpy(pEp->pui8Buffer, pcText, ui32Chunk);
+		pEp->ui32Size = ui32Chunk;
+		pEp->bArmed = false;
+		USBD_CDC.DataOut(&g_hostUsbDevice, CDC_OUT_EP);
+		pcText += ui32Chunk;
+		ui32Length -= ui32Chunk;
+	}
+}
+
+/**
+ * @brief  Open or close the terminal (SET_CONTROL_LINE_STATE).
+ */
+static void cdc_setDtr(bool bDtr)
+{
+	USBD_SetupReqTypedef req;
+	memset(&req, 0, sizeof(req));
+	req.bmRequest = 0x21; /* Class, interface */
+	req.bRequest = 0x22;
+	req.wValue = (bDtr) ? (1) : (0);
+	req.wIndex = CDC_COMM_INTERFACE;
+	USBD_CDC.Setup(&g_hostUsbDevice, &req);
+}
+
+/**
+ * @brief  Count the lines of a capture.
+ */
+static uint32_t cdc_countLines(const cdc_capture_t *pCapture)
+{
+	uint32_t ui32Lines = 0;
+	const char *pcText;
+	for (pcText = pCapture->pcText; NULL != (pcText = strchr(pcText, '\n'));
+			pcText++)
+	{
+		ui32Lines++;
+	}
+	return ui32Lines;
+}
+
+int main(void)
+{
+	static cdc_capture_t capture;
+	usbd_cdc_statistic_t statistic;
+	uint32_t ui32Lines = 0;
+	uint32_t ui32TraceBytes;
+	uint32_t ui32TracePackets;
+	uint32_t ui32TraceNs;
+	uint32_t ui32StatBytes = 0;
+	uint32_t ui32MscNs;
+	uint32_t i;
+
+	host_usb_reset();
+	USBD_CDC.Init(&g_hostUsbDevice, 0);
+	g_testCounters.ui32Magic = USBD_PERF_MAGIC;
+	g_testCounters.ui32Version = USBD_PERF_VERSION;
+	g_testCounters.ui32Size = sizeof(usbd_perf_counters_t);
+	g_testCounters.ui32SdReadBlocks = 4096;
+	g_testCounters.ui32CacheDataHits = 1234;
+
+	printf("console:\n");
+	cdc_send("help\r\n");
+	cdc_serve(&capture);
+	cdc_check(0 == capture.ui32Length, "silent while the terminal is closed");
+
+	cdc_setDtr(true);
+	cdc_serve(&capture);
+	cdc_check(0 == strncmp(capture.pcText, "Project Moon console", 20),
+			"banner on open");
+
+	cdc_send("help\r\n");
+	cdc_serve(&capture);
+	cdc_check(0 == strcmp(capture.pcText,
+			"commands: stat, clear, trace MS|off, help\r\n"), "help");
+
+	/* The stat lines outgrow the TX ring: written as the host reads */
+	cdc_send("stat\r\n");
+	for (i = 0; i < 8; i++)
+	{
+		usbd_console_process();
+		cdc_runIrq();
+	}
+	usbd_cdc_getStatistic(&statistic);
+	cdc_check((0 == statistic.ui32TxDropped)
+			&& (usbd_cdc_getTxRoom() < CDC_TX_RING_SIZE), "stat waits for a full ring");
+	for (i = 0; i < 64; i++)
+	{
+		cdc_serve(&capture);
+		ui32Lines += cdc_countLines(&capture);
+		ui32StatBytes += capture.ui32Length;
+	}
+	usbd_cdc_getStatistic(&statistic);
+	cdc_check((40 == ui32Lines) && (ui32StatBytes > CDC_TX_RING_SIZE)
+			&& (0 == statistic.ui32TxDropped), "stat prints 40 lines, none dropped");
+	cdc_check(0 == g_ui32UnmaskedReads, "counters read with the USB IRQ masked");
+
+	cdc_send("stat\r\n");
+	memset(&capture, 0, sizeof(capture));
+	for (i = 0; i < 64; i++)
+	{
+		usbd_console_process();
+		cdc_read(&capture);
+	}
+	cdc_check((NULL != strstr(capture.pcText, "\r\nui32SdReadBlocks 4096\r\n"))
+			&& (NULL != strstr(capture.pcText, "\r\nui32CacheDataHits 1234\r\n")),
+			"stat values");
+
+	cdc_send("clear\r\n");
+	cdc_serve(&capture);
+	cdc_check((0 == strcmp(capture.pcText, "cleared\r\n"))
+			&& (0 == g_testCounters.ui32SdReadBlocks), "clear");
+
+	/* Trace records: the counters gained over each period */
+	cdc_send("trace 1000\r\n");
+	cdc_serve(&capture);
+	cdc_check(0 == strcmp(capture.pcText, "trace on\r\n"), "trace on");
+	g_ui32HostTick += 999;
+	g_testCounters.ui32SdReadBlocks += 8;
+	g_testCounters.ui32CacheDataHits += 5;
+	g_testCounters.ui32UsbInNakUs += 1500;
+	cdc_serve(&capture);
+	cdc_check(0 == capture.ui32Length, "no record before the period");
+	g_ui32HostTick += 1;
+	cdc_serve(&capture);
+	cdc_check(0 == strcmp(capture.pcText,
+			"T 1000 rd=8 wr=0 hit=5 miss=0 usb=0 innak=1500 outnak=0 stall=0 drop=0\r\n"),
+			"trace record");
+	g_ui32HostTick += 1000;
+	g_testCounters.ui32SdReadBlocks = 4294967295u;
+	cdc_serve(&capture);
+	cdc_check(0 == strcmp(capture.pcText,
+			"T 2000 rd=4294967287 wr=0 hit=0 miss=0 usb=0 innak=0 outnak=0 stall=0 drop=0\r\n"),
+			"trace record of a 10 digit count");
+	ui32TraceBytes = capture.ui32Length;
+	ui32TracePackets = capture.ui32Packets;
+	ui32TraceNs = capture.ui32BusNs;
+	g_ui32HostTick += 1000;
+	g_testCounters.ui32SdReadBlocks = 3; /* Cleared by the vendor command */
+	cdc_serve(&capture);
+	cdc_check(NULL != strstr(capture.pcText, " rd=3 "),
+			"trace record after a clear");
+
+	/* A terminal closed for 10s gets one record on open, not ten */
+	cdc_setDtr(false);
+	g_ui32HostTick += 10000;
+	cdc_serve(&capture);
+	cdc_setDtr(true);
+	cdc_serve(&capture);
+	cdc_check((2 == cdc_countLines(&capture))
+			&& (NULL != strstr(capture.pcText, "\r\nT 13000 ")),
+			"no record burst after a reopen");
+
+	/* Host not reading: the records are dropped and counted */
+	cdc_send("trace 100\r\n");
+	cdc_serve(&capture);
+	for (i = 0; i < 100; i++)
+	{
+		g_ui32HostTick += 100;
+		usbd_console_process();
+		cdc_runIrq();
+	}
+	usbd_cdc_getStatistic(&statistic);
+	cdc_check(0 != statistic.ui32TxDropped, "records dropped while unread");
+	cdc_send("trace off\r\n");
+	for (i = 0; i < 16; i++)
+	{
+		cdc_serve(&capture);
+	}
+	g_ui32HostTick += 1000;
+	cdc_serve(&capture);
+	cdc_check(0 == capture.ui32Length, "trace off");
+
+	cdc_send("stat please print all the counters now\r\n");
+	cdc_serve(&capture);
+	cdc_check(0 == strcmp(capture.pcText, "line too long\r\n"), "line too long");
+	cdc_send("reboot\n");
+	cdc_serve(&capture);
+	cdc_check(0 == strcmp(capture.pcText, "unknown command, try help\r\n"),
+			"unknown command");
+
+	/* Full speed bus time (12Mbit/s, no bit stuffing), USB 2.0 section 5.11.3 */
+	ui32MscNs = HOST_USB_NS(HOST_USB_BULK_OVERHEAD + 64);
+	printf("bus time:\n");
+	printf("  MSC bulk packet (64 bytes):       %u ns, %u per frame, %u KB/s\n",
+			ui32MscNs, CDC_TEST_MSC_PACKETS, (CDC_TEST_MSC_PACKETS * 64 * 1000) / 1024);
+	printf("  trace record (%u bytes, %u packets): %u ns, %u.%03u%% of the bus at 1/s\n",
+			ui32TraceBytes, ui32TracePackets, ui32TraceNs,
+			ui32TraceNs / 10000000, (ui32TraceNs / 10000) % 1000);
+	printf("  stat (%u bytes):                 %u MSC packets displaced once\n",
+			ui32StatBytes,
+			(((ui32StatBytes + 63) / 64) * HOST_USB_NS(HOST_USB_BULK_OVERHEAD + 64)
+					+ ui32MscNs - 1) / ui32MscNs);
+	printf("  idle IN endpoint polled (NAK) per MSC packet: %u ns, %u MSC packets per frame\n",
+			HOST_USB_NS(HOST_USB_NAK_BYTES),
+			1000000 / (ui32MscNs + HOST_USB_NS(HOST_USB_NAK_BYTES)));
+
+	printf("%s\n", (0 == g_ui32Failures) ? ("PASSED") : ("FAILED"));
+	return (0 == g_ui32Failures) ? (0) : (1);
+}
+
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
@@ -0,0 +1,107 @@
+/**
+ ****************************************************************************
+ * @file        stm32f1xx_hal.h
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       Host stand-in of the HAL header for the USB device tests.
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __STM32F1xx_HAL_H
+#define __STM32F1xx_HAL_H
+
+/* Includes ------------------------------------------------------------------*/
+/* usbd_conf.h includes the HAL: the tick, the interrupt mask and the NVIC are
+ variables of the test, the USB interrupt is run by the test itself */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+	USB_LP_CAN1_RX0_IRQn = 20
+} IRQn_Type;
+
+typedef struct
+{
+	volatile uint32_t CYCCNT;
+} DWT_Type;
+
+/* Exported macro ------------------------------------------------------------*/
+#define UNUSED(x)			((void) (x))
+#define __weak				__attribute__((weak))
+#define DWT					(&g_hostDwt)
+
+/* Exported variables --------------------------------------------------------*/
+extern uint32_t g_ui32HostTick; /*!< HAL_GetTick() value */
+extern uint32_t g_ui32HostPrimask; /*!< __get_PRIMASK() value */
+extern bool g_bHostUsbIrqEnabled; /*!< USB interrupt enabled in the NVIC */
+extern bool g_bHostUsbIrqPending; /*!< USB interrupt pended */
+extern DWT_Type g_hostDwt; /*!< Cycle counter */
+extern uint32_t SystemCoreClock;
+
+/* Exported functions --------------------------------------------------------*/
+static inline uint32_t HAL_GetTick(void)
+{
+	return g_ui32HostTick;
+}
+
+static inline uint32_t __get_PRIMASK(void)
+{
+	return g_ui32HostPrimask;
+}
+
+static inline void __set_PRIMASK(uint32_t ui32Primask)
+{
+	g_ui32HostPrimask = ui32Primask;
+}
+
+static inline void __disable_irq(void)
+{
+	g_ui32HostPrimask = 1;
+}
+
+static inline void HAL_NVIC_SetPendingIRQ(IRQn_Type IRQn)
+{
+	UNUSED(IRQn);
+	g_bHostUsbIrqPending = true;
+}
+
+static inline void HAL_NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+	UNUSED(IRQn);
+	g_bHostUsbIrqEnabled = true;
+}
+
+static inline void HAL_NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+	UNUSED(IRQn);
+	g_bHostUsbIrqEnabled = false;
+}
+
+#endif /* __STM32F1xx_HAL_H */
+
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
@@ -0,0 +1,263 @@
+/**
+ ****************************************************************************
+ * @file        host_perf.c
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       This file stands for the storage path read by the performance probe.
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/* Includes ------------------------------------------------------------------*/
+/* lib/usb/src/usbd_perf.c runs its benchmarks through the block device and
+ the disk I/O layer (lib/fatfs), built unchanged over a card model in RAM
+ which advances the cycle counter. The card timing statistic comes from the
+ model, the SCSI layer and the song player report zero. The storage test
+ (HOST_PERF_MSC) builds the SCSI layer itself */
+#include "host_perf.h"
+#include "sd_diskio.h"
+#include "usbd_msc_scsi.h"
+#include "sd.h"
+#include "audio.h"
+#include <string.h>
+
+/* Private variables ---------------------------------------------------------*/
+static sd_latency_statistic_t g_hostCardRead; /*!< Commands of the model */
+static sd_latency_statistic_t g_hostCardWrite;
+static uint32_t g_ui32HostCardBusyUs = 0; /*!< Programming left after the last write */
+
+/* Exported variables --------------------------------------------------------*/
+uint8_t g_pui8HostCard[HOST_CARD_SECTORS * HOST_CARD_SECTOR_SIZE];
+uint32_t g_ui32HostCardFailSector = 0xFFFFFFFF;
+
+/* Private function prototypes -----------------------------------------------*/
+/**
+ * @brief  Spend the card time on the cycle counter and count the command.
+ */
+static void host_perf_spend(sd_latency_statistic_t *pStatistic, uint32_t ui32Us,
+		UINT count)
+{
+	g_hostDwt.CYCCNT += ui32Us * (SystemCoreClock / 1000000);
+	pStatistic->ui32Commands++;
+	pStatistic->ui32Blocks += count;
+	pStatistic->ui32TotalUs += ui32Us;
+	if (ui32Us > pStatistic->ui32MaxUs)
+	{
+		pStatistic->ui32MaxUs = ui32Us;
+	}
+}
+
+/**
+ * @brief  Check a transfer against the card and the failing sector.
+ */
+static DRESULT host_perf_check(DWORD sector, UINT count)
+{
+	if ((sector + count) > HOST_CARD_SECTORS)
+	{
+		return RES_PARERR;
+	}
+	if ((g_ui32HostCardFailSector >= sector)
+			&& ((g_ui32HostCardFailSector - sector) < count))
+	{
+		return RES_ERROR;
+	}
+	return RES_OK;
+}
+
+/* Exported functions prototype ----------------------------------------------*/
+/**
+ * @brief  Fill the card with its pattern, clear the statistics and mount the
+ *         drive of the disk I/O layer.
+ * @retval None
+ */
+void host_perf_reset(void)
+{
+	uint32_t i;
+
+	for (i = 0; i < sizeof(g_pui8HostCard); i++)
+	{
+		g_pui8HostCard[i] = host_perf_pattern(i);
+	}
+	memset(&g_hostCardRead, 0, sizeof(g_hostCardRead));
+	memset(&g_hostCardWrite, 0, sizeof(g_hostCardWrite));
+	g_ui32HostCardBusyUs = 0;
+	g_ui32HostCardFailSector = 0xFFFFFFFF;
+	disk_initialize(0);
+}
+
+/**
+ * @brief  Content of the card at a byte offset, different in every sector.
+ * @retval uint8_t: byte value
+ */
+uint8_t host_perf_pattern(uint32_t ui32Offset)
+{
+	return (uint8_t) (ui32Offset ^ (ui32Offset >> 9));
+}
+
+DSTATUS diskio_sd_initialize(BYTE lun)
+{
+	UNUSED(lun);
+	return 0;
+}
+
+DSTATUS diskio_sd_status(BYTE lun)
+{
+	UNUSED(lun);
+	return 0;
+}
+
+DRESULT diskio_sd_read(BYTE lun, BYTE *buff, DWORD sector, UINT count)
+{
+	DRESULT eResult = host_perf_check(sector, count);
+
+	UNUSED(lun);
+	if (RES_PARERR == eResult)
+	{
+		return eResult;
+	}
+	/* The next command waits for the programming */
+	host_perf_spend(&g_hostCardRead, g_ui32HostCardBusyUs + HOST_CARD_COMMAND_US
+			+ (count * HOST_CARD_READ_US), count);
+	g_ui32HostCardBusyUs = 0;
+	memcpy(buff, &g_pui8HostCard[(size_t) sector * HOST_CARD_SECTOR_SIZE],
+			(size_t) count * HOST_CARD_SECTOR_SIZE);
+	return eResult;
+}
+
+DRESULT diskio_sd_write(BYTE lun, const BYTE *buff, DWORD sector, UINT count)
+{
+	DRESULT eResult = host_perf_check(sector, count);
+
+	UNUSED(lun);
+	if (RES_OK != eResult)
+	{
+		return eResult;
+	}
+	host_perf_spend(&g_hostCardWrite, g_ui32HostCardBusyUs + HOST_CARD_COMMAND_US
+			+ (count * HOST_CARD_WRITE_US), count);
+	g_ui32HostCardBusyUs = HOST_CARD_PROGRAM_US;
+	memcpy(&g_pui8HostCard[(size_t) sector * HOST_CARD_SECTOR_SIZE], buff,
+			(size_t) count * HOST_CARD_SECTOR_SIZE);
+	return RES_OK;
+}
+
+DRESULT diskio_sd_ioctl(BYTE lun, BYTE cmd, void *buff)
+{
+	UNUSED(lun);
+	switch (cmd)
+	{
+	case CTRL_SYNC:
+		g_hostDwt.CYCCNT += g_ui32HostCardBusyUs * (SystemCoreClock / 1000000);
+		g_ui32HostCardBusyUs = 0;
+		return RES_OK;
+
+	case GET_SECTOR_COUNT:
+		*(DWORD *) buff = HOST_CARD_SECTORS;
+		return RES_OK;
+
+	case GET_SECTOR_SIZE:
+		*(WORD *) buff = HOST_CARD_SECTOR_SIZE;
+		return RES_OK;
+
+		/* Erase the sectors from start to end sector (DWORD[2]) */
+	case CTRL_TRIM:
+	{
+		DWORD sector = ((DWORD *) buff)[0];
+		UINT count = ((DWORD *) buff)[1] - sector + 1;
+		DRESULT eResult = host_perf_check(sector, count);
+
+		if (RES_OK != eResult)
+		{
+			return eResult;
+		}
+		host_perf_spend(&g_hostCardWrite, g_ui32HostCardBusyUs
+				+ HOST_CARD_COMMAND_US, 0);
+		g_ui32HostCardBusyUs = HOST_CARD_PROGRAM_US;
+		memset(&g_pui8HostCard[(size_t) sector * HOST_CARD_SECTOR_SIZE],
+				HOST_CARD_ERASED, (size_t) count * HOST_CARD_SECTOR_SIZE);
+		return RES_OK;
+	}
+
+	default:
+		return RES_PARERR;
+	}
+}
+
+bool bsp_sdio_isDetected(void)
+{
+	return true;
+}
+
+uint32_t sd_getBlockNumber(void)
+{
+	return HOST_CARD_SECTORS;
+}
+
+void sd_getLatencyStatistic(sd_latency_statistic_t *pReadStatistic,
+		sd_latency_statistic_t *pWriteStatistic)
+{
+	*pReadStatistic = g_hostCardRead;
+	*pWriteStatistic = g_hostCardWrite;
+}
+
+void sd_resetLatencyStatistic(void)
+{
+	memset(&g_hostCardRead, 0, sizeof(g_hostCardRead));
+	memset(&g_hostCardWrite, 0, sizeof(g_hostCardWrite));
+}
+
+void sd_getBusyStatistic(sd_busy_statistic_t *pStatistic)
+{
+	memset(pStatistic, 0, sizeof(sd_busy_statistic_t));
+}
+
+void sd_resetBusyStatistic(void)
+{
+}
+
+void sd_getCrcStatistic(sd_crc_statistic_t *pStatistic)
+{
+	memset(pStatistic, 0, sizeof(sd_crc_statistic_t));
+}
+
+#ifndef HOST_PERF_MSC
+void SCSI_GetStatistic(USBD_SCSI_StatisticTypeDef *stat)
+{
+	memset(stat, 0, sizeof(USBD_SCSI_StatisticTypeDef));
+}
+
+void SCSI_ResetStatistic(void)
+{
+}
+#endif /* HOST_PERF_MSC */
+
+void audio_getStatistic(audio_statistic_t *pStatistic)
+{
+	memset(pStatistic, 0, sizeof(audio_statistic_t));
+}
+
+void audio_resetStatistic(void)
+{
+}
+
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
@@ -0,0 +1,60 @@
+/**
+ ****************************************************************************
+ * @file        host_perf.h
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       This file is the header of the storage path stand-in of the probe.
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef HOST_PERF_H_
+#define HOST_PERF_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "diskio.h"
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+/* Card model behind the disk I/O layer: the times are parameters of the
+ model, to check the arithmetic of the probe, not figures of a card */
+#define HOST_CARD_SECTOR_SIZE	(512)
+#define HOST_CARD_SECTORS		(8192) /*!< 4MB */
+#define HOST_CARD_COMMAND_US	(100) /*!< Per read or write command */
+#define HOST_CARD_READ_US		(300) /*!< Per sector read */
+#define HOST_CARD_WRITE_US		(400) /*!< Per sector written */
+#define HOST_CARD_PROGRAM_US	(2000) /*!< Busy after a write, waited by CTRL_SYNC */
+#define HOST_CARD_ERASED		(0x00) /*!< Content of a sector erased by CTRL_TRIM */
+
+/* Exported variables --------------------------------------------------------*/
+extern uint8_t g_pui8HostCard[HOST_CARD_SECTORS * HOST_CARD_SECTOR_SIZE];
+extern uint32_t g_ui32HostCardFailSector; /*!< A transfer of this sector fails, 0xFFFFFFFF: none */
+
+/* Exported functions --------------------------------------------------------*/
+void host_perf_reset(void);
+uint8_t host_perf_pattern(uint32_t ui32Offset);
+
+#endif /* HOST_PERF_H_ */
+
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
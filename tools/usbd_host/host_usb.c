@@ -0,0 +1,182 @@
+/**
+ ****************************************************************************
+ * @file        host_usb.c
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       Host stand-in of the USB device driver for the USB device tests.
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/* Includes ------------------------------------------------------------------*/
+#include "host_usb.h"
+
+/* Exported variables --------------------------------------------------------*/
+uint32_t g_ui32HostTick = 0;
+uint32_t g_ui32HostPrimask = 0;
+bool g_bHostUsbIrqEnabled = true;
+bool g_bHostUsbIrqPending = false;
+DWT_Type g_hostDwt;
+uint32_t SystemCoreClock = 72000000;
+
+USBD_HandleTypeDef g_hostUsbDevice;
+host_usb_ep_t g_pHostUsbIn[HOST_USB_ENDPOINTS];
+host_usb_ep_t g_pHostUsbOut[HOST_USB_ENDPOINTS];
+uint8_t *g_pui8HostUsbControl = NULL;
+uint32_t g_ui32HostUsbControlSize = 0;
+uint32_t g_ui32HostUsbControlErrors = 0;
+
+/* Exported functions prototype ----------------------------------------------*/
+/**
+ * @brief  Close every endpoint and clear the interrupt state.
+ * @retval None
+ */
+void host_usb_reset(void)
+{
+	memset(&g_hostUsbDevice, 0, sizeof(g_hostUsbDevice));
+	memset(g_pHostUsbIn, 0, sizeof(g_pHostUsbIn));
+	memset(g_pHostUsbOut, 0, sizeof(g_pHostUsbOut));
+	g_bHostUsbIrqEnabled = true;
+	g_bHostUsbIrqPending = false;
+	g_ui32HostPrimask = 0;
+}
+
+/**
+ * @brief  Take the pended USB interrupt, as the NVIC would run it.
+ * @retval bool: The interrupt handler must run now
+ */
+bool host_usb_irqReady(void)
+{
+	if (!g_bHostUsbIrqPending || !g_bHostUsbIrqEnabled
+			|| (0 != g_ui32HostPrimask))
+	{
+		return false;
+	}
+	g_bHostUsbIrqPending = false;
+	return true;
+}
+
+USBD_StatusTypeDef USBD_LL_OpenEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr,
+		uint8_t ep_type, uint16_t ep_mps)
+{
+	host_usb_ep_t *pEp = (0 != (ep_addr & 0x80)) ?
+			(&g_pHostUsbIn[ep_addr & 0x7F]) : (&g_pHostUsbOut[ep_addr]);
+	UNUSED(pdev);
+	UNUSED(ep_type);
+	UNUSED(ep_mps);
+	memset(pEp, 0, sizeof(host_usb_ep_t));
+	pEp->bOpen = true;
+	return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_CloseEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+	host_usb_ep_t *pEp = (0 != (ep_addr & 0x80)) ?
+			(&g_pHostUsbIn[ep_addr & 0x7F]) : (&g_pHostUsbOut[ep_addr]);
+	UNUSED(pdev);
+	memset(pEp, 0, sizeof(host_usb_ep_t));
+	return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_Transmit(USBD_HandleTypeDef *pdev, uint8_t ep_addr,
+		uint8_t *pbuf, uint16_t size)
+{
+	host_usb_ep_t *pEp = &g_pHostUsbIn[ep_addr & 0x7F];
+	UNUSED(pdev);
+	pEp->pui8Buffer = pbuf;
+	pEp->ui32Size = size;
+	pEp->bArmed = true;
+	return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_PrepareReceive(USBD_HandleTypeDef *pdev,
+		uint8_t ep_addr, uint8_t *pbuf, uint16_t size)
+{
+	host_usb_ep_t *pEp = &g_pHostUsbOut[ep_addr];
+	UNUSED(pdev);
+	pEp->pui8Buffer = pbuf;
+	pEp->ui32Size = size;
+	pEp->bArmed = true;
+	return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_FlushEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+	host_usb_ep_t *pEp = (0 != (ep_addr & 0x80)) ?
+			(&g_pHostUsbIn[ep_addr & 0x7F]) : (&g_pHostUsbOut[ep_addr]);
+	UNUSED(pdev);
+	pEp->bArmed = false;
+	return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_StallEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+	host_usb_ep_t *pEp = (0 != (ep_addr & 0x80)) ?
+			(&g_pHostUsbIn[ep_addr & 0x7F]) : (&g_pHostUsbOut[ep_addr]);
+	UNUSED(pdev);
+	pEp->bStalled = true;
+	return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_ClearStallEP(USBD_HandleTypeDef *pdev,
+		uint8_t ep_addr)
+{
+	host_usb_ep_t *pEp = (0 != (ep_addr & 0x80)) ?
+			(&g_pHostUsbIn[ep_addr & 0x7F]) : (&g_pHostUsbOut[ep_addr]);
+	UNUSED(pdev);
+	pEp->bStalled = false;
+	return USBD_OK;
+}
+
+uint32_t USBD_LL_GetRxDataSize(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+	UNUSED(pdev);
+	return g_pHostUsbOut[ep_addr].ui32Size;
+}
+
+USBD_StatusTypeDef USBD_CtlSendData(USBD_HandleTypeDef *pdev, uint8_t *buf,
+		uint16_t len)
+{
+	UNUSED(pdev);
+	g_pui8HostUsbControl = buf;
+	g_ui32HostUsbControlSize = len;
+	return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_CtlPrepareRx(USBD_HandleTypeDef *pdev, uint8_t *pbuf,
+		uint16_t len)
+{
+	UNUSED(pdev);
+	g_pui8HostUsbControl = pbuf;
+	g_ui32HostUsbControlSize = len;
+	return USBD_OK;
+}
+
+void USBD_CtlError(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
+{
+	UNUSED(pdev);
+	UNUSED(req);
+	g_ui32HostUsbControlErrors++;
+}
+
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
@@ -0,0 +1,80 @@
+/**
+ ****************************************************************************
+ * @file        host_usb.h
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       Host stand-in of the USB device driver for the USB device tests.
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef HOST_USB_H_
+#define HOST_USB_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_core.h"
+#include <stdbool.h>
+#include <string.h>
+
+/* Exported types ------------------------------------------------------------*/
+/**
+ * @struct _host_usb_ep_t
+ * This type define an endpoint as the class left it to the driver.
+ */
+typedef struct _host_usb_ep_t
+{
+	bool bOpen; /*!< Opened by USBD_LL_OpenEP() */
+	bool bArmed; /*!< IN packet to send or OUT packet buffer given */
+	bool bStalled; /*!< Stalled by USBD_LL_StallEP() */
+	uint8_t *pui8Buffer; /*!< Packet data */
+	uint32_t ui32Size; /*!< IN packet length, OUT buffer size then received length */
+} host_usb_ep_t;
+
+/* Exported constants --------------------------------------------------------*/
+#define HOST_USB_ENDPOINTS		(8)
+
+/* Full speed transaction time, USB 2.0 section 5.11.3: 13 bytes of protocol
+ (tokens, handshake, SYNC, PID, CRC, EOP, inter-packet gaps) per bulk packet,
+ 9 per isochronous packet, at 12Mbit/s without bit stuffing as the tables of
+ the specification. A NAKed IN poll is a token and a handshake: 7 bytes. */
+#define HOST_USB_BULK_OVERHEAD	(13)
+#define HOST_USB_ISO_OVERHEAD	(9)
+#define HOST_USB_NAK_BYTES		(7)
+#define HOST_USB_NS(ui32Bytes)	(((ui32Bytes) * 8 * 1000) / 12)
+
+/* Exported variables --------------------------------------------------------*/
+extern USBD_HandleTypeDef g_hostUsbDevice;
+extern host_usb_ep_t g_pHostUsbIn[HOST_USB_ENDPOINTS];
+extern host_usb_ep_t g_pHostUsbOut[HOST_USB_ENDPOINTS];
+extern uint8_t *g_pui8HostUsbControl; /*!< Data stage given by USBD_CtlSendData()/USBD_CtlPrepareRx() */
+extern uint32_t g_ui32HostUsbControlSize;
+extern uint32_t g_ui32HostUsbControlErrors; /*!< Requests stalled by USBD_CtlError() */
+
+/* Exported functions --------------------------------------------------------*/
+void host_usb_reset(void);
+bool host_usb_irqReady(void);
+
+#endif /* HOST_USB_H_ */
+
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
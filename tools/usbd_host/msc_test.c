@@ -0,0 +1,400 @@
+/**
+ ****************************************************************************
+ * @file        msc_test.c
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       Host test of the USB storage class over the block device layer.
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/*
+ * Run the USB storage class (lib/usb/Class/MSC) and its storage interface
+ * (lib/usb/src/usbd_storage_if.c) against the driver stand-in, over the block
+ * device and the disk I/O layer built unchanged on the card model of
+ * host_perf.c. The test is the host: it sends the Bulk-Only commands, moves
+ * the data stage and reads the status wrapper, the main loop (blockdev
+ * service) only runs when the test says so, to check which command waits for
+ * the card.
+ *
+ * Build and run:  make -C tools/usbd_host check
+ */
+/* Includes ------------------------------------------------------------------*/
+#include "host_usb.h"
+#include "host_perf.h"
+#include "usbd_msc.h"
+#include "usbd_msc_bot.h"
+#include "usbd_msc_scsi.h"
+#include "usbd_storage_if.h"
+#include "blockdev.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define MSC_TEST_IN_EP			(MSC_EPIN_ADDR & 0x7F)
+#define MSC_TEST_OUT_EP			(MSC_EPOUT_ADDR)
+#define MSC_TEST_SERVICE		(64) /*!< Main loop passes before a command is given up */
+#define MSC_TEST_NO_CSW			(0xFF) /*!< msc_command(): no status wrapper */
+#define MSC_TEST_SECTORS		(8) /*!< Sectors of the READ10/WRITE10 round trip */
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t g_pui32Pool[(sizeof(USBD_MSC_BOT_HandleTypeDef) / 4) + 1]; /*!< USBD_static_malloc() */
+static uint8_t g_pui8Data[MSC_TEST_SECTORS * HOST_CARD_SECTOR_SIZE]; /*!< Data stage of the host */
+static uint32_t g_ui32Tag = 0;
+static uint32_t g_ui32Failures = 0;
+
+/* Exported variables --------------------------------------------------------*/
+USBD_HandleTypeDef hUsbDeviceFS;
+
+/* Private function prototypes -----------------------------------------------*/
+/**
+ * @brief  Driver stand-ins of usbd_conf.c.
+ */
+void *USBD_static_malloc(uint32_t size)
+{
+	return (size <= sizeof(g_pui32Pool)) ? (g_pui32Pool) : (NULL);
+}
+
+void USBD_static_free(void *p)
+{
+	UNUSED(p);
+}
+
+static void msc_check(bool bPassed, const char *pcName)
+{
+	printf("  %-40s %s\n", pcName, (bPassed) ? ("OK") : ("FAIL"));
+	if (!bPassed)
+	{
+		g_ui32Failures++;
+	}
+}
+
+/**
+ * @brief  Run the main loop until the endpoint is armed by the device.
+ * @retval bool: Armed, false if the device never answers
+ */
+static bool msc_wait(host_usb_ep_t *pEp)
+{
+	uint32_t i;
+
+	for (i = 0; (i < MSC_TEST_SERVICE) && !pEp->bArmed; i++)
+	{
+		blockdev_process(BLOCKDEV_PRIORITY_USB, BLOCKDEV_UNLIMITED);
+	}
+	return pEp->bArmed;
+}
+
+/**
+ * @brief  Give an OUT packet to the device, the whole buffer it armed at most.
+ * @retval uint32_t: Bytes taken
+ */
+static uint32_t msc_out(const uint8_t *pui8Data, uint32_t ui32Length)
+{
+	host_usb_ep_t *pEp = &g_pHostUsbOut[MSC_TEST_OUT_EP];
+
+	if (ui32Length > pEp->ui32Size)
+	{
+		ui32Length = pEp->ui32Size;
+	}
+	memcpy(pEp->pui8Buffer, pui8Data, ui32Length);
+	pEp->ui32Size = ui32Length;
+	pEp->bArmed = false;
+	USBD_MSC.DataOut(&hUsbDeviceFS, MSC_TEST_OUT_EP);
+	return ui32Length;
+}
+
+/**
+ * @brief  Take the IN transfer armed by the device.
+ * @retval uint32_t: Bytes read
+ */
+static uint32_t msc_in(uint8_t *pui8Data, uint32_t ui32Size)
+{
+	host_usb_ep_t *pEp = &g_pHostUsbIn[MSC_TEST_IN_EP];
+	uint32_t ui32Length = (pEp->ui32Size < ui32Size) ? (pEp->ui32Size) : (ui32Size);
+
+	memcpy(pui8Data, pEp->pui8Buffer, ui32Length);
+	pEp->bArmed = false;
+	USBD_MSC.DataIn(&hUsbDeviceFS, MSC_TEST_IN_EP);
+	return ui32Length;
+}
+
+/**
+ * @brief  Send the CBW of a command.
+ */
+static void msc_sendCbw(const uint8_t *pui8Cb, uint8_t ui8CbLength,
+		uint32_t ui32DataLength, bool bDataIn)
+{
+	USBD_MSC_BOT_CBWTypeDef cbw;
+
+	memset(&cbw, 0, sizeof(cbw));
+	cbw.dSignature = USBD_BOT_CBW_SIGNATURE;
+	cbw.dTag = ++g_ui32Tag;
+	cbw.dDataLength = ui32DataLength;
+	cbw.bmFlags = (bDataIn) ? (0x80) : (0x00);
+	cbw.bCBLength = ui8CbLength;
+	memcpy(cbw.CB, pui8Cb, ui8CbLength);
+	msc_out((const uint8_t *) &cbw, USBD_BOT_CBW_LENGTH);
+}
+
+/**
+ * @brief  Read the CSW of the last command.
+ * @retval uint8_t: CSW status, MSC_TEST_NO_CSW if the device never sends it
+ */
+static uint8_t msc_readCsw(void)
+{
+	USBD_MSC_BOT_CSWTypeDef csw;
+
+	if (!msc_wait(&g_pHostUsbIn[MSC_TEST_IN_EP])
+			|| (USBD_BOT_CSW_LENGTH != g_pHostUsbIn[MSC_TEST_IN_EP].ui32Size))
+	{
+		return MSC_TEST_NO_CSW;
+	}
+	msc_in((uint8_t *) &csw, USBD_BOT_CSW_LENGTH);
+	if ((USBD_BOT_CSW_SIGNATURE != csw.dSignature) || (g_ui32Tag != csw.dTag))
+	{
+		return MSC_TEST_NO_CSW;
+	}
+	return csw.bStatus;
+}
+
+/**
+ * @brief  Run a command with its data stage and read its status.
+ * @retval uint8_t: CSW status, MSC_TEST_NO_CSW if the device never sends it
+ */
+static uint8_t msc_command(const uint8_t *pui8Cb, uint8_t ui8CbLength,
+		uint8_t *pui8Data, uint32_t ui32Length, bool bDataIn)
+{
+	uint32_t ui32Done = 0;
+
+	msc_sendCbw(pui8Cb, ui8CbLength, ui32Length, bDataIn);
+	while (ui32Done < ui32Length)
+	{
+		if (bDataIn)
+		{
+			if (!msc_wait(&g_pHostUsbIn[MSC_TEST_IN_EP]))
+			{
+				return MSC_TEST_NO_CSW;
+			}
+			ui32Done += msc_in(&pui8Data[ui32Done], ui32Length - ui32Done);
+		}
+		else
+		{
+			if (!msc_wait(&g_pHostUsbOut[MSC_TEST_OUT_EP]))
+			{
+				return MSC_TEST_NO_CSW;
+			}
+			ui32Done += msc_out(&pui8Data[ui32Done], ui32Length - ui32Done);
+		}
+	}
+	return msc_readCsw();
+}
+
+/**
+ * @brief  READ10/WRITE10 of whole sectors.
+ */
+static uint8_t msc_readWrite(uint8_t ui8Opcode, uint32_t ui32Sector,
+		uint16_t ui16Count)
+{
+	uint8_t pui8Cb[10] =
+	{ ui8Opcode, 0, (uint8_t) (ui32Sector >> 24), (uint8_t) (ui32Sector >> 16),
+			(uint8_t) (ui32Sector >> 8), (uint8_t) ui32Sector, 0,
+			(uint8_t) (ui16Count >> 8), (uint8_t) ui16Count, 0 };
+
+	return msc_command(pui8Cb, sizeof(pui8Cb), g_pui8Data,
+			(uint32_t) ui16Count * HOST_CARD_SECTOR_SIZE,
+			(SCSI_READ10 == ui8Opcode));
+}
+
+/**
+ * @brief  Sense key and additional sense code of the last failed command.
+ */
+static uint16_t msc_sense(void)
+{
+	uint8_t pui8Cb[6] =
+	{ SCSI_REQUEST_SENSE, 0, 0, 0, REQUEST_SENSE_DATA_LEN, 0 };
+	uint8_t pui8Sense[REQUEST_SENSE_DATA_LEN];
+
+	if (USBD_CSW_CMD_PASSED != msc_command(pui8Cb, sizeof(pui8Cb), pui8Sense,
+			sizeof(pui8Sense), true))
+	{
+		return 0xFFFF;
+	}
+	return (uint16_t) (((pui8Sense[2] & 0x0F) << 8) | pui8Sense[12]);
+}
+
+/**
+ * @brief  Build an UNMAP parameter list of (sector, count) pairs in g_pui8Data.
+ * @retval uint16_t: Parameter list length
+ */
+static uint16_t msc_unmapList(const uint32_t *pui32Ranges, uint32_t ui32Ranges)
+{
+	uint16_t ui16Length = UNMAP_HEADER_LEN + (ui32Ranges * UNMAP_DESCRIPTOR_LEN);
+	uint8_t *pui8Descriptor = &g_pui8Data[UNMAP_HEADER_LEN];
+	uint32_t i;
+
+	memset(g_pui8Data, 0, ui16Length);
+	g_pui8Data[0] = (uint8_t) ((ui16Length - 2) >> 8);
+	g_pui8Data[1] = (uint8_t) (ui16Length - 2);
+	g_pui8Data[2] = (uint8_t) ((ui16Length - UNMAP_HEADER_LEN) >> 8);
+	g_pui8Data[3] = (uint8_t) (ui16Length - UNMAP_HEADER_LEN);
+	for (i = 0; i < ui32Ranges; i++, pui8Descriptor += UNMAP_DESCRIPTOR_LEN)
+	{
+		pui8Descriptor[4] = (uint8_t) (pui32Ranges[2 * i] >> 24);
+		pui8Descriptor[5] = (uint8_t) (pui32Ranges[2 * i] >> 16);
+		pui8Descriptor[6] = (uint8_t) (pui32Ranges[2 * i] >> 8);
+		pui8Descriptor[7] = (uint8_t) pui32Ranges[2 * i];
+		pui8Descriptor[8] = (uint8_t) (pui32Ranges[(2 * i) + 1] >> 24);
+		pui8Descriptor[9] = (uint8_t) (pui32Ranges[(2 * i) + 1] >> 16);
+		pui8Descriptor[10] = (uint8_t) (pui32Ranges[(2 * i) + 1] >> 8);
+		pui8Descriptor[11] = (uint8_t) pui32Ranges[(2 * i) + 1];
+	}
+	return ui16Length;
+}
+
+/**
+ * @brief  Send an UNMAP command and its parameter list, the status is left
+ *         to the caller (msc_readCsw).
+ * @retval bool: The device sent its status before the main loop ran
+ */
+static bool msc_unmap(const uint32_t *pui32Ranges, uint32_t ui32Ranges)
+{
+	uint16_t ui16Length = msc_unmapList(pui32Ranges, ui32Ranges);
+	uint8_t pui8Cb[10] =
+	{ SCSI_UNMAP, 0, 0, 0, 0, 0, 0, (uint8_t) (ui16Length >> 8),
+			(uint8_t) ui16Length, 0 };
+
+	msc_sendCbw(pui8Cb, sizeof(pui8Cb), ui16Length, false);
+	msc_out(g_pui8Data, ui16Length);
+	return g_pHostUsbIn[MSC_TEST_IN_EP].bArmed;
+}
+
+/**
+ * @brief  Check that a range of the card holds its pattern or is erased.
+ */
+static bool msc_cardIs(uint32_t ui32Sector, uint32_t ui32Count, bool bErased)
+{
+	uint32_t i = ui32Sector * HOST_CARD_SECTOR_SIZE;
+	uint32_t ui32End = (ui32Sector + ui32Count) * HOST_CARD_SECTOR_SIZE;
+
+	for (; i < ui32End; i++)
+	{
+		if (g_pui8HostCard[i] != ((bErased) ? (HOST_CARD_ERASED) : (host_perf_pattern(i))))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Exported functions --------------------------------------------------------*/
+int main(void)
+{
+	static const uint32_t pui32Two[] = { 200, 4, 300, 8 };
+	static const uint32_t pui32Eight[] = { 1000, 1, 1010, 2, 1020, 3, 1030, 0,
+			1040, 5, 1050, 6, 1060, 7, 1070, 8 };
+	static const uint32_t pui32Failing[] = { 400, 4, 500, 8 };
+	static const uint32_t pui32Outside[] = { 600, 4, HOST_CARD_SECTORS - 2, 4 };
+	uint8_t pui8Sync[10] = { SCSI_SYNCHRONIZE_CACHE10 };
+	uint8_t pui8Ready[6] = { SCSI_TEST_UNIT_READY };
+	uint8_t pui8Capacity[10] = { SCSI_READ_CAPACITY10 };
+	blockdev_statistic_t statistic;
+	bool bEarly;
+	uint32_t i;
+
+	host_perf_reset();
+	host_usb_reset();
+	memset(&hUsbDeviceFS, 0, sizeof(hUsbDeviceFS));
+	hUsbDeviceFS.pUserData = &USBD_Storage_Interface_fops_FS;
+	USBD_MSC.Init(&hUsbDeviceFS, 0);
+
+	printf("storage:\n");
+	msc_check(USBD_CSW_CMD_PASSED == msc_command(pui8Ready, sizeof(pui8Ready),
+			NULL, 0, false), "test unit ready");
+	msc_check((USBD_CSW_CMD_PASSED == msc_command(pui8Capacity,
+			sizeof(pui8Capacity), g_pui8Data, 8, true))
+			&& ((HOST_CARD_SECTORS - 1) == ((g_pui8Data[2] << 8) | g_pui8Data[3]))
+			&& (HOST_CARD_SECTOR_SIZE == ((g_pui8Data[6] << 8) | g_pui8Data[7])),
+			"read capacity");
+
+	for (i = 0; i < sizeof(g_pui8Data); i++)
+	{
+		g_pui8Data[i] = (uint8_t) ~i;
+	}
+	msc_check((USBD_CSW_CMD_PASSED == msc_readWrite(SCSI_WRITE10, 100,
+			MSC_TEST_SECTORS)) && (USBD_CSW_CMD_PASSED == msc_command(pui8Sync,
+			sizeof(pui8Sync), NULL, 0, false)), "write10 and synchronize");
+	memset(g_pui8Data, 0, sizeof(g_pui8Data));
+	msc_check(USBD_CSW_CMD_PASSED == msc_readWrite(SCSI_READ10, 100,
+			MSC_TEST_SECTORS), "read10");
+	for (i = 0; (i < sizeof(g_pui8Data)) && (g_pui8Data[i] == (uint8_t) ~i); i++)
+	{
+	}
+	msc_check((sizeof(g_pui8Data) == i) && (0 == memcmp(g_pui8Data,
+			&g_pui8HostCard[100 * HOST_CARD_SECTOR_SIZE], sizeof(g_pui8Data))),
+			"read10 returns the sectors written");
+
+	/* The status waits for the erase of the main loop */
+	bEarly = msc_unmap(pui32Two, 2);
+	msc_check(!bEarly, "unmap status after the erase");
+	msc_check(USBD_CSW_CMD_PASSED == msc_readCsw(), "unmap passed");
+	msc_check(msc_cardIs(200, 4, true) && msc_cardIs(300, 8, true)
+			&& msc_cardIs(204, 96, false) && msc_cardIs(308, 4, false),
+			"unmap erases its ranges only");
+
+	msc_unmap(pui32Eight, 8);
+	msc_check((USBD_CSW_CMD_PASSED == msc_readCsw()) && msc_cardIs(1000, 1, true)
+			&& msc_cardIs(1030, 1, false) && msc_cardIs(1070, 8, true),
+			"unmap of 8 descriptors");
+
+	g_ui32HostCardFailSector = 503;
+	msc_unmap(pui32Failing, 2);
+	msc_check(USBD_CSW_CMD_FAILED == msc_readCsw(), "unmap error fails the command");
+	msc_check(((MEDIUM_ERROR << 8) | WRITE_FAULT) == msc_sense(),
+			"unmap error sense: write fault");
+	g_ui32HostCardFailSector = 0xFFFFFFFF;
+
+	msc_unmap(pui32Outside, 2);
+	msc_check(USBD_CSW_CMD_FAILED == msc_readCsw(), "unmap out of range fails");
+	msc_check((((ILLEGAL_REQUEST << 8) | ADDRESS_OUT_OF_RANGE) == msc_sense())
+			&& msc_cardIs(600, 4, false), "unmap out of range erases nothing");
+
+	msc_check(USBD_CSW_CMD_PASSED == msc_command(pui8Ready, sizeof(pui8Ready),
+			NULL, 0, false), "ready after the errors");
+
+	/* FatFs is told once per host session: until it mounts the volume again */
+	blockdev_getStatistic(&statistic);
+	i = statistic.ui32HostWrites;
+	disk_initialize(0);
+	msc_unmap(pui32Two, 2);
+	msc_readCsw();
+	msc_readWrite(SCSI_WRITE10, 100, MSC_TEST_SECTORS);
+	blockdev_getStatistic(&statistic);
+	msc_check((1 == i) && (2 == statistic.ui32HostWrites)
+			&& (STA_NOINIT == (disk_status(0) & STA_NOINIT)),
+			"volume marked once per host session");
+
+	printf("%s\n", (0 == g_ui32Failures) ? ("PASSED") : ("FAILED"));
+	return (0 == g_ui32Failures) ? (0) : (1);
+}
+
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
@@ -0,0 +1,202 @@
+/**
+ ****************************************************************************
+ * @file        perf_model.c
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       This file implement the model transport of the probe tool.
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/*
+ * The model transport answers the vendor command with the firmware sources:
+ * the checks of SCSI_VendorPerf (usbd_msc_scsi.c) are repeated here, the
+ * counters and the benchmarks are lib/usb/src/usbd_perf.c, run on the block
+ * device and the disk I/O layer (lib/fatfs) over the card model of the USB
+ * host tests (tools/usbd_host/host_perf.c). The benchmark loop stands for the
+ * main loop, its status for the one of the mass storage command. The times
+ * printed are the ones of the card model.
+ */
+/* Includes ------------------------------------------------------------------*/
+#include "perf_model.h"
+#include "usbd_perf.h"
+#include "usbd_conf.h"
+#include "host_perf.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t g_pui32ModelStaging[MSC_STAGING_SIZE / 4]; /*!< MSC staging buffer */
+static bool g_bModelOwned = false; /*!< Benchmark command waiting for its status */
+static bool g_bModelSuccess = false; /*!< Status of the last benchmark */
+
+/* Private functions declaration ---------------------------------------------*/
+static bool perf_modelOwned(void);
+static void perf_modelComplete(bool bSuccess);
+static bool perf_modelCheckCard(void);
+static void perf_setSense(uint8_t *pui8Sense, uint8_t ui8Key, uint8_t ui8Asc);
+
+/* Private function prototypes -----------------------------------------------*/
+/**
+ * @brief  Check that the staging buffer still belongs to the benchmark.
+ * @retval bool: the benchmark command waits for its status
+ */
+static bool perf_modelOwned(void)
+{
+	return g_bModelOwned;
+}
+
+/**
+ * @brief  Receive the status of the benchmark command.
+ * @param  bSuccess: benchmark result.
+ * @retval None
+ */
+static void perf_modelComplete(bool bSuccess)
+{
+	g_bModelSuccess = bSuccess;
+	g_bModelOwned = false;
+}
+
+/**
+ * @brief  Check that the card model still holds its pattern: a rewrite must
+ *         write back the data read.
+ * @retval bool: content unchanged
+ */
+static bool perf_modelCheckCard(void)
+{
+	uint32_t i;
+
+	for (i = 0; i < sizeof(g_pui8HostCard); i++)
+	{
+		if (host_perf_pattern(i) != g_pui8HostCard[i])
+		{
+			fprintf(stderr, "model: card byte %u changed\n", i);
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief  Fill a fixed format sense.
+ * @param  pui8Sense: PERF_SENSE_SIZE bytes sense buffer.
+ * @param  ui8Key: sense key.
+ * @param  ui8Asc: additional sense code.
+ * @retval None
+ */
+static void perf_setSense(uint8_t *pui8Sense, uint8_t ui8Key, uint8_t ui8Asc)
+{
+	memset(pui8Sense, 0, PERF_SENSE_SIZE);
+	pui8Sense[0] = 0x70;
+	pui8Sense[2] = ui8Key;
+	pui8Sense[7] = 10;
+	pui8Sense[12] = ui8Asc;
+}
+
+/* Exported functions prototype ----------------------------------------------*/
+/**
+ * @brief  Fill the card model and mount it.
+ * @retval None
+ */
+void perf_modelOpen(void)
+{
+	host_perf_reset();
+}
+
+/**
+ * @brief  Answer one command as the firmware (SCSI_VendorPerf and usbd_perf.c).
+ * @param  pContext: unused.
+ * @param  pui8Cdb: USBD_PERF_CDB_LENGTH bytes command.
+ * @param  pui8Data: data in buffer.
+ * @param  pui32Length: data in length, updated with the bytes returned.
+ * @param  pui8Sense: PERF_SENSE_SIZE bytes sense buffer.
+ * @retval int: 0 good, 1 check condition, -1 card content changed
+ */
+int perf_modelCommand(void *pContext, const uint8_t *pui8Cdb,
+		uint8_t *pui8Data, uint32_t *pui32Length, uint8_t *pui8Sense)
+{
+	uint32_t ui32Length = ((uint32_t) pui8Cdb[7] << 8) | pui8Cdb[8];
+	uint32_t ui32Sector = ((uint32_t) pui8Cdb[3] << 24)
+			| ((uint32_t) pui8Cdb[4] << 16) | ((uint32_t) pui8Cdb[5] << 8)
+			| pui8Cdb[6];
+
+	(void) pContext;
+	/* The tick follows the cycle counter advanced by the card model */
+	g_ui32HostTick = g_hostDwt.CYCCNT / (SystemCoreClock / 1000);
+	if (USBD_PERF_OPCODE != pui8Cdb[0])
+	{
+		perf_setSense(pui8Sense, 0x05, 0x20); /* ILLEGAL REQUEST, INVALID CDB */
+		return 1;
+	}
+	switch (pui8Cdb[1])
+	{
+	case USBD_PERF_GET_COUNTERS:
+		/* The blob is built in the staging buffer */
+		ui32Length = MIN(ui32Length, MIN(*pui32Length, MSC_STAGING_SIZE));
+		*pui32Length = usbd_perf_getCounters((uint8_t *) g_pui32ModelStaging,
+				(uint16_t) ui32Length, (0 != (pui8Cdb[2] & USBD_PERF_CLEAR)));
+		memcpy(pui8Data, g_pui32ModelStaging, *pui32Length);
+		return 0;
+
+	case USBD_PERF_BENCHMARK:
+		if ((0 != *pui32Length) || (0 == ui32Length)
+				|| (USBD_PERF_MAX_SECTORS < ui32Length))
+		{
+			perf_setSense(pui8Sense, 0x05, 0x24); /* ILLEGAL REQUEST, INVALID FIELD IN CDB */
+			return 1;
+		}
+		if ((ui32Sector + ui32Length) > HOST_CARD_SECTORS)
+		{
+			perf_setSense(pui8Sense, 0x05, 0x21); /* ILLEGAL REQUEST, LBA OUT OF RANGE */
+			return 1;
+		}
+		g_bModelOwned = true;
+		if (!usbd_perf_startBenchmark((usbd_perf_benchmark_t) pui8Cdb[2],
+				(uint8_t *) g_pui32ModelStaging, MSC_STAGING_SIZE, ui32Sector,
+				ui32Length, perf_modelOwned, perf_modelComplete))
+		{
+			g_bModelOwned = false;
+			g_bModelSuccess = false;
+		}
+		while (g_bModelOwned)
+		{
+			usbd_perf_process();
+		}
+		if (!perf_modelCheckCard())
+		{
+			return -1;
+		}
+		if (!g_bModelSuccess)
+		{
+			perf_setSense(pui8Sense, 0x03, 0x11); /* MEDIUM ERROR, UNRECOVERED READ ERROR */
+			return 1;
+		}
+		return 0;
+
+	default:
+		perf_setSense(pui8Sense, 0x05, 0x24);
+		return 1;
+	}
+}
+
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
@@ -0,0 +1,48 @@
+/**
+ ****************************************************************************
+ * @file        perf_model.h
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       This file is the header of the model transport of the probe tool.
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef PERF_MODEL_H_
+#define PERF_MODEL_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define PERF_SENSE_SIZE			(32) /*!< Sense buffer of a command */
+
+/* Exported functions --------------------------------------------------------*/
+void perf_modelOpen(void);
+int perf_modelCommand(void *pContext, const uint8_t *pui8Cdb,
+		uint8_t *pui8Data, uint32_t *pui32Length, uint8_t *pui8Sense);
+
+#endif /* PERF_MODEL_H_ */
+
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/
@@ -0,0 +1,512 @@
+/**
+ ****************************************************************************
+ * @file        usbd_perf_cli.c
+ * @author      Long Dang
+ * @version     V0.1
+ * @date        19-October-2026
+ * @copyright   LGPLv3
+ * @brief       Host tool of the performance probe (Linux SG_IO and usbfs).
+ ****************************************************************************
+ * @attention
+ *
+ * <h2><center>&trade; PnL - Programming and Leverage </center></h2>
+ *
+ * This file is part of Project Moon.
+ *
+ *   Project Moon is free embedded software: you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation, either version 3 of the
+ *   License, or (at your option) any later version.
+ *
+ *   Project Moon is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *   See the GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with Project Moon.
+ *   If not, see <http://www.gnu.org/licenses>.
+ ****************************************************************************
+ */
+/*
+ * Read the performance counters of the device and run its benchmarks through
+ * the vendor SCSI command of the mass storage function (lib/usb/inc/usbd_perf.h).
+ * Commands are sent by SG_IO to the disk (/dev/sdX) or its generic node
+ * (/dev/sgN), which needs root. The speaker build has no mass storage: its
+ * counters are read by the vendor control request through usbfs
+ * (/dev/bus/usb/BBB/DDD, see lsusb), without benchmark. The model transport
+ * (perf_model.c) runs the firmware sources of the probe over a card model, to
+ * check the command encoding, the blob decoding and the benchmarks without a
+ * board.
+ *
+ * Build:  make (make check runs the model transport)
+ * Usage:  usbd_perf_cli DEVICE|--model counters [--clear]
+ *         usbd_perf_cli DEVICE|--model bench read|rewrite SECTOR COUNT
+ */
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_perf.h"
+#include "perf_model.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <scsi/sg.h>
+#include <linux/usbdevice_fs.h>
+
+/* Private typedef -----------------------------------------------------------*/
+/**
+ * @typedef perf_command_t
+ * Send one command: data in if pui32Length is not 0, the sense is filled on a
+ * CHECK CONDITION. Return 0 on GOOD status, 1 on CHECK CONDITION, -1 on a
+ * transport error.
+ */
+typedef int (*perf_command_t)(void *pContext, const uint8_t *pui8Cdb,
+		uint8_t *pui8Data, uint32_t *pui32Length, uint8_t *pui8Sense);
+
+/**
+ * @struct _perf_transport_t
+ * This type define the path to the device.
+ */
+typedef struct _perf_transport_t
+{
+	perf_command_t pfnCommand;
+	void *pContext;
+} perf_transport_t;
+
+/**
+ * @struct _perf_field_t
+ * This type define a counter of the blob to print.
+ */
+typedef struct _perf_field_t
+{
+	const char *pcName;
+	size_t ui32Offset;
+} perf_field_t;
+
+/* Private define ------------------------------------------------------------*/
+#define PERF_COUNTERS_TIMEOUT_MS	(5000)
+#define PERF_BENCH_TIMEOUT_MS	(60000) /*!< USBD_PERF_MAX_SECTORS at the slowest card */
+#define PERF_USBFS_PREFIX		"/dev/bus/usb/"
+
+/* Private macro -------------------------------------------------------------*/
+#define PERF_FIELD(name)		{ #name, offsetof(usbd_perf_counters_t, name) }
+
+/* Private variables ---------------------------------------------------------*/
+static const perf_field_t g_pPerfFields[] =
+{
+PERF_FIELD(ui32TickMs),
+PERF_FIELD(ui32SdReadCommands),
+PERF_FIELD(ui32SdReadBlocks),
+PERF_FIELD(ui32SdReadTotalUs),
+PERF_FIELD(ui32SdReadMaxUs),
+PERF_FIELD(ui32SdWriteCommands),
+PERF_FIELD(ui32SdWriteBlocks),
+PERF_FIELD(ui32SdWriteTotalUs),
+PERF_FIELD(ui32SdWriteMaxUs),
+PERF_FIELD(ui32SdDeferredWrites),
+PERF_FIELD(ui32SdBusyHiddenMs),
+PERF_FIELD(ui32SdBusyStalledMs),
+PERF_FIELD(ui32SdCrcReadErrors),
+PERF_FIELD(ui32SdCrcWriteErrors),
+PERF_FIELD(ui32SdCrcFailures),
+PERF_FIELD(ui32CacheMetaHits),
+PERF_FIELD(ui32CacheMetaMisses),
+PERF_FIELD(ui32CacheDataHits),
+PERF_FIELD(ui32CacheDataMisses),
+PERF_FIELD(pui32BlockdevServed[0]),
+PERF_FIELD(pui32BlockdevServed[1]),
+PERF_FIELD(pui32BlockdevMaxWaitMs[0]),
+PERF_FIELD(pui32BlockdevMaxWaitMs[1]),
+PERF_FIELD(ui32BlockdevHostWrites),
+PERF_FIELD(ui32UsbInNakWindows),
+PERF_FIELD(ui32UsbInNakUs),
+PERF_FIELD(ui32UsbOutNakWindows),
+PERF_FIELD(ui32UsbOutNakUs),
+PERF_FIELD(ui32CodecChunks),
+PERF_FIELD(ui32CodecStalls),
+PERF_FIELD(ui32BenchType),
+PERF_FIELD(ui32BenchState),
+PERF_FIELD(ui32BenchSector),
+PERF_FIELD(ui32BenchCount),
+PERF_FIELD(ui32BenchUs),
+PERF_FIELD(ui32BenchMaxChunkUs),
+PERF_FIELD(ui32SpeakerPackets),
+PERF_FIELD(ui32SpeakerOverruns),
+PERF_FIELD(ui32SpeakerUnderruns),
+PERF_FIELD(ui32SpeakerFillLevel),
+PERF_FIELD(ui32SpeakerFillMin),
+PERF_FIELD(ui32SpeakerFillMax),
+PERF_FIELD(ui32SpeakerFeedback),
+PERF_FIELD(ui32SpeakerHostRate),
+PERF_FIELD(ui32SpeakerSampleRate), };
+
+/* Private functions declaration ---------------------------------------------*/
+static int perf_sgCommand(void *pContext, const uint8_t *pui8Cdb,
+		uint8_t *pui8Data, uint32_t *pui32Length, uint8_t *pui8Sense);
+static int perf_usbCommand(void *pContext, const uint8_t *pui8Cdb,
+		uint8_t *pui8Data, uint32_t *pui32Length, uint8_t *pui8Sense);
+static uint32_t perf_getWord(const uint8_t *pui8Blob, uint32_t ui32Length,
+		size_t ui32Offset);
+static void perf_buildCdb(uint8_t *pui8Cdb, uint8_t ui8Action, uint8_t ui8Param,
+		uint32_t ui32Sector, uint16_t ui16Length);
+static int perf_report(int iStatus, const uint8_t *pui8Sense);
+static int perf_counters(const perf_transport_t *pTransport, bool bClear);
+static int perf_bench(const perf_transport_t *pTransport,
+		usbd_perf_benchmark_t eType, uint32_t ui32Sector, uint32_t ui32Count);
+static void perf_usage(void);
+
+/* Private function prototypes -----------------------------------------------*/
+/**
+ * @brief  Send one command through the SCSI generic driver.
+ * @param  pContext: pointer to the file descriptor of the device.
+ * @param  pui8Cdb: USBD_PERF_CDB_LENGTH bytes command.
+ * @param  pui8Data: data in buffer.
+ * @param  pui32Length: data in length, updated with the bytes received.
+ * @param  pui8Sense: PERF_SENSE_SIZE bytes sense buffer.
+ * @retval int: 0 good, 1 check condition, -1 transport error
+ */
+static int perf_sgCommand(void *pContext, const uint8_t *pui8Cdb,
+		uint8_t *pui8Data, uint32_t *pui32Length, uint8_t *pui8Sense)
+{
+	sg_io_hdr_t io;
+
+	memset(&io, 0, sizeof(sg_io_hdr_t));
+	io.interface_id = 'S';
+	io.cmdp = (unsigned char *) pui8Cdb;
+	io.cmd_len = USBD_PERF_CDB_LENGTH;
+	io.sbp = pui8Sense;
+	io.mx_sb_len = PERF_SENSE_SIZE;
+	io.dxfer_direction = (0 != *pui32Length) ? (SG_DXFER_FROM_DEV) : (SG_DXFER_NONE);
+	io.dxferp = pui8Data;
+	io.dxfer_len = *pui32Length;
+	io.timeout = (USBD_PERF_BENCHMARK == pui8Cdb[1]) ?
+			(PERF_BENCH_TIMEOUT_MS) : (PERF_COUNTERS_TIMEOUT_MS);
+	if (ioctl(*(int *) pContext, SG_IO, &io) < 0)
+	{
+		perror("SG_IO");
+		return -1;
+	}
+	if ((0 != io.host_status) || ((0 != io.driver_status) && (0 == io.sb_len_wr)))
+	{
+		fprintf(stderr, "transport failed: host 0x%x, driver 0x%x\n",
+				io.host_status, io.driver_status);
+		return -1;
+	}
+	*pui32Length -= io.resid;
+	return (0 == io.status) ? (0) : (1);
+}
+
+/**
+ * @brief  Send the counters command as the vendor control request of the
+ * 			speaker build (usbfs), no root needed with a udev rule.
+ * @param  pContext: pointer to the file descriptor of the USB device.
+ * @param  pui8Cdb: USBD_PERF_CDB_LENGTH bytes command.
+ * @param  pui8Data: data in buffer.
+ * @param  pui32Length: data in length, updated with the bytes received.
+ * @param  pui8Sense: not filled, a stall is a transport error.
+ * @retval int: 0 good, -1 transport error
+ */
+static int perf_usbCommand(void *pContext, const uint8_t *pui8Cdb,
+		uint8_t *pui8Data, uint32_t *pui32Length, uint8_t *pui8Sense)
+{
+	struct usbdevfs_ctrltransfer control;
+	int iLength;
+
+	(void) pui8Sense;
+	if (USBD_PERF_GET_COUNTERS != pui8Cdb[1])
+	{
+		fprintf(stderr, "the speaker build has no benchmark\n");
+		return -1;
+	}
+	memset(&control, 0, sizeof(control));
+	control.bRequestType = USBD_PERF_REQUEST_TYPE;
+	control.bRequest = USBD_PERF_OPCODE;
+	control.wValue = pui8Cdb[2];
+	control.wIndex = 0;
+	control.wLength = (uint16_t) ((*pui32Length > 0xFFFF) ? (0xFFFF) : (*pui32Length));
+	control.timeout = PERF_COUNTERS_TIMEOUT_MS;
+	control.data = pui8Data;
+	iLength = ioctl(*(int *) pContext, USBDEVFS_CONTROL, &control);
+	if (iLength < 0)
+	{
+		perror("USBDEVFS_CONTROL");
+		return -1;
+	}
+	*pui32Length = (uint32_t) iLength;
+	return 0;
+}
+
+/**
+ * @brief  Read a little endian word of the blob, 0 if not received.
+ * @param  pui8Blob: received blob.
+ * @param  ui32Length: number of bytes received.
+ * @param  ui32Offset: offset of the word.
+ * @retval uint32_t: word value
+ */
+static uint32_t perf_getWord(const uint8_t *pui8Blob, uint32_t ui32Length,
+		size_t ui32Offset)
+{
+	if ((ui32Offset + 4) > ui32Length)
+	{
+		return 0;
+	}
+	return (uint32_t) pui8Blob[ui32Offset]
+			| ((uint32_t) pui8Blob[ui32Offset + 1] << 8)
+			| ((uint32_t) pui8Blob[ui32Offset + 2] << 16)
+			| ((uint32_t) pui8Blob[ui32Offset + 3] << 24);
+}
+
+/**
+ * @brief  Build the command descriptor block (usbd_perf.h).
+ * @param  pui8Cdb: USBD_PERF_CDB_LENGTH bytes output.
+ * @param  ui8Action: USBD_PERF_GET_COUNTERS or USBD_PERF_BENCHMARK.
+ * @param  ui8Param: flags or benchmark type.
+ * @param  ui32Sector: first sector.
+ * @param  ui16Length: allocation length or number of sectors.
+ * @retval None
+ */
+static void perf_buildCdb(uint8_t *pui8Cdb, uint8_t ui8Action, uint8_t ui8Param,
+		uint32_t ui32Sector, uint16_t ui16Length)
+{
+	memset(pui8Cdb, 0, USBD_PERF_CDB_LENGTH);
+	pui8Cdb[0] = USBD_PERF_OPCODE;
+	pui8Cdb[1] = ui8Action;
+	pui8Cdb[2] = ui8Param;
+	pui8Cdb[3] = (uint8_t) (ui32Sector >> 24);
+	pui8Cdb[4] = (uint8_t) (ui32Sector >> 16);
+	pui8Cdb[5] = (uint8_t) (ui32Sector >> 8);
+	pui8Cdb[6] = (uint8_t) ui32Sector;
+	pui8Cdb[7] = (uint8_t) (ui16Length >> 8);
+	pui8Cdb[8] = (uint8_t) ui16Length;
+}
+
+/**
+ * @brief  Print a failed command.
+ * @param  iStatus: result of the transport.
+ * @param  pui8Sense: sense of a check condition.
+ * @retval int: process exit code
+ */
+static int perf_report(int iStatus, const uint8_t *pui8Sense)
+{
+	if (1 == iStatus)
+	{
+		fprintf(stderr, "check condition: key 0x%x, asc 0x%02x, ascq 0x%02x\n",
+				pui8Sense[2] & 0x0F, pui8Sense[12], pui8Sense[13]);
+	}
+	return EXIT_FAILURE;
+}
+
+/**
+ * @brief  Read and print the counters.
+ * @param  pTransport: path to the device.
+ * @param  bClear: clear the counters once read.
+ * @retval int: process exit code
+ */
+static int perf_counters(const perf_transport_t *pTransport, bool bClear)
+{
+	uint8_t pui8Cdb[USBD_PERF_CDB_LENGTH];
+	uint8_t pui8Sense[PERF_SENSE_SIZE];
+	uint8_t pui8Blob[512];
+	uint32_t ui32Length = sizeof(pui8Blob);
+	uint32_t ui32Index;
+	uint32_t ui32Value;
+	int iStatus;
+
+	perf_buildCdb(pui8Cdb, USBD_PERF_GET_COUNTERS,
+			(bClear) ? (USBD_PERF_CLEAR) : (0), 0, sizeof(pui8Blob));
+	iStatus = pTransport->pfnCommand(pTransport->pContext, pui8Cdb, pui8Blob,
+			&ui32Length, pui8Sense);
+	if (0 != iStatus)
+	{
+		return perf_report(iStatus, pui8Sense);
+	}
+	if ((USBD_PERF_MAGIC != perf_getWord(pui8Blob, ui32Length, 0))
+			|| (USBD_PERF_VERSION != perf_getWord(pui8Blob, ui32Length, 4)))
+	{
+		fprintf(stderr, "not a counters blob (%u bytes)\n", ui32Length);
+		return EXIT_FAILURE;
+	}
+
+	printf("blob: %u bytes, device %u bytes\n", ui32Length,
+			perf_getWord(pui8Blob, ui32Length, 8));
+	for (ui32Index = 0; ui32Index < (sizeof(g_pPerfFields) / sizeof(perf_field_t));
+			ui32Index++)
+	{
+		ui32Value = perf_getWord(pui8Blob, ui32Length,
+				g_pPerfFields[ui32Index].ui32Offset);
+		printf("%-28s %10u\n", g_pPerfFields[ui32Index].pcName, ui32Value);
+	}
+
+	/* Derived values */
+	ui32Value = perf_getWord(pui8Blob, ui32Length,
+			offsetof(usbd_perf_counters_t, ui32SdReadCommands));
+	if (0 != ui32Value)
+	{
+		printf("%-28s %10u\n", "sd read avg us",
+				perf_getWord(pui8Blob, ui32Length,
+						offsetof(usbd_perf_counters_t, ui32SdReadTotalUs)) / ui32Value);
+	}
+	ui32Value = perf_getWord(pui8Blob, ui32Length,
+			offsetof(usbd_perf_counters_t, ui32SdWriteCommands));
+	if (0 != ui32Value)
+	{
+		printf("%-28s %10u\n", "sd write avg us",
+				perf_getWord(pui8Blob, ui32Length,
+						offsetof(usbd_perf_counters_t, ui32SdWriteTotalUs)) / ui32Value);
+	}
+	ui32Value = perf_getWord(pui8Blob, ui32Length,
+			offsetof(usbd_perf_counters_t, ui32BenchUs));
+	if (0 != ui32Value)
+	{
+		printf("%-28s %10.1f\n", "bench KB/s",
+				(perf_getWord(pui8Blob, ui32Length,
+						offsetof(usbd_perf_counters_t, ui32BenchCount)) * 512.0
+						* 1000000.0 / 1024.0) / ui32Value);
+	}
+	if (bClear)
+	{
+		printf("cleared\n");
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief  Run a benchmark, then print its result.
+ * @param  pTransport: path to the device.
+ * @param  eType: benchmark to run.
+ * @param  ui32Sector: first sector.
+ * @param  ui32Count: number of sectors.
+ * @retval int: process exit code
+ */
+static int perf_bench(const perf_transport_t *pTransport,
+		usbd_perf_benchmark_t eType, uint32_t ui32Sector, uint32_t ui32Count)
+{
+	uint8_t pui8Cdb[USBD_PERF_CDB_LENGTH];
+	uint8_t pui8Sense[PERF_SENSE_SIZE];
+	uint8_t pui8Blob[sizeof(usbd_perf_counters_t)];
+	uint32_t ui32Length = 0;
+	uint32_t ui32Us;
+	uint32_t ui32MaxUs;
+	int iStatus;
+
+	if ((0 == ui32Count) || (USBD_PERF_MAX_SECTORS < ui32Count))
+	{
+		fprintf(stderr, "COUNT must be 1 to %u sectors\n", USBD_PERF_MAX_SECTORS);
+		return EXIT_FAILURE;
+	}
+	perf_buildCdb(pui8Cdb, USBD_PERF_BENCHMARK, (uint8_t) eType, ui32Sector,
+			(uint16_t) ui32Count);
+	iStatus = pTransport->pfnCommand(pTransport->pContext, pui8Cdb, NULL,
+			&ui32Length, pui8Sense);
+	if (0 != iStatus)
+	{
+		return perf_report(iStatus, pui8Sense);
+	}
+
+	/* The result is kept with the counters */
+	ui32Length = sizeof(pui8Blob);
+	perf_buildCdb(pui8Cdb, USBD_PERF_GET_COUNTERS, 0, 0, sizeof(pui8Blob));
+	iStatus = pTransport->pfnCommand(pTransport->pContext, pui8Cdb, pui8Blob,
+			&ui32Length, pui8Sense);
+	if (0 != iStatus)
+	{
+		return perf_report(iStatus, pui8Sense);
+	}
+	if ((USBD_PERF_STATE_DONE
+			!= perf_getWord(pui8Blob, ui32Length,
+					offsetof(usbd_perf_counters_t, ui32BenchState)))
+			|| (ui32Count
+					!= perf_getWord(pui8Blob, ui32Length,
+							offsetof(usbd_perf_counters_t, ui32BenchCount))))
+	{
+		fprintf(stderr, "benchmark result not found\n");
+		return EXIT_FAILURE;
+	}
+	ui32Us = perf_getWord(pui8Blob, ui32Length,
+			offsetof(usbd_perf_counters_t, ui32BenchUs));
+	ui32MaxUs = perf_getWord(pui8Blob, ui32Length,
+			offsetof(usbd_perf_counters_t, ui32BenchMaxChunkUs));
+	printf("%s %u sectors from %u: %u us, %.1f KB/s, slowest transfer %u us\n",
+			(USBD_PERF_BENCH_READ == eType) ? ("read") : ("rewrite"), ui32Count,
+			ui32Sector, ui32Us,
+			(0 != ui32Us) ? ((ui32Count * 512.0 * 1000000.0 / 1024.0) / ui32Us) : (0.0),
+			ui32MaxUs);
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief  Print the command line.
+ * @retval None
+ */
+static void perf_usage(void)
+{
+	fprintf(stderr,
+			"usage: usbd_perf_cli DEVICE|--model counters [--clear]\n"
+			"       usbd_perf_cli DEVICE|--model bench read|rewrite SECTOR COUNT\n"
+			"DEVICE is /dev/sdX or /dev/sgN of the board, root is needed,\n"
+			"or /dev/bus/usb/BBB/DDD of the speaker build (counters only).\n"
+			"A rewrite writes back the sectors read: the content is kept.\n");
+}
+
+/* Exported functions prototype ----------------------------------------------*/
+int main(int argc, char *argv[])
+{
+	perf_transport_t transport;
+	int iFd = -1;
+	int iResult = EXIT_FAILURE;
+
+	if (argc < 3)
+	{
+		perf_usage();
+		return EXIT_FAILURE;
+	}
+
+	if (0 == strcmp(argv[1], "--model"))
+	{
+		perf_modelOpen();
+		transport.pfnCommand = perf_modelCommand;
+		transport.pContext = NULL;
+	}
+	else
+	{
+		iFd = open(argv[1], O_RDWR | O_NONBLOCK);
+		if (iFd < 0)
+		{
+			perror(argv[1]);
+			return EXIT_FAILURE;
+		}
+		transport.pfnCommand = (0 == strncmp(argv[1], PERF_USBFS_PREFIX,
+				strlen(PERF_USBFS_PREFIX))) ? (perf_usbCommand) : (perf_sgCommand);
+		transport.pContext = &iFd;
+	}
+
+	if ((0 == strcmp(argv[2], "counters")) && (argc <= 4))
+	{
+		iResult = perf_counters(&transport,
+				(4 == argc) && (0 == strcmp(argv[3], "--clear")));
+	}
+	else if ((0 == strcmp(argv[2], "bench")) && (6 == argc)
+			&& ((0 == strcmp(argv[3], "read")) || (0 == strcmp(argv[3], "rewrite"))))
+	{
+		iResult = perf_bench(&transport,
+				(0 == strcmp(argv[3], "read")) ?
+						(USBD_PERF_BENCH_READ) : (USBD_PERF_BENCH_REWRITE),
+				(uint32_t) strtoul(argv[4], NULL, 0),
+				(uint32_t) strtoul(argv[5], NULL, 0));
+	}
+	else
+	{
+		perf_usage();
+	}
+
+	if (iFd >= 0)
+	{
+		close(iFd);
+	}
+	return iResult;
+}
+
+/********************** (TM) PnL - Programming and Leverage ****END OF FILE****/